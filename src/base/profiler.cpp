@@ -0,0 +1,151 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+
+namespace rigel { namespace base { namespace profiler {
+
+namespace {
+
+struct ThreadRegistry {
+  std::mutex mMutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> mBuffers;
+};
+
+
+// Buffers are never destroyed, so that the zones recorded by a thread
+// remain available for export after it has finished.
+ThreadRegistry& registry() {
+  static auto pRegistry = new ThreadRegistry;
+  return *pRegistry;
+}
+
+
+ThreadBuffer* registerCurrentThread() {
+  auto& threads = registry();
+  std::lock_guard<std::mutex> lock(threads.mMutex);
+
+  const auto threadId = static_cast<std::uint32_t>(threads.mBuffers.size());
+  threads.mBuffers.push_back(std::make_unique<ThreadBuffer>(threadId));
+  return threads.mBuffers.back().get();
+}
+
+
+void writeJsonString(std::ostream& stream, const char* pText) {
+  stream << '"';
+  for (auto pChar = pText; *pChar; ++pChar) {
+    if (*pChar == '"' || *pChar == '\\') {
+      stream << '\\';
+    }
+    stream << *pChar;
+  }
+  stream << '"';
+}
+
+}
+
+
+ThreadBuffer::ThreadBuffer(const std::uint32_t threadId)
+  : mThreadId(threadId)
+{
+}
+
+
+std::uint64_t ThreadBuffer::read(
+  const std::uint64_t fromPosition,
+  std::vector<ZoneRecord>& output
+) const {
+  const auto endPosition = mWritePosition;
+  const auto oldestAvailable =
+    endPosition > CAPACITY ? endPosition - CAPACITY : 0;
+  const auto startPosition = std::max(fromPosition, oldestAvailable);
+
+  for (auto position = startPosition; position < endPosition; ++position) {
+    output.push_back(mRecords[position % CAPACITY]);
+  }
+
+  return endPosition;
+}
+
+
+ThreadBuffer& threadBuffer() {
+  thread_local const auto pBuffer = registerCurrentThread();
+  return *pBuffer;
+}
+
+
+void writeChromeTrace(std::ostream& stream) {
+  struct ThreadRecords {
+    std::uint32_t mThreadId;
+    std::vector<ZoneRecord> mRecords;
+  };
+
+  std::vector<ThreadRecords> recordsByThread;
+  {
+    auto& threads = registry();
+    std::lock_guard<std::mutex> lock(threads.mMutex);
+
+    for (const auto& pBuffer : threads.mBuffers) {
+      recordsByThread.push_back({pBuffer->threadId(), {}});
+      pBuffer->read(0, recordsByThread.back().mRecords);
+    }
+  }
+
+  auto startOfTrace = std::numeric_limits<std::int64_t>::max();
+  for (const auto& thread : recordsByThread) {
+    for (const auto& record : thread.mRecords) {
+      startOfTrace = std::min(startOfTrace, record.mStartNs);
+    }
+  }
+
+  // Chrome expects timestamps in microseconds
+  const auto toMicroseconds = [](const std::int64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / 1000.0;
+  };
+
+  stream << std::fixed << std::setprecision(3);
+  stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+  auto isFirstEvent = true;
+  for (const auto& thread : recordsByThread) {
+    for (const auto& record : thread.mRecords) {
+      if (!isFirstEvent) {
+        stream << ',';
+      }
+      isFirstEvent = false;
+
+      stream << "\n{\"name\":";
+      writeJsonString(stream, record.mpName);
+      stream
+        << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread.mThreadId
+        << ",\"ts\":" << toMicroseconds(record.mStartNs - startOfTrace)
+        << ",\"dur\":" << toMicroseconds(record.mEndNs - record.mStartNs)
+        << '}';
+    }
+  }
+
+  stream << "\n]}\n";
+}
+
+}}}
@@ -0,0 +1,161 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+
+/* Scoped timing zones for finding out where frame time goes
+ *
+ * Put RIGEL_PROFILE_ZONE("Name") at the start of a scope to record how long
+ * it takes to execute. Zones can be nested. Each thread records into its own
+ * ring buffer without taking any locks, so zones are cheap enough to be
+ * placed around every system update. The name must be a string literal (or
+ * otherwise outlive the profiler), since only the pointer is stored.
+ *
+ * Unless RIGEL_ENABLE_PROFILER is defined, the macro expands to nothing, so
+ * zones can be compiled out entirely.
+ */
+
+#if defined(RIGEL_ENABLE_PROFILER)
+
+  #define RIGEL_PROFILE_ZONE_CONCAT_IMPL(a, b) a##b
+  #define RIGEL_PROFILE_ZONE_CONCAT(a, b) RIGEL_PROFILE_ZONE_CONCAT_IMPL(a, b)
+
+  #define RIGEL_PROFILE_ZONE(name) \
+    const ::rigel::base::profiler::ScopedZone \
+      RIGEL_PROFILE_ZONE_CONCAT(rigelProfileZone, __LINE__){name}
+
+#else
+
+  #define RIGEL_PROFILE_ZONE(name) static_cast<void>(0)
+
+#endif
+
+
+namespace rigel { namespace base { namespace profiler {
+
+/** A completed zone
+ *
+ * Times are in nanoseconds since an arbitrary fixed point. Depth 0 means
+ * that the zone wasn't nested in any other zone on the same thread.
+ */
+struct ZoneRecord {
+  const char* mpName;
+  std::int64_t mStartNs;
+  std::int64_t mEndNs;
+  std::uint32_t mDepth;
+};
+
+
+/** Fixed-size ring buffer holding the zones recorded by a single thread
+ *
+ * Only the owning thread writes to the buffer. Records are plain data, so
+ * reading is only safe on the owning thread, or from another thread once the
+ * owner has stopped recording and the reader has synchronized with it (e.g.
+ * by joining it). Once full, the oldest records are overwritten.
+ */
+class ThreadBuffer {
+public:
+  static constexpr std::size_t CAPACITY = 1 << 15;
+
+  explicit ThreadBuffer(std::uint32_t threadId);
+
+  void push(const ZoneRecord& record) noexcept {
+    mRecords[mWritePosition % CAPACITY] = record;
+    ++mWritePosition;
+  }
+
+  /** Append records written since the given position to the output
+   *
+   * Returns the position to pass in on the next call in order to get only
+   * new records. If more than CAPACITY records were written in between,
+   * the oldest ones are lost.
+   */
+  std::uint64_t read(
+    std::uint64_t fromPosition,
+    std::vector<ZoneRecord>& output) const;
+
+  std::uint32_t threadId() const {
+    return mThreadId;
+  }
+
+  // Nesting level of the next zone, only used by the owning thread
+  std::uint32_t mCurrentDepth = 0;
+
+private:
+  std::array<ZoneRecord, CAPACITY> mRecords;
+  std::uint64_t mWritePosition = 0;
+  std::uint32_t mThreadId;
+};
+
+
+/** Buffer for the calling thread, created on first use
+ *
+ * Creating the buffer allocates, so the first zone on each thread may throw
+ * std::bad_alloc.
+ */
+ThreadBuffer& threadBuffer();
+
+
+inline std::int64_t currentTimeNs() {
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(
+    steady_clock::now().time_since_epoch()).count();
+}
+
+
+class ScopedZone {
+public:
+  explicit ScopedZone(const char* pName)
+    : mpBuffer(&threadBuffer())
+    , mpName(pName)
+    , mDepth(mpBuffer->mCurrentDepth++)
+    , mStartNs(currentTimeNs())
+  {
+  }
+
+  ~ScopedZone() {
+    const auto endNs = currentTimeNs();
+    --mpBuffer->mCurrentDepth;
+    mpBuffer->push({mpName, mStartNs, endNs, mDepth});
+  }
+
+  ScopedZone(const ScopedZone&) = delete;
+  ScopedZone& operator=(const ScopedZone&) = delete;
+
+private:
+  ThreadBuffer* mpBuffer;
+  const char* mpName;
+  std::uint32_t mDepth;
+  std::int64_t mStartNs;
+};
+
+
+/** Write all currently buffered zones of all threads as Chrome trace JSON
+ *
+ * The output can be loaded into chrome://tracing or Perfetto. Must not be
+ * called while other threads are still recording zones, see ThreadBuffer.
+ */
+void writeChromeTrace(std::ostream& stream);
+
+}}}
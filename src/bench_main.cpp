@@ -0,0 +1,439 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Headless level benchmark
+ *
+ * Runs the game logic of a single level for a fixed number of ticks, without
+ * creating a window or opening an audio device, and reports how fast the
+ * simulation runs. Since the world's random number generator always starts
+ * in the same state and the player input is scripted, each run of the same
+ * level performs exactly the same work, which makes the numbers comparable
+ * between builds.
+ */
+
+#include "base/profiler.hpp"
+#include "base/warnings.hpp"
+#include "data/game_session_data.hpp"
+#include "data/player_model.hpp"
+#include "engine/renderer.hpp"
+#include "engine/texture_atlas.hpp"
+#include "engine/tile_renderer.hpp"
+#include "game_logic/game_world.hpp"
+#include "game_logic/input.hpp"
+#include "game_logic/world_state_hash.hpp"
+#include "loader/resource_loader.hpp"
+#include "ui/menu_element_renderer.hpp"
+
+#include "game_mode.hpp"
+#include "game_service_provider.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <boost/program_options.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+using namespace rigel;
+using namespace std;
+
+namespace po = boost::program_options;
+
+
+namespace {
+
+std::atomic<std::uint64_t> allocationCount{0};
+std::atomic<std::uint64_t> allocatedBytes{0};
+
+}
+
+
+// Replacing the global allocation functions lets us count all heap
+// allocations made during the simulation. The array forms and the nothrow
+// variants forward to these by default.
+void* operator new(const std::size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+  if (auto pMemory = std::malloc(size == 0 ? 1 : size)) {
+    return pMemory;
+  }
+
+  throw std::bad_alloc{};
+}
+
+
+void operator delete(void* pMemory) noexcept {
+  std::free(pMemory);
+}
+
+
+void operator delete(void* pMemory, std::size_t) noexcept {
+  std::free(pMemory);
+}
+
+
+namespace {
+
+constexpr auto DEFAULT_NUM_TICKS = 2000;
+
+
+/** Service provider which doesn't need a window or audio device */
+struct HeadlessServiceProvider : public IGameServiceProvider {
+  void fadeOutScreen() override {}
+  void fadeInScreen() override {}
+
+  void playSound(data::SoundId) override {
+    ++mSoundsTriggered;
+  }
+  void stopSound(data::SoundId) override {}
+  void setSoundsMuted(bool) override {}
+
+  void playMusic(const std::string&) override {}
+  void stopMusic() override {}
+  void scheduleNewGameStart(int, data::Difficulty) override {}
+  void scheduleStartFromSavedGame(const data::SavedGame&) override {}
+  void scheduleEnterMainMenu() override {}
+  void scheduleGameQuit() override {}
+  bool isShareWareVersion() const override { return false; }
+
+  void showDebugText(const std::string&) override {}
+
+  int mSoundsTriggered = 0;
+};
+
+
+/** Input used when no other input is given
+ *
+ * Alternates between walking right and left every 64 ticks, jumping during
+ * every other stretch, and keeps firing. This moves the player through a
+ * good part of the level and regularly spawns projectiles and explosions.
+ */
+game_logic::PlayerInput scriptedInput(const int tick) {
+  game_logic::PlayerInput input;
+
+  const auto stretch = (tick / 64) % 4;
+  input.mRight = stretch < 2;
+  input.mLeft = !input.mRight;
+
+  const auto isJumpingStretch = stretch % 2 == 1;
+  input.mJump.mIsPressed = isJumpingStretch && tick % 16 < 8;
+  input.mJump.mWasTriggered = isJumpingStretch && tick % 16 == 0;
+
+  input.mFire.mIsPressed = tick % 4 == 0;
+  input.mFire.mWasTriggered = input.mFire.mIsPressed;
+
+  return input;
+}
+
+
+/** Accumulates time spent in each profiler zone over the whole run */
+class ZoneStatistics {
+public:
+  void skipExistingRecords() {
+    mRecords.clear();
+    mReadPosition =
+      base::profiler::threadBuffer().read(mReadPosition, mRecords);
+  }
+
+  // Needs to be called at least once per tick, so that the profiler's ring
+  // buffer doesn't overflow
+  void consumeNewRecords() {
+    mRecords.clear();
+    mReadPosition =
+      base::profiler::threadBuffer().read(mReadPosition, mRecords);
+
+    for (const auto& record : mRecords) {
+      const auto duration = record.mEndNs - record.mStartNs;
+      const auto iEntry = std::find_if(mTotals.begin(), mTotals.end(),
+        [&](const auto& entry) { return entry.first == record.mpName; });
+      if (iEntry != mTotals.end()) {
+        iEntry->second += duration;
+      } else {
+        mTotals.emplace_back(record.mpName, duration);
+      }
+    }
+  }
+
+  void print(std::ostream& stream, const int numTicks) const {
+    auto sortedTotals = mTotals;
+    std::sort(sortedTotals.begin(), sortedTotals.end(),
+      [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+
+    stream << "Time per tick by zone (including nested zones):\n";
+    for (const auto& [pName, totalNs] : sortedTotals) {
+      const auto averageUs =
+        static_cast<double>(totalNs) / numTicks / 1000.0;
+      stream
+        << "  " << std::left << std::setw(32) << pName << std::right
+        << std::fixed << std::setprecision(2) << std::setw(10) << averageUs
+        << " us\n";
+    }
+  }
+
+private:
+  std::uint64_t mReadPosition = 0;
+  std::vector<base::profiler::ZoneRecord> mRecords;
+  std::vector<std::pair<const char*, std::int64_t>> mTotals;
+};
+
+
+struct BenchmarkOptions {
+  std::string mGamePath;
+  data::GameSessionId mSessionId{0, 0, data::Difficulty::Medium};
+  int mNumTicks = DEFAULT_NUM_TICKS;
+  bool mIncludeRendering = false;
+  std::optional<double> mMinTicksPerSecond;
+  std::optional<std::string> mWorldStateHashFile;
+};
+
+
+std::pair<int, int> parseLevelName(const std::string& levelName) {
+  if (levelName.size() != 2) {
+    throw invalid_argument("Invalid level name");
+  }
+
+  const auto episode = static_cast<int>(levelName[0] - 'L');
+  const auto level = static_cast<int>(levelName[1] - '0') - 1;
+
+  if (episode < 0 || episode >= 4 || level < 0 || level >= 8) {
+    throw invalid_argument(string("Invalid level name: ") + levelName);
+  }
+
+  return {episode, level};
+}
+
+
+/** Runs the benchmark, returns true if it met the minimum speed (if any) */
+bool runBenchmark(const BenchmarkOptions& options) {
+  using namespace std::chrono;
+  using Clock = high_resolution_clock;
+
+  // Rendering on the CPU doesn't need a window or OpenGL context
+  engine::Renderer renderer(nullptr, engine::RenderBackend::Software);
+  loader::ResourceLoader resources(options.mGamePath);
+  engine::TextureAtlas uiTextureAtlas(&renderer);
+  engine::TileRenderer uiSpriteSheetRenderer(
+    uiTextureAtlas.insert(resources.loadTiledFullscreenImage("STATUS.MNI")),
+    &renderer);
+  ui::MenuElementRenderer textRenderer(
+    &uiSpriteSheetRenderer, &renderer, &uiTextureAtlas, resources);
+  HeadlessServiceProvider serviceProvider;
+
+  // The world doesn't use the script runner, scripts, or user profile
+  const auto context = GameMode::Context{
+    &resources,
+    &renderer,
+    &serviceProvider,
+    nullptr,
+    nullptr,
+    &textRenderer,
+    &uiSpriteSheetRenderer,
+    nullptr};
+
+  data::PlayerModel playerModel;
+
+  const auto beforeLoad = Clock::now();
+  game_logic::GameWorld world(&playerModel, options.mSessionId, context);
+  const auto loadTime = duration<double>(Clock::now() - beforeLoad).count();
+
+  std::optional<std::ofstream> worldStateHashStream;
+  if (options.mWorldStateHashFile) {
+    worldStateHashStream.emplace(*options.mWorldStateHashFile);
+    if (!*worldStateHashStream) {
+      throw runtime_error(
+        "Cannot open file for writing: " + *options.mWorldStateHashFile);
+    }
+  }
+
+  ZoneStatistics zoneStatistics;
+  zoneStatistics.skipExistingRecords();
+
+  auto peakEntityCount = world.numEntities();
+  auto ticksRun = 0;
+
+  const auto allocationsBefore = allocationCount.load();
+  const auto bytesBefore = allocatedBytes.load();
+  const auto beforeSimulation = Clock::now();
+
+  for (; ticksRun < options.mNumTicks; ++ticksRun) {
+    world.updateGameLogic(scriptedInput(ticksRun));
+    if (worldStateHashStream) {
+      game_logic::writeWorldStateHash(
+        *worldStateHashStream, ticksRun, world.stateHash());
+    }
+
+    if (options.mIncludeRendering) {
+      world.render();
+      renderer.swapBuffers();
+    }
+
+    peakEntityCount = std::max(peakEntityCount, world.numEntities());
+    zoneStatistics.consumeNewRecords();
+
+    if (world.levelFinished()) {
+      ++ticksRun;
+      break;
+    }
+  }
+
+  const auto simulationTime =
+    duration<double>(Clock::now() - beforeSimulation).count();
+  const auto allocations = allocationCount.load() - allocationsBefore;
+  const auto bytes = allocatedBytes.load() - bytesBefore;
+  const auto ticksPerSecond = ticksRun / simulationTime;
+
+  cout
+    << std::fixed << std::setprecision(2)
+    << "Level: L" << options.mSessionId.mEpisode + 1
+    << options.mSessionId.mLevel + 1
+    << (options.mIncludeRendering ? " (logic and rendering)" : " (logic only)")
+    << '\n'
+    << "Level load time: " << loadTime * 1000.0 << " ms\n"
+    << "Ticks run: " << ticksRun
+    << (world.levelFinished() ? " (level finished)" : "") << '\n'
+    << "Simulation time: " << simulationTime * 1000.0 << " ms\n"
+    << "Ticks per second: " << ticksPerSecond << '\n'
+    << "Peak entity count: " << peakEntityCount << '\n'
+    << "Allocations: " << allocations << " ("
+    << static_cast<double>(allocations) / ticksRun << " per tick), "
+    << static_cast<double>(bytes) / 1024.0 << " KiB\n"
+    << "Sounds triggered: " << serviceProvider.mSoundsTriggered << '\n'
+    << '\n';
+
+#if defined(RIGEL_ENABLE_PROFILER)
+  zoneStatistics.print(cout, ticksRun);
+#else
+  cout << "Per-zone timing not available, profiler is disabled\n";
+#endif
+
+  const auto& minTicksPerSecond = options.mMinTicksPerSecond;
+  if (minTicksPerSecond && ticksPerSecond < *minTicksPerSecond) {
+    cerr
+      << "FAILED: Expected at least " << *minTicksPerSecond
+      << " ticks per second\n";
+    return false;
+  }
+
+  return true;
+}
+
+}
+
+
+int main(int argc, char** argv) {
+  BenchmarkOptions benchmarkOptions;
+  std::string levelName = "L1";
+  double minTicksPerSecond = 0.0;
+
+  po::options_description optionsDescription("Options");
+  optionsDescription.add_options()
+    ("help,h", "Show command line help message")
+    ("level,l",
+     po::value<string>(&levelName),
+     "Level to run, e.g. L1 for the first level of the first episode")
+    ("ticks,t",
+     po::value<int>(&benchmarkOptions.mNumTicks),
+     "Number of game logic ticks to run")
+    ("render",
+     po::bool_switch(&benchmarkOptions.mIncludeRendering),
+     "Also render each tick using the software renderer")
+    ("min-ticks-per-second",
+     po::value<double>(&minTicksPerSecond),
+     "Exit with an error if the simulation runs slower than this")
+    ("world-hashes",
+     po::value<string>(),
+     "Write a hash of the world state after each tick into the given file, "
+     "for comparing simulation results between builds using the game's "
+     "'compare-world-hashes' option. Hashing is included in the timings.")
+    ("game-path",
+     po::value<string>(&benchmarkOptions.mGamePath),
+     "Path to original game's installation. Can also be given as positional "
+     "argument.");
+
+  po::positional_options_description positionalArgsDescription;
+  positionalArgsDescription.add("game-path", -1);
+
+  try
+  {
+    po::variables_map options;
+    po::store(
+      po::command_line_parser(argc, argv)
+        .options(optionsDescription)
+        .positional(positionalArgsDescription)
+        .run(),
+      options);
+    po::notify(options);
+
+    if (options.count("help")) {
+      cout << optionsDescription << '\n';
+      return 0;
+    }
+
+    const auto [episode, level] = parseLevelName(levelName);
+    benchmarkOptions.mSessionId =
+      data::GameSessionId{episode, level, data::Difficulty::Medium};
+
+    if (benchmarkOptions.mNumTicks <= 0) {
+      throw invalid_argument("Number of ticks must be positive");
+    }
+
+    if (options.count("min-ticks-per-second")) {
+      benchmarkOptions.mMinTicksPerSecond = minTicksPerSecond;
+    }
+
+    if (options.count("world-hashes")) {
+      benchmarkOptions.mWorldStateHashFile =
+        options["world-hashes"].as<string>();
+    }
+
+    auto& gamePath = benchmarkOptions.mGamePath;
+    if (!gamePath.empty() && gamePath.back() != '/') {
+      gamePath += "/";
+    }
+
+    return runBenchmark(benchmarkOptions) ? 0 : 1;
+  }
+  catch (const po::error& err)
+  {
+    cerr << "ERROR: " << err.what() << "\n\n";
+    cerr << optionsDescription << '\n';
+    return -1;
+  }
+  catch (const std::exception& ex)
+  {
+    cerr << "ERROR: " << ex.what() << '\n';
+    return -2;
+  }
+  catch (...)
+  {
+    cerr << "UNKNOWN ERROR\n";
+    return -3;
+  }
+}
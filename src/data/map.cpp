@@ -23,11 +23,69 @@
 #include <stdexcept>
 #include <utility>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+  #define RIGEL_USE_SSE2
+  #include <emmintrin.h>
+#endif
+
 
 namespace rigel { namespace data { namespace map {
 
 using namespace std;
 
+namespace {
+
+// Once the change log exceeds this size, the older half of it is discarded
+const auto MAX_CHANGE_LOG_SIZE = 4096u;
+
+
+// Collision flags used for the padding columns left and right of the map
+const auto SOLID_EDGE_FLAGS = std::uint8_t{0xFF};
+
+
+std::uint64_t nextRevision() {
+  static std::uint64_t revisionCounter = 0;
+  return ++revisionCounter;
+}
+
+
+// Returns true if any of the given bytes has a bit from mask set. Instead of
+// testing each byte individually, all bytes are OR-ed together and the result
+// is tested once at the end.
+bool anyFlagSet(
+  const std::uint8_t* pFlags,
+  const int count,
+  const std::uint8_t mask
+) {
+  auto combinedFlags = std::uint8_t{0};
+  auto i = 0;
+
+#ifdef RIGEL_USE_SSE2
+  if (count >= 16) {
+    auto combined = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+      combined = _mm_or_si128(
+        combined,
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pFlags + i)));
+    }
+
+    combined = _mm_or_si128(combined, _mm_srli_si128(combined, 8));
+    combined = _mm_or_si128(combined, _mm_srli_si128(combined, 4));
+    combined = _mm_or_si128(combined, _mm_srli_si128(combined, 2));
+    combined = _mm_or_si128(combined, _mm_srli_si128(combined, 1));
+    combinedFlags = static_cast<std::uint8_t>(_mm_cvtsi128_si32(combined));
+  }
+#endif
+
+  for (; i < count; ++i) {
+    combinedFlags |= pFlags[i];
+  }
+
+  return (combinedFlags & mask) != 0;
+}
+
+}
+
 
 Map::Map(
   const int widthInTiles,
@@ -37,12 +95,34 @@ Map::Map(
   : mLayers({
       TileArray(widthInTiles*heightInTiles, 0),
       TileArray(widthInTiles*heightInTiles, 0)})
+  , mCollisionGridRowMajor((widthInTiles + 2) * (heightInTiles + 2), 0)
+  , mCollisionGridColumnMajor((widthInTiles + 2) * (heightInTiles + 2), 0)
   , mWidthInTiles(static_cast<size_t>(widthInTiles))
   , mHeightInTiles(static_cast<size_t>(heightInTiles))
   , mAttributes(std::move(attributes))
 {
   assert(widthInTiles >= 0);
   assert(heightInTiles >= 0);
+
+  for (auto y = -1; y <= heightInTiles; ++y) {
+    for (auto x : {-1, widthInTiles}) {
+      mCollisionGridRowMajor[rowMajorGridIndex(x, y)] = SOLID_EDGE_FLAGS;
+      mCollisionGridColumnMajor[columnMajorGridIndex(x, y)] =
+        SOLID_EDGE_FLAGS;
+    }
+  }
+
+  for (auto y = 0; y < heightInTiles; ++y) {
+    for (auto x = 0; x < widthInTiles; ++x) {
+      updateCollisionGrid(x, y);
+    }
+  }
+}
+
+
+Map::Map()
+  : Map(0, 0, TileAttributeDict{})
+{
 }
 
 
@@ -65,6 +145,8 @@ void Map::setTileAt(
     throw invalid_argument("Tile index too large for tile set");
   }
   tileRefAt(layer, x, y) = index;
+  updateCollisionGrid(x, y);
+  recordChange(x, y);
 }
 
 
@@ -76,8 +158,10 @@ void Map::clearSection(
 ) {
   for (auto row = y; row < y+height; ++row) {
     for (auto col = x; col < x + width; ++col) {
-      setTileAt(0, col, row, 0);
-      setTileAt(1, col, row, 0);
+      tileRefAt(0, col, row) = 0;
+      tileRefAt(1, col, row) = 0;
+      updateCollisionGrid(col, row);
+      recordChange(col, row);
     }
   }
 }
@@ -112,25 +196,52 @@ TileAttributes Map::attributes(const int x, const int y) const {
 
 
 CollisionData Map::collisionData(const int x, const int y) const {
-  if (static_cast<std::size_t>(x) >= mWidthInTiles) {
-    // Left/right edge of the map are always solid
-    return CollisionData::fullySolid();
-  }
+  // Coordinates outside of the map are clamped into the padding area, which
+  // holds the collision data for the map's edges
+  const auto gridX = std::clamp(x, -1, width());
+  const auto gridY = std::clamp(y, -1, height());
+  return CollisionData{
+    mCollisionGridRowMajor[rowMajorGridIndex(gridX, gridY)]};
+}
+
 
-  if (static_cast<std::size_t>(y) >= mHeightInTiles) {
-    // Bottom/top edge of the map are never solid
-    return CollisionData{};
+bool Map::hasSolidEdgeInRow(
+  const int y,
+  const int startX,
+  const int endX,
+  const SolidEdge edge
+) const {
+  if (startX > endX) {
+    return false;
   }
 
-  if (tileAt(0, x, y) != 0 && tileAt(1, x, y) != 0) {
-    // "Composite" tiles (content on both layers) are ignored for collision
-    // checking
-    return CollisionData{};
+  const auto gridY = std::clamp(y, -1, height());
+  const auto firstX = std::clamp(startX, -1, width());
+  const auto lastX = std::clamp(endX, -1, width());
+  return anyFlagSet(
+    &mCollisionGridRowMajor[rowMajorGridIndex(firstX, gridY)],
+    lastX - firstX + 1,
+    edge.mFlagsBitPack);
+}
+
+
+bool Map::hasSolidEdgeInColumn(
+  const int x,
+  const int startY,
+  const int endY,
+  const SolidEdge edge
+) const {
+  if (startY > endY) {
+    return false;
   }
 
-  const auto data1 = mAttributes.collisionData(tileAt(0, x, y));
-  const auto data2 = mAttributes.collisionData(tileAt(1, x, y));
-  return CollisionData{data1, data2};
+  const auto gridX = std::clamp(x, -1, width());
+  const auto firstY = std::clamp(startY, -1, height());
+  const auto lastY = std::clamp(endY, -1, height());
+  return anyFlagSet(
+    &mCollisionGridColumnMajor[columnMajorGridIndex(gridX, firstY)],
+    lastY - firstY + 1,
+    edge.mFlagsBitPack);
 }
 
 
@@ -166,4 +277,77 @@ map::TileIndex& Map::tileRefAt(
 }
 
 
+void Map::updateCollisionGrid(const int x, const int y) {
+  const auto tile1 = tileRefAt(0, x, y);
+  const auto tile2 = tileRefAt(1, x, y);
+
+  auto flags = std::uint8_t{0};
+
+  // "Composite" tiles (content on both layers) are ignored for collision
+  // checking
+  if (tile1 == 0 || tile2 == 0) {
+    flags = static_cast<std::uint8_t>(
+      mAttributes.collisionData(tile1).mCollisionFlagsBitPack |
+      mAttributes.collisionData(tile2).mCollisionFlagsBitPack);
+  }
+
+  mCollisionGridRowMajor[rowMajorGridIndex(x, y)] = flags;
+  mCollisionGridColumnMajor[columnMajorGridIndex(x, y)] = flags;
+}
+
+
+std::size_t Map::rowMajorGridIndex(const int x, const int y) const {
+  return
+    static_cast<size_t>(x + 1) +
+    static_cast<size_t>(y + 1) * (mWidthInTiles + 2);
+}
+
+
+std::size_t Map::columnMajorGridIndex(const int x, const int y) const {
+  return
+    static_cast<size_t>(y + 1) +
+    static_cast<size_t>(x + 1) * (mHeightInTiles + 2);
+}
+
+
+void Map::recordChange(const int x, const int y) {
+  auto& changeLog = mHistory.mChangeLog;
+  if (changeLog.size() >= MAX_CHANGE_LOG_SIZE) {
+    const auto firstKept = changeLog.begin() + MAX_CHANGE_LOG_SIZE / 2;
+
+    // Changes made at the revision right before the first kept entry can't
+    // be reported anymore
+    mHistory.mOldestLoggedRevision = prev(firstKept)->mRevision;
+    changeLog.erase(changeLog.begin(), firstKept);
+  }
+
+  mHistory.mRevision = nextRevision();
+  changeLog.push_back(TileChange{mHistory.mRevision, x, y});
+}
+
+
+Map::ChangeHistory::ChangeHistory() {
+  restart();
+}
+
+
+Map::ChangeHistory::ChangeHistory(const ChangeHistory&)
+  : ChangeHistory()
+{
+}
+
+
+Map::ChangeHistory& Map::ChangeHistory::operator=(const ChangeHistory&) {
+  restart();
+  return *this;
+}
+
+
+void Map::ChangeHistory::restart() {
+  mChangeLog.clear();
+  mRevision = nextRevision();
+  mOldestLoggedRevision = mRevision;
+}
+
+
 }}}
@@ -21,6 +21,8 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <optional>
 #include <string>
 #include <vector>
@@ -51,7 +53,7 @@ enum class BackdropSwitchCondition {
 
 class Map {
 public:
-  Map() = default;
+  Map();
   Map(int widthInTiles, int heightInTiles, TileAttributeDict attributes);
 
   TileIndex tileAt(int layer, int x, int y) const;
@@ -73,16 +75,98 @@ public:
 
   CollisionData collisionData(int x, int y) const;
 
+  /** Test if any tile in row y between startX and endX (inclusive) is solid
+   * on the given edge
+   *
+   * Coordinates outside of the map follow the same rules as collisionData():
+   * The left/right edges are solid, the top/bottom edges are not.
+   */
+  bool hasSolidEdgeInRow(
+    int y,
+    int startX,
+    int endX,
+    SolidEdge edge) const;
+
+  /** Test if any tile in column x between startY and endY (inclusive) is
+   * solid on the given edge
+   *
+   * See hasSolidEdgeInRow().
+   */
+  bool hasSolidEdgeInColumn(
+    int x,
+    int startY,
+    int endY,
+    SolidEdge edge) const;
+
+  /** Returns a number identifying the current state of the map's tiles
+   *
+   * The revision changes with every modification. Revision numbers are
+   * unique across all Map instances. Constructing, copying or assigning a
+   * map starts a new change history with a fresh revision, so replacing a
+   * map with another one (like when restarting a level) can always be told
+   * apart from modifications made to it.
+   */
+  std::uint64_t revision() const {
+    return mHistory.mRevision;
+  }
+
+  /** Invoke callback(x, y) for each tile position modified after the given
+   * revision
+   *
+   * Positions might be reported multiple times. Returns false without
+   * invoking the callback if the change history doesn't go back far enough,
+   * or if the given revision predates the map's current history (i.e. the
+   * map has been assigned to since). In that case, the client needs to
+   * assume that all tiles have changed.
+   */
+  template <typename Callback>
+  bool forEachChangeSince(std::uint64_t revision, Callback&& callback) const;
+
 private:
   const TileIndex& tileRefAt(int layer, int x, int y) const;
   TileIndex& tileRefAt(int layer, int x, int y);
 
+  void recordChange(int x, int y);
+  void updateCollisionGrid(int x, int y);
+
+  std::size_t rowMajorGridIndex(int x, int y) const;
+  std::size_t columnMajorGridIndex(int x, int y) const;
+
 private:
+  struct TileChange {
+    std::uint64_t mRevision;
+    int mX;
+    int mY;
+  };
+
   using TileArray = std::vector<TileIndex>;
   std::array<TileArray, 2> mLayers;
 
-  std::size_t mWidthInTiles;
-  std::size_t mHeightInTiles;
+  // Combined collision flags for each tile, surrounded by one tile of
+  // padding on each side which encodes the behavior of the map's edges.
+  // The column-major copy keeps vertical span tests contiguous in memory.
+  std::vector<std::uint8_t> mCollisionGridRowMajor;
+  std::vector<std::uint8_t> mCollisionGridColumnMajor;
+
+  // Copying or moving a history doesn't carry over its contents, but starts
+  // a new one instead. Revisions from before are thus never mistaken for
+  // being part of the new history.
+  struct ChangeHistory {
+    ChangeHistory();
+    ChangeHistory(const ChangeHistory&);
+    ChangeHistory& operator=(const ChangeHistory&);
+
+    void restart();
+
+    std::deque<TileChange> mChangeLog;
+    std::uint64_t mRevision;
+    std::uint64_t mOldestLoggedRevision;
+  };
+
+  ChangeHistory mHistory;
+
+  std::size_t mWidthInTiles = 0;
+  std::size_t mHeightInTiles = 0;
 
   TileAttributeDict mAttributes;
 };
@@ -111,4 +195,29 @@ struct LevelData {
 
 using ActorDescriptionList = std::vector<LevelData::Actor>;
 
+
+template <typename Callback>
+bool Map::forEachChangeSince(
+  const std::uint64_t revision,
+  Callback&& callback
+) const {
+  if (
+    revision > mHistory.mRevision ||
+    revision < mHistory.mOldestLoggedRevision
+  ) {
+    return false;
+  }
+
+  const auto& changeLog = mHistory.mChangeLog;
+  for (auto it = changeLog.rbegin(); it != changeLog.rend(); ++it) {
+    if (it->mRevision <= revision) {
+      break;
+    }
+
+    callback(it->mX, it->mY);
+  }
+
+  return true;
+}
+
 }}}
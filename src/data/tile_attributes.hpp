@@ -27,6 +27,9 @@ namespace rigel::data::map {
 using TileIndex = std::uint32_t;
 
 
+class Map;
+
+
 class SolidEdge {
 public:
   static SolidEdge top();
@@ -35,6 +38,7 @@ public:
   static SolidEdge right();
 
   friend class CollisionData;
+  friend class Map;
 
 private:
   explicit SolidEdge(const std::uint8_t bitPack)
@@ -58,6 +62,8 @@ public:
     return (mCollisionFlagsBitPack & edge.mFlagsBitPack) != 0;
   }
 
+  friend class Map;
+
 private:
   std::uint8_t mCollisionFlagsBitPack = 0;
 };
@@ -41,6 +41,8 @@ CollisionChecker::CollisionChecker(
 
   eventManager.subscribe<ex::ComponentAddedEvent<SolidBody>>(*this);
   eventManager.subscribe<ex::ComponentRemovedEvent<SolidBody>>(*this);
+  eventManager.subscribe<events::PrefabInstanceRecycled>(*this);
+  eventManager.subscribe<events::PrefabInstancesParked>(*this);
 }
 
 
@@ -92,15 +94,7 @@ bool CollisionChecker::testHorizontalSpan(
     return true;
   }
 
-  const auto startX = bbox.left();
-  const auto endX = bbox.right();
-  for (int x = startX; x <= endX; ++x) {
-    if (mpMap->collisionData(x, y).isSolidOn(edge)) {
-      return true;
-    }
-  }
-
-  return false;
+  return mpMap->hasSolidEdgeInRow(y, bbox.left(), bbox.right(), edge);
 }
 
 
@@ -116,15 +110,7 @@ bool CollisionChecker::testVerticalSpan(
     return true;
   }
 
-  const auto startY = bbox.top();
-  const auto endY = bbox.bottom();
-  for (int y = startY; y <= endY; ++y) {
-    if (mpMap->collisionData(x, y).isSolidOn(edge)) {
-      return true;
-    }
-  }
-
-  return false;
+  return mpMap->hasSolidEdgeInColumn(x, bbox.top(), bbox.bottom(), edge);
 }
 
 
@@ -148,6 +134,148 @@ bool CollisionChecker::testSolidBodyCollision(
 }
 
 
+int CollisionChecker::sweepHorizontally(
+  const BoundingBox& bbox,
+  const int firstX,
+  const int direction,
+  const int maxDistance,
+  const SolidEdge edge
+) const {
+  auto distance = maxDistance;
+
+  // The column tested after moving i units is firstX + direction * i. A solid
+  // body blocks movement starting at the first step where this column
+  // overlaps it.
+  if (bbox.size.height > 0) {
+    for (const auto& entity : mSolidBodies) {
+      if (
+        !entity.has_component<BoundingBox>() ||
+        !entity.has_component<WorldPosition>()
+      ) {
+        continue;
+      }
+
+      const auto body = engine::toWorldSpace(
+        *entity.component<const BoundingBox>(),
+        *entity.component<const WorldPosition>());
+      if (
+        body.size.width <= 0 || body.size.height <= 0 ||
+        body.top() > bbox.bottom() || body.bottom() < bbox.top()
+      ) {
+        continue;
+      }
+
+      const auto nearX = direction > 0 ? body.left() : body.right();
+      const auto farX = direction > 0 ? body.right() : body.left();
+      if ((farX - firstX) * direction < 0) {
+        continue;
+      }
+
+      distance = std::min(distance, std::max(0, (nearX - firstX) * direction));
+    }
+  }
+
+  for (int i = 0; i < distance; ++i) {
+    const auto x = firstX + direction * i;
+    if (mpMap->hasSolidEdgeInColumn(x, bbox.top(), bbox.bottom(), edge)) {
+      return i;
+    }
+  }
+
+  return distance;
+}
+
+
+int CollisionChecker::sweepVertically(
+  const BoundingBox& bbox,
+  const int firstY,
+  const int direction,
+  const int maxDistance,
+  const SolidEdge edge
+) const {
+  auto distance = maxDistance;
+
+  // See sweepHorizontally()
+  if (bbox.size.width > 0) {
+    for (const auto& entity : mSolidBodies) {
+      if (
+        !entity.has_component<BoundingBox>() ||
+        !entity.has_component<WorldPosition>()
+      ) {
+        continue;
+      }
+
+      const auto body = engine::toWorldSpace(
+        *entity.component<const BoundingBox>(),
+        *entity.component<const WorldPosition>());
+      if (
+        body.size.width <= 0 || body.size.height <= 0 ||
+        body.left() > bbox.right() || body.right() < bbox.left()
+      ) {
+        continue;
+      }
+
+      const auto nearY = direction > 0 ? body.top() : body.bottom();
+      const auto farY = direction > 0 ? body.bottom() : body.top();
+      if ((farY - firstY) * direction < 0) {
+        continue;
+      }
+
+      distance = std::min(distance, std::max(0, (nearY - firstY) * direction));
+    }
+  }
+
+  for (int i = 0; i < distance; ++i) {
+    const auto y = firstY + direction * i;
+    if (mpMap->hasSolidEdgeInRow(y, bbox.left(), bbox.right(), edge)) {
+      return i;
+    }
+  }
+
+  return distance;
+}
+
+
+int CollisionChecker::distanceToLeftWall(
+  const BoundingBox& worldSpaceBbox,
+  const int maxDistance
+) const {
+  const auto x = worldSpaceBbox.left() - 1;
+  return sweepHorizontally(
+    worldSpaceBbox, x, -1, maxDistance, SolidEdge::right());
+}
+
+
+int CollisionChecker::distanceToRightWall(
+  const BoundingBox& worldSpaceBbox,
+  const int maxDistance
+) const {
+  const auto x = worldSpaceBbox.right() + 1;
+  return sweepHorizontally(
+    worldSpaceBbox, x, 1, maxDistance, SolidEdge::left());
+}
+
+
+int CollisionChecker::distanceToCeiling(
+  const BoundingBox& worldSpaceBbox,
+  const int maxDistance
+) const {
+  const auto y = worldSpaceBbox.top() - 1;
+  return sweepVertically(
+    worldSpaceBbox, y, -1, maxDistance, SolidEdge::bottom());
+}
+
+
+int CollisionChecker::distanceToGround(
+  const BoundingBox& worldSpaceBbox,
+  const int maxDistance
+) const {
+  const auto y = worldSpaceBbox.bottom() + 1;
+  return sweepVertically(
+    worldSpaceBbox, y, 1, maxDistance, SolidEdge::top());
+}
+
+
 bool CollisionChecker::isTouchingCeiling(
   const BoundingBox& worldSpaceBbox
 ) const {
@@ -200,4 +328,27 @@ void CollisionChecker::receive(
   }
 }
 
+
+void CollisionChecker::receive(const events::PrefabInstanceRecycled& event) {
+  auto entity = event.mEntity;
+  if (!entity.has_component<SolidBody>()) {
+    return;
+  }
+
+  // See PhysicsSystem::receive(const events::PrefabInstanceRecycled&)
+  const auto alreadyRegistered =
+    !mSolidBodies.empty() && mSolidBodies.back() == entity;
+  if (!alreadyRegistered) {
+    mSolidBodies.push_back(entity);
+  }
+}
+
+
+void CollisionChecker::receive(const events::PrefabInstancesParked& event) {
+  mSolidBodies.erase(
+    remove_if(begin(mSolidBodies), end(mSolidBodies),
+      [&event](const auto& entity) { return event.contains(entity); }),
+    end(mSolidBodies));
+}
+
 }}
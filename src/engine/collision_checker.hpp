@@ -20,6 +20,7 @@
 #include "data/map.hpp"
 #include "engine/base_components.hpp"
 #include "engine/physical_components.hpp"
+#include "engine/prefab_pool.hpp"
 
 #include <vector>
 
@@ -58,10 +59,33 @@ public:
   bool isTouchingLeftWall(const engine::components::BoundingBox& bbox) const;
   bool isTouchingRightWall(const engine::components::BoundingBox& bbox) const;
 
+  /** Determine how far the given bounding box can move before colliding
+   *
+   * Returns the number of units (at most maxDistance) the bounding box can be
+   * moved towards the given direction until the corresponding isTouching...
+   * or isOnSolidGround test would return true. This gives the same result as
+   * moving one unit at a time and testing after each step, but examines
+   * each tile and solid body only once.
+   */
+  int distanceToLeftWall(
+    const engine::components::BoundingBox& bbox,
+    int maxDistance) const;
+  int distanceToRightWall(
+    const engine::components::BoundingBox& bbox,
+    int maxDistance) const;
+  int distanceToCeiling(
+    const engine::components::BoundingBox& bbox,
+    int maxDistance) const;
+  int distanceToGround(
+    const engine::components::BoundingBox& bbox,
+    int maxDistance) const;
+
   void receive(
     const entityx::ComponentAddedEvent<components::SolidBody>& event);
   void receive(
     const entityx::ComponentRemovedEvent<components::SolidBody>& event);
+  void receive(const events::PrefabInstanceRecycled& event);
+  void receive(const events::PrefabInstancesParked& event);
 
 private:
   bool testHorizontalSpan(
@@ -75,6 +99,19 @@ private:
   bool testSolidBodyCollision(
     const engine::components::BoundingBox& bbox) const;
 
+  int sweepHorizontally(
+    const engine::components::BoundingBox& bbox,
+    int firstX,
+    int direction,
+    int maxDistance,
+    data::map::SolidEdge edge) const;
+  int sweepVertically(
+    const engine::components::BoundingBox& bbox,
+    int firstY,
+    int direction,
+    int maxDistance,
+    data::map::SolidEdge edge) const;
+
   std::vector<entityx::Entity> mSolidBodies;
   const data::map::Map* mpMap;
 };
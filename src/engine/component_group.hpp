@@ -0,0 +1,452 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/warnings.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <entityx/entityx.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+
+namespace rigel { namespace engine {
+
+/** Dense list of all entities which have a certain set of components
+ *
+ * entityx's each() has to look at every entity slot to find the ones with
+ * the requested components, and goes through a ComponentHandle for each
+ * component access. For components which are accessed on every frame, this
+ * class instead keeps the matching entities in a packed array, along with
+ * one array of component pointers per component type. Membership is kept
+ * up to date via component added/removed events, and members are ordered
+ * by entity index, so iteration order is the same as with each().
+ *
+ * Membership changes are collected and applied as a batch before the next
+ * iteration. Removed members are only marked as such, and new members are
+ * merged in all at once. This keeps the cost of spawning or destroying
+ * many entities at once (e.g. when a wall section explodes into debris)
+ * linear in the size of the group.
+ *
+ * Changes during forEach() are safe, and behave the same as with each():
+ * Entities which lose one of the components are skipped from then on.
+ * Entities which gain all of them are still visited by the ongoing
+ * iteration if their index lies ahead of the current one and within the
+ * entity manager's capacity at the start of the iteration (e.g. because
+ * they were created in a previously freed slot). Otherwise, they are
+ * visited starting with the next call to forEach(). Nested calls to
+ * forEach() only visit the members as of the start of the outermost one.
+ */
+template <typename... Components>
+class ComponentGroup :
+  public entityx::Receiver<ComponentGroup<Components...>>
+{
+public:
+  ComponentGroup(
+    entityx::EntityManager& entities,
+    entityx::EventManager& eventManager);
+
+  ComponentGroup(const ComponentGroup&) = delete;
+  ComponentGroup& operator=(const ComponentGroup&) = delete;
+
+  /** Invoke callback(entity, components&...) for each member */
+  template <typename Callback>
+  void forEach(Callback&& callback);
+
+  /** Number of members. Applies pending membership changes. */
+  std::size_t size();
+
+  template <typename C>
+  void receive(const entityx::ComponentAddedEvent<C>& event);
+  template <typename C>
+  void receive(const entityx::ComponentRemovedEvent<C>& event);
+
+private:
+  using FirstComponent = std::tuple_element_t<0, std::tuple<Components...>>;
+
+  template <typename C>
+  std::vector<C*>& componentsOf() {
+    return std::get<std::vector<C*>>(mComponents);
+  }
+
+  static bool isOrderedBefore(
+    const entityx::Entity& lhs,
+    const entityx::Entity& rhs);
+
+  bool hasAllComponents(entityx::Entity entity) const;
+  bool isRemoved(std::size_t position) const;
+  std::size_t lowerBound(entityx::Entity entity) const;
+  bool isMember(entityx::Entity entity, std::size_t position) const;
+
+  void collectLateAdditions(
+    std::vector<entityx::Entity>& lateAdditions,
+    std::size_t firstUnvisited,
+    std::size_t& numPendingChecked,
+    std::size_t nextIndex,
+    std::size_t capacity);
+
+  void applyPendingChanges();
+  void compact();
+  void mergeAdditions();
+
+  entityx::EntityManager* mpEntities;
+  std::vector<entityx::Entity> mEntities;
+  std::tuple<std::vector<Components*>...> mComponents;
+
+  std::vector<entityx::Entity> mPendingAdditions;
+  std::size_t mNumRemoved = 0;
+  int mIterationDepth = 0;
+};
+
+
+template <typename... Components>
+ComponentGroup<Components...>::ComponentGroup(
+  entityx::EntityManager& entities,
+  entityx::EventManager& eventManager
+)
+  : mpEntities(&entities)
+{
+  entities.each<Components...>(
+    [this](entityx::Entity entity, Components&... components) {
+      mEntities.push_back(entity);
+      (componentsOf<Components>().push_back(&components), ...);
+    });
+
+  (eventManager.subscribe<entityx::ComponentAddedEvent<Components>>(*this),
+   ...);
+  (eventManager.subscribe<entityx::ComponentRemovedEvent<Components>>(*this),
+   ...);
+}
+
+
+template <typename... Components>
+template <typename Callback>
+void ComponentGroup<Components...>::forEach(Callback&& callback) {
+  const auto isOutermost = mIterationDepth == 0;
+  if (isOutermost) {
+    applyPendingChanges();
+  }
+
+  ++mIterationDepth;
+
+  // Entities added during iteration are only merged in afterwards, so the
+  // member arrays don't change within the loop. Additions which each()
+  // would still reach are collected into a separate sorted list instead,
+  // which is walked alongside the members.
+  std::vector<entityx::Entity> lateAdditions;
+  std::size_t numLateVisited = 0;
+  std::size_t numPendingChecked = 0;
+  const auto capacity = mpEntities->capacity();
+  const auto count = mEntities.size();
+
+  // Returns true if there are now late additions to visit
+  const auto collectAfter = [&](const entityx::Entity& visited) {
+    if (isOutermost && numPendingChecked < mPendingAdditions.size()) {
+      collectLateAdditions(
+        lateAdditions,
+        numLateVisited,
+        numPendingChecked,
+        visited.id().index() + std::size_t{1},
+        capacity);
+      return numLateVisited < lateAdditions.size();
+    }
+
+    return false;
+  };
+
+  std::size_t i = 0;
+  while (true) {
+    // Common case: Nothing to interleave with the members
+    if (numLateVisited == lateAdditions.size()) {
+      while (i < count) {
+        const auto position = i++;
+        if (isRemoved(position)) {
+          continue;
+        }
+
+        callback(
+          mEntities[position], *componentsOf<Components>()[position]...);
+        if (collectAfter(mEntities[position])) {
+          break;
+        }
+      }
+    }
+
+    if (numLateVisited == lateAdditions.size()) {
+      break;
+    }
+
+    auto entity = lateAdditions[numLateVisited];
+    if (i < count && mEntities[i].id().index() <= entity.id().index()) {
+      const auto position = i++;
+      if (!isRemoved(position)) {
+        callback(
+          mEntities[position], *componentsOf<Components>()[position]...);
+        collectAfter(mEntities[position]);
+      }
+
+      continue;
+    }
+
+    const auto isDuplicate = numLateVisited > 0 &&
+      lateAdditions[numLateVisited - 1] == entity;
+    ++numLateVisited;
+
+    if (
+      !isDuplicate &&
+      entity.valid() &&
+      hasAllComponents(entity) &&
+      !isMember(entity, lowerBound(entity))
+    ) {
+      callback(entity, *entity.component<Components>().get()...);
+      collectAfter(entity);
+    }
+  }
+
+  // Late additions still need to become members
+  mPendingAdditions.insert(
+    mPendingAdditions.end(), lateAdditions.begin(), lateAdditions.end());
+
+  --mIterationDepth;
+}
+
+
+template <typename... Components>
+std::size_t ComponentGroup<Components...>::size() {
+  if (mIterationDepth == 0) {
+    applyPendingChanges();
+  }
+
+  return mEntities.size() - mNumRemoved;
+}
+
+
+template <typename... Components>
+template <typename C>
+void ComponentGroup<Components...>::receive(
+  const entityx::ComponentAddedEvent<C>& event
+) {
+  // Whether the entity actually qualifies is checked when applying the
+  // change, since further components might be removed again until then.
+  mPendingAdditions.push_back(event.entity);
+}
+
+
+template <typename... Components>
+template <typename C>
+void ComponentGroup<Components...>::receive(
+  const entityx::ComponentRemovedEvent<C>& event
+) {
+  const auto position = lowerBound(event.entity);
+  if (!isMember(event.entity, position)) {
+    return;
+  }
+
+  // The event is emitted before the component is actually removed, but
+  // the pointers must not be used anymore afterwards. Clearing the first
+  // one marks the entry as removed, while keeping the entity handle in
+  // place so that the array stays sorted.
+  componentsOf<FirstComponent>()[position] = nullptr;
+  ++mNumRemoved;
+}
+
+
+template <typename... Components>
+bool ComponentGroup<Components...>::isOrderedBefore(
+  const entityx::Entity& lhs,
+  const entityx::Entity& rhs
+) {
+  const auto lhsId = lhs.id();
+  const auto rhsId = rhs.id();
+  return std::make_pair(lhsId.index(), lhsId.version()) <
+    std::make_pair(rhsId.index(), rhsId.version());
+}
+
+
+template <typename... Components>
+bool ComponentGroup<Components...>::hasAllComponents(
+  entityx::Entity entity
+) const {
+  return (entity.has_component<Components>() && ...);
+}
+
+
+template <typename... Components>
+bool ComponentGroup<Components...>::isRemoved(
+  const std::size_t position
+) const {
+  return std::get<std::vector<FirstComponent*>>(mComponents)[position] ==
+    nullptr;
+}
+
+
+template <typename... Components>
+std::size_t ComponentGroup<Components...>::lowerBound(
+  entityx::Entity entity
+) const {
+  const auto it = std::lower_bound(
+    mEntities.begin(),
+    mEntities.end(),
+    entity,
+    [](const entityx::Entity& lhs, const entityx::Entity& rhs) {
+      return lhs.id().index() < rhs.id().index();
+    });
+  return static_cast<std::size_t>(std::distance(mEntities.begin(), it));
+}
+
+
+template <typename... Components>
+bool ComponentGroup<Components...>::isMember(
+  entityx::Entity entity,
+  const std::size_t position
+) const {
+  return
+    position < mEntities.size() &&
+    mEntities[position] == entity &&
+    !isRemoved(position);
+}
+
+
+template <typename... Components>
+void ComponentGroup<Components...>::collectLateAdditions(
+  std::vector<entityx::Entity>& lateAdditions,
+  const std::size_t firstUnvisited,
+  std::size_t& numPendingChecked,
+  const std::size_t nextIndex,
+  const std::size_t capacity
+) {
+  // Since the iteration only moves forward, additions which don't qualify
+  // now never will during this iteration. They are kept at the front of the
+  // pending list, so that they are only checked once.
+  const auto firstUnchecked = mPendingAdditions.begin() + numPendingChecked;
+  const auto firstLate = std::partition(
+    firstUnchecked,
+    mPendingAdditions.end(),
+    [&](const entityx::Entity& entity) {
+      const auto index = std::size_t{entity.id().index()};
+      return index < nextIndex || index >= capacity;
+    });
+
+  const auto numPreviouslyCollected = lateAdditions.size();
+  lateAdditions.insert(
+    lateAdditions.end(), firstLate, mPendingAdditions.end());
+  mPendingAdditions.erase(firstLate, mPendingAdditions.end());
+  numPendingChecked = mPendingAdditions.size();
+
+  if (lateAdditions.size() > numPreviouslyCollected) {
+    std::sort(
+      lateAdditions.begin() + firstUnvisited,
+      lateAdditions.end(),
+      isOrderedBefore);
+  }
+}
+
+
+template <typename... Components>
+void ComponentGroup<Components...>::applyPendingChanges() {
+  if (mNumRemoved > 0) {
+    compact();
+  }
+
+  if (!mPendingAdditions.empty()) {
+    mergeAdditions();
+  }
+}
+
+
+template <typename... Components>
+void ComponentGroup<Components...>::compact() {
+  std::size_t target = 0;
+  for (std::size_t i = 0; i < mEntities.size(); ++i) {
+    if (isRemoved(i)) {
+      continue;
+    }
+
+    mEntities[target] = mEntities[i];
+    ((componentsOf<Components>()[target] = componentsOf<Components>()[i]),
+     ...);
+    ++target;
+  }
+
+  mEntities.resize(target);
+  (componentsOf<Components>().resize(target), ...);
+  mNumRemoved = 0;
+}
+
+
+template <typename... Components>
+void ComponentGroup<Components...>::mergeAdditions() {
+  auto& additions = mPendingAdditions;
+
+  const auto byIndex = [](
+    const entityx::Entity& lhs,
+    const entityx::Entity& rhs
+  ) {
+    return lhs.id().index() < rhs.id().index();
+  };
+
+  // The same entity is reported once per component it receives. Sorting by
+  // version as well places duplicates next to each other even if an index
+  // was re-used in the meantime.
+  std::sort(additions.begin(), additions.end(), isOrderedBefore);
+  additions.erase(
+    std::unique(additions.begin(), additions.end()),
+    additions.end());
+  additions.erase(
+    std::remove_if(additions.begin(), additions.end(),
+      [this](const entityx::Entity& entity) {
+        return
+          !entity.valid() ||
+          !hasAllComponents(entity) ||
+          isMember(entity, lowerBound(entity));
+      }),
+    additions.end());
+
+  // Merge from the back, so that each existing entry is moved at most once
+  auto read = mEntities.size();
+  auto write = read + additions.size();
+  auto numToInsert = additions.size();
+
+  mEntities.resize(write);
+  (componentsOf<Components>().resize(write), ...);
+
+  while (numToInsert > 0) {
+    --write;
+
+    auto entity = additions[numToInsert - 1];
+    if (read > 0 && byIndex(entity, mEntities[read - 1])) {
+      --read;
+      mEntities[write] = mEntities[read];
+      ((componentsOf<Components>()[write] = componentsOf<Components>()[read]),
+       ...);
+    } else {
+      --numToInsert;
+      mEntities[write] = entity;
+      ((componentsOf<Components>()[write] =
+        entity.component<Components>().get()), ...);
+    }
+  }
+
+  additions.clear();
+}
+
+}}
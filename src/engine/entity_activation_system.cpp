@@ -19,16 +19,59 @@
 #include "data/game_traits.hpp"
 #include "engine/base_components.hpp"
 #include "engine/entity_tools.hpp"
-#include "engine/physical_components.hpp"
+
+#include <algorithm>
+#include <cassert>
 
 
 namespace rigel { namespace engine {
 
+namespace ex = entityx;
+
 using namespace components;
 
 
 namespace {
 
+const auto REGION_SIZE = 16;
+
+// Regions within this distance of the active region are evaluated. Needs to
+// be at least REGION_SIZE, since entities are assigned to the region
+// containing their top-left corner.
+const auto ACTIVATION_MARGIN = REGION_SIZE;
+
+// Used for entities which are not yet assigned to a list
+const auto NO_LIST = -1;
+
+
+int regionCount(const int sizeInTiles) {
+  return std::max(1, (sizeInTiles + REGION_SIZE - 1) / REGION_SIZE);
+}
+
+
+// Rounds towards negative infinity, unlike regular integer division
+int toRegion(const int tileCoordinate) {
+  return tileCoordinate >= 0
+    ? tileCoordinate / REGION_SIZE
+    : (tileCoordinate - REGION_SIZE + 1) / REGION_SIZE;
+}
+
+
+bool isPermanentlyActive(ex::Entity entity) {
+  using Policy = ActivationSettings::Policy;
+
+  if (!entity.has_component<ActivationSettings>()) {
+    return false;
+  }
+
+  const auto& settings = *entity.component<const ActivationSettings>();
+  return
+    settings.mPolicy == Policy::Always ||
+    (settings.mPolicy == Policy::AlwaysAfterFirstActivation &&
+     settings.mHasBeenActivated);
+}
+
+
 bool determineActiveState(entityx::Entity entity, const bool inActiveRegion) {
   using Policy = ActivationSettings::Policy;
 
@@ -58,27 +101,273 @@ bool determineActiveState(entityx::Entity entity, const bool inActiveRegion) {
 }
 
 
-void markActiveEntities(
-  entityx::EntityManager& es,
-  const base::Vector& cameraPosition
-) {
-  const BoundingBox activeRegionBox{
+bool EntityActivationSystem::RegionRange::contains(
+  const int x,
+  const int y
+) const {
+  return x >= mFirstX && x <= mLastX && y >= mFirstY && y <= mLastY;
+}
+
+
+EntityActivationSystem::EntityActivationSystem(
+  const int mapWidthInTiles,
+  const int mapHeightInTiles,
+  ex::EntityManager& entities,
+  ex::EventManager& eventManager
+)
+  : mEntityLists(
+      regionCount(mapWidthInTiles) * regionCount(mapHeightInTiles) + 1)
+  , mPreviousRange{0, 0, -1, -1}
+  , mWidthInRegions(regionCount(mapWidthInTiles))
+  , mHeightInRegions(regionCount(mapHeightInTiles))
+{
+  // All existing entities are evaluated on the first update
+  entities.each<WorldPosition, BoundingBox>(
+    [this](ex::Entity entity, const WorldPosition&, const BoundingBox&) {
+      mPendingEntities.push_back(entity);
+    });
+
+  eventManager.subscribe<ex::ComponentAddedEvent<BoundingBox>>(*this);
+  eventManager.subscribe<ex::ComponentAddedEvent<WorldPosition>>(*this);
+  eventManager.subscribe<ex::ComponentAddedEvent<ActivationSettings>>(*this);
+  eventManager.subscribe<ex::EntityDestroyedEvent>(*this);
+}
+
+
+void EntityActivationSystem::update(const base::Vector& cameraPosition) {
+  mEntitiesEvaluated = 0;
+  mActiveRegion = base::Rect<int>{
     cameraPosition,
     data::GameTraits::mapViewPortSize};
 
-  es.each<WorldPosition, BoundingBox>([&activeRegionBox](
-    entityx::Entity entity,
-    const WorldPosition& position,
-    const BoundingBox& bbox
-  ) {
-    const auto worldSpaceBbox = toWorldSpace(bbox, position);
-    const auto inActiveRegion = worldSpaceBbox.intersects(activeRegionBox);
+  removeDestroyedEntities();
+  registerPendingEntities();
+
+  const auto alwaysEvaluatedIndex = alwaysEvaluatedListIndex();
+  evaluateList(mEntityLists[alwaysEvaluatedIndex], alwaysEvaluatedIndex);
+
+  const auto range = regionRange({
+    mActiveRegion.topLeft - base::Vector{ACTIVATION_MARGIN, ACTIVATION_MARGIN},
+    {mActiveRegion.size.width + 2 * ACTIVATION_MARGIN,
+     mActiveRegion.size.height + 2 * ACTIVATION_MARGIN}});
+
+  // Regions which just went out of range need to be evaluated one last
+  // time, to deactivate any entities which were active previously.
+  for (auto y = mPreviousRange.mFirstY; y <= mPreviousRange.mLastY; ++y) {
+    for (auto x = mPreviousRange.mFirstX; x <= mPreviousRange.mLastX; ++x) {
+      if (!range.contains(x, y)) {
+        const auto index = x + y * mWidthInRegions;
+        evaluateList(mEntityLists[index], index);
+      }
+    }
+  }
+
+  for (auto y = range.mFirstY; y <= range.mLastY; ++y) {
+    for (auto x = range.mFirstX; x <= range.mLastX; ++x) {
+      const auto index = x + y * mWidthInRegions;
+      evaluateList(mEntityLists[index], index);
+    }
+  }
+
+  mPreviousRange = range;
+}
+
+
+void EntityActivationSystem::receive(
+  const ex::ComponentAddedEvent<BoundingBox>& event
+) {
+  mPendingEntities.push_back(event.entity);
+}
+
+
+void EntityActivationSystem::receive(
+  const ex::ComponentAddedEvent<WorldPosition>& event
+) {
+  mPendingEntities.push_back(event.entity);
+}
+
+
+void EntityActivationSystem::receive(
+  const ex::ComponentAddedEvent<ActivationSettings>& event
+) {
+  // The entity might need to move to the list of entities which are always
+  // evaluated
+  mPendingEntities.push_back(event.entity);
+}
+
+
+void EntityActivationSystem::receive(const ex::EntityDestroyedEvent& event) {
+  const auto iListIndex = mListIndexByEntityId.find(event.entity.id().id());
+  if (iListIndex == mListIndexByEntityId.end()) {
+    return;
+  }
+
+  if (iListIndex->second != NO_LIST) {
+    mListsWithDestroyedEntities.push_back(iListIndex->second);
+  }
+
+  mListIndexByEntityId.erase(iListIndex);
+}
+
+
+void EntityActivationSystem::removeDestroyedEntities() {
+  if (mListsWithDestroyedEntities.empty()) {
+    return;
+  }
+
+  auto& listIndices = mListsWithDestroyedEntities;
+  std::sort(listIndices.begin(), listIndices.end());
+  listIndices.erase(
+    std::unique(listIndices.begin(), listIndices.end()),
+    listIndices.end());
+
+  for (const auto listIndex : listIndices) {
+    auto& list = mEntityLists[listIndex];
+    list.erase(
+      std::remove_if(list.begin(), list.end(),
+        [](const ex::Entity& entity) { return !entity.valid(); }),
+      list.end());
+  }
+
+  listIndices.clear();
+}
+
+
+void EntityActivationSystem::registerPendingEntities() {
+  if (mPendingEntities.empty()) {
+    return;
+  }
+
+  EntityList entitiesToEvaluate;
+
+  for (auto& entity : mPendingEntities) {
+    if (!entity.valid()) {
+      continue;
+    }
+
+    const auto iListIndex = mListIndexByEntityId.find(entity.id().id());
+    if (iListIndex != mListIndexByEntityId.end()) {
+      if (iListIndex->second == NO_LIST) {
+        // Entity is pending more than once
+        continue;
+      }
+
+      auto& list = mEntityLists[iListIndex->second];
+      const auto iEntity = std::find(list.begin(), list.end(), entity);
+      if (iEntity != list.end()) {
+        *iEntity = list.back();
+        list.pop_back();
+      }
+    }
+
+    mListIndexByEntityId[entity.id().id()] = NO_LIST;
+    entitiesToEvaluate.push_back(entity);
+  }
+
+  mPendingEntities.clear();
+
+  // Since NO_LIST never matches an actual list, this assigns all the
+  // entities to their proper list.
+  evaluateList(entitiesToEvaluate, NO_LIST);
+}
+
+
+void EntityActivationSystem::evaluateList(
+  EntityList& list,
+  const int listIndex
+) {
+  auto removeCurrent = [&list](const std::size_t i) {
+    list[i] = list.back();
+    list.pop_back();
+  };
+
+  for (std::size_t i = 0; i < list.size();) {
+    auto entity = list[i];
+
+    if (
+      !entity.valid() ||
+      !entity.has_component<WorldPosition>() ||
+      !entity.has_component<BoundingBox>()
+    ) {
+      // Entities are registered again once they regain the needed
+      // components
+      mListIndexByEntityId.erase(entity.id().id());
+      removeCurrent(i);
+      continue;
+    }
+
+    const auto worldSpaceBbox = toWorldSpace(
+      *entity.component<const BoundingBox>(),
+      *entity.component<const WorldPosition>());
+    const auto wasActive = entity.has_component<Active>();
+    const auto inActiveRegion = worldSpaceBbox.intersects(mActiveRegion);
     const auto active = determineActiveState(entity, inActiveRegion);
     setTag<Active>(entity, active);
     if (active) {
       entity.component<Active>()->mIsOnScreen = inActiveRegion;
     }
-  });
+
+    ++mEntitiesEvaluated;
+
+    const auto newListIndex = listIndexFor(entity, worldSpaceBbox);
+
+    // An inactive entity which left its region might have been missed by
+    // previous updates, since its new region wasn't evaluated. Entities in
+    // the always evaluated list can't be missed.
+    assert(
+      wasActive ||
+      listIndex == NO_LIST ||
+      listIndex == alwaysEvaluatedListIndex() ||
+      newListIndex == listIndex ||
+      newListIndex == alwaysEvaluatedListIndex());
+
+    if (newListIndex != listIndex) {
+      mEntityLists[newListIndex].push_back(entity);
+      mListIndexByEntityId[entity.id().id()] = newListIndex;
+      removeCurrent(i);
+      continue;
+    }
+
+    ++i;
+  }
+}
+
+
+int EntityActivationSystem::listIndexFor(
+  ex::Entity entity,
+  const BoundingBox& worldSpaceBbox
+) const {
+  const auto isTooLarge =
+    worldSpaceBbox.size.width > REGION_SIZE ||
+    worldSpaceBbox.size.height > REGION_SIZE;
+
+  if (isTooLarge || isPermanentlyActive(entity)) {
+    return alwaysEvaluatedListIndex();
+  }
+
+  const auto x = std::clamp(
+    toRegion(worldSpaceBbox.left()), 0, mWidthInRegions - 1);
+  const auto y = std::clamp(
+    toRegion(worldSpaceBbox.top()), 0, mHeightInRegions - 1);
+  return x + y * mWidthInRegions;
+}
+
+
+EntityActivationSystem::RegionRange EntityActivationSystem::regionRange(
+  const BoundingBox& area
+) const {
+  const auto clampX = [this](const int x) {
+    return std::clamp(toRegion(x), 0, mWidthInRegions - 1);
+  };
+  const auto clampY = [this](const int y) {
+    return std::clamp(toRegion(y), 0, mHeightInRegions - 1);
+  };
+
+  return RegionRange{
+    clampX(area.left()),
+    clampY(area.top()),
+    clampX(area.right()),
+    clampY(area.bottom())};
 }
 
 }}
@@ -18,16 +18,112 @@
 
 #include "base/spatial_types.hpp"
 #include "base/warnings.hpp"
+#include "engine/physical_components.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
 
 namespace rigel { namespace engine {
 
-void markActiveEntities(
-  entityx::EntityManager& es,
-  const base::Vector& cameraPosition);
+/** Assigns or removes the Active tag based on entity position and
+ * ActivationSettings
+ *
+ * Instead of testing every entity on each update, entities are grouped into
+ * regions of the map based on their position. Only regions within a margin
+ * around the active region are evaluated, plus those which were in range
+ * during the previous update, so that entities leaving the active region are
+ * deactivated. Entities which are always active (or have permanently become
+ * active) are kept in a separate list, as are entities too large to be
+ * assigned to a single region.
+ *
+ * This relies on inactive entities not moving out of their region, which
+ * holds since systems only update active entities. Debug builds assert
+ * this when evaluating a region. Moving an inactive entity elsewhere
+ * requires re-assigning its WorldPosition, so that it is registered again.
+ */
+class EntityActivationSystem :
+  public entityx::Receiver<EntityActivationSystem>
+{
+public:
+  EntityActivationSystem(
+    int mapWidthInTiles,
+    int mapHeightInTiles,
+    entityx::EntityManager& entities,
+    entityx::EventManager& eventManager);
+
+  void update(const base::Vector& cameraPosition);
+
+  /** Number of entities whose active state was determined in the last
+   * update */
+  std::size_t entitiesEvaluatedLastUpdate() const {
+    return mEntitiesEvaluated;
+  }
+
+  /** Number of entities currently assigned to a region or the list of
+   * always evaluated entities */
+  std::size_t numTrackedEntities() const {
+    return mListIndexByEntityId.size();
+  }
+
+  void receive(
+    const entityx::ComponentAddedEvent<components::BoundingBox>& event);
+  void receive(
+    const entityx::ComponentAddedEvent<components::WorldPosition>& event);
+  void receive(
+    const entityx::ComponentAddedEvent<components::ActivationSettings>&
+      event);
+  void receive(const entityx::EntityDestroyedEvent& event);
+
+private:
+  struct RegionRange {
+    int mFirstX;
+    int mFirstY;
+    int mLastX;
+    int mLastY;
+
+    bool contains(int x, int y) const;
+  };
+
+  using EntityList = std::vector<entityx::Entity>;
+
+  void removeDestroyedEntities();
+  void registerPendingEntities();
+  void evaluateList(EntityList& list, int listIndex);
+
+  int alwaysEvaluatedListIndex() const {
+    return static_cast<int>(mEntityLists.size()) - 1;
+  }
+
+  int listIndexFor(
+    entityx::Entity entity,
+    const components::BoundingBox& worldSpaceBbox) const;
+  RegionRange regionRange(const components::BoundingBox& area) const;
+
+  // One list per region, followed by the list of entities which are
+  // evaluated on every update
+  std::vector<EntityList> mEntityLists;
+  std::unordered_map<std::uint64_t, int> mListIndexByEntityId;
+  EntityList mPendingEntities;
+
+  // Lists which contain handles to destroyed entities. These are removed
+  // on the next update, since the list might not be evaluated again for a
+  // long time.
+  std::vector<int> mListsWithDestroyedEntities;
+
+  base::Rect<int> mActiveRegion;
+  RegionRange mPreviousRange;
+
+  int mWidthInRegions;
+  int mHeightInRegions;
+
+  std::size_t mEntitiesEvaluated = 0;
+};
 
 }}
@@ -53,6 +53,19 @@ void reassign(entityx::Entity entity, Args&&... args) {
 }
 
 
+/** Like Entity::assign, but overwrites the component in place if already
+ * present. No component events are emitted in that case.
+ */
+template<typename ComponentT, typename... Args>
+void assignOrReplace(entityx::Entity entity, Args&&... args) {
+  if (entity.has_component<ComponentT>()) {
+    *entity.component<ComponentT>() = ComponentT(std::forward<Args>(args)...);
+  } else {
+    entity.assign<ComponentT>(std::forward<Args>(args)...);
+  }
+}
+
+
 inline bool isOnScreen(const entityx::Entity entity) {
   return
       entity.has_component<components::Active>() &&
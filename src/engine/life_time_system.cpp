@@ -18,39 +18,181 @@
 
 #include "engine/physical_components.hpp"
 
+#include <algorithm>
+
 
 namespace rigel { namespace engine {
 
-void LifeTimeSystem::update(entityx::EntityManager& es) {
-  using Condition = components::AutoDestroy::Condition;
-  es.each<components::AutoDestroy>([](
-    entityx::Entity entity,
-    components::AutoDestroy& autoDestroyProperties
-  ) {
-    const auto flags = autoDestroyProperties.mConditionFlags;
+using components::AutoDestroy;
+using Condition = AutoDestroy::Condition;
+
+
+namespace {
+
+bool conditionIsSet(const AutoDestroy& autoDestroy, const Condition condition) {
+  const auto conditionValue = static_cast<int>(condition);
+  return (autoDestroy.mConditionFlags & conditionValue) != 0;
+}
+
+}
+
+
+LifeTimeSystem::LifeTimeSystem(
+  entityx::EntityManager& entities,
+  entityx::EventManager& eventManager,
+  PrefabPool* pPrefabPool
+)
+  : mpPrefabPool(pPrefabPool)
+{
+  entities.each<AutoDestroy>([this](entityx::Entity entity, AutoDestroy&) {
+    registerEntity(entity);
+  });
+
+  eventManager.subscribe<entityx::ComponentAddedEvent<AutoDestroy>>(*this);
+  eventManager.subscribe<entityx::ComponentRemovedEvent<AutoDestroy>>(*this);
+  eventManager.subscribe<events::PrefabInstanceRecycled>(*this);
+  eventManager.subscribe<events::PrefabInstancesParked>(*this);
+}
 
-    const auto conditionIsSet = [&flags](const Condition condition) {
-      const auto conditionValue = static_cast<int>(condition);
-      return (flags & conditionValue) != 0;
-    };
 
-    const auto hasTimeout = conditionIsSet(Condition::OnTimeoutElapsed);
-    if (hasTimeout) {
-      --autoDestroyProperties.mFramesToLive;
+void LifeTimeSystem::update() {
+  mCandidates.clear();
+  mEntitiesToPark.clear();
+
+  mTimeouts.advance([this](const Registration& registration) {
+    if (isCurrent(registration)) {
+      mCandidates.push_back({registration.mEntity, true});
+    }
+  });
+
+  mPolledEntities.erase(
+    std::remove_if(
+      mPolledEntities.begin(),
+      mPolledEntities.end(),
+      [this](const Registration& registration) {
+        return !isCurrent(registration);
+      }),
+    mPolledEntities.end());
+  for (const auto& registration : mPolledEntities) {
+    mCandidates.push_back({registration.mEntity, false});
+  }
+
+  std::sort(
+    mCandidates.begin(),
+    mCandidates.end(),
+    [](const Candidate& lhs, const Candidate& rhs) {
+      return lhs.mEntity.id().index() < rhs.mEntity.id().index();
+    });
+
+  for (auto i = 0u; i < mCandidates.size(); ++i) {
+    auto entity = mCandidates[i].mEntity;
+
+    // An entity with a timeout and another condition shows up twice
+    auto timeoutElapsed = mCandidates[i].mTimeoutElapsed;
+    while (
+      i + 1 < mCandidates.size() &&
+      mCandidates[i + 1].mEntity == entity
+    ) {
+      ++i;
+      timeoutElapsed = timeoutElapsed || mCandidates[i].mTimeoutElapsed;
     }
 
+    const auto& autoDestroy = *entity.component<AutoDestroy>();
     const auto mustDestroy =
-      (conditionIsSet(Condition::OnWorldCollision) &&
+      (conditionIsSet(autoDestroy, Condition::OnWorldCollision) &&
         entity.has_component<components::CollidedWithWorld>()) ||
-      (conditionIsSet(Condition::OnLeavingActiveRegion) &&
+      (conditionIsSet(autoDestroy, Condition::OnLeavingActiveRegion) &&
         !entity.has_component<components::Active>()) ||
-      (hasTimeout && autoDestroyProperties.mFramesToLive < 0);
+      timeoutElapsed;
 
     if (mustDestroy) {
-      entity.destroy();
+      if (mpPrefabPool && mpPrefabPool->isInstance(entity)) {
+        mEntitiesToPark.push_back(entity);
+      } else {
+        entity.destroy();
+      }
     }
-  });
+  }
+
+  if (mpPrefabPool) {
+    mpPrefabPool->park(mEntitiesToPark);
+  }
 }
 
-}}
 
+void LifeTimeSystem::receive(
+  const entityx::ComponentAddedEvent<AutoDestroy>& event
+) {
+  registerEntity(event.entity);
+}
+
+
+void LifeTimeSystem::receive(
+  const entityx::ComponentRemovedEvent<AutoDestroy>& event
+) {
+  auto entity = event.entity;
+  ++generationFor(entity);
+}
+
+
+void LifeTimeSystem::receive(const events::PrefabInstanceRecycled& event) {
+  auto entity = event.mEntity;
+
+  // If the entity lost its AutoDestroy component during its previous life,
+  // it has already been registered again via the component added event.
+  // Starting a new generation makes sure it's only registered once.
+  ++generationFor(entity);
+  if (entity.has_component<AutoDestroy>()) {
+    registerEntity(entity);
+  }
+}
+
+
+void LifeTimeSystem::receive(const events::PrefabInstancesParked& event) {
+  for (const auto& entity : event.mEntities) {
+    ++generationFor(entity);
+  }
+}
+
+
+void LifeTimeSystem::registerEntity(entityx::Entity entity) {
+  const auto& autoDestroy = *entity.component<AutoDestroy>();
+  const auto registration = Registration{entity, generationFor(entity)};
+
+  if (conditionIsSet(autoDestroy, Condition::OnTimeoutElapsed)) {
+    // The entity stays alive for mFramesToLive updates, and is destroyed on
+    // the update following those.
+    const auto updatesToLive = std::max(autoDestroy.mFramesToLive + 1, 1);
+    mTimeouts.schedule(
+      mTimeouts.currentTick() + updatesToLive,
+      registration);
+  }
+
+  if (
+    conditionIsSet(autoDestroy, Condition::OnWorldCollision) ||
+    conditionIsSet(autoDestroy, Condition::OnLeavingActiveRegion)
+  ) {
+    mPolledEntities.push_back(registration);
+  }
+}
+
+
+bool LifeTimeSystem::isCurrent(const Registration& registration) const {
+  const auto index = registration.mEntity.id().index();
+  return
+    registration.mEntity.valid() &&
+    index < mGenerations.size() &&
+    mGenerations[index] == registration.mGeneration;
+}
+
+
+std::uint32_t& LifeTimeSystem::generationFor(entityx::Entity entity) {
+  const auto index = entity.id().index();
+  if (index >= mGenerations.size()) {
+    mGenerations.resize(index + 1, 0);
+  }
+
+  return mGenerations[index];
+}
+
+}}
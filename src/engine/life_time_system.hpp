@@ -17,17 +17,73 @@
 #pragma once
 
 #include "engine/life_time_components.hpp"
+#include "engine/prefab_pool.hpp"
+#include "engine/timer_wheel.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <cstdint>
+#include <vector>
+
 
 namespace rigel { namespace engine {
 
-class LifeTimeSystem {
+/** Destroys entities once their AutoDestroy condition is fulfilled
+ *
+ * Timeouts are kept in a timer wheel, so that entities which only have a
+ * timeout aren't visited until it elapses. Entities with other conditions
+ * still need to be checked on every update.
+ *
+ * Entities are destroyed in the order of their entity index, like when
+ * iterating over all AutoDestroy components. This matters, since it
+ * determines which entity slots are re-used by entities created later on.
+ *
+ * Expired instances of prefabs are handed to the PrefabPool as a single
+ * batch instead of being destroyed.
+ */
+class LifeTimeSystem : public entityx::Receiver<LifeTimeSystem> {
 public:
-  void update(entityx::EntityManager& es);
+  LifeTimeSystem(
+    entityx::EntityManager& entities,
+    entityx::EventManager& eventManager,
+    PrefabPool* pPrefabPool);
+
+  void update();
+
+  void receive(
+    const entityx::ComponentAddedEvent<components::AutoDestroy>& event);
+  void receive(
+    const entityx::ComponentRemovedEvent<components::AutoDestroy>& event);
+  void receive(const events::PrefabInstanceRecycled& event);
+  void receive(const events::PrefabInstancesParked& event);
+
+private:
+  struct Registration {
+    entityx::Entity mEntity;
+    std::uint32_t mGeneration;
+  };
+
+  struct Candidate {
+    entityx::Entity mEntity;
+    bool mTimeoutElapsed;
+  };
+
+  void registerEntity(entityx::Entity entity);
+  bool isCurrent(const Registration& registration) const;
+  std::uint32_t& generationFor(entityx::Entity entity);
+
+  TimerWheel<Registration> mTimeouts;
+  std::vector<Registration> mPolledEntities;
+
+  // Incremented whenever an entity loses its AutoDestroy component, which
+  // invalidates any previous registrations for that entity.
+  std::vector<std::uint32_t> mGenerations;
+
+  std::vector<Candidate> mCandidates;
+  std::vector<entityx::Entity> mEntitiesToPark;
+  PrefabPool* mpPrefabPool;
 };
 
 }}
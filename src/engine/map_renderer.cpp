@@ -17,9 +17,12 @@
 #include "map_renderer.hpp"
 
 #include "data/game_traits.hpp"
+#include "data/unit_conversions.hpp"
 
+#include <algorithm>
 #include <cfenv>
 #include <cmath>
+#include <cstdlib>
 #include <iostream>
 
 
@@ -38,6 +41,9 @@ const auto FAST_ANIM_FRAME_DELAY = 1;
 const auto SLOW_ANIM_FRAME_DELAY = 2;
 const auto PARALLAX_FACTOR = 4;
 
+const auto VIEW_PORT_WIDTH_TILES = GameTraits::mapViewPortWidthTiles;
+const auto VIEW_PORT_HEIGHT_TILES = GameTraits::mapViewPortHeightTiles;
+
 
 base::Vector wrapBackgroundOffset(base::Vector offset) {
   return {
@@ -46,6 +52,75 @@ base::Vector wrapBackgroundOffset(base::Vector offset) {
   };
 }
 
+
+std::optional<base::Rect<int>> intersection(
+  const base::Rect<int>& lhs,
+  const base::Rect<int>& rhs
+) {
+  const auto left = std::max(lhs.left(), rhs.left());
+  const auto top = std::max(lhs.top(), rhs.top());
+  const auto right = std::min(lhs.right(), rhs.right());
+  const auto bottom = std::min(lhs.bottom(), rhs.bottom());
+  if (left > right || top > bottom) {
+    return std::nullopt;
+  }
+
+  return base::Rect<int>{{left, top}, {right - left + 1, bottom - top + 1}};
+}
+
+
+base::Color encodeTileIndices(
+  const map::TileIndex layer0Index,
+  const map::TileIndex layer1Index
+) {
+  auto lowByte = [](const map::TileIndex index) {
+    return static_cast<std::uint8_t>(index & 0xFF);
+  };
+  auto highByte = [](const map::TileIndex index) {
+    return static_cast<std::uint8_t>((index >> 8) & 0xFF);
+  };
+
+  return {
+    lowByte(layer0Index),
+    highByte(layer0Index),
+    lowByte(layer1Index),
+    highByte(layer1Index)};
+}
+
+
+/** Creates a lookup table for the tile map shader, see
+ * Renderer::drawTileMap()
+ */
+data::Image createTileFlagsImage(
+  const map::TileAttributeDict& attributeDict,
+  const int tilesPerRow
+) {
+  const auto numRows =
+    (GameTraits::CZone::numTilesTotal + tilesPerRow - 1) / tilesPerRow;
+  data::PixelBuffer pixels(tilesPerRow * numRows, base::Color{0, 0, 0, 255});
+
+  auto flagValue = [](const bool flag) -> std::uint8_t {
+    return flag ? 255 : 0;
+  };
+
+  // The tile set is laid out row by row, which means that the pixel index
+  // is identical to the tile index
+  for (map::TileIndex index = 0;
+    index < GameTraits::CZone::numTilesTotal;
+    ++index
+  ) {
+    const auto attributes = attributeDict.attributes(index);
+    pixels[index] = base::Color{
+      flagValue(attributes.isForeGround()),
+      flagValue(attributes.isAnimated()),
+      flagValue(attributes.isFastAnimation()),
+      255};
+  }
+
+  return data::Image{
+    std::move(pixels), std::size_t(tilesPerRow), std::size_t(numRows)};
+}
+
 }
 
 MapRenderer::MapRenderer(
@@ -55,9 +130,20 @@ MapRenderer::MapRenderer(
 )
   : mpRenderer(pRenderer)
   , mpMap(pMap)
-  , mTileRenderer(
-      engine::OwningTexture(pRenderer, renderData.mTileSetImage),
-      pRenderer)
+  , mTileSetTexture(pRenderer, renderData.mTileSetImage)
+  , mTileRenderer(engine::TextureRegion{mTileSetTexture}, pRenderer)
+  , mTileFlagsTexture(
+      pRenderer,
+      createTileFlagsImage(pMap->attributeDict(), mTileRenderer.tilesPerRow()))
+  , mMapDataTexture(pRenderer, data::Image(pMap->width(), pMap->height()))
+  , mUploadedMapRevision(pMap->revision())
+  , mScrollBuffer(
+      pRenderer,
+      GameTraits::mapViewPortWidthTiles * GameTraits::tileSize,
+      GameTraits::mapViewPortHeightTiles * GameTraits::tileSize)
+  , mAnimatedScrollBufferCells(
+      VIEW_PORT_WIDTH_TILES * VIEW_PORT_HEIGHT_TILES, false)
+  , mScrollBufferMapRevision(pMap->revision())
   , mBackdropTexture(mpRenderer, renderData.mBackdropImage)
   , mScrollMode(renderData.mBackdropScrollMode)
 {
@@ -65,6 +151,8 @@ MapRenderer::MapRenderer(
     mAlternativeBackdropTexture = engine::OwningTexture(
       mpRenderer, *renderData.mSecondaryBackdropImage);
   }
+
+  uploadMapData({{0, 0}, {mpMap->width(), mpMap->height()}});
 }
 
 
@@ -74,7 +162,9 @@ void MapRenderer::switchBackdrops() {
 
 
 void MapRenderer::renderBackground(const base::Vector& cameraPosition) {
-  renderMapTiles(cameraPosition, false);
+  updateMapDataTexture();
+  updateScrollBuffer(cameraPosition);
+  renderScrollBuffer(cameraPosition);
 }
 
 
@@ -145,26 +235,286 @@ void MapRenderer::renderMapTiles(
   const base::Vector& cameraPosition,
   const bool renderForeground
 ) {
-  for (int layer=0; layer<2; ++layer) {
-    for (int y=0; y<GameTraits::mapViewPortHeightTiles; ++y) {
-      for (int x=0; x<GameTraits::mapViewPortWidthTiles; ++x) {
-        const auto col = x + cameraPosition.x;
-        const auto row = y + cameraPosition.y;
-        if (col >= mpMap->width() || row >= mpMap->height()) {
-          continue;
-        }
+  updateMapDataTexture();
+
+  drawMapSection(
+    {cameraPosition, {VIEW_PORT_WIDTH_TILES, VIEW_PORT_HEIGHT_TILES}},
+    {0, 0},
+    renderForeground);
+}
+
+
+void MapRenderer::drawMapSection(
+  const base::Rect<int>& section,
+  const base::Vector& destPosition,
+  const bool renderForeground
+) {
+  const auto animOffsets = animationOffsets();
+  mpRenderer->drawTileMap(
+    mTileSetTexture.data(),
+    mTileFlagsTexture.data(),
+    mMapDataTexture.data(),
+    {
+      tileVectorToPixelVector(destPosition),
+      tileExtentsToPixelExtents(section.size)
+    },
+    tileVectorToPixelVector(section.topLeft),
+    animOffsets.x,
+    animOffsets.y,
+    renderForeground);
+}
+
+
+void MapRenderer::updateScrollBuffer(const base::Vector& cameraPosition) {
+  const auto visibleArea = base::Rect<int>{
+    cameraPosition, {VIEW_PORT_WIDTH_TILES, VIEW_PORT_HEIGHT_TILES}};
+  const auto changedArea = changedAreaSince(mScrollBufferMapRevision);
+  const auto animationChanged =
+    animationOffsets() != mScrollBufferAnimationOffsets;
+
+  const auto needsUpdate =
+    !mScrollBufferCameraPosition ||
+    *mScrollBufferCameraPosition != cameraPosition ||
+    changedArea ||
+    animationChanged;
+  if (!needsUpdate) {
+    return;
+  }
+
+  engine::RenderTargetTexture::Binder bindScrollBuffer(
+    mScrollBuffer, mpRenderer);
+
+  // Redrawn tiles need to replace the previous contents, including
+  // transparent areas
+  mpRenderer->setBlendingEnabled(false);
+
+  const auto previousPosition = mScrollBufferCameraPosition;
+  const auto delta = previousPosition
+    ? cameraPosition - *previousPosition
+    : base::Vector{};
+  const auto needsFullRedraw =
+    !previousPosition ||
+    std::abs(delta.x) >= VIEW_PORT_WIDTH_TILES ||
+    std::abs(delta.y) >= VIEW_PORT_HEIGHT_TILES;
+
+  if (needsFullRedraw) {
+    redrawScrollBufferArea(visibleArea);
+  } else {
+    // Newly exposed columns
+    if (delta.x > 0) {
+      redrawScrollBufferArea({
+        {previousPosition->x + VIEW_PORT_WIDTH_TILES, cameraPosition.y},
+        {delta.x, VIEW_PORT_HEIGHT_TILES}});
+    } else if (delta.x < 0) {
+      redrawScrollBufferArea(
+        {cameraPosition, {-delta.x, VIEW_PORT_HEIGHT_TILES}});
+    }
+
+    // Newly exposed rows
+    if (delta.y > 0) {
+      redrawScrollBufferArea({
+        {cameraPosition.x, previousPosition->y + VIEW_PORT_HEIGHT_TILES},
+        {VIEW_PORT_WIDTH_TILES, delta.y}});
+    } else if (delta.y < 0) {
+      redrawScrollBufferArea(
+        {cameraPosition, {VIEW_PORT_WIDTH_TILES, -delta.y}});
+    }
+
+    if (changedArea) {
+      if (const auto dirtyArea = intersection(*changedArea, visibleArea)) {
+        redrawScrollBufferArea(*dirtyArea);
+      }
+    }
+
+    if (animationChanged) {
+      redrawAnimatedScrollBufferCells(cameraPosition);
+    }
+  }
+
+  mpRenderer->setBlendingEnabled(true);
+
+  mScrollBufferCameraPosition = cameraPosition;
+  mScrollBufferMapRevision = mpMap->revision();
+  mScrollBufferAnimationOffsets = animationOffsets();
+}
 
-        const auto tileIndex = mpMap->tileAt(layer, col, row);
-        const auto isForeground =
-          mpMap->attributeDict().attributes(tileIndex).isForeGround();
-        if (isForeground != renderForeground) {
-          continue;
+
+void MapRenderer::redrawScrollBufferArea(const base::Rect<int>& area) {
+  // The scroll buffer wraps around in both directions, so the area might
+  // need to be split into up to four pieces.
+  for (auto row = area.top(); row <= area.bottom();) {
+    const auto bufferRow = row % VIEW_PORT_HEIGHT_TILES;
+    const auto numRows = std::min(
+      area.bottom() + 1 - row, VIEW_PORT_HEIGHT_TILES - bufferRow);
+
+    for (auto col = area.left(); col <= area.right();) {
+      const auto bufferCol = col % VIEW_PORT_WIDTH_TILES;
+      const auto numCols = std::min(
+        area.right() + 1 - col, VIEW_PORT_WIDTH_TILES - bufferCol);
+
+      drawMapSection(
+        {{col, row}, {numCols, numRows}}, {bufferCol, bufferRow}, false);
+
+      for (auto y = 0; y < numRows; ++y) {
+        for (auto x = 0; x < numCols; ++x) {
+          const auto bufferIndex =
+            bufferCol + x + (bufferRow + y) * VIEW_PORT_WIDTH_TILES;
+          mAnimatedScrollBufferCells[bufferIndex] =
+            hasAnimatedBackgroundTile(col + x, row + y);
         }
+      }
+
+      col += numCols;
+    }
+
+    row += numRows;
+  }
+}
+
+
+void MapRenderer::redrawAnimatedScrollBufferCells(
+  const base::Vector& cameraPosition
+) {
+  auto wrap = [](const int value, const int size) {
+    return (value % size + size) % size;
+  };
+
+  for (auto bufferRow = 0; bufferRow < VIEW_PORT_HEIGHT_TILES; ++bufferRow) {
+    for (auto bufferCol = 0; bufferCol < VIEW_PORT_WIDTH_TILES; ++bufferCol) {
+      const auto bufferIndex = bufferCol + bufferRow * VIEW_PORT_WIDTH_TILES;
+      if (!mAnimatedScrollBufferCells[bufferIndex]) {
+        continue;
+      }
+
+      // Find the visible map position currently stored in this cell
+      const auto mapPosition = base::Vector{
+        cameraPosition.x +
+          wrap(bufferCol - cameraPosition.x, VIEW_PORT_WIDTH_TILES),
+        cameraPosition.y +
+          wrap(bufferRow - cameraPosition.y, VIEW_PORT_HEIGHT_TILES)};
+      drawMapSection(
+        {mapPosition, {1, 1}}, {bufferCol, bufferRow}, false);
+    }
+  }
+}
+
+
+bool MapRenderer::hasAnimatedBackgroundTile(const int x, const int y) const {
+  if (x >= mpMap->width() || y >= mpMap->height()) {
+    return false;
+  }
+
+  for (int layer = 0; layer < 2; ++layer) {
+    const auto attributes =
+      mpMap->attributeDict().attributes(mpMap->tileAt(layer, x, y));
+    if (attributes.isAnimated() && !attributes.isForeGround()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 
-        renderTile(tileIndex, x, y);
+void MapRenderer::renderScrollBuffer(const base::Vector& cameraPosition) {
+  const auto bufferWidth = mScrollBuffer.width();
+  const auto bufferHeight = mScrollBuffer.height();
+  const auto offset = tileVectorToPixelVector({
+    cameraPosition.x % VIEW_PORT_WIDTH_TILES,
+    cameraPosition.y % VIEW_PORT_HEIGHT_TILES});
+
+  // Undo the wrap-around. The pieces all use the same texture, so they end up
+  // in a single batch.
+  auto renderPiece = [this](
+    const base::Rect<int>& sourceRect,
+    const base::Vector& destPosition
+  ) {
+    if (sourceRect.size.width > 0 && sourceRect.size.height > 0) {
+      mScrollBuffer.render(mpRenderer, destPosition, sourceRect);
+    }
+  };
+
+  const auto remainder = base::Extents{
+    bufferWidth - offset.x, bufferHeight - offset.y};
+  renderPiece({offset, remainder}, {0, 0});
+  renderPiece(
+    {{0, offset.y}, {offset.x, remainder.height}}, {remainder.width, 0});
+  renderPiece(
+    {{offset.x, 0}, {remainder.width, offset.y}}, {0, remainder.height});
+  renderPiece(
+    {{0, 0}, {offset.x, offset.y}}, {remainder.width, remainder.height});
+}
+
+
+base::Vector MapRenderer::animationOffsets() const {
+  const auto fastAnimOffset =
+    (mElapsedFrames / FAST_ANIM_FRAME_DELAY) % ANIM_STATES;
+  const auto slowAnimOffset =
+    (mElapsedFrames / SLOW_ANIM_FRAME_DELAY) % ANIM_STATES;
+  return {int(fastAnimOffset), int(slowAnimOffset)};
+}
+
+
+std::optional<base::Rect<int>> MapRenderer::changedAreaSince(
+  const std::uint64_t revision
+) const {
+  if (mpMap->revision() == revision) {
+    return std::nullopt;
+  }
+
+  auto changedArea = std::optional<base::Rect<int>>{};
+  const auto historyComplete = mpMap->forEachChangeSince(
+    revision,
+    [&changedArea](const int x, const int y) {
+      if (!changedArea) {
+        changedArea = base::Rect<int>{{x, y}, {1, 1}};
+        return;
       }
+
+      // Note: right() and bottom() are inclusive
+      const auto left = std::min(changedArea->left(), x);
+      const auto top = std::min(changedArea->top(), y);
+      const auto right = std::max(changedArea->right(), x);
+      const auto bottom = std::max(changedArea->bottom(), y);
+      changedArea = base::Rect<int>{
+        {left, top}, {right - left + 1, bottom - top + 1}};
+    });
+
+  if (!historyComplete) {
+    return base::Rect<int>{{0, 0}, {mpMap->width(), mpMap->height()}};
+  }
+
+  return changedArea;
+}
+
+
+void MapRenderer::updateMapDataTexture() {
+  if (const auto changedArea = changedAreaSince(mUploadedMapRevision)) {
+    uploadMapData(*changedArea);
+  }
+
+  mUploadedMapRevision = mpMap->revision();
+}
+
+
+void MapRenderer::uploadMapData(const base::Rect<int>& area) {
+  data::PixelBuffer pixels;
+  pixels.reserve(area.size.width * area.size.height);
+
+  for (int y = area.top(); y <= area.bottom(); ++y) {
+    for (int x = area.left(); x <= area.right(); ++x) {
+      pixels.push_back(
+        encodeTileIndices(mpMap->tileAt(0, x, y), mpMap->tileAt(1, x, y)));
     }
   }
+
+  mpRenderer->updateTextureRegion(
+    mMapDataTexture.data(),
+    area.topLeft,
+    data::Image{
+      std::move(pixels),
+      std::size_t(area.size.width),
+      std::size_t(area.size.height)});
 }
 
 
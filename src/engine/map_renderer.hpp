@@ -22,6 +22,10 @@
 #include "engine/tile_renderer.hpp"
 #include "loader/level_loader.hpp"
 
+#include <cstdint>
+#include <optional>
+#include <vector>
+
 
 namespace rigel { namespace engine {
 
@@ -67,11 +71,44 @@ private:
   void renderTile(data::map::TileIndex index, int x, int y);
   data::map::TileIndex animatedTileIndex(data::map::TileIndex) const;
 
+  void drawMapSection(
+    const base::Rect<int>& section,
+    const base::Vector& destPosition,
+    bool renderForeground);
+
+  void updateScrollBuffer(const base::Vector& cameraPosition);
+  void redrawScrollBufferArea(const base::Rect<int>& area);
+  void redrawAnimatedScrollBufferCells(const base::Vector& cameraPosition);
+  bool hasAnimatedBackgroundTile(int x, int y) const;
+  void renderScrollBuffer(const base::Vector& cameraPosition);
+
+  base::Vector animationOffsets() const;
+  std::optional<base::Rect<int>> changedAreaSince(
+    std::uint64_t revision) const;
+  void updateMapDataTexture();
+  void uploadMapData(const base::Rect<int>& area);
+
 private:
   engine::Renderer* mpRenderer;
   const data::map::Map* mpMap;
 
+  engine::OwningTexture mTileSetTexture;
   TileRenderer mTileRenderer;
+  engine::OwningTexture mTileFlagsTexture;
+  engine::OwningTexture mMapDataTexture;
+  std::uint64_t mUploadedMapRevision;
+
+  /** Background layer cache, similar to the scroll buffer in the original
+   * game
+   *
+   * Map tile (x, y) is stored in cell (x % width, y % height). When the
+   * camera moves, only the newly exposed rows and columns need to be drawn.
+   */
+  engine::RenderTargetTexture mScrollBuffer;
+  std::vector<bool> mAnimatedScrollBufferCells;
+  std::optional<base::Vector> mScrollBufferCameraPosition;
+  base::Vector mScrollBufferAnimationOffsets;
+  std::uint64_t mScrollBufferMapRevision;
   engine::OwningTexture mBackdropTexture;
   engine::OwningTexture mAlternativeBackdropTexture;
 
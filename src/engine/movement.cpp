@@ -50,7 +50,7 @@ template<typename CallableT>
 MovementResult move(
   int* pPosition,
   const int amount,
-  CallableT isColliding
+  CallableT distanceToObstacle
 ) {
   if (amount == 0) {
     return MovementResult::Completed;
@@ -59,16 +59,9 @@ MovementResult move(
   const auto desiredDistance = std::abs(amount);
   const auto movement = amount < 0 ? -1 : 1;
 
-  const auto previousPosition = *pPosition;
-  for (int i = 0; i < desiredDistance; ++i) {
-    if (isColliding()) {
-      break;
-    }
-
-    *pPosition += movement;
-  }
+  const auto actualDistance = distanceToObstacle(desiredDistance);
+  *pPosition += actualDistance * movement;
 
-  const auto actualDistance = std::abs(*pPosition - previousPosition);
   if (actualDistance == 0) {
     return MovementResult::Failed;
   }
@@ -153,10 +146,11 @@ MovementResult moveHorizontally(
   auto& bbox = *entity.component<BoundingBox>();
 
   return move(&position.x, amount,
-    [&]() {
+    [&](const int maxDistance) {
+      const auto worldSpaceBbox = toWorldSpace(bbox, position);
       return amount < 0
-        ? collisionChecker.isTouchingLeftWall(position, bbox)
-        : collisionChecker.isTouchingRightWall(position, bbox);
+        ? collisionChecker.distanceToLeftWall(worldSpaceBbox, maxDistance)
+        : collisionChecker.distanceToRightWall(worldSpaceBbox, maxDistance);
     });
 }
 
@@ -170,10 +164,11 @@ MovementResult moveVertically(
   auto& bbox = *entity.component<BoundingBox>();
 
   return move(&position.y, amount,
-    [&]() {
+    [&](const int maxDistance) {
+      const auto worldSpaceBbox = toWorldSpace(bbox, position);
       return amount < 0
-        ? collisionChecker.isTouchingCeiling(position, bbox)
-        : collisionChecker.isOnSolidGround(position, bbox);
+        ? collisionChecker.distanceToCeiling(worldSpaceBbox, maxDistance)
+        : collisionChecker.distanceToGround(worldSpaceBbox, maxDistance);
     });
 }
 
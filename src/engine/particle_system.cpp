@@ -22,8 +22,6 @@
 
 #include <algorithm>
 #include <array>
-#include <functional>
-#include <memory>
 
 
 namespace rigel { namespace engine {
@@ -34,6 +32,8 @@ const auto PARTICLE_SYSTEM_LIFE_TIME = 28;
 
 const auto INITIAL_INDEX_LIMIT = 15;
 
+const auto PARTICLES_PER_CLOUD = 64;
+
 const std::array<std::int16_t, 43> VERTICAL_MOVEMENT_TABLE{
   -8, -8, -8, -8, -4, -4, -4, -2, -1, 0, 0, 1, 2, 4, 4, 4,
   8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
@@ -43,45 +43,32 @@ const std::array<std::int16_t, 43> VERTICAL_MOVEMENT_TABLE{
 constexpr auto SPAWN_OFFSET = base::Vector{0, -1};
 
 
-struct Particle {
-  Particle() = default;
-
-  void update() {
-    static_assert(
-      (PARTICLE_SYSTEM_LIFE_TIME - 1) + INITIAL_INDEX_LIMIT <
-      VERTICAL_MOVEMENT_TABLE.size());
+static_assert(
+  (PARTICLE_SYSTEM_LIFE_TIME - 1) + INITIAL_INDEX_LIMIT <
+  VERTICAL_MOVEMENT_TABLE.size());
 
-    mOffsetY += VERTICAL_MOVEMENT_TABLE[mMovementIndexY++];
-  }
 
-  base::Vector offsetAtTime(const int framesElapsed) const {
-    return {mVelocityX * framesElapsed, mOffsetY};
+/** Prefix sums of VERTICAL_MOVEMENT_TABLE
+ *
+ * A particle starting at movement index i has moved by
+ * table[i + frames] - table[i] after the given number of frames. This way,
+ * vertical positions can be computed directly instead of stepping each
+ * particle through the movement table on every update.
+ */
+std::array<std::int16_t, VERTICAL_MOVEMENT_TABLE.size() + 1>
+  createAccumulatedMovementTable()
+{
+  std::array<std::int16_t, VERTICAL_MOVEMENT_TABLE.size() + 1> table{};
+  for (std::size_t i = 0; i < VERTICAL_MOVEMENT_TABLE.size(); ++i) {
+    table[i + 1] =
+      static_cast<std::int16_t>(table[i] + VERTICAL_MOVEMENT_TABLE[i]);
   }
 
-  std::int16_t mVelocityX;
-  std::int16_t mOffsetY = 0;
-  std::int16_t mMovementIndexY;
-};
-
+  return table;
+}
 
-using ParticlesList = std::array<Particle, 64>;
 
-
-std::unique_ptr<ParticlesList> createParticles(
-  RandomNumberGenerator& randomGenerator,
-  const int velocityScaleX
-) {
-  auto pParticles = std::make_unique<ParticlesList>();
-  for (auto& particle : *pParticles) {
-    const auto randomVariation = randomGenerator.gen() % 20;
-    particle.mVelocityX = static_cast<std::int16_t>(velocityScaleX == 0
-      ? 10 - randomVariation
-      : velocityScaleX * (randomVariation + 1));
-    particle.mMovementIndexY =
-      randomGenerator.gen() % (INITIAL_INDEX_LIMIT + 1);
-  }
-  return pParticles;
-}
+const auto ACCUMULATED_MOVEMENT_TABLE = createAccumulatedMovementTable();
 
 }
 
@@ -90,40 +77,21 @@ struct ParticleCloud {
   ParticleCloud(
     const base::Vector& origin,
     const base::Color& color,
-    std::unique_ptr<ParticlesList> pParticles
+    const std::size_t slot
   )
-    : mpParticles(std::move(pParticles))
-    , mOrigin(origin)
+    : mOrigin(origin)
     , mColor(color)
+    , mSlot(slot)
   {
   }
 
-  void update() {
-    for (auto& particle : *mpParticles) {
-      particle.update();
-    }
-
-    ++mFramesElapsed;
-  }
-
-  void render(Renderer& renderer, const base::Vector& cameraPosition) {
-    const auto screenSpaceOrigin =
-      data::tileVectorToPixelVector(mOrigin - cameraPosition);
-    for (auto& particle : *mpParticles) {
-      const auto particlePosition =
-        screenSpaceOrigin + particle.offsetAtTime(mFramesElapsed);
-      renderer.drawPoint(particlePosition, mColor);
-    }
-  }
-
-
   bool isExpired() const {
     return mFramesElapsed >= PARTICLE_SYSTEM_LIFE_TIME;
   }
 
-  std::unique_ptr<ParticlesList> mpParticles;
   base::Vector mOrigin;
   base::Color mColor;
+  std::size_t mSlot;
   int mFramesElapsed = 0;
 };
 
@@ -146,9 +114,19 @@ void ParticleSystem::spawnParticles(
   const base::Color& color,
   int velocityScaleX
 ) {
-  auto pParticles = createParticles(*mpRandomGenerator, velocityScaleX);
-  mParticleClouds.emplace_back(
-    origin + SPAWN_OFFSET, color, std::move(pParticles));
+  const auto slot = allocateSlot();
+  const auto first = slot * PARTICLES_PER_CLOUD;
+
+  for (auto i = first; i < first + PARTICLES_PER_CLOUD; ++i) {
+    const auto randomVariation = mpRandomGenerator->gen() % 20;
+    mVelocitiesX[i] = static_cast<std::int16_t>(velocityScaleX == 0
+      ? 10 - randomVariation
+      : velocityScaleX * (randomVariation + 1));
+    mMovementStartIndices[i] = static_cast<std::int16_t>(
+      mpRandomGenerator->gen() % (INITIAL_INDEX_LIMIT + 1));
+  }
+
+  mParticleClouds.emplace_back(origin + SPAWN_OFFSET, color, slot);
 }
 
 
@@ -158,19 +136,59 @@ void ParticleSystem::update() {
   const auto it = remove_if(
     begin(mParticleClouds),
     end(mParticleClouds),
-    mem_fn(&ParticleCloud::isExpired));
+    [this](const ParticleCloud& cloud) {
+      if (cloud.isExpired()) {
+        mFreeSlots.push_back(cloud.mSlot);
+        return true;
+      }
+
+      return false;
+    });
   mParticleClouds.erase(it, end(mParticleClouds));
 
-  for (auto& system : mParticleClouds) {
-    system.update();
+  for (auto& cloud : mParticleClouds) {
+    ++cloud.mFramesElapsed;
   }
 }
 
 
 void ParticleSystem::render(const base::Vector& cameraPosition) {
-  for (auto& system : mParticleClouds) {
-    system.render(*mpRenderer, cameraPosition);
+  mPositionsBuffer.resize(PARTICLES_PER_CLOUD);
+
+  // All clouds end up in the same batch of points
+  for (const auto& cloud : mParticleClouds) {
+    const auto screenSpaceOrigin =
+      data::tileVectorToPixelVector(cloud.mOrigin - cameraPosition);
+    const auto framesElapsed = cloud.mFramesElapsed;
+    const auto first = cloud.mSlot * PARTICLES_PER_CLOUD;
+
+    for (auto i = 0; i < PARTICLES_PER_CLOUD; ++i) {
+      const auto startIndex = mMovementStartIndices[first + i];
+      const auto offsetY =
+        ACCUMULATED_MOVEMENT_TABLE[startIndex + framesElapsed] -
+        ACCUMULATED_MOVEMENT_TABLE[startIndex];
+      mPositionsBuffer[i] = screenSpaceOrigin + base::Vector{
+        mVelocitiesX[first + i] * framesElapsed, offsetY};
+    }
+
+    mpRenderer->drawPoints(
+      {mPositionsBuffer.data(), PARTICLES_PER_CLOUD}, cloud.mColor);
   }
 }
 
+
+std::size_t ParticleSystem::allocateSlot() {
+  if (!mFreeSlots.empty()) {
+    const auto slot = mFreeSlots.back();
+    mFreeSlots.pop_back();
+    return slot;
+  }
+
+  const auto slot = mVelocitiesX.size() / PARTICLES_PER_CLOUD;
+  mVelocitiesX.resize(mVelocitiesX.size() + PARTICLES_PER_CLOUD);
+  mMovementStartIndices.resize(
+    mMovementStartIndices.size() + PARTICLES_PER_CLOUD);
+  return slot;
+}
+
 }}
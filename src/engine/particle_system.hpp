@@ -19,6 +19,8 @@
 #include "base/color.hpp"
 #include "base/spatial_types.hpp"
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 
@@ -43,8 +45,21 @@ public:
   void update();
   void render(const base::Vector& cameraPosition);
 
+private:
+  std::size_t allocateSlot();
+
 private:
   std::vector<ParticleCloud> mParticleClouds;
+
+  // Particle data in structure-of-arrays layout. Each cloud owns a slot of
+  // PARTICLES_PER_CLOUD consecutive entries. Slots of expired clouds are
+  // reused for new ones, so after warming up, spawning doesn't allocate.
+  std::vector<std::int16_t> mVelocitiesX;
+  std::vector<std::int16_t> mMovementStartIndices;
+  std::vector<std::size_t> mFreeSlots;
+
+  std::vector<base::Vector> mPositionsBuffer;
+
   RandomNumberGenerator* mpRandomGenerator;
   Renderer* mpRenderer;
 };
@@ -86,11 +86,19 @@ PhysicsSystem::PhysicsSystem(
 {
   mpEvents->subscribe<ex::ComponentAddedEvent<MovingBody>>(*this);
   mpEvents->subscribe<ex::ComponentRemovedEvent<MovingBody>>(*this);
+  mpEvents->subscribe<events::PrefabInstanceRecycled>(*this);
+  mpEvents->subscribe<events::PrefabInstancesParked>(*this);
 }
 
 
 void PhysicsSystem::update(ex::EntityManager& es) {
-  es.each<MovingBody, WorldPosition, BoundingBox, components::Active>(
+  // The group is created on first use, since we don't have access to the
+  // entity manager at construction time
+  if (!mPhysicsObjects) {
+    mPhysicsObjects.emplace(es, *mpEvents);
+  }
+
+  mPhysicsObjects->forEach(
     [this](
       ex::Entity entity,
       MovingBody& body,
@@ -227,6 +235,38 @@ void PhysicsSystem::receive(
 }
 
 
+void PhysicsSystem::receive(const events::PrefabInstanceRecycled& event) {
+  auto entity = event.mEntity;
+  if (!mShouldCollectForPhase2 || !entity.has_component<MovingBody>()) {
+    return;
+  }
+
+  // If the MovingBody had to be assigned again while re-initializing the
+  // entity, the component added event has already put it into the list.
+  // Nothing else is added to the list in the meantime.
+  const auto alreadyCollected =
+    !mPhysicsObjectsForPhase2.empty() &&
+    mPhysicsObjectsForPhase2.back() == entity;
+  if (!alreadyCollected) {
+    mPhysicsObjectsForPhase2.push_back(entity);
+  }
+}
+
+
+void PhysicsSystem::receive(const events::PrefabInstancesParked& event) {
+  if (!mShouldCollectForPhase2) {
+    return;
+  }
+
+  mPhysicsObjectsForPhase2.erase(
+    remove_if(
+      begin(mPhysicsObjectsForPhase2),
+      end(mPhysicsObjectsForPhase2),
+      [&event](const auto& entity) { return event.contains(entity); }),
+    end(mPhysicsObjectsForPhase2));
+}
+
+
 float PhysicsSystem::applyGravity(
   const BoundingBox& bbox,
   const float currentVelocity
@@ -19,13 +19,16 @@
 #include "base/spatial_types.hpp"
 #include "base/warnings.hpp"
 #include "engine/base_components.hpp"
+#include "engine/component_group.hpp"
 #include "engine/physical_components.hpp"
+#include "engine/prefab_pool.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
 #include <cstdint>
+#include <optional>
 #include <tuple>
 
 
@@ -89,6 +92,8 @@ public:
     const entityx::ComponentAddedEvent<components::MovingBody>& event);
   void receive(
     const entityx::ComponentRemovedEvent<components::MovingBody>& event);
+  void receive(const events::PrefabInstanceRecycled& event);
+  void receive(const events::PrefabInstancesParked& event);
 
 private:
   void applyPhysics(
@@ -101,6 +106,13 @@ private:
     float currentVelocity);
 
 private:
+  using PhysicsObjectGroup = ComponentGroup<
+    components::MovingBody,
+    components::WorldPosition,
+    components::BoundingBox,
+    components::Active>;
+
+  std::optional<PhysicsObjectGroup> mPhysicsObjects;
   std::vector<entityx::Entity> mPhysicsObjectsForPhase2;
   const CollisionChecker* mpCollisionChecker;
   const data::map::Map* mpMap;
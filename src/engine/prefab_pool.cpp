@@ -0,0 +1,142 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "prefab_pool.hpp"
+
+#include "engine/base_components.hpp"
+#include "engine/entity_tools.hpp"
+#include "engine/physical_components.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+
+namespace rigel { namespace engine {
+
+PrefabPool::PrefabPool(
+  entityx::EntityManager& entities,
+  entityx::EventManager& eventManager
+)
+  : mpEntities(&entities)
+  , mpEvents(&eventManager)
+{
+  eventManager.subscribe<entityx::EntityDestroyedEvent>(*this);
+}
+
+
+bool PrefabPool::isInstance(entityx::Entity entity) const {
+  const auto index = entity.id().index();
+  return index < mInstances.size() && mInstances[index].mEntity == entity;
+}
+
+
+void PrefabPool::park(const std::vector<entityx::Entity>& entities) {
+  if (entities.empty()) {
+    return;
+  }
+
+  for (auto entity : entities) {
+    assert(isInstance(entity));
+
+    removeSafely<components::WorldPosition>(entity);
+    removeSafely<components::Active>(entity);
+
+    auto& instance = instanceRecordFor(entity);
+    instance.mIsParked = true;
+    mParkedEntities[instance.mPrefabId].push_back(entity);
+    ++mNumParked;
+  }
+
+  mpEvents->emit(events::PrefabInstancesParked{entities});
+}
+
+
+void PrefabPool::receive(const entityx::EntityDestroyedEvent& event) {
+  const auto entity = event.entity;
+  if (!isInstance(entity)) {
+    return;
+  }
+
+  auto& instance = mInstances[entity.id().index()];
+  const auto wasParked = instance.mIsParked;
+  instance = Instance{};
+
+  if (wasParked) {
+    // Only happens when all entities are destroyed at once, e.g. when
+    // restarting a level. Removing each entity from its list individually
+    // would take quadratic time, so they are removed in bulk once they make
+    // up the majority of all entries.
+    --mNumParked;
+    ++mNumDestroyedWhileParked;
+    if (mNumDestroyedWhileParked > mNumParked) {
+      removeDestroyedParkedEntities();
+    }
+  }
+}
+
+
+entityx::Entity PrefabPool::takeParkedInstance(const PrefabId id) {
+  const auto iParked = mParkedEntities.find(id);
+  if (iParked == mParkedEntities.end()) {
+    return {};
+  }
+
+  // Entities destroyed while parked might not have been removed yet
+  auto& parked = iParked->second;
+  while (!parked.empty() && !isInstance(parked.back())) {
+    parked.pop_back();
+    --mNumDestroyedWhileParked;
+  }
+
+  if (parked.empty()) {
+    return {};
+  }
+
+  auto entity = parked.back();
+  parked.pop_back();
+  --mNumParked;
+
+  instanceRecordFor(entity).mIsParked = false;
+  return entity;
+}
+
+
+void PrefabPool::removeDestroyedParkedEntities() {
+  for (auto& entry : mParkedEntities) {
+    auto& parked = entry.second;
+    parked.erase(
+      std::remove_if(parked.begin(), parked.end(),
+        [this](const entityx::Entity& entity) {
+          return !isInstance(entity);
+        }),
+      parked.end());
+  }
+
+  mNumDestroyedWhileParked = 0;
+}
+
+
+PrefabPool::Instance& PrefabPool::instanceRecordFor(entityx::Entity entity) {
+  const auto index = entity.id().index();
+  if (index >= mInstances.size()) {
+    mInstances.resize(index + 1);
+  }
+
+  return mInstances[index];
+}
+
+}}
@@ -0,0 +1,186 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "base/warnings.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <entityx/entityx.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+namespace rigel { namespace engine {
+
+using PrefabId = std::uint32_t;
+
+
+namespace events {
+
+/** A parked entity has been re-initialized and is in use again
+ *
+ * Components which the entity already had are overwritten in place, which
+ * doesn't emit any component added events. Systems which keep track of
+ * entities with certain components need to handle this event in addition
+ * to those.
+ */
+struct PrefabInstanceRecycled {
+  entityx::Entity mEntity;
+};
+
+
+/** A batch of expired entities has been parked
+ *
+ * Parked entities keep all their components except for WorldPosition and
+ * Active. Systems which keep track of entities with certain components need
+ * to forget about these entities, as they would for destroyed ones.
+ * Entities are sorted by entity index.
+ */
+struct PrefabInstancesParked {
+  bool contains(entityx::Entity entity) const {
+    const auto it = std::lower_bound(
+      mEntities.begin(),
+      mEntities.end(),
+      entity,
+      [](const entityx::Entity& lhs, const entityx::Entity& rhs) {
+        return lhs.id().index() < rhs.id().index();
+      });
+    return it != mEntities.end() && *it == entity;
+  }
+
+  std::vector<entityx::Entity> mEntities;
+};
+
+}
+
+
+/** Recycles short-lived entities which are spawned in large numbers
+ *
+ * Effect sprites, score numbers and player projectiles are created and
+ * destroyed all the time. Creating an entity from scratch assigns each of its
+ * components one by one, and each component assignment notifies all systems
+ * interested in that component type.
+ *
+ * Entities spawned via this class are instances of a prefab, identified by a
+ * PrefabId. When such an entity expires, it can be parked instead of being
+ * destroyed (see park()). Parking removes the WorldPosition and Active
+ * components, which takes the entity out of all systems operating on
+ * entities in the world. The next spawn of the same prefab then re-uses the
+ * parked entity, and overwrites its components in place.
+ *
+ * Since entities are re-used, handles to prefab instances must not be kept
+ * around past the entity's life time. To make sure that a recycled entity
+ * doesn't carry over any components from its previous use (e.g. assigned by
+ * the code which spawned it, or through such a stale handle), the pool
+ * remembers which components a newly created instance of each prefab has.
+ * A parked instance which still has a different set of components after
+ * initialization is destroyed, and replaced by a newly created entity.
+ */
+class PrefabPool : public entityx::Receiver<PrefabPool> {
+public:
+  PrefabPool(
+    entityx::EntityManager& entities,
+    entityx::EventManager& eventManager);
+
+  /** Create an instance of the given prefab
+   *
+   * initialize(entity) is invoked on either a newly created entity, or a
+   * parked instance of the same prefab. In the latter case, the entity still
+   * has all components it had when it expired, apart from WorldPosition and
+   * Active. initialize must bring the entity into the same state in both
+   * cases, i.e. overwrite components via assignOrReplace() and remove any
+   * components which the prefab doesn't start out with. Otherwise, the
+   * parked instance is discarded, and initialize is invoked again on a new
+   * entity.
+   */
+  template <typename Initializer>
+  entityx::Entity spawn(PrefabId id, Initializer&& initialize);
+
+  bool isInstance(entityx::Entity entity) const;
+
+  /** Park the given prefab instances, emits PrefabInstancesParked
+   *
+   * Entities must be sorted by entity index.
+   */
+  void park(const std::vector<entityx::Entity>& entities);
+
+  std::size_t numParked() const {
+    return mNumParked;
+  }
+
+  void receive(const entityx::EntityDestroyedEvent& event);
+
+private:
+  struct Instance {
+    entityx::Entity mEntity;
+    PrefabId mPrefabId = 0;
+    bool mIsParked = false;
+  };
+
+  using ComponentMask = std::bitset<entityx::MAX_COMPONENTS>;
+
+  entityx::Entity takeParkedInstance(PrefabId id);
+  Instance& instanceRecordFor(entityx::Entity entity);
+  void removeDestroyedParkedEntities();
+
+  entityx::EntityManager* mpEntities;
+  entityx::EventManager* mpEvents;
+
+  // Indexed by entity index
+  std::vector<Instance> mInstances;
+  std::unordered_map<PrefabId, std::vector<entityx::Entity>> mParkedEntities;
+  std::unordered_map<PrefabId, ComponentMask> mComponentMasks;
+  std::size_t mNumParked = 0;
+
+  // Destroyed entities which are still in one of the parked lists
+  std::size_t mNumDestroyedWhileParked = 0;
+};
+
+
+template <typename Initializer>
+entityx::Entity PrefabPool::spawn(
+  const PrefabId id,
+  Initializer&& initialize
+) {
+  if (auto entity = takeParkedInstance(id)) {
+    initialize(entity);
+
+    // Components which the initializer doesn't know about can't be removed
+    // generically, so the instance can only be re-used if there are none.
+    if (entity.component_mask() == mComponentMasks[id]) {
+      mpEvents->emit(events::PrefabInstanceRecycled{entity});
+      return entity;
+    }
+
+    entity.destroy();
+  }
+
+  auto entity = mpEntities->create();
+  initialize(entity);
+  instanceRecordFor(entity) = Instance{entity, id, false};
+  mComponentMasks[id] = entity.component_mask();
+  return entity;
+}
+
+}}
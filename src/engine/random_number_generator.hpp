@@ -29,6 +29,10 @@ class RandomNumberGenerator {
 public:
   int gen();
 
+  std::size_t nextNumberIndex() const {
+    return mNextNumberIndex;
+  }
+
 private:
   std::size_t mNextNumberIndex = 0;
 };
@@ -17,13 +17,20 @@
 #include "renderer.hpp"
 
 #include "data/game_traits.hpp"
+#include "engine/software_renderer.hpp"
 #include "loader/palette.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <glm/gtc/matrix_transform.hpp>
 RIGEL_RESTORE_WARNINGS
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <vector>
 
 
 namespace rigel { namespace engine {
@@ -54,12 +61,33 @@ const auto LOGICAL_DISPLAY_HEIGHT =
 
 const GLushort QUAD_INDICES[] = { 0, 1, 2, 2, 3, 1 };
 
+// Vertex data is streamed to the GPU in batches of at most this size. When a
+// batch runs full, it is submitted and a new one is started.
+constexpr auto BATCH_SIZE_BYTES = std::size_t{256 * 1024};
+
+// Space in the stream buffer for each frame. Frames exceeding this cause the
+// buffer to be orphaned, which is slower but still correct.
+constexpr auto STREAM_BUFFER_SIZE_PER_FRAME = std::size_t{4 * 1024 * 1024};
+
+// All quad render modes use at least 4 floats per vertex
+constexpr auto MAX_QUADS_PER_BATCH =
+  BATCH_SIZE_BYTES / (4 * 4 * sizeof(GLfloat));
+
+static_assert(
+  MAX_QUADS_PER_BATCH * 4 <= std::numeric_limits<GLushort>::max() + 1,
+  "Quad indices must fit into 16 bits");
+
 
 constexpr auto WATER_MASK_WIDTH = 8;
 constexpr auto WATER_MASK_HEIGHT = 8;
 constexpr auto WATER_NUM_MASKS = 5;
 constexpr auto WATER_MASK_INDEX_FILLED = 4;
 
+// Texture unit 0 is used for regular textures, 1 holds the water effect mask
+constexpr auto TILE_FLAGS_TEXTURE_UNIT = 2;
+constexpr auto TILE_MAP_TEXTURE_UNIT = 3;
+constexpr auto WATER_LOOKUP_TEXTURE_UNIT = 4;
+
 
 #ifdef RIGEL_USE_GL_ES
 
@@ -95,14 +123,20 @@ const auto SHADER_PREAMBLE = R"shd(
 const auto VERTEX_SOURCE = R"shd(
 ATTRIBUTE vec2 position;
 ATTRIBUTE vec2 texCoord;
+ATTRIBUTE vec4 overlayColor;
+ATTRIBUTE vec4 colorModulation;
 
 OUT vec2 texCoordFrag;
+OUT vec4 overlayColorFrag;
+OUT vec4 colorModulationFrag;
 
 uniform mat4 transform;
 
 void main() {
   gl_Position = transform * vec4(position, 0.0, 1.0);
   texCoordFrag = vec2(texCoord.x, 1.0 - texCoord.y);
+  overlayColorFrag = overlayColor;
+  colorModulationFrag = colorModulation;
 }
 )shd";
 
@@ -110,19 +144,19 @@ const auto FRAGMENT_SOURCE = R"shd(
 OUTPUT_COLOR_DECLARATION
 
 IN vec2 texCoordFrag;
+IN vec4 overlayColorFrag;
+IN vec4 colorModulationFrag;
 
 uniform sampler2D textureData;
-uniform vec4 overlayColor;
-
-uniform vec4 colorModulation;
 
 void main() {
   vec4 baseColor = TEXTURE_LOOKUP(textureData, texCoordFrag);
-  vec4 modulated = baseColor * colorModulation;
+  vec4 modulated = baseColor * colorModulationFrag;
   float targetAlpha = modulated.a;
 
-  OUTPUT_COLOR =
-    vec4(mix(modulated.rgb, overlayColor.rgb, overlayColor.a), targetAlpha);
+  OUTPUT_COLOR = vec4(
+    mix(modulated.rgb, overlayColorFrag.rgb, overlayColorFrag.a),
+    targetAlpha);
 }
 )shd";
 
@@ -178,19 +212,22 @@ IN vec2 texCoordMaskFrag;
 
 uniform sampler2D textureData;
 uniform sampler2D maskData;
-uniform vec3 palette[16];
+uniform sampler2D colorLookupData;
+uniform vec3 nonPaletteWaterColor;
 
 
+// See createWaterColorLookupImage()
 vec4 applyWaterEffect(vec4 color) {
-  int index = 0;
-  for (int i = 0; i < 16; ++i) {
-    if (color.rgb == palette[i]) {
-      index = i;
-    }
-  }
-
-  int adjustedIndex = (index & 0x3) | 0x8;
-  return vec4(palette[adjustedIndex], color.a);
+  vec3 quantized = floor(color.rgb * (255.0 / 16.0));
+  float lookupX = (quantized.r + quantized.b * 16.0 + 0.5) / 256.0;
+  vec3 waterColor = TEXTURE_LOOKUP(
+    colorLookupData, vec2(lookupX, 1.0 - (quantized.g + 0.5) / 32.0)).rgb;
+  vec3 paletteColor = TEXTURE_LOOKUP(
+    colorLookupData, vec2(lookupX, 1.0 - (quantized.g + 16.5) / 32.0)).rgb;
+
+  bool isPaletteColor =
+    all(lessThan(abs(color.rgb - paletteColor), vec3(0.5 / 255.0)));
+  return vec4(isPaletteColor ? waterColor : nonPaletteWaterColor, color.a);
 }
 
 void main() {
@@ -202,6 +239,118 @@ void main() {
 )shd";
 
 
+const auto VERTEX_SOURCE_TILE_MAP = R"shd(
+ATTRIBUTE vec2 position;
+ATTRIBUTE vec2 mapPosition;
+
+OUT vec2 mapPositionFrag;
+
+uniform mat4 transform;
+
+void main() {
+  gl_Position = transform * vec4(position, 0.0, 1.0);
+  mapPositionFrag = mapPosition;
+}
+)shd";
+
+const auto FRAGMENT_SOURCE_TILE_MAP = R"shd(
+#ifdef GL_ES
+  #ifdef GL_FRAGMENT_PRECISION_HIGH
+    precision highp float;
+  #else
+    precision mediump float;
+  #endif
+#endif
+
+OUTPUT_COLOR_DECLARATION
+
+IN vec2 mapPositionFrag;
+
+uniform sampler2D tileSetData;
+uniform sampler2D tileFlagsData;
+uniform sampler2D mapData;
+
+// All sizes are in tiles
+uniform vec2 tileSetSize;
+uniform vec2 mapSize;
+
+// x: fast animation, y: slow animation
+uniform vec2 animOffsets;
+uniform float drawForeground;
+
+const float TILE_SIZE = 8.0;
+
+
+// Textures are stored bottom-up, hence the inverted y coordinate
+vec2 texCoordForTexel(vec2 texel, vec2 textureSize) {
+  vec2 coord = (texel + 0.5) / textureSize;
+  return vec2(coord.x, 1.0 - coord.y);
+}
+
+float decodeTileIndex(vec2 lowAndHighByte) {
+  vec2 bytes = floor(lowAndHighByte * 255.0 + 0.5);
+  return bytes.x + bytes.y * 256.0;
+}
+
+vec2 tileSetPosition(float tileIndex) {
+  float row = floor((tileIndex + 0.5) / tileSetSize.x);
+  return vec2(tileIndex - row * tileSetSize.x, row);
+}
+
+vec4 tileColor(float tileIndex, vec2 pixelInTile) {
+  // Tile index 0 is used to represent a transparent tile, i.e. the backdrop
+  // should be visible.
+  if (tileIndex < 0.5) {
+    return vec4(0.0);
+  }
+
+  // r: foreground, g: animated, b: fast animation
+  vec4 flags = TEXTURE_LOOKUP(
+    tileFlagsData,
+    texCoordForTexel(tileSetPosition(tileIndex), tileSetSize));
+  if (abs(flags.r - drawForeground) > 0.5) {
+    return vec4(0.0);
+  }
+
+  float animOffset = flags.g > 0.5
+    ? (flags.b > 0.5 ? animOffsets.x : animOffsets.y)
+    : 0.0;
+  vec2 texel =
+    tileSetPosition(tileIndex + animOffset) * TILE_SIZE + pixelInTile;
+  return TEXTURE_LOOKUP(
+    tileSetData, texCoordForTexel(texel, tileSetSize * TILE_SIZE));
+}
+
+void main() {
+  vec2 tile = floor(mapPositionFrag / TILE_SIZE);
+  // Areas without any tiles are output as fully transparent instead of being
+  // discarded, so that they also overwrite existing content when blending is
+  // disabled.
+  if (tile.x >= mapSize.x || tile.y >= mapSize.y) {
+    OUTPUT_COLOR = vec4(0.0);
+    return;
+  }
+
+  vec2 pixelInTile = floor(mapPositionFrag - tile * TILE_SIZE);
+  vec4 indices = TEXTURE_LOOKUP(mapData, texCoordForTexel(tile, mapSize));
+
+  // Layer 1 is drawn on top of layer 0
+  vec4 bottom = tileColor(decodeTileIndex(indices.rg), pixelInTile);
+  vec4 top = tileColor(decodeTileIndex(indices.ba), pixelInTile);
+
+  float alpha = top.a + bottom.a * (1.0 - top.a);
+  if (alpha == 0.0) {
+    OUTPUT_COLOR = vec4(0.0);
+    return;
+  }
+
+  vec3 color =
+    (top.rgb * top.a + bottom.rgb * bottom.a * (1.0 - top.a)) / alpha;
+  OUTPUT_COLOR = vec4(color, alpha);
+}
+)shd";
+
+
 base::Rect<int> determineDefaultViewport(SDL_Window* pWindow) {
   // This calculates the required view port coordinates to have aspect-ratio
   // correct scaling from the internal display resolution to the window's
@@ -241,6 +390,16 @@ glm::vec4 toGlColor(const base::Color& color) {
 }
 
 
+base::Color toColor(const glm::vec4& glColor) {
+  const auto scaled = glColor * 255.0f + 0.5f;
+  return base::Color{
+    std::uint8_t(scaled.r),
+    std::uint8_t(scaled.g),
+    std::uint8_t(scaled.b),
+    std::uint8_t(scaled.a)};
+}
+
+
 void setScissorBox(
   const base::Rect<int>& clipRect,
   const base::Size<int>& frameBufferSize
@@ -334,6 +493,105 @@ void fillTexCoords(
 }
 
 
+template <typename Iter>
+void fillColors(
+  const glm::vec4& color,
+  Iter&& destIter,
+  const std::size_t offset,
+  const std::size_t stride
+) {
+  using namespace std;
+  advance(destIter, offset);
+
+  for (auto i = 0; i < 4; ++i) {
+    *destIter++ = color.r;
+    *destIter++ = color.g;
+    *destIter++ = color.b;
+    *destIter++ = color.a;
+
+    if (i < 3) {
+      advance(destIter, stride - 4);
+    }
+  }
+}
+
+
+std::vector<std::uint8_t> toGlPixelData(const data::Image& image) {
+  // OpenGL wants pixel data in bottom-up format, so transform it accordingly
+  std::vector<std::uint8_t> pixelData;
+  pixelData.resize(image.width() * image.height() * 4);
+  for (std::size_t y = 0; y < image.height(); ++y) {
+    const auto sourceRow = image.height() - (y + 1);
+    const auto yOffsetSource = image.width() * sourceRow;
+    const auto yOffset = y * image.width() * 4;
+
+    for (std::size_t x = 0; x < image.width(); ++x) {
+      const auto& pixel = image.pixelData()[x + yOffsetSource];
+      pixelData[x*4 +     yOffset] = pixel.r;
+      pixelData[x*4 + 1 + yOffset] = pixel.g;
+      pixelData[x*4 + 2 + yOffset] = pixel.b;
+      pixelData[x*4 + 3 + yOffset] = pixel.a;
+    }
+  }
+
+  return pixelData;
+}
+
+
+data::Pixel waterColorForIndex(const std::size_t index) {
+  return loader::INGAME_PALETTE[(index & 0x3) | 0x8];
+}
+
+
+/** Water effect result for colors which aren't part of the palette
+ *
+ * These are treated like index 0.
+ */
+data::Pixel nonPaletteWaterColor() {
+  return waterColorForIndex(0);
+}
+
+
+/** Creates a lookup table mapping colors to their water effect counterpart
+ *
+ * The water effect works on palette indices: A color is replaced by the
+ * palette entry at (index & 0x3) | 0x8. To avoid searching the palette for
+ * each pixel, the shader looks up the result in this table instead. Colors
+ * are quantized to 4 bits per channel, which is still enough to tell all
+ * colors of the in-game palette apart. The table is a 16x16x16 cube, laid
+ * out as a 256x16 block with x = red + 16 * blue and y = green.
+ *
+ * Other colors can fall into the same cell as a palette entry, so a second
+ * block below the first one holds the palette color occupying each cell.
+ * Only an exact match with that color gets the cell's water color, anything
+ * else gets nonPaletteWaterColor().
+ */
+data::Image createWaterColorLookupImage() {
+  constexpr auto SIZE_PER_CHANNEL = 16;
+  constexpr auto WIDTH = SIZE_PER_CHANNEL * SIZE_PER_CHANNEL;
+  constexpr auto PALETTE_COLORS_START = WIDTH * SIZE_PER_CHANNEL;
+
+  auto quantize = [](const std::uint8_t value) {
+    return value / (256 / SIZE_PER_CHANNEL);
+  };
+
+  data::PixelBuffer pixels(PALETTE_COLORS_START * 2, nonPaletteWaterColor());
+
+  for (std::size_t index = 0; index < loader::INGAME_PALETTE.size(); ++index) {
+    const auto& color = loader::INGAME_PALETTE[index];
+    const auto x = quantize(color.r) + quantize(color.b) * SIZE_PER_CHANNEL;
+    const auto y = quantize(color.g);
+    pixels[x + y * WIDTH] = waterColorForIndex(index);
+    pixels[x + y * WIDTH + PALETTE_COLORS_START] = color;
+  }
+
+  return data::Image{
+    std::move(pixels),
+    std::size_t(WIDTH),
+    std::size_t(SIZE_PER_CHANNEL * 2)};
+}
+
+
 data::Image createWaterSurfaceAnimImage() {
   auto pixels = data::PixelBuffer{
     WATER_MASK_WIDTH * WATER_MASK_HEIGHT * WATER_NUM_MASKS,
@@ -384,26 +642,12 @@ data::Image createWaterSurfaceAnimImage() {
 }
 
 
-Renderer::Renderer(SDL_Window* pWindow)
+Renderer::Renderer(SDL_Window* pWindow, const RenderBackend backend)
   : mpWindow(pWindow)
-  , mTexturedQuadShader(
-      SHADER_PREAMBLE,
-      VERTEX_SOURCE,
-      FRAGMENT_SOURCE,
-      {"position", "texCoord"})
-  , mSolidColorShader(
-      SHADER_PREAMBLE,
-      VERTEX_SOURCE_SOLID,
-      FRAGMENT_SOURCE_SOLID,
-      {"position", "color"})
-  , mWaterEffectShader(
-      SHADER_PREAMBLE,
-      VERTEX_SOURCE_WATER_EFFECT,
-      FRAGMENT_SOURCE_WATER_EFFECT,
-      {"position", "texCoord", "texCoordMask"})
   , mLastUsedShader(0)
   , mLastUsedTexture(0)
   , mRenderMode(RenderMode::SpriteBatch)
+  , mBlendingEnabled(true)
   , mCurrentFbo(0)
   , mCurrentFramebufferSize(LOGICAL_DISPLAY_WIDTH, LOGICAL_DISPLAY_HEIGHT)
   , mDefaultViewport(determineDefaultViewport(pWindow))
@@ -412,45 +656,93 @@ Renderer::Renderer(SDL_Window* pWindow)
 {
   using namespace std;
 
+  if (backend == RenderBackend::Software) {
+    mpSoftwareRenderer = make_unique<SoftwareRenderer>(
+      LOGICAL_DISPLAY_WIDTH, LOGICAL_DISPLAY_HEIGHT);
+    mWaterSurfaceAnimTexture = createTexture(createWaterSurfaceAnimImage());
+    mWaterColorLookupTexture = createTexture(createWaterColorLookupImage());
+    return;
+  }
+
+  mDummyVao.emplace();
+  mStreamBuffer.emplace(STREAM_BUFFER_SIZE_PER_FRAME);
+  mTexturedQuadShader.emplace(
+    SHADER_PREAMBLE,
+    VERTEX_SOURCE,
+    FRAGMENT_SOURCE,
+    initializer_list<string>{
+      "position", "texCoord", "overlayColor", "colorModulation"});
+  mSolidColorShader.emplace(
+    SHADER_PREAMBLE,
+    VERTEX_SOURCE_SOLID,
+    FRAGMENT_SOURCE_SOLID,
+    initializer_list<string>{"position", "color"});
+  mWaterEffectShader.emplace(
+    SHADER_PREAMBLE,
+    VERTEX_SOURCE_WATER_EFFECT,
+    FRAGMENT_SOURCE_WATER_EFFECT,
+    initializer_list<string>{"position", "texCoord", "texCoordMask"});
+  mTileMapShader.emplace(
+    SHADER_PREAMBLE,
+    VERTEX_SOURCE_TILE_MAP,
+    FRAGMENT_SOURCE_TILE_MAP,
+    initializer_list<string>{"position", "mapPosition"});
+
   // General configuration
   glDisable(GL_DEPTH_TEST);
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   SDL_GL_SetSwapInterval(1);
 
-  // Setup a VBO for streaming data to the GPU, stays bound all the time
-  glGenBuffers(1, &mStreamVbo);
-  glBindBuffer(GL_ARRAY_BUFFER, mStreamVbo);
-  glGenBuffers(1, &mStreamEbo);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mStreamEbo);
+  // The stream buffer binds itself to GL_ARRAY_BUFFER. All quads use the
+  // same index pattern, so we can use a static index buffer which also stays
+  // bound all the time.
+  vector<GLushort> quadIndices;
+  quadIndices.reserve(MAX_QUADS_PER_BATCH * size(QUAD_INDICES));
+  for (auto quad = 0u; quad < MAX_QUADS_PER_BATCH; ++quad) {
+    for (const auto index : QUAD_INDICES) {
+      quadIndices.push_back(GLushort(index + quad * 4));
+    }
+  }
+
+  glGenBuffers(1, &mQuadIndexBuffer);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mQuadIndexBuffer);
+  glBufferData(
+    GL_ELEMENT_ARRAY_BUFFER,
+    sizeof(GLushort) * quadIndices.size(),
+    quadIndices.data(),
+    GL_STATIC_DRAW);
 
   glEnableVertexAttribArray(0);
   glEnableVertexAttribArray(1);
 
   // One-time setup for water effect shader
-  useShaderIfChanged(mWaterEffectShader);
-  array<glm::vec3, 16> palette;
-  transform(
-    begin(loader::INGAME_PALETTE),
-    end(loader::INGAME_PALETTE),
-    begin(palette),
-    [](const base::Color& color) {
-      return glm::vec3{color.r, color.g, color.b} / 255.0f;
-    });
-  mWaterEffectShader.setUniform("palette", palette);
-  mWaterEffectShader.setUniform("textureData", 0);
-  mWaterEffectShader.setUniform("maskData", 1);
+  useShaderIfChanged(*mWaterEffectShader);
+  mWaterEffectShader->setUniform("textureData", 0);
+  mWaterEffectShader->setUniform("maskData", 1);
+  mWaterEffectShader->setUniform("colorLookupData", WATER_LOOKUP_TEXTURE_UNIT);
+  mWaterEffectShader->setUniform(
+    "nonPaletteWaterColor", glm::vec3{toGlColor(nonPaletteWaterColor())});
 
   mWaterSurfaceAnimTexture = createTexture(createWaterSurfaceAnimImage());
+  mWaterColorLookupTexture = createTexture(createWaterColorLookupImage());
 
   glActiveTexture(GL_TEXTURE1);
   glBindTexture(GL_TEXTURE_2D, mWaterSurfaceAnimTexture.mHandle);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glActiveTexture(GL_TEXTURE0 + WATER_LOOKUP_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, mWaterColorLookupTexture.mHandle);
   glActiveTexture(GL_TEXTURE0);
 
+  // One-time setup for tile map shader
+  useShaderIfChanged(*mTileMapShader);
+  mTileMapShader->setUniform("tileSetData", 0);
+  mTileMapShader->setUniform("tileFlagsData", TILE_FLAGS_TEXTURE_UNIT);
+  mTileMapShader->setUniform("mapData", TILE_MAP_TEXTURE_UNIT);
+
   // One-time setup for textured quad shader
-  useShaderIfChanged(mTexturedQuadShader);
-  mTexturedQuadShader.setUniform("textureData", 0);
+  useShaderIfChanged(*mTexturedQuadShader);
+  mTexturedQuadShader->setUniform("textureData", 0);
 
   // Remaining setup
   onRenderTargetChanged();
@@ -460,8 +752,13 @@ Renderer::Renderer(SDL_Window* pWindow)
 
 
 Renderer::~Renderer() {
-  glDeleteBuffers(1, &mStreamVbo);
+  if (mpSoftwareRenderer) {
+    return;
+  }
+
+  glDeleteBuffers(1, &mQuadIndexBuffer);
   glDeleteTextures(1, &mWaterSurfaceAnimTexture.mHandle);
+  glDeleteTextures(1, &mWaterColorLookupTexture.mHandle);
 }
 
 
@@ -471,25 +768,14 @@ base::Rect<int> Renderer::fullScreenRect() const {
 
 
 void Renderer::setOverlayColor(const base::Color& color) {
-  if (color != mLastOverlayColor) {
-    submitBatch();
-
-    setRenderModeIfChanged(RenderMode::SpriteBatch);
-    mTexturedQuadShader.setUniform("overlayColor", toGlColor(color));
-    mLastOverlayColor = color;
-  }
+  // Colors are part of the vertex data, so changing them doesn't require
+  // submitting the current batch
+  mOverlayColor = toGlColor(color);
 }
 
 
 void Renderer::setColorModulation(const base::Color& colorModulation) {
-  if (colorModulation != mLastColorModulation) {
-    submitBatch();
-
-    setRenderModeIfChanged(RenderMode::SpriteBatch);
-    mTexturedQuadShader.setUniform(
-      "colorModulation", toGlColor(colorModulation));
-    mLastColorModulation = colorModulation;
-  }
+  mColorModulation = toGlColor(colorModulation);
 }
 
 
@@ -502,60 +788,120 @@ void Renderer::drawTexture(
     return;
   }
 
-  setRenderModeIfChanged(RenderMode::SpriteBatch);
+  // Commands within a group can be reordered freely. Without a draw order,
+  // each command gets its own group, which keeps them in submission order.
+  if (!mDrawOrder || mDrawOrder != mLastCommandDrawOrder) {
+    ++mCurrentCommandGroup;
+    mLastCommandDrawOrder = mDrawOrder;
+  }
+
+  const auto sortKey =
+    (std::uint64_t{mCurrentCommandGroup} << 32) | textureData.mHandle;
+  mCommands.push_back(TextureDrawCommand{
+    sortKey,
+    textureData,
+    sourceRect,
+    destRect,
+    mOverlayColor,
+    mColorModulation});
+}
+
+
+void Renderer::setDrawOrder(const std::optional<int> drawOrder) {
+  mDrawOrder = drawOrder;
+}
+
+
+void Renderer::submitBatch() {
+  flushCommands();
+  flushBatch();
+}
 
-  if (textureData.mHandle != mLastUsedTexture) {
-    submitBatch();
 
-    glBindTexture(GL_TEXTURE_2D, textureData.mHandle);
-    mLastUsedTexture = textureData.mHandle;
+void Renderer::flushCommands() {
+  if (mCommands.empty()) {
+    return;
   }
 
-  // x, y, tex_u, tex_v
-  GLfloat vertices[4 * (2 + 2)];
-  fillVertexPositions(destRect, std::begin(vertices), 0, 4);
-  fillTexCoords(sourceRect, textureData, std::begin(vertices), 2, 4);
+  // Render target, shader and the remaining state can't differ between
+  // commands, since changing any of them flushes the command list. This
+  // leaves the command group and texture to sort by.
+  std::stable_sort(
+    mCommands.begin(),
+    mCommands.end(),
+    [](const TextureDrawCommand& lhs, const TextureDrawCommand& rhs) {
+      return lhs.mSortKey < rhs.mSortKey;
+    });
 
-  batchQuadVertices(std::cbegin(vertices), std::cend(vertices), 4u);
+  for (const auto& command : mCommands) {
+    executeDrawTexture(command);
+  }
+
+  mCommands.clear();
+  mCurrentCommandGroup = 0;
+  mLastCommandDrawOrder = std::nullopt;
+  ++mStatistics.mCommandFlushes;
 }
 
 
-void Renderer::submitBatch() {
-  if (mBatchData.empty()) {
+void Renderer::executeDrawTexture(const TextureDrawCommand& command) {
+  if (mpSoftwareRenderer) {
+    mpSoftwareRenderer->drawTexture(
+      command.mTexture.mHandle,
+      command.mSourceRect,
+      toRenderTargetCoordinates(command.mDestRect),
+      toColor(command.mOverlayColor),
+      toColor(command.mColorModulation));
+    ++mStatistics.mDrawCalls;
     return;
   }
 
-  auto submitBatchedQuads = [this]() {
-    glBufferData(
-      GL_ARRAY_BUFFER,
-      sizeof(float) * mBatchData.size(),
-      mBatchData.data(),
-      GL_STREAM_DRAW);
-    glBufferData(
-      GL_ELEMENT_ARRAY_BUFFER,
-      sizeof(GLushort) * mBatchIndices.size(),
-      mBatchIndices.data(),
-      GL_STREAM_DRAW);
-    glDrawElements(
-      GL_TRIANGLES,
-      GLsizei(mBatchIndices.size()),
-      GL_UNSIGNED_SHORT,
-      nullptr);
-  };
+  setRenderModeIfChanged(RenderMode::SpriteBatch);
+  bindTextureIfChanged(command.mTexture.mHandle);
+
+  // x, y, tex_u, tex_v, overlay_rgba, modulation_rgba
+  GLfloat vertices[4 * (2 + 2 + 4 + 4)];
+  fillVertexPositions(command.mDestRect, std::begin(vertices), 0, 12);
+  fillTexCoords(
+    command.mSourceRect, command.mTexture, std::begin(vertices), 2, 12);
+  fillColors(command.mOverlayColor, std::begin(vertices), 4, 12);
+  fillColors(command.mColorModulation, std::begin(vertices), 8, 12);
+
+  batchQuadVertices(std::cbegin(vertices), std::cend(vertices), 12u);
+}
+
+
+void Renderer::flushBatch() {
+  if (!mpBatchData) {
+    return;
+  }
+
+  const auto numFloats = mBatchSize;
+  const auto offset = mStreamBuffer->commit(sizeof(GLfloat) * numFloats);
+  mpBatchData = nullptr;
+  mBatchSize = 0;
+  mBatchCapacity = 0;
+
+  if (numFloats == 0) {
+    return;
+  }
+
+  setVertexAttributePointers(offset);
+  ++mStatistics.mDrawCalls;
 
   switch (mRenderMode) {
     case RenderMode::SpriteBatch:
     case RenderMode::WaterEffect:
-      submitBatchedQuads();
+    case RenderMode::TileMap:
+      glDrawElements(
+        GL_TRIANGLES,
+        GLsizei(mBatchQuads * std::size(QUAD_INDICES)),
+        GL_UNSIGNED_SHORT,
+        nullptr);
       break;
 
     case RenderMode::Points:
-      glBufferData(
-        GL_ARRAY_BUFFER,
-        sizeof(float) * mBatchData.size(),
-        mBatchData.data(),
-        GL_STREAM_DRAW);
-      glDrawArrays(GL_POINTS, 0, GLsizei(mBatchData.size() / 6));
+      glDrawArrays(GL_POINTS, 0, GLsizei(numFloats / 6));
       break;
 
     case RenderMode::NonTexturedRender:
@@ -564,8 +910,7 @@ void Renderer::submitBatch() {
       break;
   }
 
-  mBatchData.clear();
-  mBatchIndices.clear();
+  mBatchQuads = 0;
 }
 
 
@@ -579,6 +924,24 @@ void Renderer::drawRectangle(
     return;
   }
 
+  flushCommands();
+
+  if (mpSoftwareRenderer) {
+    const auto corners = std::array<base::Vector, 5>{
+      base::Vector{rect.left(), rect.top()},
+      base::Vector{rect.left(), rect.bottom()},
+      base::Vector{rect.right(), rect.bottom()},
+      base::Vector{rect.right(), rect.top()},
+      base::Vector{rect.left(), rect.top()}};
+    for (auto i = 0u; i < corners.size() - 1; ++i) {
+      mpSoftwareRenderer->drawLine(
+        toRenderTargetCoordinates(corners[i]),
+        toRenderTargetCoordinates(corners[i + 1]),
+        color);
+    }
+    return;
+  }
+
   setRenderModeIfChanged(RenderMode::NonTexturedRender);
 
   const auto left = float(rect.left());
@@ -595,8 +958,7 @@ void Renderer::drawRectangle(
     left, top, colorVec.r, colorVec.g, colorVec.b, colorVec.a
   };
 
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
-  glDrawArrays(GL_LINE_STRIP, 0, 5);
+  drawNonBatched(vertices, sizeof(vertices), GL_LINE_STRIP, 5);
 }
 
 
@@ -609,6 +971,16 @@ void Renderer::drawLine(
 ) {
   // Note: No batching for now, drawLine is only used for debugging at the
   // moment
+  flushCommands();
+
+  if (mpSoftwareRenderer) {
+    mpSoftwareRenderer->drawLine(
+      toRenderTargetCoordinates(base::Vector{x1, y1}),
+      toRenderTargetCoordinates(base::Vector{x2, y2}),
+      color);
+    return;
+  }
+
   setRenderModeIfChanged(RenderMode::NonTexturedRender);
 
   const auto colorVec = toGlColor(color);
@@ -618,8 +990,7 @@ void Renderer::drawLine(
     float(x2), float(y2), colorVec.r, colorVec.g, colorVec.b, colorVec.a
   };
 
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
-  glDrawArrays(GL_LINE_STRIP, 0, 2);
+  drawNonBatched(vertices, sizeof(vertices), GL_LINE_STRIP, 2);
 }
 
 
@@ -632,6 +1003,13 @@ void Renderer::drawPoint(
     return;
   }
 
+  flushCommands();
+
+  if (mpSoftwareRenderer) {
+    mpSoftwareRenderer->drawPoint(toRenderTargetCoordinates(position), color);
+    return;
+  }
+
   setRenderModeIfChanged(RenderMode::Points);
 
   float vertices[] = {
@@ -642,8 +1020,46 @@ void Renderer::drawPoint(
     color.b / 255.0f,
     color.a / 255.0f
   };
-  mBatchData.insert(
-    std::end(mBatchData), std::cbegin(vertices), std::cend(vertices));
+  addToBatch(std::cbegin(vertices), std::cend(vertices));
+}
+
+
+void Renderer::drawPoints(
+  const base::ArrayView<base::Vector>& positions,
+  const base::Color& color
+) {
+  flushCommands();
+
+  if (mpSoftwareRenderer) {
+    const auto& visibleRect = fullScreenRect();
+    for (const auto& position : positions) {
+      if (visibleRect.containsPoint(position)) {
+        mpSoftwareRenderer->drawPoint(
+          toRenderTargetCoordinates(position), color);
+      }
+    }
+    return;
+  }
+
+  setRenderModeIfChanged(RenderMode::Points);
+
+  const auto colorVec = toGlColor(color);
+  const auto& visibleRect = fullScreenRect();
+  for (const auto& position : positions) {
+    if (!visibleRect.containsPoint(position)) {
+      continue;
+    }
+
+    const float vertex[] = {
+      float(position.x),
+      float(position.y),
+      colorVec.r,
+      colorVec.g,
+      colorVec.b,
+      colorVec.a
+    };
+    addToBatch(std::cbegin(vertex), std::cend(vertex));
+  }
 }
 
 
@@ -673,6 +1089,18 @@ void Renderer::drawWaterEffect(
       {areaWidth, WATER_MASK_HEIGHT}
     };
 
+    if (mpSoftwareRenderer) {
+      mpSoftwareRenderer->drawWaterEffect(
+        toRenderTargetCoordinates(destRect),
+        textureData.mHandle,
+        destRect,
+        mWaterSurfaceAnimTexture.mHandle,
+        animSourceRect,
+        mWaterColorLookupTexture.mHandle,
+        nonPaletteWaterColor());
+      return;
+    }
+
     // x, y, tex_u, tex_v, mask_u, mask_v
     GLfloat vertices[4 * (2 + 2 + 2)];
     fillVertexPositions(destRect, std::begin(vertices), 0, 6);
@@ -683,12 +1111,11 @@ void Renderer::drawWaterEffect(
     batchQuadVertices(std::cbegin(vertices), std::cend(vertices), 6);
   };
 
-  setRenderModeIfChanged(RenderMode::WaterEffect);
+  flushCommands();
 
-  if (mLastUsedTexture != textureData.mHandle) {
-    submitBatch();
-    glBindTexture(GL_TEXTURE_2D, textureData.mHandle);
-    mLastUsedTexture = textureData.mHandle;
+  if (!mpSoftwareRenderer) {
+    setRenderModeIfChanged(RenderMode::WaterEffect);
+    bindTextureIfChanged(textureData.mHandle);
   }
 
   if (surfaceAnimationStep) {
@@ -710,6 +1137,103 @@ void Renderer::drawWaterEffect(
 }
 
 
+void Renderer::drawTileMap(
+  const TextureData& tileSet,
+  const TextureData& tileFlags,
+  const TextureData& mapData,
+  const base::Rect<int>& destRect,
+  const base::Vector& mapPixelOffset,
+  const int fastAnimOffset,
+  const int slowAnimOffset,
+  const bool drawForeground
+) {
+  if (!isVisible(destRect)) {
+    return;
+  }
+
+  flushCommands();
+
+  if (mpSoftwareRenderer) {
+    mpSoftwareRenderer->drawTileMap(
+      toRenderTargetCoordinates(destRect),
+      tileSet.mHandle,
+      tileFlags.mHandle,
+      mapData.mHandle,
+      mapPixelOffset,
+      fastAnimOffset,
+      slowAnimOffset,
+      drawForeground);
+    return;
+  }
+
+  setRenderModeIfChanged(RenderMode::TileMap);
+  bindTextureIfChanged(tileSet.mHandle);
+
+  const auto tileSize = float(data::GameTraits::tileSize);
+  const auto state = TileMapState{
+    tileFlags.mHandle,
+    mapData.mHandle,
+    glm::vec2{tileSet.mWidth / tileSize, tileSet.mHeight / tileSize},
+    glm::vec2{float(mapData.mWidth), float(mapData.mHeight)},
+    glm::vec2{float(fastAnimOffset), float(slowAnimOffset)},
+    drawForeground ? 1.0f : 0.0f};
+
+  // Consecutive draws using the same map and parameters are batched
+  if (state != mLastTileMapState) {
+    flushBatch();
+
+    mTileMapShader->setUniform("tileSetSize", state.mTileSetSize);
+    mTileMapShader->setUniform("mapSize", state.mMapSize);
+    mTileMapShader->setUniform("animOffsets", state.mAnimOffsets);
+    mTileMapShader->setUniform("drawForeground", state.mDrawForeground);
+    mLastTileMapState = state;
+  }
+
+  // Texture handles might have been re-used since the last draw, so we always
+  // bind the textures. This is cheap if nothing has changed.
+  glActiveTexture(GL_TEXTURE0 + TILE_FLAGS_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, tileFlags.mHandle);
+  glActiveTexture(GL_TEXTURE0 + TILE_MAP_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, mapData.mHandle);
+  glActiveTexture(GL_TEXTURE0);
+  mStatistics.mTextureBinds += 2;
+
+  const auto mapLeft = float(mapPixelOffset.x);
+  const auto mapTop = float(mapPixelOffset.y);
+
+  // x, y, map_x, map_y
+  GLfloat vertices[4 * (2 + 2)];
+  fillVertexPositions(destRect, std::begin(vertices), 0, 4);
+  fillVertexData(
+    mapLeft,
+    mapLeft + destRect.size.width,
+    mapTop,
+    mapTop + destRect.size.height,
+    std::begin(vertices),
+    2,
+    4);
+
+  batchQuadVertices(std::cbegin(vertices), std::cend(vertices), 4u);
+}
+
+
+void Renderer::setBlendingEnabled(const bool enabled) {
+  if (enabled != mBlendingEnabled) {
+    submitBatch();
+
+    if (mpSoftwareRenderer) {
+      mpSoftwareRenderer->setBlendingEnabled(enabled);
+    } else if (enabled) {
+      glEnable(GL_BLEND);
+    } else {
+      glDisable(GL_BLEND);
+    }
+
+    mBlendingEnabled = enabled;
+  }
+}
+
+
 void Renderer::setGlobalTranslation(const base::Vector& translation) {
   const auto glTranslation = glm::vec2{translation.x, translation.y};
   if (glTranslation != mGlobalTranslation) {
@@ -749,8 +1273,12 @@ void Renderer::setClipRect(const std::optional<base::Rect<int>>& clipRect) {
     return;
   }
 
+  submitBatch();
+
   mClipRect = clipRect;
-  if (mClipRect) {
+  if (mpSoftwareRenderer) {
+    mpSoftwareRenderer->setClipRect(clipRect);
+  } else if (mClipRect) {
     glEnable(GL_SCISSOR_TEST);
 
     setScissorBox(*clipRect, mCurrentFramebufferSize);
@@ -792,11 +1320,80 @@ void Renderer::setRenderTarget(const RenderTarget& target) {
 
 void Renderer::swapBuffers() {
   submitBatch();
+
+  mLastFrameStatistics = mStatistics;
+  mStatistics = Statistics{};
+
+  if (mpSoftwareRenderer) {
+    presentSoftwareFrameBuffer();
+    return;
+  }
+
+  mStreamBuffer->endFrame();
   SDL_GL_SwapWindow(mpWindow);
+
+  mLastFrameStatistics.mVertexBytesUploaded =
+    mStreamBuffer->bytesUploadedLastFrame();
+}
+
+
+void Renderer::presentSoftwareFrameBuffer() {
+  // Without a window, the frame buffer is only accessed via
+  // frameBufferContents()
+  if (!mpWindow) {
+    return;
+  }
+
+  auto pWindowSurface = SDL_GetWindowSurface(mpWindow);
+  if (!pWindowSurface) {
+    return;
+  }
+
+  auto frameBuffer = mpSoftwareRenderer->frameBuffer();
+  auto pFrameSurface = SDL_CreateRGBSurfaceWithFormatFrom(
+    const_cast<data::Pixel*>(frameBuffer.pixelData().data()),
+    int(frameBuffer.width()),
+    int(frameBuffer.height()),
+    32,
+    int(frameBuffer.width() * sizeof(data::Pixel)),
+    SDL_PIXELFORMAT_RGBA32);
+  if (!pFrameSurface) {
+    return;
+  }
+
+  auto destRect = SDL_Rect{
+    mDefaultViewport.topLeft.x,
+    mDefaultViewport.topLeft.y,
+    mDefaultViewport.size.width,
+    mDefaultViewport.size.height};
+  SDL_BlitScaled(pFrameSurface, nullptr, pWindowSurface, &destRect);
+  SDL_FreeSurface(pFrameSurface);
+  SDL_UpdateWindowSurface(mpWindow);
+}
+
+
+std::optional<data::Image> Renderer::frameBufferContents() const {
+  if (mpSoftwareRenderer) {
+    return mpSoftwareRenderer->frameBuffer();
+  }
+
+  return std::nullopt;
+}
+
+
+auto Renderer::statisticsLastFrame() const -> const Statistics& {
+  return mLastFrameStatistics;
 }
 
 
 void Renderer::clear(const base::Color& clearColor) {
+  submitBatch();
+
+  if (mpSoftwareRenderer) {
+    mpSoftwareRenderer->clear(clearColor);
+    return;
+  }
+
   const auto glColor = toGlColor(clearColor);
   glClearColor(glColor.r, glColor.g, glColor.b, glColor.a);
   glClear(GL_COLOR_BUFFER_BIT);
@@ -809,31 +1406,63 @@ void Renderer::batchQuadVertices(
   VertexIter&& dataEnd,
   const std::size_t attributesPerVertex
 ) {
+  assert(
+    std::size_t(std::distance(dataBegin, dataEnd)) == 4 * attributesPerVertex);
+
+  if (mBatchQuads == MAX_QUADS_PER_BATCH) {
+    flushBatch();
+  }
+
+  addToBatch(
+    std::forward<VertexIter>(dataBegin), std::forward<VertexIter>(dataEnd));
+  ++mBatchQuads;
+}
+
+
+template <typename VertexIter>
+void Renderer::addToBatch(VertexIter&& dataBegin, VertexIter&& dataEnd) {
   using namespace std;
 
-  const auto currentIndex = GLushort(mBatchData.size() / attributesPerVertex);
+  const auto numFloats = size_t(distance(dataBegin, dataEnd));
+  if (mpBatchData && mBatchSize + numFloats > mBatchCapacity) {
+    flushBatch();
+  }
 
-  GLushort indices[6];
-  transform(
-    cbegin(QUAD_INDICES),
-    cend(QUAD_INDICES),
-    begin(indices),
-    [&](const GLushort index) -> GLushort {
-      return index + currentIndex;
-    });
+  if (!mpBatchData) {
+    mpBatchData = reinterpret_cast<GLfloat*>(mStreamBuffer->reserve(
+      numFloats * sizeof(GLfloat), BATCH_SIZE_BYTES));
+    mBatchCapacity = mStreamBuffer->reservedSize() / sizeof(GLfloat);
+  }
 
-  // TODO: Limit maximum batch size
-  mBatchData.insert(
-    mBatchData.end(),
+  copy(
     forward<VertexIter>(dataBegin),
-    forward<VertexIter>(dataEnd));
-  mBatchIndices.insert(mBatchIndices.end(), cbegin(indices), cend(indices));
+    forward<VertexIter>(dataEnd),
+    mpBatchData + mBatchSize);
+  mBatchSize += numFloats;
+}
+
+
+void Renderer::drawNonBatched(
+  const GLfloat* pVertices,
+  const std::size_t sizeInBytes,
+  const GLenum primitive,
+  const GLsizei numVertices
+) {
+  flushBatch();
+
+  auto pDestination = mStreamBuffer->reserve(sizeInBytes, sizeInBytes);
+  std::memcpy(pDestination, pVertices, sizeInBytes);
+  const auto offset = mStreamBuffer->commit(sizeInBytes);
+
+  setVertexAttributePointers(offset);
+  glDrawArrays(primitive, 0, numVertices);
+  ++mStatistics.mDrawCalls;
 }
 
 
 void Renderer::setRenderModeIfChanged(const RenderMode mode) {
   if (mRenderMode != mode) {
-    submitBatch();
+    flushBatch();
 
     mRenderMode = mode;
     updateShaders();
@@ -844,71 +1473,76 @@ void Renderer::setRenderModeIfChanged(const RenderMode mode) {
 void Renderer::updateShaders() {
   switch (mRenderMode) {
     case RenderMode::SpriteBatch:
-      useShaderIfChanged(mTexturedQuadShader);
-      mTexturedQuadShader.setUniform("transform", mProjectionMatrix);
-      glVertexAttribPointer(
-        0,
-        2,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(float) * 4,
-        toAttribOffset(0));
-      glVertexAttribPointer(
-        1,
-        2,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(float) * 4,
-        toAttribOffset(2 * sizeof(float)));
-      glDisableVertexAttribArray(2);
+      useShaderIfChanged(*mTexturedQuadShader);
+      mTexturedQuadShader->setUniform("transform", mProjectionMatrix);
+      glEnableVertexAttribArray(2);
+      glEnableVertexAttribArray(3);
       break;
 
     case RenderMode::Points:
     case RenderMode::NonTexturedRender:
-      useShaderIfChanged(mSolidColorShader);
-      mSolidColorShader.setUniform("transform", mProjectionMatrix);
-      glVertexAttribPointer(
-        0,
-        2,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(float) * 6,
-        toAttribOffset(0));
-      glVertexAttribPointer(
-        1,
-        4,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(float) * 6,
-        toAttribOffset(2 * sizeof(float)));
+      useShaderIfChanged(*mSolidColorShader);
+      mSolidColorShader->setUniform("transform", mProjectionMatrix);
       glDisableVertexAttribArray(2);
+      glDisableVertexAttribArray(3);
       break;
 
     case RenderMode::WaterEffect:
-      useShaderIfChanged(mWaterEffectShader);
-      mWaterEffectShader.setUniform("transform", mProjectionMatrix);
-      glVertexAttribPointer(
-        0,
-        2,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(float) * 6,
-        toAttribOffset(0));
-      glVertexAttribPointer(
-        1,
-        2,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(float) * 6,
-        toAttribOffset(2 * sizeof(float)));
-      glVertexAttribPointer(
-        2,
-        2,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(float) * 6,
-        toAttribOffset(4 * sizeof(float)));
+      useShaderIfChanged(*mWaterEffectShader);
+      mWaterEffectShader->setUniform("transform", mProjectionMatrix);
       glEnableVertexAttribArray(2);
+      glDisableVertexAttribArray(3);
+      break;
+
+    case RenderMode::TileMap:
+      useShaderIfChanged(*mTileMapShader);
+      mTileMapShader->setUniform("transform", mProjectionMatrix);
+      glDisableVertexAttribArray(2);
+      glDisableVertexAttribArray(3);
+      break;
+  }
+}
+
+
+void Renderer::setVertexAttributePointers(const std::size_t offset) {
+  auto setAttribute = [offset](
+    const GLuint index,
+    const GLint numComponents,
+    const std::size_t floatsPerVertex,
+    const std::size_t floatOffset
+  ) {
+    glVertexAttribPointer(
+      index,
+      numComponents,
+      GL_FLOAT,
+      GL_FALSE,
+      GLsizei(sizeof(float) * floatsPerVertex),
+      toAttribOffset(offset + floatOffset * sizeof(float)));
+  };
+
+  switch (mRenderMode) {
+    case RenderMode::SpriteBatch:
+      setAttribute(0, 2, 12, 0);
+      setAttribute(1, 2, 12, 2);
+      setAttribute(2, 4, 12, 4);
+      setAttribute(3, 4, 12, 8);
+      break;
+
+    case RenderMode::TileMap:
+      setAttribute(0, 2, 4, 0);
+      setAttribute(1, 2, 4, 2);
+      break;
+
+    case RenderMode::Points:
+    case RenderMode::NonTexturedRender:
+      setAttribute(0, 2, 6, 0);
+      setAttribute(1, 4, 6, 2);
+      break;
+
+    case RenderMode::WaterEffect:
+      setAttribute(0, 2, 6, 0);
+      setAttribute(1, 2, 6, 2);
+      setAttribute(2, 2, 6, 4);
       break;
   }
 }
@@ -918,6 +1552,13 @@ Renderer::RenderTargetHandles Renderer::createRenderTargetTexture(
   const int width,
   const int height
 ) {
+  if (mpSoftwareRenderer) {
+    const auto textureHandle = mpSoftwareRenderer->createTexture(width, height);
+    return {
+      textureHandle,
+      mpSoftwareRenderer->createRenderTarget(textureHandle)};
+  }
+
   const auto textureHandle =
     createGlTexture(GLsizei(width), GLsizei(height), nullptr);
   glBindTexture(GL_TEXTURE_2D, textureHandle);
@@ -940,23 +1581,14 @@ Renderer::RenderTargetHandles Renderer::createRenderTargetTexture(
 
 
 auto Renderer::createTexture(const data::Image& image) -> TextureData {
-  // OpenGL wants pixel data in bottom-up format, so transform it accordingly
-  std::vector<std::uint8_t> pixelData;
-  pixelData.resize(image.width() * image.height() * 4);
-  for (std::size_t y = 0; y < image.height(); ++y) {
-    const auto sourceRow = image.height() - (y + 1);
-    const auto yOffsetSource = image.width() * sourceRow;
-    const auto yOffset = y * image.width() * 4;
-
-    for (std::size_t x = 0; x < image.width(); ++x) {
-      const auto& pixel = image.pixelData()[x + yOffsetSource];
-      pixelData[x*4 +     yOffset] = pixel.r;
-      pixelData[x*4 + 1 + yOffset] = pixel.g;
-      pixelData[x*4 + 2 + yOffset] = pixel.b;
-      pixelData[x*4 + 3 + yOffset] = pixel.a;
-    }
+  if (mpSoftwareRenderer) {
+    return {
+      int(image.width()),
+      int(image.height()),
+      mpSoftwareRenderer->createTexture(image)};
   }
 
+  const auto pixelData = toGlPixelData(image);
   auto handle = createGlTexture(
     GLsizei(image.width()),
     GLsizei(image.height()),
@@ -965,6 +1597,66 @@ auto Renderer::createTexture(const data::Image& image) -> TextureData {
 }
 
 
+void Renderer::updateTextureRegion(
+  const TextureData& textureData,
+  const base::Vector& position,
+  const data::Image& image
+) {
+  assert(
+    position.x >= 0 &&
+    position.y >= 0 &&
+    position.x + int(image.width()) <= textureData.mWidth &&
+    position.y + int(image.height()) <= textureData.mHeight);
+
+  // Pending draws might use the texture, so they need to happen before
+  // its contents change
+  submitBatch();
+
+  if (mpSoftwareRenderer) {
+    mpSoftwareRenderer->updateTextureRegion(
+      textureData.mHandle, position, image);
+    return;
+  }
+
+  const auto pixelData = toGlPixelData(image);
+
+  // Texture rows are stored bottom-up, see toGlPixelData()
+  const auto offsetFromBottom =
+    textureData.mHeight - (position.y + int(image.height()));
+
+  glBindTexture(GL_TEXTURE_2D, textureData.mHandle);
+  glTexSubImage2D(
+    GL_TEXTURE_2D,
+    0,
+    position.x,
+    offsetFromBottom,
+    GLsizei(image.width()),
+    GLsizei(image.height()),
+    GL_RGBA,
+    GL_UNSIGNED_BYTE,
+    pixelData.data());
+  glBindTexture(GL_TEXTURE_2D, mLastUsedTexture);
+}
+
+
+void Renderer::destroyTexture(const GLuint handle) {
+  if (mpSoftwareRenderer) {
+    mpSoftwareRenderer->destroyTexture(handle);
+  } else {
+    glDeleteTextures(1, &handle);
+  }
+}
+
+
+void Renderer::destroyRenderTarget(const GLuint fbo) {
+  if (mpSoftwareRenderer) {
+    mpSoftwareRenderer->destroyRenderTarget(fbo);
+  } else {
+    glDeleteFramebuffers(1, &fbo);
+  }
+}
+
+
 GLuint Renderer::createGlTexture(
   const GLsizei width,
   const GLsizei height,
@@ -1000,6 +1692,18 @@ void Renderer::useShaderIfChanged(Shader& shader) {
   if (shader.handle() != mLastUsedShader) {
     shader.use();
     mLastUsedShader = shader.handle();
+    ++mStatistics.mShaderSwitches;
+  }
+}
+
+
+void Renderer::bindTextureIfChanged(const GLuint handle) {
+  if (handle != mLastUsedTexture) {
+    flushBatch();
+
+    glBindTexture(GL_TEXTURE_2D, handle);
+    mLastUsedTexture = handle;
+    ++mStatistics.mTextureBinds;
   }
 }
 
@@ -1010,6 +1714,12 @@ bool Renderer::isVisible(const base::Rect<int>& rect) const {
 
 
 void Renderer::onRenderTargetChanged() {
+  if (mpSoftwareRenderer) {
+    mpSoftwareRenderer->setRenderTarget(mCurrentFbo);
+    updateProjectionMatrix();
+    return;
+  }
+
   glBindFramebuffer(GL_FRAMEBUFFER, mCurrentFbo);
   if (mCurrentFbo == 0) {
     glViewport(
@@ -1040,7 +1750,31 @@ void Renderer::updateProjectionMatrix() {
     glm::scale(projection, glm::vec3(mGlobalScale, 1.0f)),
     glm::vec3(mGlobalTranslation, 0.0f));
 
-  updateShaders();
+  if (!mpSoftwareRenderer) {
+    updateShaders();
+  }
+}
+
+
+base::Vector Renderer::toRenderTargetCoordinates(
+  const base::Vector& position
+) const {
+  const auto translated = position + globalTranslation();
+  return {
+    int(translated.x * mGlobalScale.x),
+    int(translated.y * mGlobalScale.y)};
+}
+
+
+base::Rect<int> Renderer::toRenderTargetCoordinates(
+  const base::Rect<int>& rect
+) const {
+  return {
+    toRenderTargetCoordinates(rect.topLeft),
+    {
+      int(rect.size.width * mGlobalScale.x),
+      int(rect.size.height * mGlobalScale.y)
+    }};
 }
 
 }}
@@ -16,12 +16,14 @@
 
 #pragma once
 
+#include "base/array_view.hpp"
 #include "base/color.hpp"
 #include "base/spatial_types.hpp"
 #include "base/warnings.hpp"
 #include "data/image.hpp"
 #include "engine/opengl.hpp"
 #include "engine/shader.hpp"
+#include "engine/stream_buffer.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <glm/mat4x4.hpp>
@@ -29,12 +31,29 @@ RIGEL_DISABLE_WARNINGS
 RIGEL_RESTORE_WARNINGS
 
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <tuple>
+#include <vector>
 
 
 namespace rigel { namespace engine {
 
+class SoftwareRenderer;
+
+
+enum class RenderBackend {
+  OpenGl,
+
+  /** Rasterize on the CPU, doesn't need an OpenGL context
+   *
+   * The window is optional for this backend. If given, frames are shown
+   * using the window's surface.
+   */
+  Software
+};
+
+
 class Renderer {
 public:
   // TODO: Re-evaluate how render targets work
@@ -81,6 +100,15 @@ public:
     GLuint fbo;
   };
 
+  /** Counters for the work done by the renderer during a frame */
+  struct Statistics {
+    std::size_t mDrawCalls = 0;
+    std::size_t mTextureBinds = 0;
+    std::size_t mShaderSwitches = 0;
+    std::size_t mCommandFlushes = 0;
+    std::size_t mVertexBytesUploaded = 0;
+  };
+
 
   class StateSaver {
   public:
@@ -112,19 +140,47 @@ public:
   };
 
 
-  explicit Renderer(SDL_Window* pWindow);
+  explicit Renderer(
+    SDL_Window* pWindow,
+    RenderBackend backend = RenderBackend::OpenGl);
   ~Renderer();
 
   base::Rect<int> fullScreenRect() const;
 
+  /** Set colors to apply to subsequent drawTexture() calls
+   *
+   * The overlay color is blended on top of the texture's color according to
+   * its alpha value. The modulation color is multiplied with the texture's
+   * color. Both are passed along with each vertex, so they can be changed
+   * freely without breaking up batches.
+   */
   void setOverlayColor(const base::Color& color);
   void setColorModulation(const base::Color& colorModulation);
 
+  /** Draw (part of) a texture
+   *
+   * Texture draws are recorded in a command list instead of being executed
+   * right away. The list is executed once anything else needs to happen,
+   * e.g. a different kind of draw, a change to the clip rect or render
+   * target, or the end of the frame. See also setDrawOrder().
+   */
   void drawTexture(
     const TextureData& textureData,
     const base::Rect<int>& pSourceRect,
     const base::Rect<int>& pDestRect);
 
+  /** Allow reordering subsequent drawTexture() calls to save state changes
+   *
+   * By default, recorded texture draws are executed in the order they were
+   * made. Consecutive draws made while the same draw order is set form a
+   * group, which is sorted by texture before execution. Each change of the
+   * draw order starts a new group, and groups are always executed in the
+   * order they were made. Callers should thus pass the actual draw order of
+   * what's being drawn, and only for things whose relative order within that
+   * draw order doesn't matter. Passing nullopt restores the default.
+   */
+  void setDrawOrder(std::optional<int> drawOrder);
+
   void drawRectangle(
     const base::Rect<int>& rect,
     const base::Color& color);
@@ -147,11 +203,52 @@ public:
 
   void drawPoint(const base::Vector& position, const base::Color& color);
 
+  /** Draw many points of the same color
+   *
+   * Like calling drawPoint() for each position, but with less overhead.
+   */
+  void drawPoints(
+    const base::ArrayView<base::Vector>& positions,
+    const base::Color& color);
+
+  /** Apply the water effect to an area of the given screen texture
+   *
+   * Consecutive calls using the same screen texture end up in a single draw
+   * call, so all water areas of a frame should be drawn back to back.
+   */
   void drawWaterEffect(
     const base::Rect<int>& area,
     TextureData unprocessedScreen,
     std::optional<int> surfaceAnimationStep);
 
+  /** Draw a section of a tile map, resolving tiles on the GPU
+   *
+   * mapData holds one texel per map tile. The tile index for layer 0 is
+   * stored in the red (low byte) and green (high byte) channels, the one for
+   * layer 1 in blue and alpha. tileFlags has one texel per tile of the tile
+   * set, using the same layout as the tile set itself. Red marks foreground
+   * tiles, green animated ones, and blue means fast animation.
+   *
+   * destRect is filled with the part of the map starting at mapPixelOffset.
+   * Only tiles whose foreground flag matches drawForeground are drawn.
+   */
+  void drawTileMap(
+    const TextureData& tileSet,
+    const TextureData& tileFlags,
+    const TextureData& mapData,
+    const base::Rect<int>& destRect,
+    const base::Vector& mapPixelOffset,
+    int fastAnimOffset,
+    int slowAnimOffset,
+    bool drawForeground);
+
+  /** Enable or disable alpha blending (enabled by default)
+   *
+   * With blending disabled, drawing replaces the target's contents including
+   * the alpha channel.
+   */
+  void setBlendingEnabled(bool enabled);
+
   void setGlobalTranslation(const base::Vector& translation);
   base::Vector globalTranslation() const;
 
@@ -167,15 +264,36 @@ public:
   void clear(const base::Color& clearColor = {0, 0, 0, 255});
   void swapBuffers();
 
+  /** Execute all recorded commands and submit the current batch */
   void submitBatch();
 
+  const Statistics& statisticsLastFrame() const;
+
   TextureData createTexture(const data::Image& image);
+  void destroyTexture(GLuint handle);
+
+  /** Replace part of an existing texture's contents with the given image
+   *
+   * The position refers to the top-left corner of the area to update, using
+   * the same (top-down) coordinate system as source rects for drawTexture().
+   */
+  void updateTextureRegion(
+    const TextureData& textureData,
+    const base::Vector& position,
+    const data::Image& image);
 
   // TODO: Revisit the render target API and its use in RenderTargetTexture,
   // there should be a nicer way to do this.
   RenderTargetHandles createRenderTargetTexture(
     int width,
     int height);
+  void destroyRenderTarget(GLuint fbo);
+
+  /** Returns a copy of the default frame buffer's contents
+   *
+   * Only available with the software backend, returns nullopt otherwise.
+   */
+  std::optional<data::Image> frameBufferContents() const;
 
 private:
   class DummyVao {
@@ -202,20 +320,81 @@ private:
     SpriteBatch,
     NonTexturedRender,
     Points,
-    WaterEffect
+    WaterEffect,
+    TileMap
+  };
+
+  struct TileMapState {
+    bool operator==(const TileMapState& other) const {
+      return
+        std::tie(
+          mTileFlagsHandle,
+          mMapDataHandle,
+          mTileSetSize,
+          mMapSize,
+          mAnimOffsets,
+          mDrawForeground) ==
+        std::tie(
+          other.mTileFlagsHandle,
+          other.mMapDataHandle,
+          other.mTileSetSize,
+          other.mMapSize,
+          other.mAnimOffsets,
+          other.mDrawForeground);
+    }
+
+    bool operator!=(const TileMapState& other) const {
+      return !(*this == other);
+    }
+
+    GLuint mTileFlagsHandle = 0;
+    GLuint mMapDataHandle = 0;
+    glm::vec2 mTileSetSize{0.0f, 0.0f};
+    glm::vec2 mMapSize{0.0f, 0.0f};
+    glm::vec2 mAnimOffsets{0.0f, 0.0f};
+    float mDrawForeground = 0.0f;
+  };
+
+  struct TextureDrawCommand {
+    // Command group in the upper 32 bits, texture handle in the lower ones
+    std::uint64_t mSortKey;
+    TextureData mTexture;
+    base::Rect<int> mSourceRect;
+    base::Rect<int> mDestRect;
+    glm::vec4 mOverlayColor;
+    glm::vec4 mColorModulation;
   };
 
+  void flushCommands();
+  void executeDrawTexture(const TextureDrawCommand& command);
+  void flushBatch();
+
   template <typename VertexIter>
   void batchQuadVertices(
     VertexIter&& dataBegin,
     VertexIter&& dataEnd,
     const std::size_t attributesPerVertex);
 
+  template <typename VertexIter>
+  void addToBatch(VertexIter&& dataBegin, VertexIter&& dataEnd);
+
+  void drawNonBatched(
+    const GLfloat* pVertices,
+    std::size_t sizeInBytes,
+    GLenum primitive,
+    GLsizei numVertices);
+
   bool isVisible(const base::Rect<int>& rect) const;
 
+  base::Vector toRenderTargetCoordinates(const base::Vector& position) const;
+  base::Rect<int> toRenderTargetCoordinates(const base::Rect<int>& rect) const;
+  void presentSoftwareFrameBuffer();
+
   void useShaderIfChanged(Shader& shader);
+  void bindTextureIfChanged(GLuint handle);
   void setRenderModeIfChanged(RenderMode mode);
   void updateShaders();
+  void setVertexAttributePointers(std::size_t offset);
   void onRenderTargetChanged();
   void updateProjectionMatrix();
 
@@ -227,25 +406,44 @@ private:
 private:
   SDL_Window* mpWindow;
 
-  DummyVao mDummyVao;
-  GLuint mStreamVbo;
-  GLuint mStreamEbo;
+  // Set when using the software backend. The OpenGL specific members below
+  // are left empty in that case.
+  std::unique_ptr<SoftwareRenderer> mpSoftwareRenderer;
+
+  std::optional<DummyVao> mDummyVao;
+  std::optional<StreamBuffer> mStreamBuffer;
+  GLuint mQuadIndexBuffer = 0;
 
-  Shader mTexturedQuadShader;
-  Shader mSolidColorShader;
-  Shader mWaterEffectShader;
+  std::optional<Shader> mTexturedQuadShader;
+  std::optional<Shader> mSolidColorShader;
+  std::optional<Shader> mWaterEffectShader;
+  std::optional<Shader> mTileMapShader;
 
   GLuint mLastUsedShader;
   GLuint mLastUsedTexture;
-  base::Color mLastColorModulation;
-  base::Color mLastOverlayColor;
+  glm::vec4 mColorModulation{1.0f, 1.0f, 1.0f, 1.0f};
+  glm::vec4 mOverlayColor{0.0f, 0.0f, 0.0f, 0.0f};
 
   RenderMode mRenderMode;
+  TileMapState mLastTileMapState;
+  bool mBlendingEnabled;
+
+  // Points into memory provided by mStreamBuffer while a batch is open
+  GLfloat* mpBatchData = nullptr;
+  std::size_t mBatchSize = 0;
+  std::size_t mBatchCapacity = 0;
+  std::size_t mBatchQuads = 0;
+
+  std::vector<TextureDrawCommand> mCommands;
+  std::optional<int> mDrawOrder;
+  std::optional<int> mLastCommandDrawOrder;
+  std::uint32_t mCurrentCommandGroup = 0;
 
-  std::vector<GLfloat> mBatchData;
-  std::vector<GLushort> mBatchIndices;
+  Statistics mStatistics;
+  Statistics mLastFrameStatistics;
 
   TextureData mWaterSurfaceAnimTexture;
+  TextureData mWaterColorLookupTexture;
 
   GLuint mCurrentFbo;
   base::Size<int> mCurrentFramebufferSize;
@@ -20,8 +20,8 @@
 #include "data/unit_conversions.hpp"
 #include "engine/physics_system.hpp"
 #include "engine/sprite_tools.hpp"
+#include "engine/tile_debris_system.hpp"
 #include "game_logic/actor_tag.hpp"
-#include "game_logic/dynamic_geometry_components.hpp"
 
 #include <algorithm>
 #include <functional>
@@ -43,6 +43,24 @@ using components::WorldPosition;
 
 namespace {
 
+// Range of draw orders assigned by adjustedDrawOrder() in
+// entity_configuration.ipp. Actor draw orders are scaled by 10, player
+// projectiles, muzzle flashes and effects come after the highest actor draw
+// order, and the bomber plane's bomb uses -1. Each draw order in this range
+// gets its own bucket.
+constexpr auto MIN_BUCKETED_DRAW_ORDER = -1;
+constexpr auto MAX_BUCKETED_DRAW_ORDER =
+  (data::GameTraits::maxDrawOrder + 3) * 10;
+constexpr auto NUM_DRAW_ORDER_BUCKETS =
+  MAX_BUCKETED_DRAW_ORDER - MIN_BUCKETED_DRAW_ORDER + 1;
+
+
+bool isBucketed(const int drawOrder) {
+  return
+    drawOrder >= MIN_BUCKETED_DRAW_ORDER &&
+    drawOrder <= MAX_BUCKETED_DRAW_ORDER;
+}
+
 
 void advanceAnimation(Sprite& sprite, AnimationLoop& animated) {
   const auto numFrames = static_cast<int>(sprite.mpDrawData->mFrames.size());
@@ -63,6 +81,51 @@ void advanceAnimation(Sprite& sprite, AnimationLoop& animated) {
   sprite.mFramesToRender[animated.mRenderSlot] = newFrameNr;
 }
 
+
+base::Rect<int> frameBounds(
+  const SpriteFrame& frame,
+  const base::Vector& position
+) {
+  // See drawSpriteFrame()
+  const auto widthTiles = data::pixelsToTiles(frame.mImage.width());
+  const auto heightTiles = data::pixelsToTiles(frame.mImage.height());
+  const auto topLeft =
+    position - base::Vector(0, heightTiles - 1) + frame.mDrawOffset;
+  return {topLeft, {widthTiles, heightTiles}};
+}
+
+
+bool isVisible(
+  const ex::Entity entity,
+  const Sprite& sprite,
+  const WorldPosition& position,
+  const base::Rect<int>& viewPort
+) {
+  if (!sprite.mShow) {
+    return false;
+  }
+
+  // We don't know what a custom render function is going to draw
+  if (entity.has_component<CustomRenderFunc>()) {
+    return true;
+  }
+
+  for (const auto baseFrameIndex : sprite.mFramesToRender) {
+    if (baseFrameIndex == IGNORE_RENDER_SLOT) {
+      continue;
+    }
+
+    const auto frameIndex =
+      virtualToRealFrame(baseFrameIndex, *sprite.mpDrawData, entity);
+    const auto& frame = sprite.mpDrawData->mFrames[frameIndex];
+    if (frameBounds(frame, position).intersects(viewPort)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 }
 
 
@@ -91,53 +154,54 @@ int virtualToRealFrame(
 
 
 void updateAnimatedSprites(ex::EntityManager& es) {
-  es.each<Sprite, AnimationLoop>([](
-    ex::Entity entity,
-    Sprite& sprite,
-    AnimationLoop& animated
-  ) {
-    ++animated.mFramesElapsed;
-    if (animated.mFramesElapsed >= animated.mDelayInFrames) {
-      animated.mFramesElapsed = 0;
-      advanceAnimation(sprite, animated);
-
-      if (
-        entity.has_component<components::BoundingBox>() &&
-        animated.mRenderSlot == 0
-      ) {
-        engine::synchronizeBoundingBoxToSprite(entity);
+  // Animating one sprite doesn't affect any others, so all the per-sprite
+  // work is done in a single pass over all sprites.
+  es.each<Sprite>([](ex::Entity entity, Sprite& sprite) {
+    if (entity.has_component<AnimationLoop>()) {
+      auto& animated = *entity.component<AnimationLoop>();
+
+      ++animated.mFramesElapsed;
+      if (animated.mFramesElapsed >= animated.mDelayInFrames) {
+        animated.mFramesElapsed = 0;
+        advanceAnimation(sprite, animated);
+
+        if (
+          entity.has_component<components::BoundingBox>() &&
+          animated.mRenderSlot == 0
+        ) {
+          engine::synchronizeBoundingBoxToSprite(entity);
+        }
       }
     }
-  });
 
-  es.each<Sprite, AnimationSequence>([](
-    ex::Entity entity,
-    Sprite& sprite,
-    AnimationSequence& sequence
-  ) {
-    ++sequence.mCurrentFrame;
-    if (sequence.mCurrentFrame >= sequence.mFrames.size()) {
-      if (sequence.mRepeat) {
-        sequence.mCurrentFrame = 0;
-      } else {
-        entity.remove<AnimationSequence>();
-        return;
+    if (entity.has_component<AnimationSequence>()) {
+      auto& sequence = *entity.component<AnimationSequence>();
+
+      ++sequence.mCurrentFrame;
+      auto sequenceFinished = false;
+      if (sequence.mCurrentFrame >= sequence.mFrames.size()) {
+        if (sequence.mRepeat) {
+          sequence.mCurrentFrame = 0;
+        } else {
+          entity.remove<AnimationSequence>();
+          sequenceFinished = true;
+        }
       }
-    }
 
-    sprite.mFramesToRender[sequence.mRenderSlot] =
-      sequence.mFrames[sequence.mCurrentFrame];
+      if (!sequenceFinished) {
+        sprite.mFramesToRender[sequence.mRenderSlot] =
+          sequence.mFrames[sequence.mCurrentFrame];
 
-    if (
-      entity.has_component<components::BoundingBox>() &&
-      sequence.mRenderSlot == 0
-    ) {
-      engine::synchronizeBoundingBoxToSprite(entity);
+        if (
+          entity.has_component<components::BoundingBox>() &&
+          sequence.mRenderSlot == 0
+        ) {
+          engine::synchronizeBoundingBoxToSprite(entity);
+        }
+      }
     }
-  });
 
-  es.each<Sprite>([](ex::Entity entity, Sprite& sprite) {
-     sprite.mFlashingWhite = false;
+    sprite.mFlashingWhite = false;
   });
 }
 
@@ -195,7 +259,10 @@ RenderingSystem::RenderingSystem(
   const base::Vector* pCameraPosition,
   engine::Renderer* pRenderer,
   const data::map::Map* pMap,
-  MapRenderer::MapRenderData&& mapRenderData
+  MapRenderer::MapRenderData&& mapRenderData,
+  const TileDebrisSystem* pTileDebris,
+  ex::EntityManager& entities,
+  ex::EventManager& eventManager
 )
   : mpRenderer(pRenderer)
   , mRenderTarget(
@@ -204,33 +271,118 @@ RenderingSystem::RenderingSystem(
       data::GameTraits::inGameViewPortSize.height)
   , mMapRenderer(pRenderer, pMap, std::move(mapRenderData))
   , mpCameraPosition(pCameraPosition)
+  , mpTileDebris(pTileDebris)
+  , mSprites(entities, eventManager)
+  , mSpriteBuckets(NUM_DRAW_ORDER_BUCKETS * 2)
 {
 }
 
 
+// Defined here because SpriteData is incomplete in the header
+RenderingSystem::~RenderingSystem() = default;
+
+
 void RenderingSystem::update(
   ex::EntityManager& es,
   const std::optional<base::Color>& backdropFlashColor
 ) {
   using namespace std;
-  using game_logic::components::TileDebris;
 
-  // Collect sprites, then order by draw index
-  vector<SpriteData> spritesByDrawOrder;
-  es.each<Sprite, WorldPosition>([&spritesByDrawOrder](
+  // Collect visible sprites into buckets by (top-most, draw order). The
+  // buckets are kept across frames to avoid re-allocating memory.
+  for (auto& bucket : mSpriteBuckets) {
+    bucket.clear();
+  }
+  mUnbucketedSprites.clear();
+
+  const auto viewPort = base::Rect<int>{
+    *mpCameraPosition,
+    {
+      data::GameTraits::mapViewPortWidthTiles,
+      data::GameTraits::mapViewPortHeightTiles
+    }};
+
+  mSpritesCulled = 0;
+  mSpritesRendered = 0;
+  mSprites.forEach([&, this](
     ex::Entity entity,
     Sprite& sprite,
     const WorldPosition& pos
   ) {
+    if (!isVisible(entity, sprite, pos, viewPort)) {
+      ++mSpritesCulled;
+      return;
+    }
+
+    ++mSpritesRendered;
+
     const auto drawTopMost = entity.has_component<DrawTopMost>();
-    spritesByDrawOrder.emplace_back(entity, &sprite, drawTopMost, pos);
+    SpriteData data{entity, &sprite, drawTopMost, pos};
+    if (!isBucketed(data.mDrawOrder)) {
+      mUnbucketedSprites.push_back(data);
+      return;
+    }
+
+    const auto bucketIndex =
+      std::size_t(data.mDrawOrder - MIN_BUCKETED_DRAW_ORDER) +
+      (drawTopMost ? NUM_DRAW_ORDER_BUCKETS : 0);
+    mSpriteBuckets[bucketIndex].push_back(data);
   });
-  sort(begin(spritesByDrawOrder), end(spritesByDrawOrder));
 
-  const auto firstTopMostIt = find_if(
-    begin(spritesByDrawOrder),
-    end(spritesByDrawOrder),
-    mem_fn(&SpriteData::mDrawTopMost));
+  // The sprite group visits entities in order of entity index, so sprites
+  // within a bucket are in a deterministic order. Draw orders outside of the
+  // bucketed range don't occur in the game's data, but are still handled
+  // correctly, via sorting.
+  stable_sort(begin(mUnbucketedSprites), end(mUnbucketedSprites));
+  const auto firstUnbucketedTopMost = partition_point(
+    mUnbucketedSprites.cbegin(),
+    mUnbucketedSprites.cend(),
+    [](const SpriteData& data) { return !data.mDrawTopMost; });
+
+  // Sprites sharing a draw order can be drawn in any order, which lets the
+  // renderer group them by texture. The renderer never reorders draws across
+  // different draw orders. Sprites made up of multiple draws need to keep
+  // their internal order, though.
+  auto renderSprites = [this](const auto first, const auto last) {
+    for (auto it = first; it != last; ++it) {
+      const SpriteData& data = *it;
+      const auto isSingleDraw =
+        !data.mEntity.has_component<CustomRenderFunc>() &&
+        data.mpSprite->mFramesToRender.size() == 1;
+      mpRenderer->setDrawOrder(
+        isSingleDraw ? std::optional<int>(data.mDrawOrder) : std::nullopt);
+
+      renderSprite(data);
+    }
+  };
+
+  auto renderSpriteGroup = [&, this](const bool topMost) {
+    const auto firstUnbucketed = topMost
+      ? firstUnbucketedTopMost
+      : mUnbucketedSprites.cbegin();
+    const auto lastUnbucketed = topMost
+      ? mUnbucketedSprites.cend()
+      : firstUnbucketedTopMost;
+    const auto firstAboveBuckets = partition_point(
+      firstUnbucketed,
+      lastUnbucketed,
+      [](const SpriteData& data) {
+        return data.mDrawOrder < MIN_BUCKETED_DRAW_ORDER;
+      });
+
+    renderSprites(firstUnbucketed, firstAboveBuckets);
+
+    const auto firstBucket =
+      mSpriteBuckets.cbegin() + (topMost ? NUM_DRAW_ORDER_BUCKETS : 0);
+    for_each(
+      firstBucket,
+      firstBucket + NUM_DRAW_ORDER_BUCKETS,
+      [&](const auto& bucket) { renderSprites(bucket.begin(), bucket.end()); });
+
+    renderSprites(firstAboveBuckets, lastUnbucketed);
+
+    mpRenderer->setDrawOrder(std::nullopt);
+  };
 
   {
     RenderTargetTexture::Binder bindRenderTarget(mRenderTarget, mpRenderer);
@@ -247,9 +399,7 @@ void RenderingSystem::update(
     mMapRenderer.renderBackground(*mpCameraPosition);
 
     // behind foreground
-    for (auto it = spritesByDrawOrder.cbegin(); it != firstTopMostIt; ++it) {
-      renderSprite(*it);
-    }
+    renderSpriteGroup(false);
   }
 
 
@@ -260,18 +410,10 @@ void RenderingSystem::update(
   mMapRenderer.renderForeground(*mpCameraPosition);
 
   // top most
-  for (auto it = firstTopMostIt; it != spritesByDrawOrder.cend(); ++it) {
-    renderSprite(*it);
-  }
-
-  mSpritesRendered = spritesByDrawOrder.size();
+  renderSpriteGroup(true);
 
 
-  // tile debris
-  es.each<TileDebris, WorldPosition>(
-    [this](ex::Entity, const TileDebris& debris, const WorldPosition& pos) {
-      mMapRenderer.renderSingleTile(debris.mTileIndex, pos, *mpCameraPosition);
-    });
+  mpTileDebris->render(mMapRenderer, *mpCameraPosition);
 }
 
 
@@ -19,6 +19,7 @@
 #include "base/spatial_types.hpp"
 #include "base/warnings.hpp"
 #include "engine/base_components.hpp"
+#include "engine/component_group.hpp"
 #include "engine/map_renderer.hpp"
 #include "engine/renderer.hpp"
 #include "engine/texture.hpp"
@@ -37,6 +38,9 @@ RIGEL_RESTORE_WARNINGS
 
 namespace rigel { namespace engine {
 
+class TileDebrisSystem;
+
+
 /** Animates sprites with an AnimationLoop component
  *
  * Should be called at game-logic rate. Works on all entities that have a
@@ -59,7 +63,11 @@ public:
     const base::Vector* pCameraPosition,
     engine::Renderer* pRenderer,
     const data::map::Map* pMap,
-    MapRenderer::MapRenderData&& mapRenderData);
+    MapRenderer::MapRenderData&& mapRenderData,
+    const TileDebrisSystem* pTileDebris,
+    entityx::EntityManager& entities,
+    entityx::EventManager& eventManager);
+  ~RenderingSystem();
 
   /** Update map tile animation state. Should be called at game-logic rate. */
   void updateAnimatedMapTiles() {
@@ -84,6 +92,10 @@ public:
     return mSpritesRendered;
   }
 
+  std::size_t spritesCulled() const {
+    return mSpritesCulled;
+  }
+
 private:
   struct SpriteData;
   void renderSprite(const SpriteData& data) const;
@@ -94,8 +106,13 @@ private:
   engine::RenderTargetTexture mRenderTarget;
   MapRenderer mMapRenderer;
   const base::Vector* mpCameraPosition;
+  const TileDebrisSystem* mpTileDebris;
+  ComponentGroup<components::Sprite, components::WorldPosition> mSprites;
   int mWaterAnimStep = 0;
+  std::vector<std::vector<SpriteData>> mSpriteBuckets;
+  std::vector<SpriteData> mUnbucketedSprites;
   std::size_t mSpritesRendered = 0;
+  std::size_t mSpritesCulled = 0;
 };
 
 }}
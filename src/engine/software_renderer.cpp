@@ -0,0 +1,571 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "software_renderer.hpp"
+
+#include "data/game_traits.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+  #define RIGEL_USE_SSE2
+  #include <emmintrin.h>
+#endif
+
+
+namespace rigel { namespace engine {
+
+namespace {
+
+static_assert(
+  sizeof(data::Pixel) == 4,
+  "Pixels must be tightly packed for blitting");
+
+
+// Exact for all products of two 8-bit values
+constexpr int divideBy255(const int value) {
+  return (value + 128 + ((value + 128) >> 8)) >> 8;
+}
+
+
+std::uint8_t multiply(const std::uint8_t a, const std::uint8_t b) {
+  return std::uint8_t(divideBy255(a * b));
+}
+
+
+std::uint8_t lerp(
+  const std::uint8_t from,
+  const std::uint8_t to,
+  const std::uint8_t factor
+) {
+  return std::uint8_t(divideBy255(from * (255 - factor) + to * factor));
+}
+
+
+// Matches glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA), which also
+// applies to the alpha channel
+data::Pixel blend(const data::Pixel& target, const data::Pixel& color) {
+  return {
+    lerp(target.r, color.r, color.a),
+    lerp(target.g, color.g, color.a),
+    lerp(target.b, color.b, color.a),
+    lerp(target.a, color.a, color.a)};
+}
+
+
+// Same as the OpenGL backend's textured quad fragment shader
+data::Pixel applyColors(
+  const data::Pixel& color,
+  const base::Color& overlayColor,
+  const base::Color& colorModulation
+) {
+  const auto modulated = data::Pixel{
+    multiply(color.r, colorModulation.r),
+    multiply(color.g, colorModulation.g),
+    multiply(color.b, colorModulation.b),
+    multiply(color.a, colorModulation.a)};
+
+  return {
+    lerp(modulated.r, overlayColor.r, overlayColor.a),
+    lerp(modulated.g, overlayColor.g, overlayColor.a),
+    lerp(modulated.b, overlayColor.b, overlayColor.a),
+    modulated.a};
+}
+
+
+/** Nearest neighbor sampling: Maps a destination pixel to a source pixel */
+int scaledOffset(const int offset, const int destSize, const int sourceSize) {
+  if (destSize == sourceSize) {
+    return offset;
+  }
+
+  return (2 * offset + 1) * sourceSize / (2 * destSize);
+}
+
+
+#ifdef RIGEL_USE_SSE2
+
+// Blends two pixels at once, with channels unpacked to 16 bits each. Uses
+// the same formula as the scalar blend() above, so results are identical.
+__m128i blendUnpacked(const __m128i target, const __m128i color) {
+  const auto alpha = _mm_shufflehi_epi16(
+    _mm_shufflelo_epi16(color, _MM_SHUFFLE(3, 3, 3, 3)),
+    _MM_SHUFFLE(3, 3, 3, 3));
+  const auto inverseAlpha = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+
+  const auto sum = _mm_add_epi16(
+    _mm_add_epi16(
+      _mm_mullo_epi16(color, alpha),
+      _mm_mullo_epi16(target, inverseAlpha)),
+    _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(sum, _mm_srli_epi16(sum, 8)), 8);
+}
+
+#endif
+
+}
+
+
+SoftwareRenderer::SoftwareRenderer(
+  const int frameBufferWidth,
+  const int frameBufferHeight
+)
+  : mFrameBuffer(frameBufferWidth, frameBufferHeight)
+  , mpCurrentTarget(&mFrameBuffer)
+{
+}
+
+
+GLuint SoftwareRenderer::createTexture(const data::Image& image) {
+  const auto handle = createTexture(int(image.width()), int(image.height()));
+  std::copy(
+    image.pixelData().begin(),
+    image.pixelData().end(),
+    surface(handle).mPixels.begin());
+  return handle;
+}
+
+
+GLuint SoftwareRenderer::createTexture(const int width, const int height) {
+  const auto handle = mNextHandle++;
+  mTextures.emplace(handle, Surface{width, height});
+  return handle;
+}
+
+
+void SoftwareRenderer::destroyTexture(const GLuint handle) {
+  mTextures.erase(handle);
+}
+
+
+void SoftwareRenderer::updateTextureRegion(
+  const GLuint handle,
+  const base::Vector& position,
+  const data::Image& image
+) {
+  auto& texture = surface(handle);
+  const auto width = int(image.width());
+
+  for (auto y = 0; y < int(image.height()); ++y) {
+    const auto sourceBegin = image.pixelData().begin() + y * width;
+    std::copy(
+      sourceBegin,
+      sourceBegin + width,
+      texture.row(position.y + y) + position.x);
+  }
+}
+
+
+GLuint SoftwareRenderer::createRenderTarget(const GLuint textureHandle) {
+  const auto handle = mNextHandle++;
+  mRenderTargetTextures.emplace(handle, textureHandle);
+  return handle;
+}
+
+
+void SoftwareRenderer::destroyRenderTarget(const GLuint handle) {
+  mRenderTargetTextures.erase(handle);
+}
+
+
+void SoftwareRenderer::setRenderTarget(const GLuint handle) {
+  mpCurrentTarget = handle == 0
+    ? &mFrameBuffer
+    : &surface(mRenderTargetTextures.at(handle));
+}
+
+
+void SoftwareRenderer::setClipRect(
+  const std::optional<base::Rect<int>>& clipRect
+) {
+  mClipRect = clipRect;
+}
+
+
+void SoftwareRenderer::setBlendingEnabled(const bool enabled) {
+  mBlendingEnabled = enabled;
+}
+
+
+void SoftwareRenderer::clear(const base::Color& color) {
+  // Like glClear(), this respects the clip rect (scissor box)
+  auto& target = *mpCurrentTarget;
+  const auto area =
+    visibleArea({{0, 0}, {target.mWidth, target.mHeight}});
+
+  for (auto y = area.top(); y < area.top() + area.size.height; ++y) {
+    const auto pRow = target.row(y) + area.left();
+    std::fill(pRow, pRow + area.size.width, color);
+  }
+}
+
+
+void SoftwareRenderer::drawTexture(
+  const GLuint handle,
+  const base::Rect<int>& sourceRect,
+  const base::Rect<int>& destRect,
+  const base::Color& overlayColor,
+  const base::Color& colorModulation
+) {
+  const auto& source = surface(handle);
+  auto& target = *mpCurrentTarget;
+
+  const auto area = visibleArea(destRect);
+  if (area.size.width <= 0 || area.size.height <= 0) {
+    return;
+  }
+
+  const auto isPlainCopy =
+    overlayColor.a == 0 &&
+    colorModulation == base::Color{255, 255, 255, 255} &&
+    sourceRect.size == destRect.size;
+
+  const auto firstColumn = area.left() - destRect.left();
+
+  // Fast path for the vast majority of draws
+  if (isPlainCopy) {
+    assert(
+      sourceRect.left() >= 0 &&
+      sourceRect.top() >= 0 &&
+      sourceRect.left() + sourceRect.size.width <= source.mWidth &&
+      sourceRect.top() + sourceRect.size.height <= source.mHeight);
+
+    for (auto y = area.top(); y < area.top() + area.size.height; ++y) {
+      const auto sourceY = sourceRect.top() + y - destRect.top();
+      blitRow(
+        target.row(y) + area.left(),
+        source.row(sourceY) + sourceRect.left() + firstColumn,
+        area.size.width);
+    }
+
+    return;
+  }
+
+  for (auto y = area.top(); y < area.top() + area.size.height; ++y) {
+    const auto sourceY = std::clamp(
+      sourceRect.top() + scaledOffset(
+        y - destRect.top(), destRect.size.height, sourceRect.size.height),
+      0,
+      source.mHeight - 1);
+    const auto pSourceRow = source.row(sourceY);
+    const auto pTargetRow = target.row(y);
+
+    for (auto x = area.left(); x < area.left() + area.size.width; ++x) {
+      const auto sourceX = std::clamp(
+        sourceRect.left() + scaledOffset(
+          x - destRect.left(), destRect.size.width, sourceRect.size.width),
+        0,
+        source.mWidth - 1);
+
+      writePixel(
+        pTargetRow[x],
+        applyColors(pSourceRow[sourceX], overlayColor, colorModulation));
+    }
+  }
+}
+
+
+void SoftwareRenderer::drawLine(
+  const base::Vector& start,
+  const base::Vector& end,
+  const base::Color& color
+) {
+  // Bresenham's algorithm
+  const auto deltaX = std::abs(end.x - start.x);
+  const auto deltaY = -std::abs(end.y - start.y);
+  const auto stepX = start.x < end.x ? 1 : -1;
+  const auto stepY = start.y < end.y ? 1 : -1;
+
+  auto position = start;
+  auto error = deltaX + deltaY;
+
+  for (;;) {
+    drawPoint(position, color);
+
+    if (position == end) {
+      break;
+    }
+
+    const auto doubledError = 2 * error;
+    if (doubledError >= deltaY) {
+      error += deltaY;
+      position.x += stepX;
+    }
+    if (doubledError <= deltaX) {
+      error += deltaX;
+      position.y += stepY;
+    }
+  }
+}
+
+
+void SoftwareRenderer::drawPoint(
+  const base::Vector& position,
+  const base::Color& color
+) {
+  const auto area = visibleArea({position, {1, 1}});
+  if (area.size.width > 0 && area.size.height > 0) {
+    writePixel(mpCurrentTarget->row(position.y)[position.x], color);
+  }
+}
+
+
+void SoftwareRenderer::drawWaterEffect(
+  const base::Rect<int>& destRect,
+  const GLuint screenTexture,
+  const base::Rect<int>& screenSourceRect,
+  const GLuint maskTexture,
+  const base::Rect<int>& maskSourceRect,
+  const GLuint colorLookupTexture,
+  const base::Color& nonPaletteWaterColor
+) {
+  const auto& screen = surface(screenTexture);
+  const auto& mask = surface(maskTexture);
+  const auto& colorLookup = surface(colorLookupTexture);
+  auto& target = *mpCurrentTarget;
+
+  const auto area = visibleArea(destRect);
+
+  for (auto y = area.top(); y < area.top() + area.size.height; ++y) {
+    const auto offsetY = y - destRect.top();
+    const auto screenY = std::clamp(
+      screenSourceRect.top() + scaledOffset(
+        offsetY, destRect.size.height, screenSourceRect.size.height),
+      0,
+      screen.mHeight - 1);
+    const auto maskY = maskSourceRect.top() + scaledOffset(
+      offsetY, destRect.size.height, maskSourceRect.size.height);
+
+    for (auto x = area.left(); x < area.left() + area.size.width; ++x) {
+      const auto offsetX = x - destRect.left();
+      const auto screenX = std::clamp(
+        screenSourceRect.left() + scaledOffset(
+          offsetX, destRect.size.width, screenSourceRect.size.width),
+        0,
+        screen.mWidth - 1);
+      const auto maskX = (maskSourceRect.left() + scaledOffset(
+        offsetX, destRect.size.width, maskSourceRect.size.width)) %
+        mask.mWidth;
+
+      // See createWaterColorLookupImage() in renderer.cpp
+      const auto& color = screen.at(screenX, screenY);
+      const auto lookupX = color.r / 16 + (color.b / 16) * 16;
+      const auto& paletteColor = colorLookup.at(lookupX, color.g / 16 + 16);
+      const auto isPaletteColor = paletteColor.r == color.r &&
+        paletteColor.g == color.g && paletteColor.b == color.b;
+      const auto& waterColor = isPaletteColor
+        ? colorLookup.at(lookupX, color.g / 16)
+        : nonPaletteWaterColor;
+      const auto maskValue = mask.at(maskX, maskY).r;
+
+      writePixel(
+        target.row(y)[x],
+        {
+          lerp(color.r, waterColor.r, maskValue),
+          lerp(color.g, waterColor.g, maskValue),
+          lerp(color.b, waterColor.b, maskValue),
+          color.a
+        });
+    }
+  }
+}
+
+
+void SoftwareRenderer::drawTileMap(
+  const base::Rect<int>& destRect,
+  const GLuint tileSetHandle,
+  const GLuint tileFlagsHandle,
+  const GLuint mapDataHandle,
+  const base::Vector& mapPixelOffset,
+  const int fastAnimOffset,
+  const int slowAnimOffset,
+  const bool drawForeground
+) {
+  constexpr auto TILE_SIZE = data::GameTraits::tileSize;
+
+  const auto& tileSet = surface(tileSetHandle);
+  const auto& tileFlags = surface(tileFlagsHandle);
+  const auto& mapData = surface(mapDataHandle);
+  auto& target = *mpCurrentTarget;
+
+  const auto tileSetWidth = tileFlags.mWidth;
+
+  // Mirrors tileColor() in the OpenGL backend's tile map shader
+  auto tileColor = [&](
+    const int tileIndex,
+    const int pixelX,
+    const int pixelY
+  ) {
+    if (tileIndex == 0) {
+      return data::Pixel{};
+    }
+
+    // r: foreground, g: animated, b: fast animation
+    const auto& flags =
+      tileFlags.at(tileIndex % tileSetWidth, tileIndex / tileSetWidth);
+    if ((flags.r > 127) != drawForeground) {
+      return data::Pixel{};
+    }
+
+    const auto animOffset = flags.g > 127
+      ? (flags.b > 127 ? fastAnimOffset : slowAnimOffset)
+      : 0;
+    const auto animatedIndex = tileIndex + animOffset;
+    return tileSet.at(
+      (animatedIndex % tileSetWidth) * TILE_SIZE + pixelX,
+      (animatedIndex / tileSetWidth) * TILE_SIZE + pixelY);
+  };
+
+  const auto area = visibleArea(destRect);
+
+  for (auto y = area.top(); y < area.top() + area.size.height; ++y) {
+    const auto mapY = mapPixelOffset.y + y - destRect.top();
+    const auto tileY = mapY / TILE_SIZE;
+
+    for (auto x = area.left(); x < area.left() + area.size.width; ++x) {
+      const auto mapX = mapPixelOffset.x + x - destRect.left();
+      const auto tileX = mapX / TILE_SIZE;
+
+      if (tileX >= mapData.mWidth || tileY >= mapData.mHeight) {
+        writePixel(target.row(y)[x], data::Pixel{});
+        continue;
+      }
+
+      const auto& indices = mapData.at(tileX, tileY);
+      const auto pixelX = mapX % TILE_SIZE;
+      const auto pixelY = mapY % TILE_SIZE;
+
+      // Layer 1 is drawn on top of layer 0
+      const auto bottom = tileColor(indices.r + indices.g * 256, pixelX, pixelY);
+      const auto top = tileColor(indices.b + indices.a * 256, pixelX, pixelY);
+
+      if (top.a == 255 || bottom.a == 0) {
+        writePixel(target.row(y)[x], top);
+      } else if (top.a == 0) {
+        writePixel(target.row(y)[x], bottom);
+      } else {
+        const auto bottomWeight = divideBy255(bottom.a * (255 - top.a));
+        const auto alpha = top.a + bottomWeight;
+        auto combine = [&](const int topValue, const int bottomValue) {
+          return std::uint8_t(
+            (topValue * top.a + bottomValue * bottomWeight + alpha / 2) /
+            alpha);
+        };
+
+        writePixel(
+          target.row(y)[x],
+          {
+            combine(top.r, bottom.r),
+            combine(top.g, bottom.g),
+            combine(top.b, bottom.b),
+            std::uint8_t(alpha)
+          });
+      }
+    }
+  }
+}
+
+
+data::Image SoftwareRenderer::frameBuffer() const {
+  return data::Image{
+    mFrameBuffer.mPixels,
+    std::size_t(mFrameBuffer.mWidth),
+    std::size_t(mFrameBuffer.mHeight)};
+}
+
+
+auto SoftwareRenderer::surface(const GLuint handle) -> Surface& {
+  assert(mTextures.count(handle) != 0);
+  return mTextures.at(handle);
+}
+
+
+base::Rect<int> SoftwareRenderer::visibleArea(
+  const base::Rect<int>& destRect
+) const {
+  auto left = std::max(destRect.left(), 0);
+  auto top = std::max(destRect.top(), 0);
+  auto right =
+    std::min(destRect.left() + destRect.size.width, mpCurrentTarget->mWidth);
+  auto bottom =
+    std::min(destRect.top() + destRect.size.height, mpCurrentTarget->mHeight);
+
+  if (mClipRect) {
+    left = std::max(left, mClipRect->left());
+    top = std::max(top, mClipRect->top());
+    right = std::min(right, mClipRect->left() + mClipRect->size.width);
+    bottom = std::min(bottom, mClipRect->top() + mClipRect->size.height);
+  }
+
+  return {{left, top}, {std::max(right - left, 0), std::max(bottom - top, 0)}};
+}
+
+
+void SoftwareRenderer::writePixel(
+  data::Pixel& target,
+  const data::Pixel& color
+) const {
+  target = mBlendingEnabled ? blend(target, color) : color;
+}
+
+
+void SoftwareRenderer::blitRow(
+  data::Pixel* pTarget,
+  const data::Pixel* pSource,
+  const int numPixels
+) const {
+  if (!mBlendingEnabled) {
+    std::copy(pSource, pSource + numPixels, pTarget);
+    return;
+  }
+
+  auto i = 0;
+
+#ifdef RIGEL_USE_SSE2
+  // Process 4 pixels at a time. Blocks which are fully transparent are
+  // skipped, which is common for sprites.
+  const auto zero = _mm_setzero_si128();
+  const auto alphaMask = _mm_set1_epi32(int(0xFF000000));
+
+  for (; i + 4 <= numPixels; i += 4) {
+    const auto color =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + i));
+    const auto transparentPixels =
+      _mm_cmpeq_epi32(_mm_and_si128(color, alphaMask), zero);
+    if (_mm_movemask_epi8(transparentPixels) == 0xFFFF) {
+      continue;
+    }
+
+    const auto pTargetBlock = reinterpret_cast<__m128i*>(pTarget + i);
+    const auto target = _mm_loadu_si128(pTargetBlock);
+
+    const auto low = blendUnpacked(
+      _mm_unpacklo_epi8(target, zero), _mm_unpacklo_epi8(color, zero));
+    const auto high = blendUnpacked(
+      _mm_unpackhi_epi8(target, zero), _mm_unpackhi_epi8(color, zero));
+    _mm_storeu_si128(pTargetBlock, _mm_packus_epi16(low, high));
+  }
+#endif
+
+  for (; i < numPixels; ++i) {
+    pTarget[i] = blend(pTarget[i], pSource[i]);
+  }
+}
+
+}}
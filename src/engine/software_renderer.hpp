@@ -0,0 +1,156 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "base/color.hpp"
+#include "base/spatial_types.hpp"
+#include "data/image.hpp"
+#include "engine/opengl.hpp"
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+
+namespace rigel { namespace engine {
+
+/** Rasterizes into in-memory RGBA images instead of using OpenGL
+ *
+ * This is the backend used by Renderer when running without a GPU, e.g. for
+ * benchmarks and image comparison tests on build machines. It implements
+ * the same operations as the OpenGL backend, with results that should match
+ * closely, but not necessarily bit for bit.
+ *
+ * Textures and render targets are identified by handles just like their
+ * OpenGL counterparts, so that they fit into Renderer::TextureData etc.
+ * Handle 0 refers to the default frame buffer. All coordinates are in
+ * pixels of the current render target, Renderer takes care of applying
+ * global translation and scale.
+ */
+class SoftwareRenderer {
+public:
+  SoftwareRenderer(int frameBufferWidth, int frameBufferHeight);
+
+  SoftwareRenderer(const SoftwareRenderer&) = delete;
+  SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+  GLuint createTexture(const data::Image& image);
+  GLuint createTexture(int width, int height);
+  void destroyTexture(GLuint handle);
+  void updateTextureRegion(
+    GLuint handle,
+    const base::Vector& position,
+    const data::Image& image);
+
+  /** Create a render target drawing into the given texture */
+  GLuint createRenderTarget(GLuint textureHandle);
+  void destroyRenderTarget(GLuint handle);
+  void setRenderTarget(GLuint handle);
+
+  void setClipRect(const std::optional<base::Rect<int>>& clipRect);
+  void setBlendingEnabled(bool enabled);
+
+  void clear(const base::Color& color);
+
+  void drawTexture(
+    GLuint handle,
+    const base::Rect<int>& sourceRect,
+    const base::Rect<int>& destRect,
+    const base::Color& overlayColor,
+    const base::Color& colorModulation);
+
+  void drawLine(
+    const base::Vector& start,
+    const base::Vector& end,
+    const base::Color& color);
+  void drawPoint(const base::Vector& position, const base::Color& color);
+
+  /** Apply the water effect, see the OpenGL backend's shader for details
+   *
+   * screenSourceRect is the part of screenTexture corresponding to destRect.
+   * The mask texture is repeated horizontally.
+   */
+  void drawWaterEffect(
+    const base::Rect<int>& destRect,
+    GLuint screenTexture,
+    const base::Rect<int>& screenSourceRect,
+    GLuint maskTexture,
+    const base::Rect<int>& maskSourceRect,
+    GLuint colorLookupTexture,
+    const base::Color& nonPaletteWaterColor);
+
+  /** Draw a tile map, see Renderer::drawTileMap() */
+  void drawTileMap(
+    const base::Rect<int>& destRect,
+    GLuint tileSet,
+    GLuint tileFlags,
+    GLuint mapData,
+    const base::Vector& mapPixelOffset,
+    int fastAnimOffset,
+    int slowAnimOffset,
+    bool drawForeground);
+
+  /** Returns a copy of the default frame buffer's current contents */
+  data::Image frameBuffer() const;
+
+private:
+  struct Surface {
+    Surface(int width, int height)
+      : mWidth(width)
+      , mHeight(height)
+      , mPixels(std::size_t(width * height))
+    {
+    }
+
+    data::Pixel* row(const int y) {
+      return mPixels.data() + y * mWidth;
+    }
+
+    const data::Pixel* row(const int y) const {
+      return mPixels.data() + y * mWidth;
+    }
+
+    const data::Pixel& at(const int x, const int y) const {
+      return mPixels[x + y * mWidth];
+    }
+
+    int mWidth;
+    int mHeight;
+    data::PixelBuffer mPixels;
+  };
+
+  Surface& surface(GLuint handle);
+  base::Rect<int> visibleArea(const base::Rect<int>& destRect) const;
+  void writePixel(data::Pixel& target, const data::Pixel& color) const;
+  void blitRow(
+    data::Pixel* pTarget,
+    const data::Pixel* pSource,
+    int numPixels) const;
+
+private:
+  Surface mFrameBuffer;
+  std::unordered_map<GLuint, Surface> mTextures;
+  std::unordered_map<GLuint, GLuint> mRenderTargetTextures;
+  GLuint mNextHandle = 1;
+
+  Surface* mpCurrentTarget;
+  std::optional<base::Rect<int>> mClipRect;
+  bool mBlendingEnabled = true;
+};
+
+}}
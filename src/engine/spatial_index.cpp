@@ -0,0 +1,195 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spatial_index.hpp"
+
+#include <tuple>
+
+
+namespace rigel { namespace engine {
+
+namespace ex = entityx;
+
+using namespace engine::components;
+
+
+namespace {
+
+const auto CELL_SIZE = 8;
+
+
+int cellCount(const int sizeInTiles) {
+  return std::max(1, (sizeInTiles + CELL_SIZE - 1) / CELL_SIZE);
+}
+
+
+// Rounds towards negative infinity, unlike regular integer division
+int toCell(const int tileCoordinate) {
+  return tileCoordinate >= 0
+    ? tileCoordinate / CELL_SIZE
+    : (tileCoordinate - CELL_SIZE + 1) / CELL_SIZE;
+}
+
+}
+
+
+SpatialIndex::SpatialIndex(
+  const int mapWidthInTiles,
+  const int mapHeightInTiles,
+  ex::EventManager& eventManager
+)
+  : mCellStart(cellCount(mapWidthInTiles) * cellCount(mapHeightInTiles) + 1)
+  , mWidthInCells(cellCount(mapWidthInTiles))
+  , mHeightInCells(cellCount(mapHeightInTiles))
+{
+  eventManager.subscribe<ex::ComponentAddedEvent<WorldPosition>>(*this);
+  eventManager.subscribe<ex::ComponentAddedEvent<BoundingBox>>(*this);
+}
+
+
+void SpatialIndex::rebuild(ex::EntityManager& es) {
+  mEntities.clear();
+  mEntityCells.clear();
+  mLateEntities.clear();
+
+  std::fill(mCellStart.begin(), mCellStart.end(), 0u);
+
+  // First pass: Collect entities and count how many go into each cell
+  es.each<WorldPosition, BoundingBox>(
+    [this](
+      ex::Entity entity,
+      const WorldPosition& position,
+      const BoundingBox& bbox
+    ) {
+      const auto worldSpaceBbox = engine::toWorldSpace(bbox, position);
+      if (worldSpaceBbox.size.width <= 0 || worldSpaceBbox.size.height <= 0) {
+        // Empty bounding boxes can't intersect anything
+        return;
+      }
+
+      const auto range = cellRange(worldSpaceBbox);
+      mEntities.push_back(entity);
+      mEntityCells.push_back(range);
+
+      for (auto y = range.mFirstY; y <= range.mLastY; ++y) {
+        for (auto x = range.mFirstX; x <= range.mLastX; ++x) {
+          ++mCellStart[x + y * mWidthInCells + 1];
+        }
+      }
+    });
+
+  for (auto i = 1u; i < mCellStart.size(); ++i) {
+    mCellStart[i] += mCellStart[i - 1];
+  }
+
+  // Second pass: Fill in the cell contents. Since we go through the entities
+  // in order, each cell's list ends up sorted.
+  mCellContents.resize(mCellStart.back());
+
+  auto insertPositions = std::vector<std::uint32_t>(
+    mCellStart.begin(), mCellStart.end() - 1);
+  for (auto i = 0u; i < mEntityCells.size(); ++i) {
+    const auto& range = mEntityCells[i];
+    for (auto y = range.mFirstY; y <= range.mLastY; ++y) {
+      for (auto x = range.mFirstX; x <= range.mLastX; ++x) {
+        mCellContents[insertPositions[x + y * mWidthInCells]++] = i;
+      }
+    }
+  }
+}
+
+
+void SpatialIndex::receive(
+  const ex::ComponentAddedEvent<WorldPosition>& event
+) {
+  addLateEntity(event.entity);
+}
+
+
+void SpatialIndex::receive(
+  const ex::ComponentAddedEvent<BoundingBox>& event
+) {
+  addLateEntity(event.entity);
+}
+
+
+void SpatialIndex::addLateEntity(ex::Entity entity) {
+  // Only add the entity once it has both components
+  if (
+    entity.has_component<WorldPosition>() &&
+    entity.has_component<BoundingBox>()
+  ) {
+    mLateEntities.push_back(entity);
+  }
+}
+
+
+void SpatialIndex::collectLateCandidates(
+  const BoundingBox& area,
+  std::vector<ex::Entity>& candidates
+) const {
+  candidates.clear();
+
+  for (const auto& entity : mLateEntities) {
+    if (
+      entity.valid() &&
+      entity.has_component<WorldPosition>() &&
+      entity.has_component<BoundingBox>()
+    ) {
+      const auto bbox = engine::toWorldSpace(
+        *entity.component<const BoundingBox>(),
+        *entity.component<const WorldPosition>());
+      if (bbox.intersects(area)) {
+        candidates.push_back(entity);
+      }
+    }
+  }
+
+  // An entity can be added more than once, if it loses and regains one of
+  // its components
+  const auto sortKey = [](const ex::Entity& entity) {
+    return std::make_tuple(entity.id().index(), entity.id().version());
+  };
+  std::sort(
+    candidates.begin(),
+    candidates.end(),
+    [&](const ex::Entity& lhs, const ex::Entity& rhs) {
+      return sortKey(lhs) < sortKey(rhs);
+    });
+  candidates.erase(
+    std::unique(candidates.begin(), candidates.end()),
+    candidates.end());
+}
+
+
+SpatialIndex::CellRange SpatialIndex::cellRange(
+  const BoundingBox& area
+) const {
+  const auto clampX = [this](const int x) {
+    return std::clamp(toCell(x), 0, mWidthInCells - 1);
+  };
+  const auto clampY = [this](const int y) {
+    return std::clamp(toCell(y), 0, mHeightInCells - 1);
+  };
+
+  return CellRange{
+    clampX(area.left()),
+    clampY(area.top()),
+    clampX(area.right()),
+    clampY(area.bottom())};
+}
+
+}}
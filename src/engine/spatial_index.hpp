@@ -0,0 +1,196 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/warnings.hpp"
+#include "engine/physical_components.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <entityx/entityx.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+namespace rigel { namespace engine {
+
+/** Uniform grid of all entities with a world position and bounding box
+ *
+ * Speeds up finding entities which overlap a given area. The map is divided
+ * into cells of a fixed size, and each entity is registered in all the cells
+ * its bounding box touches. Entities outside of the map are registered in the
+ * closest cells on the map's border.
+ *
+ * The grid is built from a snapshot of all entities taken by rebuild().
+ * Entities which gain a position and bounding box after that, i.e. newly
+ * created ones, are kept in a separate list which every query tests one by
+ * one. Queries thus find them just like the full scans over all entities
+ * which the index replaces.
+ *
+ * Entities which move after rebuild() are a different matter: They stay
+ * registered in the cells touched by their bounding box at the time of the
+ * rebuild, as there are no events for position changes. A query only finds
+ * such an entity if the queried area touches one of these cells, even if the
+ * entity's current bounding box overlaps the area. Clients are expected to
+ * rebuild the index once per frame, at a point where the entities they are
+ * interested in don't move anymore (see IngameSystems::update()).
+ */
+class SpatialIndex : public entityx::Receiver<SpatialIndex> {
+public:
+  SpatialIndex(
+    int mapWidthInTiles,
+    int mapHeightInTiles,
+    entityx::EventManager& eventManager);
+
+  void rebuild(entityx::EntityManager& es);
+
+  /** Invoke callback(entity) for each entity which might overlap area
+   *
+   * Entities are visited in the same order as entityx uses when iterating
+   * over entities, and at most once each. Since the callback is given all
+   * entities in the cells touched by area, it still needs to test for actual
+   * intersection. Entities might also have been destroyed or have lost
+   * components since the index was built, which the callback must check
+   * for. Entities created by the callback itself are not visited by the
+   * ongoing query.
+   */
+  template <typename Callback>
+  void forEachCandidate(
+    const components::BoundingBox& area,
+    Callback&& callback) const;
+
+  void receive(
+    const entityx::ComponentAddedEvent<components::WorldPosition>& event);
+  void receive(
+    const entityx::ComponentAddedEvent<components::BoundingBox>& event);
+
+private:
+  struct CellRange {
+    int mFirstX;
+    int mFirstY;
+    int mLastX;
+    int mLastY;
+  };
+
+  CellRange cellRange(const components::BoundingBox& area) const;
+  void addLateEntity(entityx::Entity entity);
+  void collectLateCandidates(
+    const components::BoundingBox& area,
+    std::vector<entityx::Entity>& candidates) const;
+
+  std::vector<entityx::Entity> mEntities;
+  std::vector<CellRange> mEntityCells;
+
+  // Indices into mEntities for all entities in each cell, stored
+  // contiguously. The entities in cell i are found at
+  // mCellContents[mCellStart[i]] to mCellContents[mCellStart[i + 1] - 1].
+  std::vector<std::uint32_t> mCellStart;
+  std::vector<std::uint32_t> mCellContents;
+
+  // Entities which have gained a position and bounding box since the last
+  // rebuild
+  std::vector<entityx::Entity> mLateEntities;
+
+  // Reused across queries to avoid allocations
+  mutable std::vector<std::uint32_t> mQueryBuffer;
+  mutable std::vector<entityx::Entity> mLateQueryBuffer;
+
+  int mWidthInCells;
+  int mHeightInCells;
+};
+
+
+template <typename Callback>
+void SpatialIndex::forEachCandidate(
+  const components::BoundingBox& area,
+  Callback&& callback
+) const {
+  if (area.size.width <= 0 || area.size.height <= 0) {
+    return;
+  }
+
+  const auto range = cellRange(area);
+
+  // Moving the buffer out keeps this safe in case the callback triggers
+  // another query.
+  auto candidates = std::move(mQueryBuffer);
+  candidates.clear();
+
+  for (auto y = range.mFirstY; y <= range.mLastY; ++y) {
+    for (auto x = range.mFirstX; x <= range.mLastX; ++x) {
+      const auto cell = x + y * mWidthInCells;
+      candidates.insert(
+        candidates.end(),
+        mCellContents.begin() + mCellStart[cell],
+        mCellContents.begin() + mCellStart[cell + 1]);
+    }
+  }
+
+  // mEntities is in iteration order, so sorting the indices gives us the
+  // same order. Entities spanning multiple cells are only visited once.
+  if (range.mFirstX != range.mLastX || range.mFirstY != range.mLastY) {
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(
+      std::unique(candidates.begin(), candidates.end()),
+      candidates.end());
+  }
+
+  if (mLateEntities.empty()) {
+    for (const auto index : candidates) {
+      callback(mEntities[index]);
+    }
+
+    mQueryBuffer = std::move(candidates);
+    return;
+  }
+
+  // Merge in entities created since the last rebuild, keeping iteration
+  // order. These are also sorted by entity index.
+  auto lateCandidates = std::move(mLateQueryBuffer);
+  collectLateCandidates(area, lateCandidates);
+
+  auto iLate = lateCandidates.cbegin();
+  for (const auto index : candidates) {
+    const auto entity = mEntities[index];
+    while (
+      iLate != lateCandidates.cend() &&
+      iLate->id().index() < entity.id().index()
+    ) {
+      callback(*iLate);
+      ++iLate;
+    }
+
+    // An entity which had its position or bounding box re-assigned can be
+    // in both lists
+    if (iLate != lateCandidates.cend() && *iLate == entity) {
+      ++iLate;
+    }
+
+    callback(entity);
+  }
+
+  for (; iLate != lateCandidates.cend(); ++iLate) {
+    callback(*iLate);
+  }
+
+  mQueryBuffer = std::move(candidates);
+  mLateQueryBuffer = std::move(lateCandidates);
+}
+
+}}
@@ -0,0 +1,189 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "stream_buffer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+
+namespace rigel { namespace engine {
+
+namespace {
+
+// We never wait for the GPU for longer than this. If a fence hasn't been
+// signaled by then, something is seriously wrong, and we orphan the buffer
+// instead of risking overwriting data still in use.
+constexpr GLuint64 FENCE_TIMEOUT_NS = 1'000'000'000;
+
+}
+
+
+StreamBuffer::StreamBuffer(const std::size_t sizePerFrame)
+  : mRegionSize(sizePerFrame)
+{
+  glGenBuffers(1, &mBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, mBuffer);
+  orphan();
+}
+
+
+StreamBuffer::~StreamBuffer() {
+#ifndef RIGEL_USE_GL_ES
+  for (auto fence : mFences) {
+    if (fence) {
+      glDeleteSync(fence);
+    }
+  }
+#endif
+
+  glDeleteBuffers(1, &mBuffer);
+}
+
+
+std::uint8_t* StreamBuffer::reserve(
+  const std::size_t minSize,
+  const std::size_t maxSize
+) {
+  assert(mReservedSize == 0);
+  assert(minSize <= maxSize);
+
+  if (minSize > mRegionSize) {
+    throw std::invalid_argument("Requested size exceeds stream buffer size");
+  }
+
+#ifdef RIGEL_USE_GL_ES
+  const auto end = mRegionSize * NUM_REGIONS;
+#else
+  const auto end = (mCurrentRegion + 1) * mRegionSize;
+#endif
+
+  if (mWriteOffset + minSize > end) {
+    // The available space has been used up. Orphaning gives us fresh
+    // storage without having to wait for the GPU.
+    orphan();
+  }
+
+  mReservedSize = std::min(maxSize, end - mWriteOffset);
+
+#ifdef RIGEL_USE_GL_ES
+  mStagingBuffer.resize(mReservedSize);
+  return mStagingBuffer.data();
+#else
+  mpMappedMemory = static_cast<std::uint8_t*>(glMapBufferRange(
+    GL_ARRAY_BUFFER,
+    GLintptr(mWriteOffset),
+    GLsizeiptr(mReservedSize),
+    GL_MAP_WRITE_BIT |
+      GL_MAP_INVALIDATE_RANGE_BIT |
+      GL_MAP_UNSYNCHRONIZED_BIT |
+      GL_MAP_FLUSH_EXPLICIT_BIT));
+  return mpMappedMemory;
+#endif
+}
+
+
+std::size_t StreamBuffer::commit(const std::size_t size) {
+  assert(size <= mReservedSize);
+
+#ifdef RIGEL_USE_GL_ES
+  if (size > 0) {
+    glBufferSubData(
+      GL_ARRAY_BUFFER,
+      GLintptr(mWriteOffset),
+      GLsizeiptr(size),
+      mStagingBuffer.data());
+  }
+#else
+  if (size > 0) {
+    glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, GLsizeiptr(size));
+  }
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+  mpMappedMemory = nullptr;
+#endif
+
+  const auto offset = mWriteOffset;
+  mWriteOffset += size;
+  mReservedSize = 0;
+  mBytesUploadedThisFrame += size;
+  return offset;
+}
+
+
+void StreamBuffer::endFrame() {
+  assert(mReservedSize == 0);
+
+#ifndef RIGEL_USE_GL_ES
+  mFences[mCurrentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  mCurrentRegion = (mCurrentRegion + 1) % NUM_REGIONS;
+  mWriteOffset = mCurrentRegion * mRegionSize;
+  waitForRegion(mCurrentRegion);
+#endif
+
+  mBytesUploadedLastFrame = mBytesUploadedThisFrame;
+  mBytesUploadedThisFrame = 0;
+}
+
+
+void StreamBuffer::orphan() {
+  glBufferData(
+    GL_ARRAY_BUFFER,
+    GLsizeiptr(mRegionSize * NUM_REGIONS),
+    nullptr,
+    GL_STREAM_DRAW);
+
+#ifdef RIGEL_USE_GL_ES
+  mWriteOffset = 0;
+#else
+  // The new storage isn't used by the GPU yet, so the fences for the other
+  // regions don't matter anymore
+  for (auto& fence : mFences) {
+    if (fence) {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+
+  mWriteOffset = mCurrentRegion * mRegionSize;
+#endif
+}
+
+
+#ifndef RIGEL_USE_GL_ES
+
+void StreamBuffer::waitForRegion(const int region) {
+  auto& fence = mFences[region];
+  if (!fence) {
+    return;
+  }
+
+  const auto result =
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+  if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+    orphan();
+    return;
+  }
+
+  glDeleteSync(fence);
+  fence = nullptr;
+}
+
+#endif
+
+}}
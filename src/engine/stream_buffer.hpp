@@ -0,0 +1,107 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "engine/opengl.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace rigel { namespace engine {
+
+/** Ring buffer for streaming vertex data to the GPU
+ *
+ * The buffer is divided into one region per frame in flight. Data for the
+ * current frame is written into its region directly via an unsynchronized
+ * mapping, and a fence guards each region against being overwritten while
+ * the GPU is still reading from it.
+ *
+ * On GL ES 2, which lacks both buffer mapping and fences, data is written
+ * into a staging buffer and appended to the GPU buffer using
+ * glBufferSubData. The buffer storage is orphaned whenever it runs full.
+ *
+ * The buffer is bound to GL_ARRAY_BUFFER on construction. Clients are
+ * expected to keep it bound.
+ */
+class StreamBuffer {
+public:
+  explicit StreamBuffer(std::size_t sizePerFrame);
+  ~StreamBuffer();
+
+  StreamBuffer(const StreamBuffer&) = delete;
+  StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+  /** Returns memory for writing data
+   *
+   * Provides at least minSize and at most maxSize bytes, depending on how
+   * much space is left. reservedSize() tells the actual amount.
+   *
+   * The memory stays valid until the next call to commit(). There must not
+   * be any draw calls in between reserve() and commit().
+   */
+  std::uint8_t* reserve(std::size_t minSize, std::size_t maxSize);
+
+  std::size_t reservedSize() const {
+    return mReservedSize;
+  }
+
+  /** Make the first size bytes of reserved memory available to the GPU
+   *
+   * Returns the offset of the data within the buffer, to be used for
+   * vertex attribute pointers.
+   */
+  std::size_t commit(std::size_t size);
+
+  /** Must be called once all draw calls for the current frame are issued */
+  void endFrame();
+
+  std::size_t bytesUploadedLastFrame() const {
+    return mBytesUploadedLastFrame;
+  }
+
+private:
+  static constexpr auto NUM_REGIONS = 3;
+
+  void orphan();
+
+#ifndef RIGEL_USE_GL_ES
+  void waitForRegion(int region);
+#endif
+
+private:
+  GLuint mBuffer;
+  std::size_t mRegionSize;
+  std::size_t mWriteOffset = 0;
+  std::size_t mReservedSize = 0;
+
+#ifdef RIGEL_USE_GL_ES
+  std::vector<std::uint8_t> mStagingBuffer;
+#else
+  std::uint8_t* mpMappedMemory = nullptr;
+  std::array<GLsync, NUM_REGIONS> mFences{};
+  int mCurrentRegion = 0;
+#endif
+
+  std::size_t mBytesUploadedThisFrame = 0;
+  std::size_t mBytesUploadedLastFrame = 0;
+};
+
+}}
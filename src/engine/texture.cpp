@@ -83,14 +83,53 @@ void TextureBase::render(
 }
 
 
+void TextureRegion::render(
+  engine::Renderer* pRenderer,
+  const base::Vector& position
+) const {
+  render(pRenderer, position, {{0, 0}, extents()});
+}
+
+
+void TextureRegion::render(
+  engine::Renderer* pRenderer,
+  const int x,
+  const int y
+) const {
+  render(pRenderer, base::Vector{x, y});
+}
+
+
+void TextureRegion::render(
+  engine::Renderer* pRenderer,
+  const base::Vector& position,
+  const base::Rect<int>& sourceRect
+) const {
+  const auto sourceRectInTexture = sourceRect + mRegion.topLeft;
+  pRenderer->drawTexture(
+    mTextureData, sourceRectInTexture, {position, sourceRect.size});
+}
+
+
+void TextureRegion::renderScaled(
+  engine::Renderer* pRenderer,
+  const base::Rect<int>& destRect
+) const {
+  pRenderer->drawTexture(mTextureData, mRegion, destRect);
+}
+
+
 OwningTexture::OwningTexture(engine::Renderer* pRenderer, const Image& image)
   : TextureBase(pRenderer->createTexture(image))
+  , mpRenderer(pRenderer)
 {
 }
 
 
 OwningTexture::~OwningTexture() {
-  glDeleteTextures(1, &mData.mHandle);
+  if (mpRenderer) {
+    mpRenderer->destroyTexture(mData.mHandle);
+  }
 }
 
 
@@ -100,6 +139,7 @@ RenderTargetTexture::RenderTargetTexture(
   const std::size_t height
 )
   : RenderTargetTexture(
+      pRenderer,
       pRenderer->createRenderTargetTexture(int(width), int(height)),
       static_cast<int>(width),
       static_cast<int>(height))
@@ -108,18 +148,19 @@ RenderTargetTexture::RenderTargetTexture(
 
 
 RenderTargetTexture::RenderTargetTexture(
+  engine::Renderer* pRenderer,
   const Renderer::RenderTargetHandles& handles,
   const int width,
   const int height
 )
-  : OwningTexture({width, height, handles.texture})
+  : OwningTexture(pRenderer, {width, height, handles.texture})
   , mFboHandle(handles.fbo)
 {
 }
 
 
 RenderTargetTexture::~RenderTargetTexture() {
-  glDeleteFramebuffers(1, &mFboHandle);
+  mpRenderer->destroyRenderTarget(mFboHandle);
 }
 
 
@@ -112,6 +112,7 @@ public:
 
   OwningTexture(OwningTexture&& other) noexcept
     : TextureBase(other.mData)
+    , mpRenderer(other.mpRenderer)
   {
     other.mData.mHandle = 0;
   }
@@ -121,6 +122,7 @@ public:
 
   OwningTexture& operator=(OwningTexture&& other) noexcept {
     mData = other.mData;
+    mpRenderer = other.mpRenderer;
     other.mData.mHandle = 0;
     return *this;
   }
@@ -128,10 +130,13 @@ public:
   friend class NonOwningTexture;
 
 protected:
-  explicit OwningTexture(Renderer::TextureData data)
+  OwningTexture(engine::Renderer* pRenderer, Renderer::TextureData data)
     : TextureBase(data)
+    , mpRenderer(pRenderer)
   {
   }
+
+  engine::Renderer* mpRenderer = nullptr;
 };
 
 
@@ -155,6 +160,72 @@ public:
 };
 
 
+/** Non-owning view of a rectangular region inside a texture
+ *
+ * Offers the same rendering interface as OwningTexture, but only covers a
+ * part of the underlying texture. All coordinates given to the render
+ * functions are relative to the region, e.g. (0, 0, width, height) as source
+ * rect would render the entire region.
+ *
+ * This is mainly used for images allocated from a TextureAtlas, where many
+ * images share a single texture so that they can be drawn in one batch.
+ * Like NonOwningTexture, it doesn't manage the underlying texture's
+ * life-time.
+ */
+class TextureRegion {
+public:
+  TextureRegion() = default;
+  TextureRegion(
+    const Renderer::TextureData& textureData,
+    const base::Rect<int>& region)
+    : mTextureData(textureData)
+    , mRegion(region)
+  {
+  }
+
+  /** Create a region covering the entire given texture */
+  explicit TextureRegion(const detail::TextureBase& texture)
+    : TextureRegion(texture.data(), {{0, 0}, texture.extents()})
+  {
+  }
+
+  void render(engine::Renderer* renderer, const base::Vector& position) const;
+  void render(engine::Renderer* renderer, int x, int y) const;
+  void render(
+    engine::Renderer* renderer,
+    const base::Vector& position,
+    const base::Rect<int>& sourceRect) const;
+
+  void renderScaled(
+    engine::Renderer* renderer,
+    const base::Rect<int>& destRect) const;
+
+  int width() const {
+    return mRegion.size.width;
+  }
+
+  int height() const {
+    return mRegion.size.height;
+  }
+
+  base::Extents extents() const {
+    return mRegion.size;
+  }
+
+  Renderer::TextureData data() const {
+    return mTextureData;
+  }
+
+  const base::Rect<int>& regionInTexture() const {
+    return mRegion;
+  }
+
+private:
+  Renderer::TextureData mTextureData;
+  base::Rect<int> mRegion;
+};
+
+
 /** Utility class for render target type textures
  *
  * It manages life-time like OwningTexture, but creates a SDL_Texture with an
@@ -219,6 +290,7 @@ public:
 
 private:
   RenderTargetTexture(
+    engine::Renderer* pRenderer,
     const Renderer::RenderTargetHandles& handles,
     int width,
     int height);
@@ -0,0 +1,116 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "texture_atlas.hpp"
+
+#include <algorithm>
+
+
+namespace rigel { namespace engine {
+
+namespace {
+
+// Leave some space between packed images, so that there's no risk of
+// neighboring images bleeding into each other when sampling at the edges.
+constexpr auto PADDING = 1;
+
+}
+
+
+TextureAtlas::TextureAtlas(Renderer* pRenderer, const int pageSize)
+  : mpRenderer(pRenderer)
+  , mPageSize(pageSize)
+{
+}
+
+
+TextureRegion TextureAtlas::insert(const data::Image& image) {
+  const auto size = base::Extents{int(image.width()), int(image.height())};
+  const auto allocation = allocate(size);
+
+  const auto& pageTexture = allocation.mpPage->mTexture;
+  mpRenderer->updateTextureRegion(
+    pageTexture.data(), allocation.mPosition, image);
+  return TextureRegion{pageTexture.data(), {allocation.mPosition, size}};
+}
+
+
+auto TextureAtlas::allocate(const base::Extents& size) -> Allocation {
+  const auto paddedWidth = size.width + PADDING;
+  const auto paddedHeight = size.height + PADDING;
+
+  // Images which don't fit into a regular page get a page of their own
+  if (paddedWidth > mPageSize || paddedHeight > mPageSize) {
+    auto& page = addPage(size);
+    page.mUsedHeight = size.height;
+    return {&page, {0, 0}};
+  }
+
+  // Find the best fitting existing shelf, i.e. the one wasting the least
+  // amount of vertical space
+  Page* pBestPage = nullptr;
+  Shelf* pBestShelf = nullptr;
+  for (auto& page : mPages) {
+    for (auto& shelf : page.mShelves) {
+      const auto fits =
+        shelf.mHeight >= paddedHeight &&
+        shelf.mUsedWidth + paddedWidth <= mPageSize;
+      if (fits && (!pBestShelf || shelf.mHeight < pBestShelf->mHeight)) {
+        pBestPage = &page;
+        pBestShelf = &shelf;
+      }
+    }
+  }
+
+  if (pBestShelf) {
+    const auto position = base::Vector{
+      pBestShelf->mUsedWidth, pBestShelf->mTop};
+    pBestShelf->mUsedWidth += paddedWidth;
+    return {pBestPage, position};
+  }
+
+  // Open a new shelf, on a new page if there's no vertical space left
+  auto iPage = std::find_if(
+    mPages.begin(),
+    mPages.end(),
+    [&](const Page& page) {
+      const auto isDedicatedPage =
+        page.mTexture.extents() != base::Extents{mPageSize, mPageSize};
+      return
+        !isDedicatedPage && page.mUsedHeight + paddedHeight <= mPageSize;
+    });
+  auto& page = iPage != mPages.end()
+    ? *iPage
+    : addPage({mPageSize, mPageSize});
+
+  page.mShelves.push_back(Shelf{page.mUsedHeight, paddedHeight, paddedWidth});
+  page.mUsedHeight += paddedHeight;
+  return {&page, {0, page.mShelves.back().mTop}};
+}
+
+
+auto TextureAtlas::addPage(const base::Extents& size) -> Page& {
+  const auto blankImage = data::Image{
+    std::size_t(size.width), std::size_t(size.height)};
+
+  Page page;
+  page.mTexture = OwningTexture{mpRenderer, blankImage};
+  mPages.push_back(std::move(page));
+  return mPages.back();
+}
+
+}}
@@ -0,0 +1,85 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "base/spatial_types.hpp"
+#include "data/image.hpp"
+#include "engine/renderer.hpp"
+#include "engine/texture.hpp"
+
+#include <cstddef>
+#include <vector>
+
+
+namespace rigel { namespace engine {
+
+/** Packs many small images into a few large textures
+ *
+ * Drawing from many different textures forces the renderer to flush its
+ * batch every time the texture changes. To avoid that, sprites and UI
+ * graphics are allocated from an atlas instead of getting a texture of their
+ * own. Images are packed into large pages using a simple shelf packing scheme:
+ * Each page is divided into horizontal shelves, and an image is placed on
+ * the best fitting shelf which has room left, or on a newly opened shelf.
+ * A new page is added once all existing ones are full.
+ *
+ * Allocated regions stay valid for the life-time of the atlas. There is no
+ * way to free individual regions, so an atlas should be owned by whatever
+ * object defines the life-time of the images in it (e.g. a level).
+ */
+class TextureAtlas {
+public:
+  static constexpr auto DEFAULT_PAGE_SIZE = 1024;
+
+  explicit TextureAtlas(
+    Renderer* pRenderer,
+    int pageSize = DEFAULT_PAGE_SIZE);
+
+  TextureRegion insert(const data::Image& image);
+
+  std::size_t numPages() const {
+    return mPages.size();
+  }
+
+private:
+  struct Shelf {
+    int mTop;
+    int mHeight;
+    int mUsedWidth;
+  };
+
+  struct Page {
+    OwningTexture mTexture;
+    std::vector<Shelf> mShelves;
+    int mUsedHeight = 0;
+  };
+
+  struct Allocation {
+    Page* mpPage;
+    base::Vector mPosition;
+  };
+
+  Allocation allocate(const base::Extents& size);
+  Page& addPage(const base::Extents& size);
+
+  Renderer* mpRenderer;
+  int mPageSize;
+  std::vector<Page> mPages;
+};
+
+}}
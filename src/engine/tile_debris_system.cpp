@@ -0,0 +1,148 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tile_debris_system.hpp"
+
+#include "engine/map_renderer.hpp"
+
+#include <array>
+
+
+namespace rigel { namespace engine {
+
+namespace {
+
+const auto TILE_DEBRIS_LIFE_TIME = 80;
+
+const std::array<std::int8_t, 11> TILE_DEBRIS_MOVEMENT_SEQUENCE{
+  -3, -3, -2, -2, -1, 0, 0, 1, 2, 2, 3
+};
+
+
+template <typename T>
+void eraseMarked(
+  std::vector<T>& values,
+  const std::vector<std::int16_t>& framesToLive
+) {
+  std::size_t target = 0;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    if (framesToLive[i] >= 0) {
+      values[target] = values[i];
+      ++target;
+    }
+  }
+
+  values.resize(target);
+}
+
+}
+
+
+void TileDebrisSystem::spawnDebris(
+  const base::Vector& position,
+  const data::map::TileIndex tileIndex,
+  const int velocityX,
+  const int movementSequenceOffset
+) {
+  mPositions.push_back(position);
+  mTileIndices.push_back(tileIndex);
+  mVelocitiesX.push_back(static_cast<std::int8_t>(velocityX));
+  mVelocitiesY.push_back(0);
+  mMovementSteps.push_back(static_cast<std::uint8_t>(movementSequenceOffset));
+  mFramesToLive.push_back(TILE_DEBRIS_LIFE_TIME);
+  mSpawnedAfterPhase1.push_back(mIsInPhase2Window);
+}
+
+
+void TileDebrisSystem::updatePhase1() {
+  mIsInPhase2Window = true;
+
+  for (std::size_t i = 0; i < mPositions.size(); ++i) {
+    if (!mSpawnedAfterPhase1[i]) {
+      movePiece(i);
+    }
+  }
+}
+
+
+void TileDebrisSystem::updateLifeTime() {
+  auto anyExpired = false;
+  for (auto& framesToLive : mFramesToLive) {
+    --framesToLive;
+    anyExpired = anyExpired || framesToLive < 0;
+  }
+
+  if (!anyExpired) {
+    return;
+  }
+
+  eraseMarked(mPositions, mFramesToLive);
+  eraseMarked(mTileIndices, mFramesToLive);
+  eraseMarked(mVelocitiesX, mFramesToLive);
+  eraseMarked(mVelocitiesY, mFramesToLive);
+  eraseMarked(mMovementSteps, mFramesToLive);
+  eraseMarked(mSpawnedAfterPhase1, mFramesToLive);
+  eraseMarked(mFramesToLive, mFramesToLive);
+}
+
+
+void TileDebrisSystem::updatePhase2() {
+  for (std::size_t i = 0; i < mPositions.size(); ++i) {
+    if (mSpawnedAfterPhase1[i]) {
+      movePiece(i);
+      mSpawnedAfterPhase1[i] = false;
+    }
+  }
+
+  mIsInPhase2Window = false;
+}
+
+
+void TileDebrisSystem::clear() {
+  mPositions.clear();
+  mTileIndices.clear();
+  mVelocitiesX.clear();
+  mVelocitiesY.clear();
+  mMovementSteps.clear();
+  mFramesToLive.clear();
+  mSpawnedAfterPhase1.clear();
+}
+
+
+void TileDebrisSystem::render(
+  MapRenderer& mapRenderer,
+  const base::Vector& cameraPosition
+) const {
+  // All pieces use the tile set texture, so these draws form a single batch
+  for (std::size_t i = 0; i < mPositions.size(); ++i) {
+    mapRenderer.renderSingleTile(
+      mTileIndices[i], mPositions[i], cameraPosition);
+  }
+}
+
+
+void TileDebrisSystem::movePiece(const std::size_t index) {
+  // Once the sequence is finished, the last vertical velocity is kept
+  auto& step = mMovementSteps[index];
+  if (step < TILE_DEBRIS_MOVEMENT_SEQUENCE.size()) {
+    mVelocitiesY[index] = TILE_DEBRIS_MOVEMENT_SEQUENCE[step];
+    ++step;
+  }
+
+  mPositions[index] += base::Vector{mVelocitiesX[index], mVelocitiesY[index]};
+}
+
+}}
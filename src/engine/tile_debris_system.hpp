@@ -0,0 +1,108 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/spatial_types.hpp"
+#include "data/tile_attributes.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace rigel { namespace engine {
+
+class MapRenderer;
+
+
+/** Simulates and renders pieces of exploded map geometry
+ *
+ * When a section of the map explodes, each of its tiles flies off as a
+ * separate piece of debris. There can be hundreds of these at once, but
+ * they don't interact with anything, so instead of being entities, they
+ * are kept as plain data here. Pieces are stepped through a fixed vertical
+ * movement sequence while moving horizontally at a constant speed, and
+ * disappear after a fixed amount of time.
+ *
+ * The update functions mirror the points in a frame where the physics and
+ * life time systems process entities, so that debris moves and expires on
+ * exactly the same frames as other physics objects would.
+ */
+class TileDebrisSystem {
+public:
+  void spawnDebris(
+    const base::Vector& position,
+    data::map::TileIndex tileIndex,
+    int velocityX,
+    int movementSequenceOffset);
+
+  /** Move all pieces which existed before this update
+   *
+   * Pieces spawned from now on until updatePhase2() are moved in phase 2
+   * for the first time.
+   */
+  void updatePhase1();
+
+  /** Count down life time, remove pieces whose time is up */
+  void updateLifeTime();
+
+  /** Move pieces which have been spawned after updatePhase1() */
+  void updatePhase2();
+
+  /** Remove all pieces, e.g. when restarting the level
+   *
+   * Debris used to consist of entities, which were destroyed along with all
+   * other entities on level restart. This needs to be done explicitly now.
+   */
+  void clear();
+
+  void render(
+    MapRenderer& mapRenderer,
+    const base::Vector& cameraPosition) const;
+
+  std::size_t size() const {
+    return mPositions.size();
+  }
+
+  const std::vector<base::Vector>& positions() const {
+    return mPositions;
+  }
+
+  const std::vector<std::int8_t>& velocitiesX() const {
+    return mVelocitiesX;
+  }
+
+  const std::vector<std::int8_t>& velocitiesY() const {
+    return mVelocitiesY;
+  }
+
+private:
+  void movePiece(std::size_t index);
+
+  // Debris data in structure-of-arrays layout, in order of spawning
+  std::vector<base::Vector> mPositions;
+  std::vector<data::map::TileIndex> mTileIndices;
+  std::vector<std::int8_t> mVelocitiesX;
+  std::vector<std::int8_t> mVelocitiesY;
+  std::vector<std::uint8_t> mMovementSteps;
+  std::vector<std::int16_t> mFramesToLive;
+  std::vector<std::uint8_t> mSpawnedAfterPhase1;
+
+  bool mIsInPhase2Window = false;
+};
+
+}}
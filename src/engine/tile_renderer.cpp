@@ -27,7 +27,18 @@ namespace rigel { namespace engine {
 using namespace data;
 
 TileRenderer::TileRenderer(OwningTexture&& tileSet, Renderer* pRenderer)
-  : mTileSetTexture(std::move(tileSet))
+  : mOwnedTileSetTexture(std::move(tileSet))
+  , mTileSetTexture(mOwnedTileSetTexture)
+  , mpRenderer(pRenderer)
+{
+}
+
+
+TileRenderer::TileRenderer(
+  const TextureRegion& tileSet,
+  Renderer* pRenderer
+)
+  : mTileSetTexture(tileSet)
   , mpRenderer(pRenderer)
 {
 }
@@ -37,8 +48,10 @@ void TileRenderer::renderTileStretched(
   const int index,
   const base::Rect<int>& destRect
 ) const {
+  const auto sourceRectInTexture =
+    sourceRect(index, 1, 1) + mTileSetTexture.regionInTexture().topLeft;
   mpRenderer->drawTexture(
-    mTileSetTexture.data(), sourceRect(index, 1, 1), destRect);
+    mTileSetTexture.data(), sourceRectInTexture, destRect);
 }
 
 
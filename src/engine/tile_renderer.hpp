@@ -25,6 +25,12 @@ class TileRenderer {
 public:
   TileRenderer(OwningTexture&& tileSet, Renderer* pRenderer);
 
+  /** Use a tile set which is part of a texture atlas
+   *
+   * The region must stay valid for the life-time of the TileRenderer.
+   */
+  TileRenderer(const TextureRegion& tileSet, Renderer* pRenderer);
+
   void renderTileStretched(int index, const base::Rect<int>& destRect) const;
 
   void renderTile(int index, int posX, int posY) const;
@@ -59,7 +65,8 @@ private:
     const int tileSpanY) const;
 
 private:
-  OwningTexture mTileSetTexture;
+  OwningTexture mOwnedTileSetTexture;
+  TextureRegion mTileSetTexture;
   Renderer* mpRenderer;
 };
 
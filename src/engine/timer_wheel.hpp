@@ -0,0 +1,172 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+namespace rigel { namespace engine {
+
+/** Hierarchical timer wheel
+ *
+ * Keeps track of values which are due at a certain tick, so that advancing
+ * to the next tick only touches the values which are actually due, instead
+ * of counting down a timer on each of them.
+ *
+ * Timers which are due soon are kept in the slots of the first level, one
+ * slot per tick. Each further level covers a 64 times larger range with
+ * the same number of slots. Whenever the lower level wraps around, the
+ * timers from the next slot of the higher level are distributed into the
+ * lower levels. Each timer is thus moved at most once per level.
+ *
+ * There is no way to cancel a timer. Clients are expected to check whether
+ * a timer is still relevant when it fires, e.g. by storing a generation
+ * counter along with the value.
+ */
+template <typename T>
+class TimerWheel {
+public:
+  using Tick = std::uint32_t;
+
+  Tick currentTick() const {
+    return mCurrentTick;
+  }
+
+  std::size_t size() const {
+    return mSize;
+  }
+
+  /** Schedule value to fire when advancing to the given tick
+   *
+   * Ticks which are not in the future fire on the next advance().
+   */
+  void schedule(Tick dueTick, T value);
+
+  /** Advance by one tick, invoking callback(value) for each timer due */
+  template <typename Callback>
+  void advance(Callback&& callback);
+
+private:
+  static constexpr auto BITS_PER_LEVEL = 6;
+  static constexpr auto SLOTS_PER_LEVEL = 1u << BITS_PER_LEVEL;
+  static constexpr auto SLOT_MASK = SLOTS_PER_LEVEL - 1;
+  static constexpr auto NUM_LEVELS = 4;
+
+  struct Timer {
+    Tick mDueTick;
+    T mValue;
+  };
+
+  using Slot = std::vector<Timer>;
+
+  static std::size_t slotIndex(const Tick tick, const int level) {
+    return (tick >> (level * BITS_PER_LEVEL)) & SLOT_MASK;
+  }
+
+  void insert(Timer timer);
+  void cascade(int level);
+
+  std::array<std::array<Slot, SLOTS_PER_LEVEL>, NUM_LEVELS> mLevels;
+
+  // Timers too far in the future for the highest level
+  Slot mOverflow;
+
+  // Re-used to avoid allocations when firing or cascading timers
+  Slot mScratch;
+
+  Tick mCurrentTick = 0;
+  std::size_t mSize = 0;
+};
+
+
+template <typename T>
+void TimerWheel<T>::schedule(const Tick dueTick, T value) {
+  const auto earliestTick = mCurrentTick + 1;
+  insert(Timer{
+    dueTick > mCurrentTick ? dueTick : earliestTick,
+    std::move(value)});
+  ++mSize;
+}
+
+
+template <typename T>
+template <typename Callback>
+void TimerWheel<T>::advance(Callback&& callback) {
+  ++mCurrentTick;
+
+  for (int level = 1; level < NUM_LEVELS; ++level) {
+    if (slotIndex(mCurrentTick, level - 1) != 0) {
+      break;
+    }
+
+    cascade(level);
+  }
+
+  // The callback might schedule new timers, which could end up in the
+  // slot we're currently processing
+  auto& slot = mLevels[0][slotIndex(mCurrentTick, 0)];
+  std::swap(mScratch, slot);
+  mSize -= mScratch.size();
+
+  for (auto& timer : mScratch) {
+    callback(std::as_const(timer.mValue));
+  }
+  mScratch.clear();
+}
+
+
+template <typename T>
+void TimerWheel<T>::insert(Timer timer) {
+  const auto delta = timer.mDueTick - mCurrentTick;
+
+  for (int level = 0; level < NUM_LEVELS; ++level) {
+    const auto range = Tick{1} << ((level + 1) * BITS_PER_LEVEL);
+    if (delta < range) {
+      mLevels[level][slotIndex(timer.mDueTick, level)].push_back(
+        std::move(timer));
+      return;
+    }
+  }
+
+  mOverflow.push_back(std::move(timer));
+}
+
+
+template <typename T>
+void TimerWheel<T>::cascade(const int level) {
+  auto& slot = mLevels[level][slotIndex(mCurrentTick, level)];
+  std::swap(mScratch, slot);
+
+  // Once the highest level wraps around, overflowed timers might fit again
+  if (level == NUM_LEVELS - 1 && slotIndex(mCurrentTick, level) == 0) {
+    for (auto& timer : mOverflow) {
+      mScratch.push_back(std::move(timer));
+    }
+    mOverflow.clear();
+  }
+
+  for (auto& timer : mScratch) {
+    insert(std::move(timer));
+  }
+  mScratch.clear();
+}
+
+}}
@@ -37,15 +37,15 @@ namespace rigel { namespace engine {
 struct SpriteFrame {
   SpriteFrame() = default;
   SpriteFrame(
-    engine::OwningTexture image,
+    engine::TextureRegion image,
     base::Vector drawOffset
   )
-    : mImage(std::move(image))
+    : mImage(image)
     , mDrawOffset(drawOffset)
   {
   }
 
-  engine::OwningTexture mImage;
+  engine::TextureRegion mImage;
   base::Vector mDrawOffset;
 };
 
@@ -65,17 +65,6 @@ void advanceRandomNumberGenerator(GlobalDependencies& d) {
   d.mpRandomGenerator->gen();
 }
 
-
-struct WatchBotContainer {
-  void update(
-    GlobalDependencies& dependencies,
-    GlobalState& state,
-    bool isOnScreen,
-    entityx::Entity entity);
-
-  int mFramesElapsed = 0;
-};
-
 }
 
 
@@ -102,4 +102,15 @@ struct WatchBotCarrier {
   int mFramesElapsed = 0;
 };
 
+
+struct WatchBotContainer {
+  void update(
+    GlobalDependencies& dependencies,
+    GlobalState& state,
+    bool isOnScreen,
+    entityx::Entity entity);
+
+  int mFramesElapsed = 0;
+};
+
 }}}
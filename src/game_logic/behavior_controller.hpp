@@ -17,14 +17,34 @@
 #pragma once
 
 #include "base/warnings.hpp"
+#include "game_logic/ai/blowing_fan.hpp"
+#include "game_logic/ai/bomber_plane.hpp"
+#include "game_logic/ai/boss_episode_1.hpp"
+#include "game_logic/ai/ceiling_sucker.hpp"
+#include "game_logic/ai/eyeball_thrower.hpp"
+#include "game_logic/ai/floating_laser_bot.hpp"
+#include "game_logic/ai/missile.hpp"
+#include "game_logic/ai/red_bird.hpp"
+#include "game_logic/ai/rigelatin_soldier.hpp"
+#include "game_logic/ai/security_camera.hpp"
+#include "game_logic/ai/slime_pipe.hpp"
+#include "game_logic/ai/smash_hammer.hpp"
+#include "game_logic/ai/snake.hpp"
+#include "game_logic/ai/super_force_field.hpp"
+#include "game_logic/ai/watch_bot.hpp"
+#include "game_logic/dynamic_geometry_components.hpp"
+#include "game_logic/effect_actor_components.hpp"
 #include "game_logic/global_dependencies.hpp"
+#include "game_logic/interaction/respawn_checkpoint.hpp"
+#include "game_logic/item_container.hpp"
+#include "game_logic/tile_burner.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
-#include <memory>
 #include <type_traits>
+#include <variant>
 
 namespace rigel { namespace engine { namespace events {
   struct CollidedWithWorld;
@@ -146,11 +166,48 @@ behaviorControllerOnCollision(
 }
 
 
+/** Holds the state of an actor's behavior, and dispatches to it
+ *
+ * The set of behaviors is closed: Each type which can be assigned to a
+ * BehaviorController needs to be listed in BehaviorController::Behavior.
+ * In exchange, the behavior is stored inline in the component (no heap
+ * allocation per entity), and dispatching to it is a switch on the type
+ * index instead of a virtual call.
+ */
 class BehaviorController {
 public:
+  using Behavior = std::variant<
+    behaviors::BigBomb,
+    behaviors::BlowingFan,
+    behaviors::BomberPlane,
+    behaviors::BossEpisode1,
+    behaviors::BrokenMissile,
+    behaviors::CeilingSucker,
+    behaviors::DynamicGeometryController,
+    behaviors::EyeballThrower,
+    behaviors::FloatingLaserBot,
+    behaviors::Missile,
+    behaviors::NapalmBomb,
+    behaviors::RedBird,
+    behaviors::RigelatinSoldier,
+    behaviors::SecurityCamera,
+    behaviors::SlimeDrop,
+    behaviors::SlimePipe,
+    behaviors::SmashHammer,
+    behaviors::Snake,
+    behaviors::SuperForceField,
+    behaviors::TileBurner,
+    behaviors::WatchBot,
+    behaviors::WatchBotCarrier,
+    behaviors::WatchBotContainer,
+    components::ExplosionEffect,
+    components::WaterDropGenerator,
+    components::WindBlownSpiderGenerator,
+    interaction::RespawnCheckpoint>;
+
   template<typename T>
   explicit BehaviorController(T controller)
-    : mpSelf(std::make_shared<Model<T>>(std::move(controller)))
+    : mBehavior(std::move(controller))
   {
   }
 
@@ -160,7 +217,14 @@ public:
     const bool isOnScreen,
     entityx::Entity entity
   ) {
-    mpSelf->update(dependencies, state, isOnScreen, entity);
+    std::visit([&](auto& self) {
+      updateBehaviorController(
+        self,
+        dependencies,
+        state,
+        isOnScreen,
+        entity);
+    }, mBehavior);
   }
 
   void onHit(
@@ -169,7 +233,14 @@ public:
     const base::Point<float>& inflictorVelocity,
     entityx::Entity entity
   ) {
-    mpSelf->onHit(dependencies, state, inflictorVelocity, entity);
+    std::visit([&](auto& self) {
+      behaviorControllerOnHit(
+        self,
+        dependencies,
+        state,
+        inflictorVelocity,
+        entity);
+    }, mBehavior);
   }
 
   void onKilled(
@@ -178,7 +249,14 @@ public:
     const base::Point<float>& inflictorVelocity,
     entityx::Entity entity
   ) {
-    mpSelf->onKilled(dependencies, state, inflictorVelocity, entity);
+    std::visit([&](auto& self) {
+      behaviorControllerOnKilled(
+        self,
+        dependencies,
+        state,
+        inflictorVelocity,
+        entity);
+    }, mBehavior);
   }
 
   void onCollision(
@@ -187,106 +265,18 @@ public:
     const engine::events::CollidedWithWorld& event,
     entityx::Entity entity
   ) {
-    mpSelf->onCollision(dependencies, state, event, entity);
+    std::visit([&](auto& self) {
+      behaviorControllerOnCollision(self, dependencies, state, event, entity);
+    }, mBehavior);
   }
 
   template<typename T>
   T& get() {
-    auto pSelf = mpSelf.get();
-    return dynamic_cast<Model<T>*>(pSelf)->mData;
+    return std::get<T>(mBehavior);
   }
 
 private:
-  struct Concept {
-    virtual ~Concept() = default;
-
-    virtual void update(
-      GlobalDependencies& dependencies,
-      GlobalState& state,
-      bool isOnScreen,
-      entityx::Entity entity) = 0;
-
-    virtual void onHit(
-      GlobalDependencies& dependencies,
-      GlobalState& state,
-      const base::Point<float>& inflictorVelocity,
-      entityx::Entity entity) = 0;
-
-    virtual void onKilled(
-      GlobalDependencies& dependencies,
-      GlobalState& state,
-      const base::Point<float>& inflictorVelocity,
-      entityx::Entity entity) = 0;
-
-    virtual void onCollision(
-      GlobalDependencies& dependencies,
-      GlobalState& state,
-      const engine::events::CollidedWithWorld& event,
-      entityx::Entity entity) = 0;
-  };
-
-  template<typename T>
-  struct Model : public Concept {
-    explicit Model(T data_)
-      : mData(std::move(data_))
-    {
-    }
-
-    void update(
-      GlobalDependencies& dependencies,
-      GlobalState& state,
-      bool isOnScreen,
-      entityx::Entity entity
-    ) override {
-      updateBehaviorController(
-        mData,
-        dependencies,
-        state,
-        isOnScreen,
-        entity);
-    }
-
-    void onHit(
-      GlobalDependencies& dependencies,
-      GlobalState& state,
-      const base::Point<float>& inflictorVelocity,
-      entityx::Entity entity
-    ) override {
-      behaviorControllerOnHit(
-        mData,
-        dependencies,
-        state,
-        inflictorVelocity,
-        entity);
-    }
-
-    void onKilled(
-      GlobalDependencies& dependencies,
-      GlobalState& state,
-      const base::Point<float>& inflictorVelocity,
-      entityx::Entity entity
-    ) override {
-      behaviorControllerOnKilled(
-        mData,
-        dependencies,
-        state,
-        inflictorVelocity,
-        entity);
-    }
-
-    void onCollision(
-      GlobalDependencies& dependencies,
-      GlobalState& state,
-      const engine::events::CollidedWithWorld& event,
-      entityx::Entity entity
-    ) override {
-      behaviorControllerOnCollision(mData, dependencies, state, event, entity);
-    }
-
-    T mData;
-  };
-
-  std::shared_ptr<Concept> mpSelf;
+  Behavior mBehavior;
 };
 
 }}}
@@ -19,6 +19,7 @@
 #include "data/player_model.hpp"
 #include "engine/base_components.hpp"
 #include "engine/physical_components.hpp"
+#include "engine/spatial_index.hpp"
 #include "engine/visual_components.hpp"
 #include "game_service_provider.hpp"
 
@@ -51,10 +52,12 @@ auto extractVelocity(entityx::Entity entity) {
 DamageInflictionSystem::DamageInflictionSystem(
   data::PlayerModel* pPlayerModel,
   IGameServiceProvider* pServiceProvider,
+  const engine::SpatialIndex* pSpatialIndex,
   entityx::EventManager* pEvents
 )
   : mpPlayerModel(pPlayerModel)
   , mpServiceProvider(pServiceProvider)
+  , mpSpatialIndex(pSpatialIndex)
   , mpEvents(pEvents)
 {
 }
@@ -62,7 +65,7 @@ DamageInflictionSystem::DamageInflictionSystem(
 
 void DamageInflictionSystem::update(ex::EntityManager& es) {
   es.each<DamageInflicting, WorldPosition, BoundingBox>(
-    [this, &es](
+    [this](
       ex::Entity inflictorEntity,
       DamageInflicting& damage,
       const WorldPosition& inflictorPosition,
@@ -70,32 +73,38 @@ void DamageInflictionSystem::update(ex::EntityManager& es) {
     ) {
       const auto inflictorBbox = engine::toWorldSpace(bbox, inflictorPosition);
 
-      ex::ComponentHandle<Shootable> shootable;
-      ex::ComponentHandle<WorldPosition> shootablePos;
-      ex::ComponentHandle<BoundingBox> shootableBboxLocal;
-      for (auto shootableEntity : es.entities_with_components(
-        shootable, shootablePos, shootableBboxLocal)
-      ) {
-        const auto shootableBbox =
-          engine::toWorldSpace(*shootableBboxLocal, *shootablePos);
-
-        const auto shootableOnScreen =
-          shootableEntity.has_component<Active>() &&
-          shootableEntity.component<Active>()->mIsOnScreen;
-
-        if (
-          shootableBbox.intersects(inflictorBbox) &&
-          !shootable->mInvincible &&
-          (shootableOnScreen || shootable->mCanBeHitWhenOffscreen)
-        ) {
-          const auto destroyOnContact = damage.mDestroyOnContact ||
-            shootable->mAlwaysConsumeInflictor;
-          inflictDamage(inflictorEntity, damage, shootableEntity, *shootable);
-          if (destroyOnContact) {
-            break;
+      auto inflictorConsumed = false;
+      mpSpatialIndex->forEachCandidate(inflictorBbox,
+        [&](ex::Entity shootableEntity) {
+          if (
+            inflictorConsumed ||
+            !shootableEntity.valid() ||
+            !shootableEntity.has_component<Shootable>() ||
+            !shootableEntity.has_component<WorldPosition>() ||
+            !shootableEntity.has_component<BoundingBox>()
+          ) {
+            return;
           }
-        }
-      }
+
+          auto& shootable = *shootableEntity.component<Shootable>();
+          const auto shootableBbox = engine::toWorldSpace(
+            *shootableEntity.component<BoundingBox>(),
+            *shootableEntity.component<WorldPosition>());
+
+          const auto shootableOnScreen =
+            shootableEntity.has_component<Active>() &&
+            shootableEntity.component<Active>()->mIsOnScreen;
+
+          if (
+            shootableBbox.intersects(inflictorBbox) &&
+            !shootable.mInvincible &&
+            (shootableOnScreen || shootable.mCanBeHitWhenOffscreen)
+          ) {
+            inflictorConsumed = damage.mDestroyOnContact ||
+              shootable.mAlwaysConsumeInflictor;
+            inflictDamage(inflictorEntity, damage, shootableEntity, shootable);
+          }
+        });
     });
 }
 
@@ -27,6 +27,7 @@ RIGEL_RESTORE_WARNINGS
 namespace rigel { struct IGameServiceProvider; }
 
 namespace rigel { namespace data { class PlayerModel; }}
+namespace rigel { namespace engine { class SpatialIndex; }}
 
 
 namespace rigel { namespace game_logic {
@@ -36,6 +37,7 @@ public:
   DamageInflictionSystem(
     data::PlayerModel* pPlayerModel,
     IGameServiceProvider* pServiceProvider,
+    const engine::SpatialIndex* pSpatialIndex,
     entityx::EventManager* pEvents);
 
   void update(entityx::EntityManager& es);
@@ -49,6 +51,7 @@ private:
 
   data::PlayerModel* mpPlayerModel;
   IGameServiceProvider* mpServiceProvider;
+  const engine::SpatialIndex* mpSpatialIndex;
   entityx::EventManager* mpEvents;
 };
 
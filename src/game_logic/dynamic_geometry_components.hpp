@@ -16,7 +16,6 @@
 
 #pragma once
 
-#include "data/tile_attributes.hpp"
 #include "engine/base_components.hpp"
 #include "game_logic/global_dependencies.hpp"
 
@@ -32,11 +31,6 @@ struct MapGeometryLink {
   engine::components::BoundingBox mLinkedGeometrySection;
 };
 
-
-struct TileDebris {
-  data::map::TileIndex mTileIndex;
-};
-
 }
 
 namespace behaviors {
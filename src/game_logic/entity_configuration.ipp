@@ -2009,7 +2009,7 @@ void EntityFactory::configureEntity(
     case 21: case 204: case 205: case 206:
     case 136:
     case 85: case 86:
-      entity.assign<BoundingBox>(boundingBox);
+      engine::assignOrReplace<BoundingBox>(entity, boundingBox);
       break;
 
     default:
@@ -18,6 +18,7 @@
 
 #include "data/game_traits.hpp"
 #include "data/unit_conversions.hpp"
+#include "engine/entity_tools.hpp"
 #include "engine/life_time_components.hpp"
 #include "engine/physics_system.hpp"
 #include "engine/sprite_tools.hpp"
@@ -63,6 +64,7 @@
 #include "game_logic/tile_burner.hpp"
 #include "game_logic/trigger_components.hpp"
 
+#include <algorithm>
 #include <tuple>
 #include <utility>
 
@@ -84,6 +86,25 @@ using namespace game_logic::components;
 
 namespace {
 
+// Size of the cells used for finding deferred actors, in tiles
+const auto DEFERRED_SPAWN_CELL_SIZE = 32;
+
+
+int deferredSpawnCell(const int tileCoordinate) {
+  return tileCoordinate >= 0
+    ? tileCoordinate / DEFERRED_SPAWN_CELL_SIZE
+    : (tileCoordinate - DEFERRED_SPAWN_CELL_SIZE + 1) /
+      DEFERRED_SPAWN_CELL_SIZE;
+}
+
+
+std::uint64_t deferredSpawnCellKey(const int cellX, const int cellY) {
+  return
+    (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cellX)) << 32) |
+    static_cast<std::uint32_t>(cellY);
+}
+
+
 // Assign gravity affected moving body component
 template<typename EntityLike>
 void addDefaultMovingBody(
@@ -299,6 +320,19 @@ base::ArrayView<int> frameMapForActor(const ActorID actorId) {
   }
 }
 
+
+enum class PrefabKind : engine::PrefabId {
+  OneShotSprite = 1,
+  FloatingOneShotSprite = 2,
+  ScoreNumber = 3,
+  PlayerProjectile = 4
+};
+
+
+engine::PrefabId prefabId(const PrefabKind kind, const ActorID actorId) {
+  return (static_cast<engine::PrefabId>(kind) << 16) | actorId;
+}
+
 }
 
 
@@ -306,10 +340,10 @@ base::ArrayView<int> frameMapForActor(const ActorID actorId) {
 
 
 SpriteFactory::SpriteFactory(
-  engine::Renderer* pRenderer,
+  engine::TextureAtlas* pTextureAtlas,
   const ActorImagePackage* pSpritePackage
 )
-  : mpRenderer(pRenderer)
+  : mpTextureAtlas(pTextureAtlas)
   , mpSpritePackage(pSpritePackage)
 {
 }
@@ -330,10 +364,9 @@ Sprite SpriteFactory::createSprite(const ActorID mainId) {
       lastDrawOrder = actorData.mDrawIndex;
 
       for (const auto& frameData : actorData.mFrames) {
-        auto texture = engine::OwningTexture{
-          mpRenderer, frameData.mFrameImage};
         drawData.mFrames.emplace_back(
-          std::move(texture), frameData.mDrawOffset);
+          mpTextureAtlas->insert(frameData.mFrameImage),
+          frameData.mDrawOffset);
       }
 
       framesToRender.push_back(lastFrameCount);
@@ -366,12 +399,14 @@ base::Rect<int> SpriteFactory::actorFrameRect(
 
 
 EntityFactory::EntityFactory(
-  engine::Renderer* pRenderer,
+  engine::TextureAtlas* pTextureAtlas,
   ex::EntityManager* pEntityManager,
+  engine::PrefabPool* pPrefabPool,
   const loader::ActorImagePackage* pSpritePackage,
   const data::Difficulty difficulty)
-  : mSpriteFactory(pRenderer, pSpritePackage)
+  : mSpriteFactory(pTextureAtlas, pSpritePackage)
   , mpEntityManager(pEntityManager)
+  , mpPrefabPool(pPrefabPool)
   , mDifficulty(difficulty)
 {
 }
@@ -403,28 +438,79 @@ entityx::Entity EntityFactory::createSprite(
   const base::Vector& position,
   const bool assignBoundingBox
 ) {
-  auto entity = createSprite(actorID, assignBoundingBox);
-  entity.assign<WorldPosition>(position);
+  auto entity = mpEntityManager->create();
+  initializeSprite(entity, actorID, position, assignBoundingBox);
   return entity;
 }
 
 
+void EntityFactory::initializeSprite(
+  entityx::Entity entity,
+  const data::ActorID actorID,
+  const base::Vector& position,
+  const bool assignBoundingBox
+) {
+  using engine::assignOrReplace;
+
+  assignOrReplace<Sprite>(entity, createSpriteForId(actorID));
+
+  if (assignBoundingBox) {
+    const auto& sprite = *entity.component<Sprite>();
+    assignOrReplace<BoundingBox>(
+      entity, engine::inferBoundingBox(sprite, entity));
+  }
+
+  assignOrReplace<WorldPosition>(entity, position);
+}
+
+
+entityx::Entity EntityFactory::spawnPrefab(
+  const engine::PrefabId id,
+  const std::function<void(entityx::Entity)>& initialize
+) {
+  return mpPrefabPool->spawn(id, initialize);
+}
+
+
 entityx::Entity EntityFactory::createProjectile(
   const ProjectileType type,
   const WorldPosition& pos,
   const ProjectileDirection direction
 ) {
-  auto entity = createActor(actorIdForProjectile(type, direction), pos);
-  entity.assign<Active>();
-
-  configureProjectile(
-    entity,
-    type,
-    pos,
-    direction,
-    *entity.component<BoundingBox>());
+  const auto actorId = actorIdForProjectile(type, direction);
+  auto initialize = [&](entityx::Entity entity) {
+    initializeSprite(entity, actorId, pos, false);
+    const auto boundingBox =
+      engine::inferBoundingBox(*entity.component<Sprite>(), entity);
+    configureEntity(entity, actorId, boundingBox);
+    engine::assignOrReplace<Active>(entity);
+
+    configureProjectile(
+      entity,
+      type,
+      pos,
+      direction,
+      *entity.component<BoundingBox>());
+  };
+
+  // Enemy projectiles are comparatively rare, and create a muzzle flash
+  // along with them. Only the player's shots are worth recycling.
+  const auto isPooled =
+    isPlayerProjectile(type) || type == ProjectileType::ReactorDebris;
+  if (!isPooled) {
+    auto entity = mpEntityManager->create();
+    initialize(entity);
+    return entity;
+  }
 
-  return entity;
+  return spawnPrefab(prefabId(PrefabKind::PlayerProjectile, actorId), [&](
+    entityx::Entity entity
+  ) {
+    // Deactivated projectiles lose some of their components, and might
+    // carry a collision marker from their previous life.
+    engine::removeSafely<CollidedWithWorld>(entity);
+    initialize(entity);
+  });
 }
 
 
@@ -452,6 +538,8 @@ void EntityFactory::configureProjectile(
   using namespace engine::components::parameter_aliases;
   using namespace game_logic::components::parameter_aliases;
 
+  using engine::assignOrReplace;
+
   const auto isGoingLeft = direction == ProjectileDirection::Left;
 
   // Position adjustment for the flame thrower shot
@@ -480,7 +568,8 @@ void EntityFactory::configureProjectile(
   const auto speed = speedForProjectileType(type);
   const auto damageAmount = damageForProjectileType(type);
 
-  entity.assign<MovingBody>(
+  assignOrReplace<MovingBody>(
+    entity,
     Velocity{directionToVector(direction) * speed},
     GravityAffected{false});
   if (isPlayerProjectile(type) || type == ProjectileType::ReactorDebris) {
@@ -489,10 +578,11 @@ void EntityFactory::configureProjectile(
     entity.component<MovingBody>()->mIgnoreCollisions = true;
     entity.component<MovingBody>()->mIsActive = false;
 
-    entity.assign<DamageInflicting>(damageAmount, DestroyOnContact{false});
-    entity.assign<PlayerProjectile>(toPlayerProjectileType(type));
+    assignOrReplace<DamageInflicting>(
+      entity, damageAmount, DestroyOnContact{false});
+    assignOrReplace<PlayerProjectile>(entity, toPlayerProjectileType(type));
 
-    entity.assign<AutoDestroy>(AutoDestroy{
+    assignOrReplace<AutoDestroy>(entity, AutoDestroy{
       AutoDestroy::Condition::OnLeavingActiveRegion});
   } else {
     entity.assign<PlayerDamaging>(damageAmount, false, true);
@@ -519,68 +609,262 @@ entityx::Entity EntityFactory::createEntitiesForLevel(
 ) {
   entityx::Entity playerEntity;
 
-  for (const auto& actor : actors) {
-    // Difficulty/section markers should never appear in the actor descriptions
-    // coming from the loader, as they are handled during pre-processing.
-    assert(
-      actor.mID != 82 && actor.mID != 83 &&
-      actor.mID != 103 && actor.mID != 104);
+  mDeferredActors.clear();
+  mDeferredActorsByCell.clear();
+  mNumDeferredActors = 0;
 
-    auto entity = mpEntityManager->create();
-
-    auto position = actor.mPosition;
-    if (actor.mAssignedArea) {
-      // For dynamic geometry, the original position refers to the top-left
-      // corner of the assigned area, but it refers to the bottom-left corner
-      // for all other entities. Adjust the position here so that it's also
-      // bottom-left.
-      position.y += actor.mAssignedArea->size.height - 1;
-    }
-    entity.assign<WorldPosition>(position);
-
-    BoundingBox boundingBox;
-    if (actor.mAssignedArea) {
-      const auto mapSectionRect = *actor.mAssignedArea;
-      entity.assign<MapGeometryLink>(mapSectionRect);
-
-      boundingBox = mapSectionRect;
-      boundingBox.topLeft = {0, 0};
-    } else if (hasAssociatedSprite(actor.mID)) {
-      const auto sprite = createSpriteForId(actor.mID);
-      boundingBox = engine::inferBoundingBox(sprite, entity);
-      entity.assign<Sprite>(sprite);
+  for (const auto& actor : actors) {
+    if (tryDeferActor(actor)) {
+      continue;
     }
 
-    configureEntity(entity, actor.mID, boundingBox);
+    const auto numEntitiesBefore = mpEntityManager->size();
+    auto entity = createActorFromDescription(actor);
 
     const auto isPlayer = actor.mID == 5 || actor.mID == 6;
     if (isPlayer) {
-      const auto playerOrientation = actor.mID == 5
-        ? Orientation::Left
-        : Orientation::Right;
-      assignPlayerComponents(entity, playerOrientation);
       playerEntity = entity;
     }
+
+    if (
+      mDeferredSpawnDistance &&
+      !mDeferrableActorBboxes.count(actor.mID) &&
+      !isPlayer &&
+      !actor.mAssignedArea
+    ) {
+      classifyActor(
+        actor.mID, entity, mpEntityManager->size() - numEntitiesBefore);
+    }
   }
 
   return playerEntity;
 }
 
 
-entityx::Entity spawnOneShotSprite(
+void EntityFactory::setDeferredSpawnDistance(
+  const std::optional<int> distance
+) {
+  mDeferredSpawnDistance = distance;
+}
+
+
+void EntityFactory::spawnDeferredActors(const base::Vector& cameraPosition) {
+  if (mNumDeferredActors == 0) {
+    return;
+  }
+
+  const auto distance = mDeferredSpawnDistance.value_or(0);
+  const auto spawnArea = BoundingBox{
+    cameraPosition - base::Vector{distance, distance},
+    {GameTraits::mapViewPortSize.width + 2 * distance,
+     GameTraits::mapViewPortSize.height + 2 * distance}};
+
+  std::vector<std::size_t> actorsToSpawn;
+
+  const auto firstCellX = deferredSpawnCell(spawnArea.left());
+  const auto lastCellX = deferredSpawnCell(spawnArea.right());
+  const auto firstCellY = deferredSpawnCell(spawnArea.top());
+  const auto lastCellY = deferredSpawnCell(spawnArea.bottom());
+  for (auto y = firstCellY; y <= lastCellY; ++y) {
+    for (auto x = firstCellX; x <= lastCellX; ++x) {
+      const auto iCell = mDeferredActorsByCell.find(deferredSpawnCellKey(x, y));
+      if (iCell == mDeferredActorsByCell.end()) {
+        continue;
+      }
+
+      auto& actorIndices = iCell->second;
+      for (std::size_t i = 0; i < actorIndices.size();) {
+        auto& actor = mDeferredActors[actorIndices[i]];
+        if (
+          !actor.mHasBeenSpawned &&
+          !actor.mWorldSpaceBbox.intersects(spawnArea)
+        ) {
+          ++i;
+          continue;
+        }
+
+        if (!actor.mHasBeenSpawned) {
+          actor.mHasBeenSpawned = true;
+          actorsToSpawn.push_back(actorIndices[i]);
+        }
+
+        actorIndices[i] = actorIndices.back();
+        actorIndices.pop_back();
+      }
+
+      if (actorIndices.empty()) {
+        mDeferredActorsByCell.erase(iCell);
+      }
+    }
+  }
+
+  // Spawn in the same order as the actors appear in the level file
+  std::sort(actorsToSpawn.begin(), actorsToSpawn.end());
+
+  const auto currentSpawnIndex = mSpawnIndex;
+  for (const auto index : actorsToSpawn) {
+    const auto& actor = mDeferredActors[index];
+    mSpawnIndex = actor.mSpawnIndex;
+    createActorFromDescription(actor.mDescription);
+  }
+  mSpawnIndex = currentSpawnIndex;
+
+  mNumDeferredActors -= actorsToSpawn.size();
+}
+
+
+entityx::Entity EntityFactory::createActorFromDescription(
+  const data::map::LevelData::Actor& actor
+) {
+  // Difficulty/section markers should never appear in the actor descriptions
+  // coming from the loader, as they are handled during pre-processing.
+  assert(
+    actor.mID != 82 && actor.mID != 83 &&
+    actor.mID != 103 && actor.mID != 104);
+
+  auto entity = mpEntityManager->create();
+
+  auto position = actor.mPosition;
+  if (actor.mAssignedArea) {
+    // For dynamic geometry, the original position refers to the top-left
+    // corner of the assigned area, but it refers to the bottom-left corner
+    // for all other entities. Adjust the position here so that it's also
+    // bottom-left.
+    position.y += actor.mAssignedArea->size.height - 1;
+  }
+  entity.assign<WorldPosition>(position);
+
+  BoundingBox boundingBox;
+  if (actor.mAssignedArea) {
+    const auto mapSectionRect = *actor.mAssignedArea;
+    entity.assign<MapGeometryLink>(mapSectionRect);
+
+    boundingBox = mapSectionRect;
+    boundingBox.topLeft = {0, 0};
+  } else if (hasAssociatedSprite(actor.mID)) {
+    const auto sprite = createSpriteForId(actor.mID);
+    boundingBox = engine::inferBoundingBox(sprite, entity);
+    entity.assign<Sprite>(sprite);
+  }
+
+  configureEntity(entity, actor.mID, boundingBox);
+
+  const auto isPlayer = actor.mID == 5 || actor.mID == 6;
+  if (isPlayer) {
+    const auto playerOrientation = actor.mID == 5
+      ? Orientation::Left
+      : Orientation::Right;
+    assignPlayerComponents(entity, playerOrientation);
+  }
+
+  return entity;
+}
+
+
+bool EntityFactory::tryDeferActor(const data::map::LevelData::Actor& actor) {
+  if (!mDeferredSpawnDistance) {
+    return false;
+  }
+
+  const auto iBbox = mDeferrableActorBboxes.find(actor.mID);
+  if (iBbox == mDeferrableActorBboxes.end() || !iBbox->second) {
+    return false;
+  }
+
+  const auto worldSpaceBbox = engine::toWorldSpace(
+    *iBbox->second, actor.mPosition);
+
+  const auto index = mDeferredActors.size();
+  mDeferredActors.push_back(DeferredActor{actor, worldSpaceBbox, mSpawnIndex});
+  ++mNumDeferredActors;
+
+  // Keep spawn indices the same as without deferred spawning
+  ++mSpawnIndex;
+
+  const auto firstCellX = deferredSpawnCell(worldSpaceBbox.left());
+  const auto lastCellX = deferredSpawnCell(worldSpaceBbox.right());
+  const auto firstCellY = deferredSpawnCell(worldSpaceBbox.top());
+  const auto lastCellY = deferredSpawnCell(worldSpaceBbox.bottom());
+  for (auto y = firstCellY; y <= lastCellY; ++y) {
+    for (auto x = firstCellX; x <= lastCellX; ++x) {
+      mDeferredActorsByCell[deferredSpawnCellKey(x, y)].push_back(index);
+    }
+  }
+
+  return true;
+}
+
+
+void EntityFactory::classifyActor(
+  const data::ActorID id,
+  entityx::Entity entity,
+  const std::size_t numEntitiesCreated
+) {
+  using engine::components::ActivationSettings;
+  using Policy = ActivationSettings::Policy;
+
+  const auto hasLevelWideRelevance =
+    entity.has_component<ActorTag>() ||
+    entity.has_component<RadarDish>() ||
+    entity.has_component<Interactable>() ||
+    entity.has_component<MapGeometryLink>() ||
+    (entity.has_component<ActivationSettings>() &&
+     entity.component<ActivationSettings>()->mPolicy == Policy::Always);
+
+  // Actors which create additional entities along with them, or don't
+  // have a usable bounding box, are also always created right away.
+  const auto canBeDeferred =
+    !hasLevelWideRelevance &&
+    numEntitiesCreated == 1 &&
+    entity.has_component<BoundingBox>() &&
+    entity.component<BoundingBox>()->size.width > 0 &&
+    entity.component<BoundingBox>()->size.height > 0;
+
+  mDeferrableActorBboxes[id] = canBeDeferred
+    ? std::optional<BoundingBox>{*entity.component<BoundingBox>()}
+    : std::nullopt;
+}
+
+
+namespace {
+
+void initializeOneShotSprite(
   IEntityFactory& factory,
+  ex::Entity entity,
   const ActorID id,
   const base::Vector& position
 ) {
-  auto entity = factory.createSprite(id, position, true);
+  // Some callers add damage components to the returned sprite. Removing
+  // them here keeps such instances recyclable, the prefab pool would
+  // otherwise replace them with a new entity.
+  engine::removeSafely<BehaviorController>(entity);
+  engine::removeSafely<PlayerDamaging>(entity);
+  engine::removeSafely<DamageInflicting>(entity);
+
+  factory.initializeSprite(entity, id, position, true);
   const auto numAnimationFrames = static_cast<int>(
     entity.component<Sprite>()->mpDrawData->mFrames.size());
   if (numAnimationFrames > 1) {
     engine::startAnimationLoop(entity, 1, 0, std::nullopt);
   }
-  entity.assign<AutoDestroy>(AutoDestroy::afterTimeout(numAnimationFrames));
+  engine::assignOrReplace<AutoDestroy>(
+    entity, AutoDestroy::afterTimeout(numAnimationFrames));
   assignSpecialEffectSpriteProperties(entity, id);
-  return entity;
+}
+
+}
+
+
+entityx::Entity spawnOneShotSprite(
+  IEntityFactory& factory,
+  const ActorID id,
+  const base::Vector& position
+) {
+  return factory.spawnPrefab(
+    prefabId(PrefabKind::OneShotSprite, id),
+    [&](ex::Entity entity) {
+      initializeOneShotSprite(factory, entity, id, position);
+    });
 }
 
 
@@ -591,12 +875,15 @@ entityx::Entity spawnFloatingOneShotSprite(
 ) {
   using namespace engine::components::parameter_aliases;
 
-  auto entity = spawnOneShotSprite(factory, id, position);
-  entity.assign<MovingBody>(MovingBody{
-    Velocity{0, -1.0f},
-    GravityAffected{false},
-    IgnoreCollisions{true}});
-  return entity;
+  return factory.spawnPrefab(
+    prefabId(PrefabKind::FloatingOneShotSprite, id),
+    [&](ex::Entity entity) {
+      initializeOneShotSprite(factory, entity, id, position);
+      engine::assignOrReplace<MovingBody>(entity, MovingBody{
+        Velocity{0, -1.0f},
+        GravityAffected{false},
+        IgnoreCollisions{true}});
+    });
 }
 
 
@@ -622,16 +909,24 @@ void spawnFloatingScoreNumber(
   const base::Vector& position
 ) {
   using namespace engine::components::parameter_aliases;
-
-  auto entity = factory.createSprite(scoreNumberActor(type), position, true);
-  engine::startAnimationSequence(entity, SCORE_NUMBER_ANIMATION_SEQUENCE);
-  entity.assign<MovementSequence>(SCORE_NUMBER_MOVE_SEQUENCE);
-  entity.assign<MovingBody>(
-    Velocity{},
-    GravityAffected{false},
-    IgnoreCollisions{true});
-  entity.assign<AutoDestroy>(AutoDestroy::afterTimeout(SCORE_NUMBER_LIFE_TIME));
-  entity.assign<Active>();
+  using engine::assignOrReplace;
+
+  const auto actorId = scoreNumberActor(type);
+  factory.spawnPrefab(
+    prefabId(PrefabKind::ScoreNumber, actorId),
+    [&](ex::Entity entity) {
+      factory.initializeSprite(entity, actorId, position, true);
+      engine::startAnimationSequence(entity, SCORE_NUMBER_ANIMATION_SEQUENCE);
+      assignOrReplace<MovementSequence>(entity, SCORE_NUMBER_MOVE_SEQUENCE);
+      assignOrReplace<MovingBody>(
+        entity,
+        Velocity{},
+        GravityAffected{false},
+        IgnoreCollisions{true});
+      assignOrReplace<AutoDestroy>(
+        entity, AutoDestroy::afterTimeout(SCORE_NUMBER_LIFE_TIME));
+      assignOrReplace<Active>(entity);
+    });
 }
 
 
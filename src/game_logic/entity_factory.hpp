@@ -19,7 +19,9 @@
 #include "base/warnings.hpp"
 #include "data/game_session_data.hpp"
 #include "engine/base_components.hpp"
-#include "engine/renderer.hpp"
+#include "engine/physical_components.hpp"
+#include "engine/prefab_pool.hpp"
+#include "engine/texture_atlas.hpp"
 #include "engine/visual_components.hpp"
 #include "game_logic/ientity_factory.hpp"
 #include "loader/level_loader.hpp"
@@ -29,6 +31,7 @@ RIGEL_DISABLE_WARNINGS
 #include <SDL.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <cstdint>
 #include <optional>
 #include <unordered_map>
 #include <vector>
@@ -92,7 +95,7 @@ inline bool isHorizontal(const ProjectileDirection direction) {
 class SpriteFactory {
 public:
   SpriteFactory(
-    engine::Renderer* pRenderer,
+    engine::TextureAtlas* pTextureAtlas,
     const loader::ActorImagePackage* pSpritePackage);
 
   engine::components::Sprite createSprite(data::ActorID id);
@@ -104,7 +107,7 @@ private:
     std::vector<int> mInitialFramesToRender;
   };
 
-  engine::Renderer* mpRenderer;
+  engine::TextureAtlas* mpTextureAtlas;
   const loader::ActorImagePackage* mpSpritePackage;
   std::unordered_map<data::ActorID, SpriteData> mSpriteDataCache;
 };
@@ -113,14 +116,35 @@ private:
 class EntityFactory : public IEntityFactory {
 public:
   EntityFactory(
-    engine::Renderer* pRenderer,
+    engine::TextureAtlas* pTextureAtlas,
     entityx::EntityManager* pEntityManager,
+    engine::PrefabPool* pPrefabPool,
     const loader::ActorImagePackage* pSpritePackage,
     data::Difficulty difficulty);
 
   entityx::Entity createEntitiesForLevel(
     const data::map::ActorDescriptionList& actors) override;
 
+  /** Enable or disable deferred spawning of level actors
+   *
+   * When enabled, createEntitiesForLevel() doesn't create all actors right
+   * away. Actors which don't need to exist from the start are instead kept
+   * until spawnDeferredActors() is called with a camera position that brings
+   * them within the given distance (in tiles) of the visible area.
+   *
+   * Actors which are relevant for level-wide state, like bonus items,
+   * radar dishes, or actors which are always active, are never deferred.
+   * Which actors fall into this category is determined by creating the
+   * first actor of each type normally, and inspecting the result.
+   */
+  void setDeferredSpawnDistance(std::optional<int> distance);
+
+  void spawnDeferredActors(const base::Vector& cameraPosition);
+
+  std::size_t numDeferredActors() const {
+    return mNumDeferredActors;
+  }
+
   /** Create a sprite entity using the given actor ID. If assignBoundingBox is
    * true, the dimensions of the sprite's first frame are used to assign a
    * bounding box.
@@ -134,6 +158,16 @@ public:
     const base::Vector& position,
     bool assignBoundingBox = false) override;
 
+  void initializeSprite(
+    entityx::Entity entity,
+    data::ActorID actorID,
+    const base::Vector& position,
+    bool assignBoundingBox) override;
+
+  entityx::Entity spawnPrefab(
+    engine::PrefabId id,
+    const std::function<void(entityx::Entity)>& initialize) override;
+
   entityx::Entity createProjectile(
     ProjectileType type,
     const engine::components::WorldPosition& pos,
@@ -144,8 +178,24 @@ public:
     const base::Vector& position) override;
 
 private:
+  struct DeferredActor {
+    data::map::LevelData::Actor mDescription;
+    engine::components::BoundingBox mWorldSpaceBbox;
+    int mSpawnIndex;
+    bool mHasBeenSpawned = false;
+  };
+
   engine::components::Sprite createSpriteForId(const data::ActorID actorID);
 
+  entityx::Entity createActorFromDescription(
+    const data::map::LevelData::Actor& actor);
+
+  bool tryDeferActor(const data::map::LevelData::Actor& actor);
+  void classifyActor(
+    data::ActorID id,
+    entityx::Entity entity,
+    std::size_t numEntitiesCreated);
+
   void configureEntity(
     entityx::Entity entity,
     const data::ActorID actorID,
@@ -170,8 +220,21 @@ private:
 
   SpriteFactory mSpriteFactory;
   entityx::EntityManager* mpEntityManager;
+  engine::PrefabPool* mpPrefabPool;
   int mSpawnIndex = 0;
   data::Difficulty mDifficulty;
+
+  std::optional<int> mDeferredSpawnDistance;
+  std::vector<DeferredActor> mDeferredActors;
+  std::unordered_map<std::uint64_t, std::vector<std::size_t>>
+    mDeferredActorsByCell;
+  std::size_t mNumDeferredActors = 0;
+
+  // Local space bounding box for each actor ID that can be deferred, or
+  // nullopt for actors that need to be created right away
+  std::unordered_map<
+    data::ActorID,
+    std::optional<engine::components::BoundingBox>> mDeferrableActorBboxes;
 };
 
 
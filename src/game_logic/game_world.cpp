@@ -16,6 +16,7 @@
 
 #include "game_world.hpp"
 
+#include "base/profiler.hpp"
 #include "data/game_traits.hpp"
 #include "data/map.hpp"
 #include "data/sound_ids.hpp"
@@ -65,6 +66,10 @@ std::string levelFileName(const int episode, const int level) {
 
 constexpr auto BOSS_LEVEL_INTRO_MUSIC = "CALM.IMF";
 
+// Level actors are created once they come within this many tiles of the
+// visible area
+constexpr auto DEFERRED_ACTOR_SPAWN_DISTANCE = 16;
+
 
 struct BonusRelatedItemCounts {
   int mCameraCount = 0;
@@ -134,9 +139,12 @@ GameWorld::GameWorld(
   , mpUiSpriteSheet(context.mpUiSpriteSheetRenderer)
   , mpTextRenderer(context.mpUiRenderer)
   , mEntities(mEventManager)
+  , mPrefabPool(mEntities, mEventManager)
+  , mTextureAtlas(context.mpRenderer)
   , mEntityFactory(
-      context.mpRenderer,
+      &mTextureAtlas,
       &mEntities,
+      &mPrefabPool,
       &context.mpResources->mActorImagePackage,
       sessionId.mDifficulty)
   , mpPlayerModel(pPlayerModel)
@@ -146,6 +154,7 @@ GameWorld::GameWorld(
       mpPlayerModel,
       sessionId.mLevel + 1,
       mpRenderer,
+      &mTextureAtlas,
       *context.mpResources,
       context.mpUiSpriteSheetRenderer)
   , mMessageDisplay(mpServiceProvider, context.mpUiRenderer)
@@ -162,6 +171,8 @@ GameWorld::GameWorld(
   mEventManager.subscribe<rigel::game_logic::events::ShootableKilled>(*this);
   mEventManager.subscribe<rigel::events::BossActivated>(*this);
 
+  mEntityFactory.setDeferredSpawnDistance(DEFERRED_ACTOR_SPAWN_DISTANCE);
+
   using namespace std::chrono;
   auto before = high_resolution_clock::now();
 
@@ -201,6 +212,21 @@ bool GameWorld::levelFinished() const {
 }
 
 
+std::size_t GameWorld::numEntities() const {
+  return mEntities.size();
+}
+
+
+WorldStateHash GameWorld::stateHash() {
+  return hashWorldState(
+    mLevelData.mMap,
+    mEntities,
+    mpSystems->tileDebris(),
+    *mpPlayerModel,
+    mRandomGenerator);
+}
+
+
 std::set<data::Bonus> GameWorld::achievedBonuses() const {
   std::set<data::Bonus> bonuses;
 
@@ -333,6 +359,8 @@ void GameWorld::loadLevel(
   const data::GameSessionId& sessionId,
   const loader::ResourceLoader& resources
 ) {
+  RIGEL_PROFILE_ZONE("Level setup");
+
   auto loadedLevel = loader::loadLevel(
     levelFileName(sessionId.mEpisode, sessionId.mLevel),
     resources,
@@ -362,6 +390,7 @@ void GameWorld::loadLevel(
     engine::MapRenderer::MapRenderData{std::move(loadedLevel)},
     mpServiceProvider,
     &mEntityFactory,
+    &mPrefabPool,
     &mRandomGenerator,
     &mRadarDishCounter,
     mpRenderer,
@@ -384,6 +413,8 @@ void GameWorld::loadLevel(
 
 
 void GameWorld::updateGameLogic(const PlayerInput& input) {
+  RIGEL_PROFILE_ZONE("Game logic");
+
   mBackdropFlashColor = std::nullopt;
   mScreenFlashColor = std::nullopt;
 
@@ -399,10 +430,20 @@ void GameWorld::updateGameLogic(const PlayerInput& input) {
   mMessageDisplay.update();
 
   mpSystems->update(input, mEntities);
+
+  // These can restart the level or move the player elsewhere, so they are
+  // handled once all systems are done with the current tick. Doing this as
+  // part of the tick (instead of once per rendered frame) keeps the game
+  // logic independent of the frame rate, which replays rely on.
+  handlePlayerDeath();
+  handleLevelExit();
+  handleTeleporter();
 }
 
 
 void GameWorld::render() {
+  RIGEL_PROFILE_ZONE("World rendering");
+
   mpRenderer->clear();
 
   {
@@ -422,6 +463,8 @@ void GameWorld::render() {
     } else {
       mpRenderer->clear(*mScreenFlashColor);
     }
+
+    RIGEL_PROFILE_ZONE("HUD rendering");
     mHudRenderer.render();
   }
 
@@ -434,14 +477,8 @@ void GameWorld::render() {
   } else {
     mMessageDisplay.render();
   }
-}
-
-
-void GameWorld::processEndOfFrameActions() {
-  handlePlayerDeath();
-  handleLevelExit();
-  handleTeleporter();
 
+  // Screen shake only lasts for a single frame
   mScreenShakeOffsetX = 0;
 }
 
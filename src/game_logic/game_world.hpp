@@ -23,12 +23,15 @@
 #include "data/player_model.hpp"
 #include "data/tutorial_messages.hpp"
 #include "engine/earth_quake_effect.hpp"
+#include "engine/prefab_pool.hpp"
 #include "engine/random_number_generator.hpp"
+#include "engine/texture_atlas.hpp"
 #include "game_logic/damage_components.hpp"
 #include "game_logic/enemy_radar.hpp"
 #include "game_logic/entity_factory.hpp"
 #include "game_logic/input.hpp"
 #include "game_logic/player/components.hpp"
+#include "game_logic/world_state_hash.hpp"
 #include "ui/hud_renderer.hpp"
 #include "ui/ingame_message_display.hpp"
 
@@ -62,6 +65,8 @@ public:
 
   bool levelFinished() const;
   std::set<data::Bonus> achievedBonuses() const;
+  std::size_t numEntities() const;
+  WorldStateHash stateHash();
 
   void receive(const rigel::events::CheckPointActivated& event);
   void receive(const rigel::events::ExitReached& event);
@@ -77,7 +82,6 @@ public:
 
   void updateGameLogic(const PlayerInput& input);
   void render();
-  void processEndOfFrameActions();
 
   friend class rigel::GameRunner;
 
@@ -122,6 +126,8 @@ private:
   ui::MenuElementRenderer* mpTextRenderer;
   entityx::EventManager mEventManager;
   entityx::EntityManager mEntities;
+  engine::PrefabPool mPrefabPool;
+  engine::TextureAtlas mTextureAtlas;
   EntityFactory mEntityFactory;
 
   data::PlayerModel* mpPlayerModel;
@@ -36,6 +36,7 @@ namespace rigel {
     class CollisionChecker;
     class ParticleSystem;
     class RandomNumberGenerator;
+    class TileDebrisSystem;
   }
 
   namespace game_logic {
@@ -50,6 +51,7 @@ namespace rigel { namespace game_logic {
 struct GlobalDependencies {
   const engine::CollisionChecker* mpCollisionChecker;
   engine::ParticleSystem* mpParticles;
+  engine::TileDebrisSystem* mpTileDebris;
   engine::RandomNumberGenerator* mpRandomGenerator;
   IEntityFactory* mpEntityFactory;
   IGameServiceProvider* mpServiceProvider;
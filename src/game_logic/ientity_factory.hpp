@@ -18,12 +18,15 @@
 
 #include "base/warnings.hpp"
 #include "engine/base_components.hpp"
+#include "engine/prefab_pool.hpp"
 #include "data/map.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <functional>
+
 namespace rigel { namespace game_logic {
 
 enum class ProjectileType {
@@ -64,6 +67,21 @@ struct IEntityFactory {
     const base::Vector& position,
     bool assignBoundingBox = false) = 0;
 
+  /** Assign sprite, position and optionally bounding box for the given actor
+   * ID to an existing entity. Components which the entity already has are
+   * overwritten in place.
+   */
+  virtual void initializeSprite(
+    entityx::Entity entity,
+    data::ActorID actorID,
+    const base::Vector& position,
+    bool assignBoundingBox) = 0;
+
+  /** Create an instance of the given prefab, see engine::PrefabPool */
+  virtual entityx::Entity spawnPrefab(
+    engine::PrefabId id,
+    const std::function<void(entityx::Entity)>& initialize) = 0;
+
   virtual entityx::Entity createProjectile(
     ProjectileType type,
     const engine::components::WorldPosition& pos,
@@ -16,6 +16,7 @@
 
 #include "ingame_systems.hpp"
 
+#include "base/profiler.hpp"
 #include "data/player_model.hpp"
 #include "engine/random_number_generator.hpp"
 #include "game_logic/enemy_radar.hpp"
@@ -52,6 +53,7 @@ IngameSystems::IngameSystems(
   engine::MapRenderer::MapRenderData&& mapRenderData,
   IGameServiceProvider* pServiceProvider,
   EntityFactory* pEntityFactory,
+  engine::PrefabPool* pPrefabPool,
   engine::RandomNumberGenerator* pRandomGenerator,
   const RadarDishCounter* pRadarDishCounter,
   engine::Renderer* pRenderer,
@@ -60,6 +62,12 @@ IngameSystems::IngameSystems(
   const loader::ResourceLoader& resources
 )
   : mCollisionChecker(pMap, entities, eventManager)
+  , mSpatialIndex(pMap->width(), pMap->height(), eventManager)
+  , mEntityActivationSystem(
+      pMap->width(),
+      pMap->height(),
+      entities,
+      eventManager)
   , mPlayer(
       playerEntity,
       sessionId.mDifficulty,
@@ -76,8 +84,12 @@ IngameSystems::IngameSystems(
       &mCamera.position(),
       pRenderer,
       pMap,
-      std::move(mapRenderData))
+      std::move(mapRenderData),
+      &mTileDebris,
+      entities,
+      eventManager)
   , mPhysicsSystem(&mCollisionChecker, pMap, &eventManager)
+  , mLifeTimeSystem(entities, eventManager, pPrefabPool)
   , mDebuggingSystem(pRenderer, &mCamera.position(), pMap)
   , mPlayerInteractionSystem(
       sessionId,
@@ -85,9 +97,10 @@ IngameSystems::IngameSystems(
       pPlayerModel,
       pServiceProvider,
       pEntityFactory,
+      &mSpatialIndex,
       &eventManager,
       resources)
-  , mPlayerDamageSystem(&mPlayer, &eventManager)
+  , mPlayerDamageSystem(&mPlayer, &mSpatialIndex, &eventManager)
   , mPlayerProjectileSystem(pEntityFactory, pServiceProvider, *pMap)
   , mElevatorSystem(
       playerEntity,
@@ -95,10 +108,14 @@ IngameSystems::IngameSystems(
       &mCollisionChecker,
       &eventManager)
   , mRadarComputerSystem(pRadarDishCounter)
-  , mDamageInflictionSystem(pPlayerModel, pServiceProvider, &eventManager)
+  , mDamageInflictionSystem(
+      pPlayerModel,
+      pServiceProvider,
+      &mSpatialIndex,
+      &eventManager)
   , mDynamicGeometrySystem(
       pServiceProvider,
-      &entities,
+      &mTileDebris,
       pMap,
       pRandomGenerator,
       &eventManager)
@@ -158,6 +175,7 @@ IngameSystems::IngameSystems(
       GlobalDependencies{
         &mCollisionChecker,
         &mParticles,
+        &mTileDebris,
         pRandomGenerator,
         pEntityFactory,
         pServiceProvider,
@@ -166,6 +184,7 @@ IngameSystems::IngameSystems(
       &mPlayer,
       &mCamera.position(),
       pMap)
+  , mpEntityFactory(pEntityFactory)
   , mpRandomGenerator(pRandomGenerator)
   , mpServiceProvider(pServiceProvider)
 {
@@ -179,63 +198,187 @@ void IngameSystems::update(
   // ----------------------------------------------------------------------
   // Animation update
   // ----------------------------------------------------------------------
-  mRenderingSystem.updateAnimatedMapTiles();
-  engine::updateAnimatedSprites(es);
-  interaction::animateForceFields(es, *mpRandomGenerator, *mpServiceProvider);
+  {
+    RIGEL_PROFILE_ZONE("Animation");
+    mRenderingSystem.updateAnimatedMapTiles();
+    engine::updateAnimatedSprites(es);
+    interaction::animateForceFields(es, *mpRandomGenerator, *mpServiceProvider);
+  }
 
   // ----------------------------------------------------------------------
   // Player update, camera, mark active entities
   // ----------------------------------------------------------------------
-  mPlayerInteractionSystem.updatePlayerInteraction(input, es);
-
-  mPlayer.update(input);
-  mCamera.update(input);
-  engine::markActiveEntities(es, mCamera.position());
+  {
+    RIGEL_PROFILE_ZONE("Player interaction");
+    mPlayerInteractionSystem.updatePlayerInteraction(input, es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Player");
+    mPlayer.update(input);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Camera");
+    mCamera.update(input);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Deferred actor spawning");
+    mpEntityFactory->spawnDeferredActors(mCamera.position());
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Entity activation");
+    mEntityActivationSystem.update(mCamera.position());
+  }
 
   // ----------------------------------------------------------------------
   // Player related logic update
   // ----------------------------------------------------------------------
-  mElevatorSystem.update(es);
-  mRadarComputerSystem.update(es);
+  {
+    RIGEL_PROFILE_ZONE("Elevators");
+    mElevatorSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Radar computers");
+    mRadarComputerSystem.update(es);
+  }
 
   // ----------------------------------------------------------------------
   // A.I. logic update
   // ----------------------------------------------------------------------
-  mBlueGuardSystem.update(es);
-  mHoverBotSystem.update(es);
-  mLaserTurretSystem.update(es);
-  mMessengerDroneSystem.update(es);
-  mPrisonerSystem.update(es);
-  mRocketTurretSystem.update(es);
-  mSimpleWalkerSystem.update(es);
-  mSlidingDoorSystem.update(es);
-  mSlimeBlobSystem.update(es);
-  mSpiderSystem.update(es);
-  mSpikeBallSystem.update(es);
-  mBehaviorControllerSystem.update(es, input);
+  {
+    RIGEL_PROFILE_ZONE("AI: Blue guards");
+    mBlueGuardSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("AI: Hover bots");
+    mHoverBotSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("AI: Laser turrets");
+    mLaserTurretSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("AI: Messenger drones");
+    mMessengerDroneSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("AI: Prisoners");
+    mPrisonerSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("AI: Rocket turrets");
+    mRocketTurretSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("AI: Simple walkers");
+    mSimpleWalkerSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("AI: Sliding doors");
+    mSlidingDoorSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("AI: Slime blobs");
+    mSlimeBlobSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("AI: Spiders");
+    mSpiderSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("AI: Spike balls");
+    mSpikeBallSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("AI: Behavior controllers");
+    mBehaviorControllerSystem.update(es, input);
+  }
 
   // ----------------------------------------------------------------------
   // Physics and other updates
   // ----------------------------------------------------------------------
-  mPhysicsSystem.updatePhase1(es);
-
-  // Collect items after physics, so that any collectible
-  // items are in their final positions for this frame.
-  mPlayerInteractionSystem.updateItemCollection(es);
-
-  mPlayerDamageSystem.update(es);
-  mDamageInflictionSystem.update(es);
-  mItemContainerSystem.update(es);
-
-  mPlayerProjectileSystem.update(es);
-
-  mEffectsSystem.update(es);
-  mLifeTimeSystem.update(es);
-
-  // Now process any MovingBody objects that have been spawned after phase 1
-  mPhysicsSystem.updatePhase2(es);
-
-  mParticles.update();
+  {
+    RIGEL_PROFILE_ZONE("Physics phase 1");
+    mTileDebris.updatePhase1();
+    mPhysicsSystem.updatePhase1(es);
+  }
+
+  {
+    // Item collection and damage are based on entity positions after
+    // physics, so the spatial index used by them is built at this point.
+    // Entities spawned by the following systems are picked up by the index,
+    // but an entity that gets moved by one of them (e.g. by an event
+    // handler teleporting it) is only found at its old position until the
+    // next frame. The full scans used previously would have seen the new
+    // position right away.
+    RIGEL_PROFILE_ZONE("Spatial index");
+    mSpatialIndex.rebuild(es);
+  }
+
+  {
+    // Collect items after physics, so that any collectible
+    // items are in their final positions for this frame.
+    RIGEL_PROFILE_ZONE("Item collection");
+    mPlayerInteractionSystem.updateItemCollection(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Player damage");
+    mPlayerDamageSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Damage infliction");
+    mDamageInflictionSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Item containers");
+    mItemContainerSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Player projectiles");
+    mPlayerProjectileSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Effects");
+    mEffectsSystem.update(es);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Life time");
+    mLifeTimeSystem.update();
+    mTileDebris.updateLifeTime();
+  }
+
+  {
+    // Now process any MovingBody objects that have been spawned after phase 1
+    RIGEL_PROFILE_ZONE("Physics phase 2");
+    mPhysicsSystem.updatePhase2(es);
+    mTileDebris.updatePhase2();
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Particles");
+    mParticles.update();
+  }
 }
 
 
@@ -243,9 +386,20 @@ void IngameSystems::render(
   entityx::EntityManager& es,
   const std::optional<base::Color>& backdropFlashColor
 ) {
-  mRenderingSystem.update(es, backdropFlashColor);
-  mParticles.render(mCamera.position());
-  mDebuggingSystem.update(es);
+  {
+    RIGEL_PROFILE_ZONE("Rendering system");
+    mRenderingSystem.update(es, backdropFlashColor);
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Particle rendering");
+    mParticles.render(mCamera.position());
+  }
+
+  {
+    RIGEL_PROFILE_ZONE("Debug rendering");
+    mDebuggingSystem.update(es);
+  }
 }
 
 
@@ -260,6 +414,7 @@ void IngameSystems::switchBackdrops() {
 
 
 void IngameSystems::restartFromBeginning(entityx::Entity newPlayerEntity) {
+  mTileDebris.clear();
   mPlayer.resetAfterDeath(newPlayerEntity);
 }
 
@@ -274,13 +429,21 @@ void IngameSystems::restartFromCheckpoint(
 
 void IngameSystems::centerViewOnPlayer() {
   mCamera.centerViewOnPlayer();
+  mpEntityFactory->spawnDeferredActors(mCamera.position());
 }
 
 
 void IngameSystems::printDebugText(std::ostream& stream) const {
   stream
     << "Scroll: " << vec2String(mCamera.position(), 4) << '\n'
-    << "Player: " << vec2String(mPlayer.position(), 4) << '\n';
+    << "Player: " << vec2String(mPlayer.position(), 4) << '\n'
+    << "Sprites: " << mRenderingSystem.spritesRendered() << " drawn, "
+    << mRenderingSystem.spritesCulled() << " culled" << '\n'
+    << "Activation: "
+    << mEntityActivationSystem.entitiesEvaluatedLastUpdate()
+    << " evaluated, " << mEntityActivationSystem.numTrackedEntities()
+    << " tracked" << '\n'
+    << "Deferred actors: " << mpEntityFactory->numDeferredActors() << '\n';
 }
 
 }}
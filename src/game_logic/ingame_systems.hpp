@@ -24,6 +24,8 @@
 #include "engine/physics_system.hpp"
 #include "engine/rendering_system.hpp"
 #include "engine/rendering_system.hpp"
+#include "engine/spatial_index.hpp"
+#include "engine/tile_debris_system.hpp"
 #include "game_logic/ai/blue_guard.hpp"
 #include "game_logic/ai/hover_bot.hpp"
 #include "game_logic/ai/laser_turret.hpp"
@@ -77,6 +79,7 @@ public:
     engine::MapRenderer::MapRenderData&& mapRenderData,
     IGameServiceProvider* pServiceProvider,
     EntityFactory* pEntityFactory,
+    engine::PrefabPool* pPrefabPool,
     engine::RandomNumberGenerator* pRandomGenerator,
     const RadarDishCounter* pRadarDishCounter,
     engine::Renderer* pRenderer,
@@ -102,14 +105,21 @@ public:
     return mPlayer;
   }
 
+  const engine::TileDebrisSystem& tileDebris() const {
+    return mTileDebris;
+  }
+
   void printDebugText(std::ostream& stream) const;
 
 private:
   engine::CollisionChecker mCollisionChecker;
+  engine::SpatialIndex mSpatialIndex;
+  engine::EntityActivationSystem mEntityActivationSystem;
   Player mPlayer;
   Camera mCamera;
 
   engine::ParticleSystem mParticles;
+  engine::TileDebrisSystem mTileDebris;
 
   engine::RenderingSystem mRenderingSystem;
   engine::PhysicsSystem mPhysicsSystem;
@@ -141,6 +151,7 @@ private:
 
   game_logic::BehaviorControllerSystem mBehaviorControllerSystem;
 
+  EntityFactory* mpEntityFactory;
   engine::RandomNumberGenerator* mpRandomGenerator;
   IGameServiceProvider* mpServiceProvider;
 };
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <tuple>
+
 
 namespace rigel { namespace game_logic {
 
@@ -25,6 +27,16 @@ struct Button {
 
   /** True if there was at least one button-down event since the last update */
   bool mWasTriggered = false;
+
+  bool operator==(const Button& other) const {
+    return
+      std::tie(mIsPressed, mWasTriggered) ==
+      std::tie(other.mIsPressed, other.mWasTriggered);
+  }
+
+  bool operator!=(const Button& other) const {
+    return !(*this == other);
+  }
 };
 
 
@@ -38,6 +50,23 @@ struct PlayerInput {
   Button mJump;
   Button mFire;
 
+  bool operator==(const PlayerInput& other) const {
+    return
+      std::tie(mLeft, mRight, mUp, mDown, mInteract, mJump, mFire) ==
+      std::tie(
+        other.mLeft,
+        other.mRight,
+        other.mUp,
+        other.mDown,
+        other.mInteract,
+        other.mJump,
+        other.mFire);
+  }
+
+  bool operator!=(const PlayerInput& other) const {
+    return !(*this == other);
+  }
+
   void resetTriggeredStates() {
     mInteract.mWasTriggered = false;
     mJump.mWasTriggered = false;
@@ -0,0 +1,219 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "input_recording.hpp"
+
+#include "loader/file_utils.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+
+namespace rigel { namespace game_logic {
+
+namespace {
+
+const std::uint8_t MAGIC[] = {'R', 'G', 'I', 'N'};
+constexpr auto FORMAT_VERSION = std::uint8_t{1};
+
+constexpr auto MAX_RUN_LENGTH =
+  std::size_t{std::numeric_limits<std::uint16_t>::max()};
+
+// Input word and run length
+constexpr auto BYTES_PER_RUN = std::size_t{4};
+
+
+// Bits representing the individual inputs in a run's input word
+constexpr auto LEFT = std::uint16_t{1 << 0};
+constexpr auto RIGHT = std::uint16_t{1 << 1};
+constexpr auto UP = std::uint16_t{1 << 2};
+constexpr auto DOWN = std::uint16_t{1 << 3};
+constexpr auto INTERACT_PRESSED = std::uint16_t{1 << 4};
+constexpr auto INTERACT_TRIGGERED = std::uint16_t{1 << 5};
+constexpr auto JUMP_PRESSED = std::uint16_t{1 << 6};
+constexpr auto JUMP_TRIGGERED = std::uint16_t{1 << 7};
+constexpr auto FIRE_PRESSED = std::uint16_t{1 << 8};
+constexpr auto FIRE_TRIGGERED = std::uint16_t{1 << 9};
+
+constexpr auto ALL_INPUT_BITS = std::uint16_t{(1 << 10) - 1};
+
+
+std::uint16_t encode(const PlayerInput& input) {
+  auto bits = std::uint16_t{0};
+  const auto setBit = [&bits](const bool value, const std::uint16_t bit) {
+    if (value) {
+      bits |= bit;
+    }
+  };
+
+  setBit(input.mLeft, LEFT);
+  setBit(input.mRight, RIGHT);
+  setBit(input.mUp, UP);
+  setBit(input.mDown, DOWN);
+  setBit(input.mInteract.mIsPressed, INTERACT_PRESSED);
+  setBit(input.mInteract.mWasTriggered, INTERACT_TRIGGERED);
+  setBit(input.mJump.mIsPressed, JUMP_PRESSED);
+  setBit(input.mJump.mWasTriggered, JUMP_TRIGGERED);
+  setBit(input.mFire.mIsPressed, FIRE_PRESSED);
+  setBit(input.mFire.mWasTriggered, FIRE_TRIGGERED);
+  return bits;
+}
+
+
+PlayerInput decode(const std::uint16_t bits) {
+  const auto isSet = [bits](const std::uint16_t bit) {
+    return (bits & bit) != 0;
+  };
+
+  PlayerInput input;
+  input.mLeft = isSet(LEFT);
+  input.mRight = isSet(RIGHT);
+  input.mUp = isSet(UP);
+  input.mDown = isSet(DOWN);
+  input.mInteract = {isSet(INTERACT_PRESSED), isSet(INTERACT_TRIGGERED)};
+  input.mJump = {isSet(JUMP_PRESSED), isSet(JUMP_TRIGGERED)};
+  input.mFire = {isSet(FIRE_PRESSED), isSet(FIRE_TRIGGERED)};
+  return input;
+}
+
+
+void writeU8(loader::ByteBuffer& buffer, const std::uint8_t value) {
+  buffer.push_back(value);
+}
+
+
+void writeU16(loader::ByteBuffer& buffer, const std::uint16_t value) {
+  buffer.push_back(static_cast<std::uint8_t>(value & 0xFF));
+  buffer.push_back(static_cast<std::uint8_t>(value >> 8));
+}
+
+
+void writeU32(loader::ByteBuffer& buffer, const std::uint32_t value) {
+  writeU16(buffer, static_cast<std::uint16_t>(value & 0xFFFF));
+  writeU16(buffer, static_cast<std::uint16_t>(value >> 16));
+}
+
+}
+
+
+loader::ByteBuffer serialize(const InputRecording& recording) {
+  loader::ByteBuffer buffer;
+
+  for (const auto byte : MAGIC) {
+    writeU8(buffer, byte);
+  }
+  writeU8(buffer, FORMAT_VERSION);
+  writeU8(buffer, static_cast<std::uint8_t>(recording.mSessionId.mEpisode));
+  writeU8(buffer, static_cast<std::uint8_t>(recording.mSessionId.mLevel));
+  writeU8(
+    buffer, static_cast<std::uint8_t>(recording.mSessionId.mDifficulty));
+  writeU32(buffer, static_cast<std::uint32_t>(recording.mInputs.size()));
+
+  const auto& inputs = recording.mInputs;
+  for (std::size_t runStart = 0; runStart < inputs.size();) {
+    const auto bits = encode(inputs[runStart]);
+
+    auto runEnd = runStart + 1;
+    while (
+      runEnd < inputs.size() &&
+      runEnd - runStart < MAX_RUN_LENGTH &&
+      encode(inputs[runEnd]) == bits
+    ) {
+      ++runEnd;
+    }
+
+    writeU16(buffer, bits);
+    writeU16(buffer, static_cast<std::uint16_t>(runEnd - runStart));
+    runStart = runEnd;
+  }
+
+  return buffer;
+}
+
+
+InputRecording deserializeInputRecording(const loader::ByteBuffer& data) {
+  loader::LeStreamReader reader(data);
+
+  for (const auto expectedByte : MAGIC) {
+    if (reader.readU8() != expectedByte) {
+      throw std::invalid_argument("Not an input recording");
+    }
+  }
+
+  if (reader.readU8() != FORMAT_VERSION) {
+    throw std::invalid_argument("Unsupported input recording version");
+  }
+
+  const auto episode = int{reader.readU8()};
+  const auto level = int{reader.readU8()};
+  const auto difficulty = int{reader.readU8()};
+  if (
+    episode >= data::NUM_EPISODES ||
+    level >= data::NUM_LEVELS_PER_EPISODE ||
+    difficulty > static_cast<int>(data::Difficulty::Hard)
+  ) {
+    throw std::invalid_argument("Invalid session in input recording");
+  }
+
+  InputRecording recording{
+    data::GameSessionId{
+      episode, level, static_cast<data::Difficulty>(difficulty)},
+    {}};
+
+  // The tick count isn't used to reserve memory up front, since a corrupt
+  // file could then cause a huge allocation. It can still be checked against
+  // the amount of run data that follows, though.
+  const auto numTicks = std::size_t{reader.readU32()};
+  const auto numRuns =
+    static_cast<std::size_t>(data.end() - reader.currentIter()) /
+    BYTES_PER_RUN;
+  if (numTicks > numRuns * MAX_RUN_LENGTH) {
+    throw std::invalid_argument("Corrupt input recording");
+  }
+
+  while (recording.mInputs.size() < numTicks) {
+    const auto bits = reader.readU16();
+    const auto runLength = std::size_t{reader.readU16()};
+    if (
+      (bits & ~ALL_INPUT_BITS) != 0 ||
+      runLength == 0 ||
+      recording.mInputs.size() + runLength > numTicks
+    ) {
+      throw std::invalid_argument("Corrupt input recording");
+    }
+
+    recording.mInputs.insert(
+      recording.mInputs.end(), runLength, decode(bits));
+  }
+
+  return recording;
+}
+
+
+void saveInputRecording(
+  const InputRecording& recording,
+  const std::string& fileName
+) {
+  loader::saveFile(serialize(recording), fileName);
+}
+
+
+InputRecording loadInputRecording(const std::string& fileName) {
+  return deserializeInputRecording(loader::loadFile(fileName));
+}
+
+}}
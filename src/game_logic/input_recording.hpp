@@ -0,0 +1,76 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "data/game_session_data.hpp"
+#include "game_logic/input.hpp"
+#include "loader/byte_buffer.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+
+namespace rigel { namespace game_logic {
+
+/** Player input for each game logic tick of a level
+ *
+ * Since the game logic is deterministic, feeding the same input into a
+ * freshly started level reproduces the exact same session.
+ */
+struct InputRecording {
+  data::GameSessionId mSessionId;
+  std::vector<PlayerInput> mInputs;
+};
+
+
+/** Serialize recording into compact binary format
+ *
+ * The format consists of a header holding the session id and the number of
+ * ticks, followed by run-length encoded input. Consecutive ticks with
+ * identical input (which is the common case) are stored as a single run.
+ */
+loader::ByteBuffer serialize(const InputRecording& recording);
+
+/** Parse binary format written by serialize()
+ *
+ * Throws an exception if the data is not a valid recording.
+ */
+InputRecording deserializeInputRecording(const loader::ByteBuffer& data);
+
+void saveInputRecording(
+  const InputRecording& recording,
+  const std::string& fileName);
+InputRecording loadInputRecording(const std::string& fileName);
+
+
+/** Settings for recording or replaying the input of a level */
+struct InputRecordingOptions {
+  /** Save the level's input to this file once the level ends */
+  std::optional<std::string> mRecordToFile;
+
+  /** Take input from this recording instead of the keyboard */
+  std::optional<InputRecording> mReplay;
+
+  /** Write a hash of the world state after each tick to this file
+   *
+   * See WorldStateHash.
+   */
+  std::optional<std::string> mWorldStateHashFile;
+};
+
+}}
@@ -19,6 +19,7 @@
 #include "data/player_model.hpp"
 #include "engine/base_components.hpp"
 #include "engine/physical_components.hpp"
+#include "engine/spatial_index.hpp"
 #include "engine/visual_components.hpp"
 #include "game_logic/damage_components.hpp"
 #include "game_logic/player.hpp"
@@ -36,27 +37,39 @@ using engine::toWorldSpace;
 using game_logic::components::PlayerDamaging;
 
 
-DamageSystem::DamageSystem(Player* pPlayer, entityx::EventManager* pEvents)
+DamageSystem::DamageSystem(
+  Player* pPlayer,
+  const engine::SpatialIndex* pSpatialIndex,
+  entityx::EventManager* pEvents
+)
   : mpPlayer(pPlayer)
+  , mpSpatialIndex(pSpatialIndex)
   , mpEvents(pEvents)
 {
 }
 
 
-void DamageSystem::update(entityx::EntityManager& es) {
+void DamageSystem::update(entityx::EntityManager&) {
   if (mpPlayer->isDead()) {
     return;
   }
 
   const auto playerBBox = mpPlayer->worldSpaceHitBox();
-  es.each<PlayerDamaging, BoundingBox, WorldPosition>(
-    [this, &playerBBox](
-      entityx::Entity entity,
-      const PlayerDamaging& damage,
-      const BoundingBox& boundingBox,
-      const WorldPosition& position
-    ) {
-      const auto bbox = toWorldSpace(boundingBox, position);
+  mpSpatialIndex->forEachCandidate(playerBBox,
+    [this, &playerBBox](entityx::Entity entity) {
+      if (
+        !entity.valid() ||
+        !entity.has_component<PlayerDamaging>() ||
+        !entity.has_component<BoundingBox>() ||
+        !entity.has_component<WorldPosition>()
+      ) {
+        return;
+      }
+
+      const auto& damage = *entity.component<PlayerDamaging>();
+      const auto bbox = toWorldSpace(
+        *entity.component<BoundingBox>(),
+        *entity.component<WorldPosition>());
       const auto hasCollision = bbox.intersects(playerBBox);
       const auto playerCanTakeDamage =
         mpPlayer->canTakeDamage() || damage.mIsFatal;
@@ -23,6 +23,7 @@ RIGEL_DISABLE_WARNINGS
 RIGEL_RESTORE_WARNINGS
 
 
+namespace rigel { namespace engine { class SpatialIndex; }}
 namespace rigel { namespace game_logic { class Player; }}
 
 
@@ -30,12 +31,16 @@ namespace rigel { namespace game_logic { namespace player {
 
 class DamageSystem {
 public:
-  explicit DamageSystem(Player* pPlayer, entityx::EventManager* pEvents);
+  DamageSystem(
+    Player* pPlayer,
+    const engine::SpatialIndex* pSpatialIndex,
+    entityx::EventManager* pEvents);
 
   void update(entityx::EntityManager& es);
 
 private:
   Player* mpPlayer;
+  const engine::SpatialIndex* mpSpatialIndex;
   entityx::EventManager* mpEvents;
 };
 
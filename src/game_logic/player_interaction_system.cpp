@@ -18,6 +18,7 @@
 
 #include "data/strings.hpp"
 #include "engine/physics_system.hpp"
+#include "engine/spatial_index.hpp"
 #include "engine/visual_components.hpp"
 #include "game_logic/actor_tag.hpp"
 #include "game_logic/collectable_components.hpp"
@@ -156,6 +157,7 @@ PlayerInteractionSystem::PlayerInteractionSystem(
   PlayerModel* pPlayerModel,
   IGameServiceProvider* pServices,
   EntityFactory* pEntityFactory,
+  const engine::SpatialIndex* pSpatialIndex,
   entityx::EventManager* pEvents,
   const loader::ResourceLoader& resources
 )
@@ -163,6 +165,7 @@ PlayerInteractionSystem::PlayerInteractionSystem(
   , mpPlayerModel(pPlayerModel)
   , mpServiceProvider(pServices)
   , mpEntityFactory(pEntityFactory)
+  , mpSpatialIndex(pSpatialIndex)
   , mpEvents(pEvents)
   , mLevelHints(loadHints(resources))
   , mSessionId(sessionId)
@@ -238,20 +241,27 @@ void PlayerInteractionSystem::updateItemCollection(entityx::EntityManager& es) {
     return;
   }
 
-  es.each<CollectableItem, WorldPosition, BoundingBox>(
-    [this, &es](
-      ex::Entity entity,
-      const CollectableItem& collectable,
-      const WorldPosition& pos,
-      const BoundingBox& collisionRect
-    ) {
+  const auto playerBBox = mpPlayer->worldSpaceHitBox();
+  mpSpatialIndex->forEachCandidate(playerBBox,
+    [this, &es, &playerBBox](ex::Entity entity) {
       using namespace data;
 
-      auto worldSpaceBbox = collisionRect;
+      if (
+        !entity.valid() ||
+        !entity.has_component<CollectableItem>() ||
+        !entity.has_component<WorldPosition>() ||
+        !entity.has_component<BoundingBox>()
+      ) {
+        return;
+      }
+
+      const auto& collectable = *entity.component<CollectableItem>();
+      const auto& pos = *entity.component<WorldPosition>();
+
+      auto worldSpaceBbox = *entity.component<BoundingBox>();
       worldSpaceBbox.topLeft +=
         base::Vector{pos.x, pos.y - (worldSpaceBbox.size.height - 1)};
 
-      auto playerBBox = mpPlayer->worldSpaceHitBox();
       if (worldSpaceBbox.intersects(playerBBox)) {
         std::optional<data::SoundId> soundToPlay;
 
@@ -42,6 +42,10 @@ namespace rigel {
     struct CloakExpired;
   }
 
+  namespace engine {
+    class SpatialIndex;
+  }
+
   namespace game_logic {
     class EntityFactory;
   }
@@ -66,6 +70,7 @@ public:
     data::PlayerModel* pPlayerModel,
     IGameServiceProvider* pServices,
     EntityFactory* pEntityFactory,
+    const engine::SpatialIndex* pSpatialIndex,
     entityx::EventManager* pEvents,
     const loader::ResourceLoader& resources);
 
@@ -106,6 +111,7 @@ private:
   data::PlayerModel* mpPlayerModel;
   IGameServiceProvider* mpServiceProvider;
   EntityFactory* mpEntityFactory;
+  const engine::SpatialIndex* mpSpatialIndex;
   entityx::EventManager* mpEvents;
   data::LevelHints mLevelHints;
   data::GameSessionId mSessionId;
@@ -0,0 +1,272 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "world_state_hash.hpp"
+
+#include "engine/base_components.hpp"
+#include "engine/physical_components.hpp"
+#include "engine/tile_debris_system.hpp"
+#include "game_logic/damage_components.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+
+namespace rigel { namespace game_logic {
+
+using engine::components::MovingBody;
+using engine::components::WorldPosition;
+using game_logic::components::Shootable;
+
+namespace {
+
+// 64-bit FNV-1a
+constexpr auto FNV_OFFSET_BASIS = std::uint64_t{14695981039346656037ull};
+constexpr auto FNV_PRIME = std::uint64_t{1099511628211ull};
+
+
+class Hasher {
+public:
+  template <typename T>
+  void add(const T& value) {
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+
+    // Hashing the object representation makes floating point values compare
+    // bit-exact, which is what we want for detecting divergences
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+
+    for (const auto byte : bytes) {
+      mHash = (mHash ^ byte) * FNV_PRIME;
+    }
+  }
+
+  std::uint64_t result() const {
+    return mHash;
+  }
+
+private:
+  std::uint64_t mHash = FNV_OFFSET_BASIS;
+};
+
+
+std::uint64_t hashMapTiles(const data::map::Map& map) {
+  Hasher hasher;
+  hasher.add(map.width());
+  hasher.add(map.height());
+
+  for (int layer = 0; layer < 2; ++layer) {
+    for (int y = 0; y < map.height(); ++y) {
+      for (int x = 0; x < map.width(); ++x) {
+        hasher.add(map.tileAt(layer, x, y));
+      }
+    }
+  }
+
+  return hasher.result();
+}
+
+
+std::uint64_t hashPlayerModel(const data::PlayerModel& playerModel) {
+  Hasher hasher;
+  hasher.add(playerModel.score());
+  hasher.add(playerModel.ammo());
+  hasher.add(playerModel.health());
+  hasher.add(playerModel.weapon());
+
+  hasher.add(playerModel.inventory().size());
+  for (const auto item : playerModel.inventory()) {
+    hasher.add(item);
+  }
+
+  hasher.add(playerModel.collectedLetters().size());
+  for (const auto letter : playerModel.collectedLetters()) {
+    hasher.add(letter);
+  }
+
+  return hasher.result();
+}
+
+
+// Names used when reporting divergences, in the same order as the members
+// of WorldStateHash
+constexpr const char* PART_NAMES[] = {
+  "map tiles",
+  "entity positions",
+  "entity velocities",
+  "entity health",
+  "player model",
+  "random number generator"
+};
+
+
+auto asArray(const WorldStateHash& hash) {
+  return std::array<std::uint64_t, 6>{
+    hash.mMapTiles,
+    hash.mEntityPositions,
+    hash.mEntityVelocities,
+    hash.mEntityHealth,
+    hash.mPlayerModel,
+    hash.mRandomGenerator};
+}
+
+}
+
+
+WorldStateHash hashWorldState(
+  const data::map::Map& map,
+  entityx::EntityManager& entities,
+  const engine::TileDebrisSystem& tileDebris,
+  const data::PlayerModel& playerModel,
+  const engine::RandomNumberGenerator& randomGenerator
+) {
+  // The entity index is part of the hash, so that the same state ending up
+  // on different entities is treated as a divergence.
+  Hasher positionHasher;
+  entities.each<WorldPosition>(
+    [&](entityx::Entity entity, const WorldPosition& position) {
+      positionHasher.add(entity.id().index());
+      positionHasher.add(position.x);
+      positionHasher.add(position.y);
+    });
+
+  Hasher velocityHasher;
+  entities.each<MovingBody>(
+    [&](entityx::Entity entity, const MovingBody& body) {
+      velocityHasher.add(entity.id().index());
+      velocityHasher.add(body.mVelocity.x);
+      velocityHasher.add(body.mVelocity.y);
+    });
+
+  positionHasher.add(tileDebris.size());
+  for (const auto& position : tileDebris.positions()) {
+    positionHasher.add(position.x);
+    positionHasher.add(position.y);
+  }
+
+  velocityHasher.add(tileDebris.size());
+  for (std::size_t i = 0; i < tileDebris.size(); ++i) {
+    velocityHasher.add(tileDebris.velocitiesX()[i]);
+    velocityHasher.add(tileDebris.velocitiesY()[i]);
+  }
+
+  Hasher healthHasher;
+  entities.each<Shootable>(
+    [&](entityx::Entity entity, const Shootable& shootable) {
+      healthHasher.add(entity.id().index());
+      healthHasher.add(shootable.mHealth);
+    });
+
+  Hasher randomGeneratorHasher;
+  randomGeneratorHasher.add(randomGenerator.nextNumberIndex());
+
+  return {
+    hashMapTiles(map),
+    positionHasher.result(),
+    velocityHasher.result(),
+    healthHasher.result(),
+    hashPlayerModel(playerModel),
+    randomGeneratorHasher.result()};
+}
+
+
+void writeWorldStateHash(
+  std::ostream& stream,
+  const std::size_t tick,
+  const WorldStateHash& hash
+) {
+  stream << tick << std::hex << std::setfill('0');
+  for (const auto partHash : asArray(hash)) {
+    stream << ' ' << std::setw(16) << partHash;
+  }
+  stream << std::dec << '\n';
+}
+
+
+std::vector<WorldStateHash> readWorldStateHashes(std::istream& stream) {
+  std::vector<WorldStateHash> hashes;
+
+  std::string line;
+  while (std::getline(stream, line)) {
+    if (line.empty()) {
+      continue;
+    }
+
+    std::istringstream lineStream(line);
+    std::size_t tick;
+    WorldStateHash hash;
+    lineStream >> tick >> std::hex
+      >> hash.mMapTiles
+      >> hash.mEntityPositions
+      >> hash.mEntityVelocities
+      >> hash.mEntityHealth
+      >> hash.mPlayerModel
+      >> hash.mRandomGenerator;
+
+    if (!lineStream || !(lineStream >> std::ws).eof()) {
+      throw std::invalid_argument("Malformed world state hash: " + line);
+    }
+
+    if (tick != hashes.size()) {
+      throw std::invalid_argument(
+        "Unexpected tick in world state hashes: " + std::to_string(tick));
+    }
+
+    hashes.push_back(hash);
+  }
+
+  return hashes;
+}
+
+
+std::optional<WorldStateDivergence> findFirstDivergence(
+  const std::vector<WorldStateHash>& hashes,
+  const std::vector<WorldStateHash>& otherHashes
+) {
+  const auto numCommonTicks = std::min(hashes.size(), otherHashes.size());
+
+  for (std::size_t tick = 0; tick < numCommonTicks; ++tick) {
+    const auto parts = asArray(hashes[tick]);
+    const auto otherParts = asArray(otherHashes[tick]);
+
+    if (parts != otherParts) {
+      WorldStateDivergence divergence{tick, {}};
+      for (std::size_t i = 0; i < parts.size(); ++i) {
+        if (parts[i] != otherParts[i]) {
+          divergence.mDifferingParts.push_back(PART_NAMES[i]);
+        }
+      }
+
+      return divergence;
+    }
+  }
+
+  if (hashes.size() != otherHashes.size()) {
+    return WorldStateDivergence{numCommonTicks, {}};
+  }
+
+  return std::nullopt;
+}
+
+}}
@@ -0,0 +1,98 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/warnings.hpp"
+#include "data/map.hpp"
+#include "data/player_model.hpp"
+#include "engine/random_number_generator.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <entityx/entityx.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+namespace rigel { namespace engine { class TileDebrisSystem; }}
+
+
+namespace rigel { namespace game_logic {
+
+/** Hashes over the simulation-relevant parts of the game world
+ *
+ * Meant for verifying that changes to the game logic don't alter simulation
+ * results: Record the hashes for each tick of an input replay before and
+ * after the change, and compare them. Each part of the world state is hashed
+ * separately, so that a divergence can be attributed to one of them.
+ * Tile debris isn't made of entities, but is included in the position and
+ * velocity hashes.
+ */
+struct WorldStateHash {
+  std::uint64_t mMapTiles = 0;
+  std::uint64_t mEntityPositions = 0;
+  std::uint64_t mEntityVelocities = 0;
+  std::uint64_t mEntityHealth = 0;
+  std::uint64_t mPlayerModel = 0;
+  std::uint64_t mRandomGenerator = 0;
+};
+
+
+WorldStateHash hashWorldState(
+  const data::map::Map& map,
+  entityx::EntityManager& entities,
+  const engine::TileDebrisSystem& tileDebris,
+  const data::PlayerModel& playerModel,
+  const engine::RandomNumberGenerator& randomGenerator);
+
+
+/** Write hash as a single line of text, prefixed with the tick number */
+void writeWorldStateHash(
+  std::ostream& stream,
+  std::size_t tick,
+  const WorldStateHash& hash);
+
+/** Read all lines written by writeWorldStateHash()
+ *
+ * Ticks must be consecutive, starting at 0. Throws an exception if the
+ * stream contains anything else.
+ */
+std::vector<WorldStateHash> readWorldStateHashes(std::istream& stream);
+
+
+/** Description of the first tick where two hash streams differ */
+struct WorldStateDivergence {
+  std::size_t mTick;
+
+  /** Names of the parts of the world state that differ
+   *
+   * Empty if one stream ends before the other, without any difference up to
+   * that point.
+   */
+  std::vector<std::string> mDifferingParts;
+};
+
+
+std::optional<WorldStateDivergence> findFirstDivergence(
+  const std::vector<WorldStateHash>& hashes,
+  const std::vector<WorldStateHash>& otherHashes);
+
+}}
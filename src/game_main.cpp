@@ -17,10 +17,13 @@
 #include "game_main.hpp"
 #include "game_main.ipp"
 
+#include "base/profiler.hpp"
 #include "data/duke_script.hpp"
 #include "data/game_traits.hpp"
 #include "engine/timing.hpp"
+#include "game_logic/input_recording.hpp"
 #include "loader/duke_script_loader.hpp"
+#include "loader/png_image.hpp"
 #include "sdl_utils/error.hpp"
 
 #include "game_session_mode.hpp"
@@ -29,6 +32,10 @@
 
 #include <cassert>
 #include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
 
 
 namespace rigel {
@@ -40,6 +47,9 @@ using RenderTargetBinder = engine::RenderTargetTexture::Binder;
 
 namespace {
 
+const auto PROFILER_TRACE_FILE_NAME = "rigel_trace.json";
+
+
 struct NullGameMode : public GameMode {
   void handleEvent(const SDL_Event&) override {}
   void updateAndRender(engine::TimeDelta) override {}
@@ -61,14 +71,22 @@ auto loadScripts(const loader::ResourceLoader& resources) {
 
 
 void gameMain(const StartupOptions& options, SDL_Window* pWindow) {
-  Game game(options.mGamePath, pWindow);
+  const auto renderBackend = options.mUseSoftwareRendering
+    ? engine::RenderBackend::Software
+    : engine::RenderBackend::OpenGl;
+  Game game(options.mGamePath, pWindow, renderBackend);
   game.run(options);
 }
 
 
-Game::Game(const std::string& gamePath, SDL_Window* pWindow)
-  : mRenderer(pWindow)
+Game::Game(
+  const std::string& gamePath,
+  SDL_Window* pWindow,
+  const engine::RenderBackend renderBackend
+)
+  : mRenderer(pWindow, renderBackend)
   , mResources(gamePath)
+  , mUiTextureAtlas(&mRenderer)
   , mIsShareWareVersion(true)
   , mRenderTarget(
       &mRenderer,
@@ -78,14 +96,21 @@ Game::Game(const std::string& gamePath, SDL_Window* pWindow)
   , mIsRunning(true)
   , mIsMinimized(false)
   , mUserProfile(loadOrCreateUserProfile(gamePath))
-  , mScriptRunner(&mResources, &mRenderer, &mUserProfile.mSaveSlots, this)
+  , mScriptRunner(
+      &mResources,
+      &mRenderer,
+      &mUiTextureAtlas,
+      &mUserProfile.mSaveSlots,
+      this)
   , mAllScripts(loadScripts(mResources))
   , mUiSpriteSheetRenderer(
-      engine::OwningTexture{
-        &mRenderer, mResources.loadTiledFullscreenImage("STATUS.MNI")},
+      mUiTextureAtlas.insert(
+        mResources.loadTiledFullscreenImage("STATUS.MNI")),
       &mRenderer)
-  , mTextRenderer(&mUiSpriteSheetRenderer, &mRenderer, mResources)
+  , mTextRenderer(
+      &mUiSpriteSheetRenderer, &mRenderer, &mUiTextureAtlas, mResources)
   , mFpsDisplay(&mTextRenderer)
+  , mProfilerOverlay(&mRenderer, &mTextRenderer)
 {
 }
 
@@ -99,6 +124,7 @@ void Game::run(const StartupOptions& startupOptions) {
   });
 
   mMusicEnabled = startupOptions.mEnableMusic;
+  mFrameDumpPath = startupOptions.mFrameDumpPath;
 
   // Check if running registered version
   if (
@@ -108,7 +134,29 @@ void Game::run(const StartupOptions& startupOptions) {
     mIsShareWareVersion = false;
   }
 
-  if (startupOptions.mLevelToJumpTo)
+  game_logic::InputRecordingOptions inputRecordingOptions;
+  inputRecordingOptions.mRecordToFile = startupOptions.mInputRecordingPath;
+  inputRecordingOptions.mWorldStateHashFile =
+    startupOptions.mWorldStateHashPath;
+
+  const auto turboModeOptions = TurboModeOptions{
+    startupOptions.mTurboMode, startupOptions.mTurboModeRenderInterval};
+
+  if (startupOptions.mInputReplayPath)
+  {
+    auto recording =
+      game_logic::loadInputRecording(*startupOptions.mInputReplayPath);
+    const auto sessionId = recording.mSessionId;
+    inputRecordingOptions.mReplay = std::move(recording);
+
+    mpNextGameMode = std::make_unique<GameSessionMode>(
+      sessionId,
+      makeModeContext(),
+      std::nullopt,
+      std::move(inputRecordingOptions),
+      turboModeOptions);
+  }
+  else if (startupOptions.mLevelToJumpTo)
   {
     int episode, level;
     std::tie(episode, level) = *startupOptions.mLevelToJumpTo;
@@ -116,7 +164,9 @@ void Game::run(const StartupOptions& startupOptions) {
     mpNextGameMode = std::make_unique<GameSessionMode>(
       data::GameSessionId{episode, level, data::Difficulty::Medium},
       makeModeContext(),
-      startupOptions.mPlayerPosition);
+      startupOptions.mPlayerPosition,
+      std::move(inputRecordingOptions),
+      turboModeOptions);
   }
   else if (startupOptions.mSkipIntro)
   {
@@ -157,6 +207,8 @@ void Game::mainLoop() {
   mLastTime = high_resolution_clock::now();
 
   for (;;) {
+    RIGEL_PROFILE_ZONE("Frame");
+
     const auto startOfFrame = high_resolution_clock::now();
     const auto elapsed =
       duration<entityx::TimeDelta>(startOfFrame - mLastTime).count();
@@ -167,45 +219,96 @@ void Game::mainLoop() {
     {
       RenderTargetBinder bindRenderTarget(mRenderTarget, &mRenderer);
 
-      while (mIsMinimized && SDL_WaitEvent(&event)) {
-        handleEvent(event);
-      }
-      while (SDL_PollEvent(&event)) {
-        handleEvent(event);
+      {
+        RIGEL_PROFILE_ZONE("Event handling");
+
+        while (mIsMinimized && SDL_WaitEvent(&event)) {
+          handleEvent(event);
+        }
+        while (SDL_PollEvent(&event)) {
+          handleEvent(event);
+        }
       }
       if (!mIsRunning) {
         break;
       }
 
       if (mpNextGameMode) {
+        RIGEL_PROFILE_ZONE("Game mode transition");
+
         fadeOutScreen();
         mpCurrentGameMode = std::move(mpNextGameMode);
         mpCurrentGameMode->updateAndRender(0);
         fadeInScreen();
       }
 
+      RIGEL_PROFILE_ZONE("Game mode update");
       mpCurrentGameMode->updateAndRender(elapsed);
     }
 
-    mRenderer.clear();
-    mRenderTarget.renderScaledToScreen(&mRenderer);
+    {
+      RIGEL_PROFILE_ZONE("Present");
+
+      mRenderer.clear();
+      mRenderTarget.renderScaledToScreen(&mRenderer);
+
+      if (!mDebugText.empty()) {
+        mTextRenderer.drawMultiLineText(0, 2, mDebugText);
+      }
+
+      if (mShowFps) {
+        const auto afterRender = high_resolution_clock::now();
+        const auto innerRenderTime =
+          duration<engine::TimeDelta>(afterRender - startOfFrame).count();
+        mFpsDisplay.updateAndRender(
+          elapsed, innerRenderTime, mRenderer.statisticsLastFrame());
+      }
 
-    if (!mDebugText.empty()) {
-      mTextRenderer.drawMultiLineText(0, 2, mDebugText);
+      if (mShowProfiler) {
+        RIGEL_PROFILE_ZONE("Profiler overlay");
+        mProfilerOverlay.updateAndRender();
+      }
     }
 
-    if (mShowFps) {
-      const auto afterRender = high_resolution_clock::now();
-      const auto innerRenderTime =
-        duration<engine::TimeDelta>(afterRender - startOfFrame).count();
-      mFpsDisplay.updateAndRender(elapsed, innerRenderTime);
+    if (mFrameDumpPath) {
+      RIGEL_PROFILE_ZONE("Frame dump");
+      dumpFrame();
     }
 
+    RIGEL_PROFILE_ZONE("Swap buffers");
     mRenderer.swapBuffers();
   }
 }
 
 
+void Game::dumpFrame() {
+  mRenderer.submitBatch();
+
+  if (const auto frame = mRenderer.frameBufferContents()) {
+    std::stringstream fileName;
+    fileName
+      << *mFrameDumpPath << "/frame_"
+      << std::setw(6) << std::setfill('0') << mFramesDumped << ".png";
+    loader::savePng(fileName.str(), *frame);
+    ++mFramesDumped;
+  }
+}
+
+
+void Game::writeProfilerTrace() {
+  std::ofstream traceFile(PROFILER_TRACE_FILE_NAME);
+  base::profiler::writeChromeTrace(traceFile);
+
+  if (traceFile) {
+    std::cout << "Profiler trace written to " << PROFILER_TRACE_FILE_NAME
+      << '\n';
+  } else {
+    std::cerr << "Failed to write profiler trace to "
+      << PROFILER_TRACE_FILE_NAME << '\n';
+  }
+}
+
+
 GameMode::Context Game::makeModeContext() {
   return {
     &mResources,
@@ -225,6 +328,12 @@ void Game::handleEvent(const SDL_Event& event) {
       if (event.key.keysym.sym == SDLK_F6) {
         mShowFps = !mShowFps;
       }
+      if (event.key.keysym.sym == SDLK_F7) {
+        mShowProfiler = !mShowProfiler;
+      }
+      if (event.key.keysym.sym == SDLK_F8) {
+        writeProfilerTrace();
+      }
       mpCurrentGameMode->handleEvent(event);
       break;
 
@@ -305,6 +414,10 @@ void Game::fadeInScreen() {
 
 
 void Game::playSound(const data::SoundId id) {
+  if (mSoundsMuted) {
+    return;
+  }
+
   const auto index = static_cast<std::size_t>(id);
   assert(index < mSoundsById.size());
 
@@ -322,6 +435,11 @@ void Game::stopSound(const data::SoundId id) {
 }
 
 
+void Game::setSoundsMuted(const bool muted) {
+  mSoundsMuted = muted;
+}
+
+
 void Game::playMusic(const std::string& name) {
   if (!mMusicEnabled) {
     return;
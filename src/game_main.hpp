@@ -36,6 +36,13 @@ struct StartupOptions {
   bool mSkipIntro = false;
   bool mEnableMusic = true;
   std::optional<base::Vector> mPlayerPosition;
+  bool mUseSoftwareRendering = false;
+  std::optional<std::string> mFrameDumpPath;
+  std::optional<std::string> mInputRecordingPath;
+  std::optional<std::string> mInputReplayPath;
+  std::optional<std::string> mWorldStateHashPath;
+  bool mTurboMode = false;
+  int mTurboModeRenderInterval = 100;
 };
 
 
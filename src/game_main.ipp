@@ -22,11 +22,13 @@
 #include "engine/sound_system.hpp"
 #include "engine/tile_renderer.hpp"
 #include "engine/texture.hpp"
+#include "engine/texture_atlas.hpp"
 #include "loader/duke_script_loader.hpp"
 #include "loader/resource_loader.hpp"
 #include "ui/fps_display.hpp"
 #include "ui/duke_script_runner.hpp"
 #include "ui/menu_element_renderer.hpp"
+#include "ui/profiler_overlay.hpp"
 
 #include "game_mode.hpp"
 #include "game_service_provider.hpp"
@@ -34,6 +36,7 @@
 
 #include <chrono>
 #include <memory>
+#include <optional>
 #include <string>
 
 
@@ -42,7 +45,10 @@ namespace rigel {
 
 class Game : public IGameServiceProvider {
 public:
-  Game(const std::string& gamePath, SDL_Window* pWindow);
+  Game(
+    const std::string& gamePath,
+    SDL_Window* pWindow,
+    engine::RenderBackend renderBackend);
   Game(const Game&) = delete;
   Game& operator=(const Game&) = delete;
 
@@ -52,6 +58,8 @@ private:
   void showAntiPiracyScreen();
 
   void mainLoop();
+  void dumpFrame();
+  void writeProfilerTrace();
 
   GameMode::Context makeModeContext();
 
@@ -64,6 +72,7 @@ private:
   void fadeInScreen() override;
   void playSound(data::SoundId id) override;
   void stopSound(data::SoundId id) override;
+  void setSoundsMuted(bool muted) override;
   void playMusic(const std::string& name) override;
   void stopMusic() override;
 
@@ -84,6 +93,7 @@ private:
   engine::Renderer mRenderer;
   engine::SoundSystem mSoundSystem;
   loader::ResourceLoader mResources;
+  engine::TextureAtlas mUiTextureAtlas;
   bool mIsShareWareVersion;
 
   engine::RenderTargetTexture mRenderTarget;
@@ -95,7 +105,9 @@ private:
   std::vector<engine::SoundSystem::SoundHandle> mSoundsById;
 
   bool mMusicEnabled = true;
+  bool mSoundsMuted = false;
   bool mShowFps = false;
+  bool mShowProfiler = false;
 
   bool mIsRunning;
   bool mIsMinimized;
@@ -108,7 +120,11 @@ private:
   engine::TileRenderer mUiSpriteSheetRenderer;
   ui::MenuElementRenderer mTextRenderer;
   ui::FpsDisplay mFpsDisplay;
+  ui::ProfilerOverlay mProfilerOverlay;
   std::string mDebugText;
+
+  std::optional<std::string> mFrameDumpPath;
+  int mFramesDumped = 0;
 };
 
 }
@@ -23,6 +23,10 @@
 #include "game_service_provider.hpp"
 #include "user_profile.hpp"
 
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
 
 namespace rigel {
 
@@ -38,6 +42,11 @@ namespace {
 // playing the game on a 486 at the default game speed setting.
 constexpr auto GAME_LOGIC_UPDATE_DELAY = 1.0/15.0;
 
+// In turbo mode, we run as many logic updates as fit into this amount of time
+// before returning to the main loop. This keeps the game responsive to events,
+// while making the cost of presenting the frame negligible.
+constexpr auto TURBO_MODE_TIME_PER_FRAME = 1.0/10.0;
+
 constexpr auto SAVE_SLOT_NAME_ENTRY_POS_X = 14;
 constexpr auto SAVE_SLOT_NAME_ENTRY_START_POS_Y = 6;
 constexpr auto SAVE_SLOT_NAME_HEIGHT = 2;
@@ -72,7 +81,9 @@ GameRunner::GameRunner(
   const data::GameSessionId& sessionId,
   GameMode::Context context,
   const std::optional<base::Vector> playerPositionOverride,
-  const bool showWelcomeMessage
+  const bool showWelcomeMessage,
+  game_logic::InputRecordingOptions inputRecordingOptions,
+  const TurboModeOptions turboModeOptions
 )
   : mContext(context)
   , mSavedGame(createSavedGame(sessionId, *pPlayerModel))
@@ -82,8 +93,45 @@ GameRunner::GameRunner(
       context,
       playerPositionOverride,
       showWelcomeMessage)
+  , mInputRecordingFile(std::move(inputRecordingOptions.mRecordToFile))
+  , mInputReplay(std::move(inputRecordingOptions.mReplay))
 {
-  mStateStack.emplace(World{&mWorld});
+  World worldState{&mWorld, context.mpServiceProvider};
+  worldState.mTurboMode = turboModeOptions;
+
+  if (mInputRecordingFile) {
+    mInputRecording = game_logic::InputRecording{sessionId, {}};
+    worldState.mpInputRecording = &*mInputRecording;
+  }
+
+  if (mInputReplay) {
+    worldState.mpInputReplay = &*mInputReplay;
+  }
+
+  if (const auto& hashFile = inputRecordingOptions.mWorldStateHashFile) {
+    mWorldStateHashStream.emplace(*hashFile);
+    if (!*mWorldStateHashStream) {
+      throw std::runtime_error("Cannot open file for writing: " + *hashFile);
+    }
+
+    worldState.mpWorldStateHashStream = &*mWorldStateHashStream;
+  }
+
+  mStateStack.emplace(worldState);
+}
+
+
+GameRunner::~GameRunner() {
+  if (!mInputRecording) {
+    return;
+  }
+
+  try {
+    game_logic::saveInputRecording(*mInputRecording, *mInputRecordingFile);
+    std::cout << "Input recording saved to " << *mInputRecordingFile << '\n';
+  } catch (const std::exception& error) {
+    std::cerr << "Failed to save input recording: " << error.what() << '\n';
+  }
 }
 
 
@@ -316,41 +364,111 @@ void GameRunner::World::handleEvent(const SDL_Event& event) {
 
 
 void GameRunner::World::updateAndRender(const engine::TimeDelta dt) {
+  const auto wasTurboModeActive = isTurboModeActive();
   updateWorld(dt);
-  mpWorld->render();
+
+  // In turbo mode, the render target keeps showing the last rendered frame
+  // until enough ticks have passed
+  const auto renderInterval = mTurboMode.mRenderInterval;
+  const auto skipRendering = wasTurboModeActive &&
+    (renderInterval <= 0 || mTicksSinceLastRender < renderInterval);
+  if (!skipRendering) {
+    mpWorld->render();
+    mTicksSinceLastRender = 0;
+  }
 
   if (mShowDebugText) {
     mpWorld->showDebugText();
   }
-
-  mpWorld->processEndOfFrameActions();
 }
 
 
 void GameRunner::World::updateWorld(const engine::TimeDelta dt) {
-  auto update = [this]() {
-    mpWorld->updateGameLogic(mPlayerInput);
-    mPlayerInput.resetTriggeredStates();
-  };
-
-
   if (mSingleStepping) {
     if (mDoNextSingleStep) {
-      update();
+      runGameLogicTick();
       mDoNextSingleStep = false;
     }
+  } else if (isTurboModeActive()) {
+    updateWorldTurbo();
   } else {
     mAccumulatedTime += dt;
     for (;
       mAccumulatedTime >= GAME_LOGIC_UPDATE_DELAY;
       mAccumulatedTime -= GAME_LOGIC_UPDATE_DELAY
     ) {
-      update();
+      runGameLogicTick();
     }
   }
 }
 
 
+void GameRunner::World::updateWorldTurbo() {
+  using namespace std::chrono;
+
+  const auto startTime = high_resolution_clock::now();
+  const auto timeElapsed = [&]() {
+    return duration<double>(high_resolution_clock::now() - startTime).count();
+  };
+
+  // Sound effects would be played back at many times their usual rate,
+  // which isn't useful
+  mpServiceProvider->setSoundsMuted(true);
+
+  do {
+    runGameLogicTick();
+  } while (
+    isTurboModeActive() &&
+    !mpWorld->levelFinished() &&
+    timeElapsed() < TURBO_MODE_TIME_PER_FRAME);
+
+  mpServiceProvider->setSoundsMuted(false);
+
+  mAccumulatedTime = 0.0;
+}
+
+
+void GameRunner::World::runGameLogicTick() {
+  // During a replay, keyboard input is ignored until the recorded input
+  // runs out
+  const auto wasReplaying = isReplaying();
+  const auto input = wasReplaying
+    ? mpInputReplay->mInputs[mReplayPosition++]
+    : mPlayerInput;
+
+  if (mpInputRecording) {
+    mpInputRecording->mInputs.push_back(input);
+  }
+
+  mpWorld->updateGameLogic(input);
+  mPlayerInput.resetTriggeredStates();
+  ++mTicksSinceLastRender;
+
+  if (mpWorldStateHashStream) {
+    game_logic::writeWorldStateHash(
+      *mpWorldStateHashStream, mTicksRun, mpWorld->stateHash());
+  }
+  ++mTicksRun;
+
+  if (wasReplaying && !isReplaying()) {
+    std::cout << "Input replay finished after " << mReplayPosition
+      << " ticks\n";
+  }
+}
+
+
+bool GameRunner::World::isReplaying() const {
+  return mpInputReplay && mReplayPosition < mpInputReplay->mInputs.size();
+}
+
+
+bool GameRunner::World::isTurboModeActive() const {
+  // When replaying, turbo mode only applies to the replay itself, so that
+  // the player can take over at regular speed once it's finished
+  return mTurboMode.mEnabled && (!mpInputReplay || isReplaying());
+}
+
+
 void GameRunner::World::handlePlayerInput(const SDL_Event& event) {
   const auto isKeyEvent = event.type == SDL_KEYDOWN || event.type == SDL_KEYUP;
   if (!isKeyEvent || event.key.repeat != 0) {
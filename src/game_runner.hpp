@@ -22,6 +22,7 @@
 #include "data/saved_game.hpp"
 #include "game_logic/game_world.hpp"
 #include "game_logic/input.hpp"
+#include "game_logic/input_recording.hpp"
 #include "loader/duke_script_loader.hpp"
 #include "ui/duke_script_runner.hpp"
 #include "ui/text_entry_widget.hpp"
@@ -32,13 +33,30 @@ RIGEL_DISABLE_WARNINGS
 #include <SDL.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <fstream>
 #include <functional>
+#include <optional>
 #include <stack>
+#include <string>
 #include <variant>
 
 
 namespace rigel {
 
+/** Settings for running game logic faster than real time
+ *
+ * In turbo mode, game logic ticks run as fast as possible instead of at the
+ * game's regular speed. This is meant for quickly getting through input
+ * replays or for soak testing.
+ */
+struct TurboModeOptions {
+  bool mEnabled = false;
+
+  /** Render the world once per this many logic ticks (never if 0) */
+  int mRenderInterval = 100;
+};
+
+
 class GameRunner : public entityx::Receiver<GameRunner> {
 public:
   GameRunner(
@@ -46,7 +64,13 @@ public:
     const data::GameSessionId& sessionId,
     GameMode::Context context,
     std::optional<base::Vector> playerPositionOverride = std::nullopt,
-    bool showWelcomeMessage = false);
+    bool showWelcomeMessage = false,
+    game_logic::InputRecordingOptions inputRecordingOptions = {},
+    TurboModeOptions turboModeOptions = {});
+  ~GameRunner();
+
+  GameRunner(const GameRunner&) = delete;
+  GameRunner& operator=(const GameRunner&) = delete;
 
   void handleEvent(const SDL_Event& event);
   void updateAndRender(engine::TimeDelta dt);
@@ -59,8 +83,12 @@ private:
   using ExecutionResult = ui::DukeScriptRunner::ExecutionResult;
 
   struct World {
-    explicit World(game_logic::GameWorld* pWorld)
+    World(
+      game_logic::GameWorld* pWorld,
+      IGameServiceProvider* pServiceProvider
+    )
       : mpWorld(pWorld)
+      , mpServiceProvider(pServiceProvider)
     {
     }
 
@@ -68,11 +96,23 @@ private:
     void updateAndRender(engine::TimeDelta dt);
 
     void updateWorld(engine::TimeDelta dt);
+    void updateWorldTurbo();
+    void runGameLogicTick();
+    bool isReplaying() const;
+    bool isTurboModeActive() const;
     void handlePlayerInput(const SDL_Event& event);
     void handleDebugKeys(const SDL_Event& event);
 
     game_logic::GameWorld* mpWorld;
+    IGameServiceProvider* mpServiceProvider;
     game_logic::PlayerInput mPlayerInput;
+    game_logic::InputRecording* mpInputRecording = nullptr;
+    const game_logic::InputRecording* mpInputReplay = nullptr;
+    std::size_t mReplayPosition = 0;
+    std::ostream* mpWorldStateHashStream = nullptr;
+    std::size_t mTicksRun = 0;
+    TurboModeOptions mTurboMode;
+    int mTicksSinceLastRender = 0;
     engine::TimeDelta mAccumulatedTime = 0.0;
     bool mShowDebugText = false;
     bool mSingleStepping = false;
@@ -130,6 +170,10 @@ private:
   GameMode::Context mContext;
   data::SavedGame mSavedGame;
   game_logic::GameWorld mWorld;
+  std::optional<game_logic::InputRecording> mInputRecording;
+  std::optional<std::string> mInputRecordingFile;
+  std::optional<game_logic::InputRecording> mInputReplay;
+  std::optional<std::ofstream> mWorldStateHashStream;
   std::stack<State, std::vector<State>> mStateStack;
   bool mGameWasQuit = false;
 };
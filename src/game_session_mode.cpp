@@ -29,14 +29,18 @@ namespace rigel {
 GameSessionMode::GameSessionMode(
   const data::GameSessionId& sessionId,
   Context context,
-  std::optional<base::Vector> playerPositionOverride
+  std::optional<base::Vector> playerPositionOverride,
+  game_logic::InputRecordingOptions inputRecordingOptions,
+  const TurboModeOptions turboModeOptions
 )
   : mCurrentStage(std::make_unique<GameRunner>(
       &mPlayerModel,
       sessionId,
       context,
       playerPositionOverride,
-      true /* show welcome message */))
+      true /* show welcome message */,
+      std::move(inputRecordingOptions),
+      turboModeOptions))
   , mEpisode(sessionId.mEpisode)
   , mCurrentLevelNr(sessionId.mLevel)
   , mDifficulty(sessionId.mDifficulty)
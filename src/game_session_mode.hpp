@@ -17,6 +17,7 @@
 #pragma once
 
 #include "data/player_model.hpp"
+#include "game_logic/input_recording.hpp"
 #include "ui/bonus_screen.hpp"
 #include "ui/episode_end_sequence.hpp"
 
@@ -35,7 +36,9 @@ public:
   GameSessionMode(
     const data::GameSessionId& sessionId,
     Context context,
-    std::optional<base::Vector> playerPositionOverride = std::nullopt);
+    std::optional<base::Vector> playerPositionOverride = std::nullopt,
+    game_logic::InputRecordingOptions inputRecordingOptions = {},
+    TurboModeOptions turboModeOptions = {});
 
   GameSessionMode(const data::SavedGame& save, Context context);
 
@@ -17,6 +17,7 @@
 #include "actor_image_package.hpp"
 
 #include "base/container_utils.hpp"
+#include "base/profiler.hpp"
 #include "data/game_traits.hpp"
 #include "data/unit_conversions.hpp"
 #include "loader/cmp_file_package.hpp"
@@ -101,6 +102,8 @@ ActorData ActorImagePackage::loadActor(
   const ActorID id,
   const Palette16& palette
 ) const {
+  RIGEL_PROFILE_ZONE("Load actor");
+
   // Font has to be loaded using loadFont()
   assert(id != FONT_ACTOR_ID);
 
@@ -48,6 +48,21 @@ ByteBuffer loadFile(const string& fileName) {
 }
 
 
+void saveFile(const ByteBuffer& data, const string& fileName) {
+  ofstream file(fileName, ios::binary);
+  if (!file.is_open()) {
+    throw runtime_error(string("File can't be opened: ") + fileName);
+  }
+
+  file.write(
+    reinterpret_cast<const char*>(data.data()),
+    static_cast<streamsize>(data.size()));
+  if (!file) {
+    throw runtime_error(string("Failed to write file: ") + fileName);
+  }
+}
+
+
 LeStreamReader::LeStreamReader(const ByteBuffer& data)
   : LeStreamReader(data.cbegin(), data.cend())
 {
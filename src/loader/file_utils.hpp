@@ -31,6 +31,14 @@ namespace rigel { namespace loader {
 ByteBuffer loadFile(const std::string& fileName);
 
 
+/** Write contents of ByteBuffer to file with given name
+ *
+ * Replaces the file if it already exists. Throws an exception if the file
+ * can't be written.
+ */
+void saveFile(const ByteBuffer& data, const std::string& fileName);
+
+
 /** Offers checked reading of little-endian data from a byte buffer
  *
  * All readX() methods will throw if there is not enough data left.
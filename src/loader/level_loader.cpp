@@ -19,6 +19,7 @@
 #include "base/container_utils.hpp"
 #include "base/grid.hpp"
 #include "base/math_tools.hpp"
+#include "base/profiler.hpp"
 #include "data/game_traits.hpp"
 #include "data/unit_conversions.hpp"
 #include "loader/bitwise_iter.hpp"
@@ -298,6 +299,8 @@ LevelData loadLevel(
   const ResourceLoader& resources,
   const Difficulty chosenDifficulty
 ) {
+  RIGEL_PROFILE_ZONE("Load level");
+
   const auto levelData = resources.mFilePackage.file(mapName);
   LeStreamReader levelReader(levelData);
 
@@ -17,6 +17,7 @@
 #include "resource_loader.hpp"
 
 #include "base/container_utils.hpp"
+#include "base/profiler.hpp"
 #include "data/game_traits.hpp"
 #include "data/unit_conversions.hpp"
 #include "loader/ega_image_decoder.hpp"
@@ -85,6 +86,7 @@ data::Image ResourceLoader::loadTiledFullscreenImage(
   const std::string& name,
   const Palette16& overridePalette
 ) const {
+  RIGEL_PROFILE_ZONE("Load fullscreen image");
   return loadTiledImage(
     mFilePackage.file(name),
     data::GameTraits::viewPortWidthTiles,
@@ -96,6 +98,8 @@ data::Image ResourceLoader::loadTiledFullscreenImage(
 data::Image ResourceLoader::loadStandaloneFullscreenImage(
   const std::string& name
 ) const {
+  RIGEL_PROFILE_ZONE("Load fullscreen image");
+
   const auto& data = mFilePackage.file(name);
   const auto paletteStart = data.cbegin() + FULL_SCREEN_IMAGE_DATA_SIZE;
   const auto palette = load6bitPalette16(
@@ -146,6 +150,8 @@ loader::Palette16 ResourceLoader::loadPaletteFromFullScreenImage(
 
 
 TileSet ResourceLoader::loadCZone(const std::string& name) const {
+  RIGEL_PROFILE_ZONE("Load tile set");
+
   using namespace data;
   using namespace map;
   using T = data::TileImageType;
@@ -196,16 +202,20 @@ TileSet ResourceLoader::loadCZone(const std::string& name) const {
 
 
 data::Movie ResourceLoader::loadMovie(const std::string& name) const {
+  RIGEL_PROFILE_ZONE("Load movie");
   return loader::loadMovie(loadFile(mGamePath + name));
 }
 
 
 data::Song ResourceLoader::loadMusic(const std::string& name) const {
+  RIGEL_PROFILE_ZONE("Load music");
   return loader::loadSong(mFilePackage.file(name));
 }
 
 
 data::AudioBuffer ResourceLoader::loadSound(const data::SoundId id) const {
+  RIGEL_PROFILE_ZONE("Load sound");
+
   static const std::map<data::SoundId, const char*> INTRO_SOUND_MAP{
     {data::SoundId::IntroGunShot, "INTRO3.MNI"},
     {data::SoundId::IntroGunShotLow, "INTRO4.MNI"},
@@ -240,6 +250,7 @@ data::AudioBuffer ResourceLoader::loadSound(const std::string& name) const {
 ScriptBundle ResourceLoader::loadScriptBundle(
   const std::string& fileName
 ) const {
+  RIGEL_PROFILE_ZONE("Load scripts");
   return loader::loadScripts(mFilePackage.fileAsText(fileName));
 }
 
@@ -16,6 +16,7 @@
 
 #include "base/warnings.hpp"
 #include "engine/opengl.hpp"
+#include "game_logic/world_state_hash.hpp"
 #include "sdl_utils/error.hpp"
 #include "sdl_utils/ptr.hpp"
 
@@ -28,9 +29,12 @@ RIGEL_DISABLE_WARNINGS
 #include <SDL.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <fstream>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 
 using namespace rigel;
@@ -88,21 +92,21 @@ private:
 };
 
 
-SDL_Window* createWindow() {
+SDL_Window* createWindow(const Uint32 extraFlags) {
   SDL_DisplayMode displayMode;
   if (SDL_GetDesktopDisplayMode(0, &displayMode) != 0) {
     displayMode.w = DEFAULT_RESOLUTION_X;
     displayMode.h = DEFAULT_RESOLUTION_Y;
   }
 
-  return throwIfCreationFailed([&displayMode]() {
+  return throwIfCreationFailed([&displayMode, extraFlags]() {
     return SDL_CreateWindow(
       "Rigel Engine",
       SDL_WINDOWPOS_UNDEFINED,
       SDL_WINDOWPOS_UNDEFINED,
       displayMode.w,
       displayMode.h,
-      WINDOW_FLAGS | SDL_WINDOW_OPENGL);
+      WINDOW_FLAGS | extraFlags);
   });
 }
 
@@ -130,22 +134,30 @@ void showBanner() {
 void initAndRunGame(const StartupOptions& config) {
   SdlInitializer initializeSDL;
 
-  throwIfFailed([]() { return SDL_GL_LoadLibrary(nullptr); });
+  const auto useOpenGl = !config.mUseSoftwareRendering;
+  if (useOpenGl) {
+    throwIfFailed([]() { return SDL_GL_LoadLibrary(nullptr); });
 
 #ifdef RIGEL_USE_GL_ES
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
 #else
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+    SDL_GL_SetAttribute(
+      SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
 #endif
-  SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+  }
+
+  Ptr<SDL_Window> pWindow(createWindow(useOpenGl ? SDL_WINDOW_OPENGL : 0));
 
-  Ptr<SDL_Window> pWindow(createWindow());
-  OpenGlContext glContext(pWindow.get());
-  engine::loadGlFunctions();
+  std::optional<OpenGlContext> glContext;
+  if (useOpenGl) {
+    glContext.emplace(pWindow.get());
+    engine::loadGlFunctions();
+  }
 
   SDL_DisableScreenSaver();
   SDL_ShowCursor(SDL_DISABLE);
@@ -153,6 +165,50 @@ void initAndRunGame(const StartupOptions& config) {
   gameMain(config, pWindow.get());
 }
 
+
+std::vector<game_logic::WorldStateHash> loadWorldStateHashes(
+  const string& fileName
+) {
+  ifstream file(fileName);
+  if (!file) {
+    throw runtime_error("Cannot open file: " + fileName);
+  }
+
+  return game_logic::readWorldStateHashes(file);
+}
+
+
+/** Compare two files written using 'record-world-hashes'
+ *
+ * Returns true if they are identical.
+ */
+bool compareWorldStateHashFiles(const string& fileName, const string& other) {
+  const auto hashes = loadWorldStateHashes(fileName);
+  const auto otherHashes = loadWorldStateHashes(other);
+
+  const auto divergence =
+    game_logic::findFirstDivergence(hashes, otherHashes);
+  if (!divergence) {
+    cout << "World states are identical for all " << hashes.size()
+      << " ticks\n";
+    return true;
+  }
+
+  if (divergence->mDifferingParts.empty()) {
+    cout << "World states are identical for " << divergence->mTick
+      << " ticks, but the files have different lengths ("
+      << hashes.size() << " vs. " << otherHashes.size() << " ticks)\n";
+    return false;
+  }
+
+  cout << "World states diverge at tick " << divergence->mTick << ":\n";
+  for (const auto& part : divergence->mDifferingParts) {
+    cout << "  " << part << " differ\n";
+  }
+
+  return false;
+}
+
 }
 
 
@@ -178,6 +234,39 @@ int main(int argc, char** argv) {
      po::value<string>(),
      "Specify position to place the player at (to be used in conjunction with\n"
      "'play-level')")
+    ("software-rendering",
+     po::bool_switch(&config.mUseSoftwareRendering),
+     "Render on the CPU instead of using OpenGL. Slower, but works without a "
+     "GPU (e.g. for benchmarks or image comparison tests)")
+    ("dump-frames",
+     po::value<string>(),
+     "Save each rendered frame as PNG file into the given directory "
+     "(requires 'software-rendering')")
+    ("record-input",
+     po::value<string>(),
+     "Record the player's input into the given file, for later replay "
+     "(requires 'play-level')")
+    ("replay-input",
+     po::value<string>(),
+     "Replay input recorded using 'record-input', starting the level it was "
+     "recorded in")
+    ("turbo",
+     po::bool_switch(&config.mTurboMode),
+     "Run game logic as fast as possible instead of in real time, with sound "
+     "effects muted. When replaying, only applies until the replay is "
+     "finished (requires 'play-level' or 'replay-input')")
+    ("turbo-render-interval",
+     po::value<int>(&config.mTurboModeRenderInterval),
+     "In turbo mode, render one frame per this many logic ticks, or nothing "
+     "if 0 (default: 100)")
+    ("record-world-hashes",
+     po::value<string>(),
+     "Write a hash of the world state after each game logic tick into the "
+     "given file (requires 'play-level' or 'replay-input')")
+    ("compare-world-hashes",
+     po::value<vector<string>>()->multitoken(),
+     "Compare two files written by 'record-world-hashes' and report the "
+     "first tick where they differ, then exit")
     ("game-path",
      po::value<string>(&config.mGamePath),
      "Path to original game's installation. Can also be given as positional "
@@ -202,6 +291,16 @@ int main(int argc, char** argv) {
       return 0;
     }
 
+    if (options.count("compare-world-hashes")) {
+      const auto files = options["compare-world-hashes"].as<vector<string>>();
+      if (files.size() != 2) {
+        throw invalid_argument(
+          "The compare-world-hashes option requires exactly two files");
+      }
+
+      return compareWorldStateHashFiles(files[0], files[1]) ? 0 : 1;
+    }
+
     if (disableMusic) {
       config.mEnableMusic = false;
     }
@@ -248,6 +347,66 @@ int main(int argc, char** argv) {
       config.mPlayerPosition = position;
     }
 
+    if (options.count("dump-frames")) {
+      if (!config.mUseSoftwareRendering) {
+        throw invalid_argument(
+          "This option requires also using the software-rendering option");
+      }
+
+      config.mFrameDumpPath = options["dump-frames"].as<string>();
+    }
+
+    // The player's position is not part of recordings, and the level to
+    // play is taken from the recording when replaying
+    if (options.count("record-input") || options.count("replay-input")) {
+      if (options.count("player-pos")) {
+        throw invalid_argument(
+          "Input recording and replay can't be combined with player-pos");
+      }
+    }
+
+    if (options.count("replay-input")) {
+      if (options.count("play-level")) {
+        throw invalid_argument(
+          "The replay-input option can't be combined with play-level");
+      }
+
+      config.mInputReplayPath = options["replay-input"].as<string>();
+    }
+
+    if (options.count("record-input")) {
+      if (!options.count("play-level") && !options.count("replay-input")) {
+        throw invalid_argument(
+          "The record-input option requires also using play-level");
+      }
+
+      config.mInputRecordingPath = options["record-input"].as<string>();
+    }
+
+    if (options.count("record-world-hashes")) {
+      if (!options.count("play-level") && !options.count("replay-input")) {
+        throw invalid_argument(
+          "The record-world-hashes option requires also using play-level or "
+          "replay-input");
+      }
+
+      config.mWorldStateHashPath = options["record-world-hashes"].as<string>();
+    }
+
+    if (config.mTurboMode) {
+      if (!options.count("play-level") && !options.count("replay-input")) {
+        throw invalid_argument(
+          "The turbo option requires also using play-level or replay-input");
+      }
+    } else if (options.count("turbo-render-interval")) {
+      throw invalid_argument(
+        "The turbo-render-interval option requires also using turbo");
+    }
+
+    if (config.mTurboModeRenderInterval < 0) {
+      throw invalid_argument("Turbo mode render interval can't be negative");
+    }
+
     if (!config.mGamePath.empty() && config.mGamePath.back() != '/') {
       config.mGamePath += "/";
     }
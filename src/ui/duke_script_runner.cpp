@@ -76,6 +76,7 @@ auto makeSpriteSheet(
 DukeScriptRunner::DukeScriptRunner(
   loader::ResourceLoader* pResourceLoader,
   engine::Renderer* pRenderer,
+  engine::TextureAtlas* pUiTextureAtlas,
   const data::SaveSlotArray* pSaveSlots,
   IGameServiceProvider* pServiceProvider
 )
@@ -86,7 +87,11 @@ DukeScriptRunner::DukeScriptRunner(
   , mpServices(pServiceProvider)
   , mUiSpriteSheetRenderer(
       makeSpriteSheet(pRenderer, *pResourceLoader, mCurrentPalette))
-  , mMenuElementRenderer(&mUiSpriteSheetRenderer, pRenderer, *pResourceLoader)
+  , mMenuElementRenderer(
+      &mUiSpriteSheetRenderer,
+      pRenderer,
+      pUiTextureAtlas,
+      *pResourceLoader)
   , mProgramCounter(0u)
 {
   // Default menu pre-selections at game start
@@ -49,6 +49,7 @@ public:
   DukeScriptRunner(
     loader::ResourceLoader* pResourceLoader,
     engine::Renderer* pRenderer,
+    engine::TextureAtlas* pUiTextureAtlas,
     const data::SaveSlotArray* pSaveSlots,
     IGameServiceProvider* pServiceProvider);
 
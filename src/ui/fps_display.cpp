@@ -42,7 +42,8 @@ FpsDisplay::FpsDisplay(MenuElementRenderer* pTextRenderer)
 
 void FpsDisplay::updateAndRender(
   const engine::TimeDelta totalElapsed,
-  const engine::TimeDelta renderingElapsed
+  const engine::TimeDelta renderingElapsed,
+  const engine::Renderer::Statistics& renderStats
 ) {
   mSmoothedFrameTime = (mSmoothedFrameTime * SMOOTHING) +
     (static_cast<float>(totalElapsed) * (1.0f-SMOOTHING));
@@ -62,7 +63,16 @@ void FpsDisplay::updateAndRender(
     << totalElapsed * 1000.0 << " ms, "
     << renderingElapsed * 1000.0 << " ms (inner)";
 
+  std::stringstream renderStatsReport;
+  renderStatsReport
+    << renderStats.mDrawCalls << " draws, "
+    << renderStats.mTextureBinds << " binds, "
+    << renderStats.mShaderSwitches << " shader switches, "
+    << renderStats.mCommandFlushes << " flushes, "
+    << renderStats.mVertexBytesUploaded / 1024 << " KiB vertex data";
+
   mpTextRenderer->drawText(0, 0, statsReport.str());
+  mpTextRenderer->drawText(0, 1, renderStatsReport.str());
 }
 
 }}
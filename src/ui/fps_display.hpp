@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "engine/renderer.hpp"
 #include "engine/timing.hpp"
 
 
@@ -30,7 +31,8 @@ public:
 
   void updateAndRender(
     engine::TimeDelta totalElapsed,
-    engine::TimeDelta renderingElapsed);
+    engine::TimeDelta renderingElapsed,
+    const engine::Renderer::Statistics& renderStats);
 
 private:
   MenuElementRenderer* mpTextRenderer;
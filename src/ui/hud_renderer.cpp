@@ -105,11 +105,11 @@ void drawLevelNumber(const int number, const TileRenderer& spriteSheet) {
 }
 
 
-OwningTexture actorToTexture(
-  engine::Renderer* pRenderer,
+TextureRegion actorToTexture(
+  engine::TextureAtlas* pTextureAtlas,
   const loader::ActorData& data
 ) {
-  return OwningTexture(pRenderer, data.mFrames[0].mFrameImage);
+  return pTextureAtlas->insert(data.mFrames[0].mFrameImage);
 }
 
 
@@ -117,33 +117,33 @@ OwningTexture actorToTexture(
 
 
 HudRenderer::InventoryItemTextureMap HudRenderer::makeInventoryItemTextureMap(
-  engine::Renderer* pRenderer,
+  engine::TextureAtlas* pTextureAtlas,
   const loader::ActorImagePackage& imagePack
 ) {
   InventoryItemTextureMap map;
 
   map.emplace(
     InventoryItemType::CircuitBoard,
-    actorToTexture(pRenderer, imagePack.loadActor(37)));
+    actorToTexture(pTextureAtlas, imagePack.loadActor(37)));
   map.emplace(
     InventoryItemType::BlueKey,
-    actorToTexture(pRenderer, imagePack.loadActor(121)));
+    actorToTexture(pTextureAtlas, imagePack.loadActor(121)));
   map.emplace(
     InventoryItemType::RapidFire,
-    actorToTexture(pRenderer, imagePack.loadActor(52)));
+    actorToTexture(pTextureAtlas, imagePack.loadActor(52)));
   map.emplace(
     InventoryItemType::SpecialHintGlobe,
-    actorToTexture(pRenderer, imagePack.loadActor(238)));
+    actorToTexture(pTextureAtlas, imagePack.loadActor(238)));
   map.emplace(
     InventoryItemType::CloakingDevice,
-    actorToTexture(pRenderer, imagePack.loadActor(211)));
+    actorToTexture(pTextureAtlas, imagePack.loadActor(211)));
   return map;
 }
 
 
 HudRenderer::CollectedLetterIndicatorMap
 HudRenderer::makeCollectedLetterTextureMap(
-  engine::Renderer* pRenderer,
+  engine::TextureAtlas* pTextureAtlas,
   const loader::ActorImagePackage& imagePack
 ) {
   CollectedLetterIndicatorMap map;
@@ -159,27 +159,27 @@ HudRenderer::makeCollectedLetterTextureMap(
   map.emplace(
     CollectableLetterType::N,
     CollectedLetterIndicator{
-      actorToTexture(pRenderer, imagePack.loadActor(290)),
+      actorToTexture(pTextureAtlas, imagePack.loadActor(290)),
       letterDrawStart});
   map.emplace(
     CollectableLetterType::U,
     CollectedLetterIndicator{
-      actorToTexture(pRenderer, imagePack.loadActor(291)),
+      actorToTexture(pTextureAtlas, imagePack.loadActor(291)),
       letterDrawStart});
   map.emplace(
     CollectableLetterType::K,
     CollectedLetterIndicator{
-      actorToTexture(pRenderer, imagePack.loadActor(292)),
+      actorToTexture(pTextureAtlas, imagePack.loadActor(292)),
       letterDrawStart + letterSize * 1});
   map.emplace(
     CollectableLetterType::E,
     CollectedLetterIndicator{
-      actorToTexture(pRenderer, imagePack.loadActor(293)),
+      actorToTexture(pTextureAtlas, imagePack.loadActor(293)),
       letterDrawStart + letterSize * 2});
   map.emplace(
     CollectableLetterType::M,
     CollectedLetterIndicator{
-      actorToTexture(pRenderer, imagePack.loadActor(294)),
+      actorToTexture(pTextureAtlas, imagePack.loadActor(294)),
       letterDrawStart + letterSize * 3});
   return map;
 }
@@ -189,6 +189,7 @@ HudRenderer::HudRenderer(
   data::PlayerModel* pPlayerModel,
   const int levelNumber,
   engine::Renderer* pRenderer,
+  engine::TextureAtlas* pTextureAtlas,
   const loader::ResourceLoader& bundle,
   engine::TileRenderer* pStatusSpriteSheetRenderer
 )
@@ -196,9 +197,11 @@ HudRenderer::HudRenderer(
       pPlayerModel,
       levelNumber,
       pRenderer,
+      pTextureAtlas,
       bundle.mActorImagePackage.loadActor(HUD_BACKGROUND_ACTOR_ID),
-      makeInventoryItemTextureMap(pRenderer, bundle.mActorImagePackage),
-      makeCollectedLetterTextureMap(pRenderer, bundle.mActorImagePackage),
+      makeInventoryItemTextureMap(pTextureAtlas, bundle.mActorImagePackage),
+      makeCollectedLetterTextureMap(
+        pTextureAtlas, bundle.mActorImagePackage),
       pStatusSpriteSheetRenderer)
 {
 }
@@ -208,6 +211,7 @@ HudRenderer::HudRenderer(
   data::PlayerModel* pPlayerModel,
   const int levelNumber,
   engine::Renderer* pRenderer,
+  engine::TextureAtlas* pTextureAtlas,
   const loader::ActorData& actorData,
   InventoryItemTextureMap&& inventoryItemTextures,
   CollectedLetterIndicatorMap&& collectedLetterTextures,
@@ -216,9 +220,11 @@ HudRenderer::HudRenderer(
   : mpPlayerModel(pPlayerModel)
   , mLevelNumber(levelNumber)
   , mpRenderer(pRenderer)
-  , mTopRightTexture(mpRenderer, actorData.mFrames[0].mFrameImage)
-  , mBottomLeftTexture(mpRenderer, actorData.mFrames[1].mFrameImage)
-  , mBottomRightTexture(mpRenderer, actorData.mFrames[2].mFrameImage)
+  , mTopRightTexture(pTextureAtlas->insert(actorData.mFrames[0].mFrameImage))
+  , mBottomLeftTexture(
+      pTextureAtlas->insert(actorData.mFrames[1].mFrameImage))
+  , mBottomRightTexture(
+      pTextureAtlas->insert(actorData.mFrames[2].mFrameImage))
   , mInventoryTexturesByType(std::move(inventoryItemTextures))
   , mCollectedLetterIndicatorsByType(std::move(collectedLetterTextures))
   , mpStatusSpriteSheetRenderer(pStatusSpriteSheetRenderer)
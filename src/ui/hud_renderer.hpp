@@ -18,6 +18,7 @@
 
 #include "data/player_model.hpp"
 #include "engine/texture.hpp"
+#include "engine/texture_atlas.hpp"
 #include "engine/tile_renderer.hpp"
 
 #include <cstdint>
@@ -46,6 +47,7 @@ public:
     data::PlayerModel* pPlayerModel,
     int levelNumber,
     engine::Renderer* pRenderer,
+    engine::TextureAtlas* pTextureAtlas,
     const loader::ResourceLoader& bundle,
     engine::TileRenderer* pStatusSpriteSheetRenderer);
 
@@ -54,12 +56,12 @@ public:
 
 private:
   struct CollectedLetterIndicator {
-    engine::OwningTexture mTexture;
+    engine::TextureRegion mTexture;
     base::Vector mPxPosition;
   };
 
   using InventoryItemTextureMap =
-    std::unordered_map<data::InventoryItemType, engine::OwningTexture>;
+    std::unordered_map<data::InventoryItemType, engine::TextureRegion>;
   using CollectedLetterIndicatorMap =
     std::unordered_map<data::CollectableLetterType, CollectedLetterIndicator>;
 
@@ -67,17 +69,18 @@ private:
     data::PlayerModel* pPlayerModel,
     int levelNumber,
     engine::Renderer* pRenderer,
+    engine::TextureAtlas* pTextureAtlas,
     const loader::ActorData& actorData,
     InventoryItemTextureMap&& inventoryItemTextures,
     CollectedLetterIndicatorMap&& collectedLetterTextures,
     engine::TileRenderer* pStatusSpriteSheetRenderer);
 
   static InventoryItemTextureMap makeInventoryItemTextureMap(
-    engine::Renderer* pRenderer,
+    engine::TextureAtlas* pTextureAtlas,
     const loader::ActorImagePackage& imagePack);
 
   static CollectedLetterIndicatorMap makeCollectedLetterTextureMap(
-    engine::Renderer* pRenderer,
+    engine::TextureAtlas* pTextureAtlas,
     const loader::ActorImagePackage& imagePack);
 
   void drawHealthBar() const;
@@ -89,9 +92,9 @@ private:
 
   std::uint32_t mElapsedFrames = 0;
 
-  engine::OwningTexture mTopRightTexture;
-  engine::OwningTexture mBottomLeftTexture;
-  engine::OwningTexture mBottomRightTexture;
+  engine::TextureRegion mTopRightTexture;
+  engine::TextureRegion mBottomLeftTexture;
+  engine::TextureRegion mBottomRightTexture;
   InventoryItemTextureMap mInventoryTexturesByType;
   CollectedLetterIndicatorMap mCollectedLetterIndicatorsByType;
   engine::TileRenderer* mpStatusSpriteSheetRenderer;
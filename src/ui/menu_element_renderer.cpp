@@ -147,9 +147,9 @@ constexpr auto CURSOR_ANIM_DELAY = 5;
 constexpr auto NUM_CURSOR_ANIM_STATES = 4;
 
 
-engine::OwningTexture createFontTexture(
+engine::TextureRegion createFontTexture(
   const loader::FontData& font,
-  engine::Renderer* pRenderer
+  engine::TextureAtlas* pTextureAtlas
 ) {
   if (font.size() != 67u) {
     throw std::runtime_error("Wrong number of bitmaps in menu font");
@@ -166,7 +166,7 @@ engine::OwningTexture createFontTexture(
     insertPosX += characterWidth;
   }
 
-  return engine::OwningTexture{pRenderer, combinedBitmaps};
+  return pTextureAtlas->insert(combinedBitmaps);
 }
 
 }
@@ -175,12 +175,14 @@ engine::OwningTexture createFontTexture(
 MenuElementRenderer::MenuElementRenderer(
   engine::TileRenderer* pSpriteSheetRenderer,
   engine::Renderer* pRenderer,
+  engine::TextureAtlas* pTextureAtlas,
   const loader::ResourceLoader& resources
 )
   : mpRenderer(pRenderer)
   , mpSpriteSheetRenderer(pSpriteSheetRenderer)
   , mBigTextRenderer(
-      createFontTexture(resources.mActorImagePackage.loadFont(), pRenderer),
+      createFontTexture(
+        resources.mActorImagePackage.loadFont(), pTextureAtlas),
       pRenderer)
 {
 }
@@ -19,6 +19,7 @@
 #include "base/color.hpp"
 #include "base/warnings.hpp"
 #include "engine/texture.hpp"
+#include "engine/texture_atlas.hpp"
 #include "engine/timing.hpp"
 #include "engine/tile_renderer.hpp"
 #include "loader/palette.hpp"
@@ -44,6 +45,7 @@ public:
   MenuElementRenderer(
     engine::TileRenderer* pSpriteSheetRenderer,
     engine::Renderer* pRenderer,
+    engine::TextureAtlas* pTextureAtlas,
     const loader::ResourceLoader& resources);
 
   // Stateless API
@@ -0,0 +1,233 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profiler_overlay.hpp"
+
+#include "base/color.hpp"
+#include "data/game_traits.hpp"
+#include "engine/renderer.hpp"
+
+#include "menu_element_renderer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+
+namespace rigel { namespace ui {
+
+namespace {
+
+constexpr auto NUM_FRAMES_SHOWN = std::size_t{128};
+constexpr auto BAR_WIDTH = 2;
+constexpr auto PIXELS_PER_MS = 4;
+constexpr auto MAX_BAR_HEIGHT = 120;
+constexpr auto NUM_LEGEND_ENTRIES = 8;
+
+// Frame time at 60 Hz, shown as a horizontal line in the graph
+constexpr auto FRAME_BUDGET_MS = 1000.0 / 60.0;
+
+const auto BUDGET_LINE_COLOR = base::Color{255, 255, 255, 160};
+
+const std::array<base::Color, 12> ZONE_COLORS{
+  base::Color{230, 25, 75, 255},
+  base::Color{60, 180, 75, 255},
+  base::Color{255, 225, 25, 255},
+  base::Color{0, 130, 200, 255},
+  base::Color{245, 130, 48, 255},
+  base::Color{145, 30, 180, 255},
+  base::Color{70, 240, 240, 255},
+  base::Color{240, 50, 230, 255},
+  base::Color{210, 245, 60, 255},
+  base::Color{250, 190, 190, 255},
+  base::Color{0, 128, 128, 255},
+  base::Color{170, 110, 40, 255}
+};
+
+
+std::size_t colorIndexFor(const char* pZoneName) {
+  // Hash the name instead of the pointer, so that colors stay the same
+  // from one run to the next
+  return std::hash<std::string_view>{}(pZoneName) % ZONE_COLORS.size();
+}
+
+
+void addTime(
+  std::vector<std::pair<const char*, std::int64_t>>& times,
+  const char* pZoneName,
+  const std::int64_t timeNs
+) {
+  const auto iEntry = std::find_if(times.begin(), times.end(),
+    [&](const auto& entry) { return entry.first == pZoneName; });
+  if (iEntry != times.end()) {
+    iEntry->second += timeNs;
+  } else {
+    times.emplace_back(pZoneName, timeNs);
+  }
+}
+
+
+int nsToPixels(const std::int64_t timeNs) {
+  return static_cast<int>(timeNs * PIXELS_PER_MS / 1'000'000);
+}
+
+}
+
+
+ProfilerOverlay::ProfilerOverlay(
+  engine::Renderer* pRenderer,
+  MenuElementRenderer* pTextRenderer
+)
+  : mpRenderer(pRenderer)
+  , mpTextRenderer(pTextRenderer)
+{
+}
+
+
+void ProfilerOverlay::updateAndRender() {
+  consumeNewRecords();
+
+  const auto screenHeight = mpRenderer->fullScreenRect().size.height;
+  const auto graphTop = screenHeight - MAX_BAR_HEIGHT;
+  renderGraph(screenHeight);
+  renderLegend(graphTop - data::GameTraits::tileSize);
+}
+
+
+void ProfilerOverlay::consumeNewRecords() {
+  mNewRecords.clear();
+  mReadPosition =
+    base::profiler::threadBuffer().read(mReadPosition, mNewRecords);
+
+  // Zones are recorded when they end, so all children of a zone have been
+  // seen by the time we get to the zone itself.
+  for (const auto& record : mNewRecords) {
+    const auto depth = std::size_t{record.mDepth};
+    if (mChildTimeByDepth.size() < depth + 2) {
+      mChildTimeByDepth.resize(depth + 2, 0);
+    }
+
+    const auto duration = record.mEndNs - record.mStartNs;
+    const auto selfTime = duration - mChildTimeByDepth[depth + 1];
+    mChildTimeByDepth[depth + 1] = 0;
+    addTime(mCurrentFrame, record.mpName, selfTime);
+
+    if (depth > 0) {
+      mChildTimeByDepth[depth] += duration;
+      continue;
+    }
+
+    // Sort by name to keep the stacking order stable across frames
+    std::sort(mCurrentFrame.begin(), mCurrentFrame.end(),
+      [](const auto& lhs, const auto& rhs) {
+        return std::strcmp(lhs.first, rhs.first) < 0;
+      });
+
+    mFrameHistory.push_back(std::move(mCurrentFrame));
+    mCurrentFrame.clear();
+    if (mFrameHistory.size() > NUM_FRAMES_SHOWN) {
+      mFrameHistory.pop_front();
+    }
+  }
+}
+
+
+void ProfilerOverlay::renderGraph(const int bottom) {
+  std::array<std::vector<base::Vector>, ZONE_COLORS.size()> pointsByColor;
+
+  auto x = 0;
+  for (const auto& frame : mFrameHistory) {
+    auto y = bottom - 1;
+    for (const auto& [pZoneName, timeNs] : frame) {
+      const auto height =
+        std::min(nsToPixels(timeNs), y - (bottom - MAX_BAR_HEIGHT));
+      auto& points = pointsByColor[colorIndexFor(pZoneName)];
+
+      for (auto row = 0; row < height; ++row, --y) {
+        for (auto column = 0; column < BAR_WIDTH; ++column) {
+          points.push_back({x + column, y});
+        }
+      }
+    }
+
+    x += BAR_WIDTH;
+  }
+
+  for (auto i = 0u; i < ZONE_COLORS.size(); ++i) {
+    const auto& points = pointsByColor[i];
+    mpRenderer->drawPoints(
+      {points.data(), static_cast<std::uint32_t>(points.size())},
+      ZONE_COLORS[i]);
+  }
+
+  const auto budgetY =
+    bottom - static_cast<int>(FRAME_BUDGET_MS * PIXELS_PER_MS);
+  mpRenderer->drawLine(
+    0, budgetY, int(NUM_FRAMES_SHOWN) * BAR_WIDTH, budgetY, BUDGET_LINE_COLOR);
+}
+
+
+void ProfilerOverlay::renderLegend(const int bottom) {
+  if (mFrameHistory.empty()) {
+    return;
+  }
+
+  ZoneTimes totals;
+  for (const auto& frame : mFrameHistory) {
+    for (const auto& [pZoneName, timeNs] : frame) {
+      addTime(totals, pZoneName, timeNs);
+    }
+  }
+
+  std::sort(totals.begin(), totals.end(),
+    [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+
+  const auto numEntries =
+    std::min(totals.size(), std::size_t{NUM_LEGEND_ENTRIES});
+  const auto tileSize = data::GameTraits::tileSize;
+  const auto firstRow = bottom / tileSize - int(numEntries);
+
+  std::vector<base::Vector> swatchPoints;
+  for (auto i = 0u; i < numEntries; ++i) {
+    const auto& [pZoneName, totalNs] = totals[i];
+    const auto row = firstRow + int(i);
+
+    swatchPoints.clear();
+    for (auto y = 1; y < tileSize - 1; ++y) {
+      for (auto x = 1; x < tileSize - 1; ++x) {
+        swatchPoints.push_back({x, row * tileSize + y});
+      }
+    }
+    mpRenderer->drawPoints(
+      {swatchPoints.data(), static_cast<std::uint32_t>(swatchPoints.size())},
+      ZONE_COLORS[colorIndexFor(pZoneName)]);
+
+    const auto averageMs =
+      static_cast<double>(totalNs) / mFrameHistory.size() / 1'000'000.0;
+    std::stringstream entry;
+    entry
+      << pZoneName << ": "
+      << std::fixed << std::setprecision(2) << averageMs << " ms";
+    mpTextRenderer->drawText(1, row, entry.str());
+  }
+}
+
+}}
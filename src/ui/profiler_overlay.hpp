@@ -0,0 +1,65 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/profiler.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+
+namespace rigel { namespace engine { class Renderer; }}
+namespace rigel { namespace ui { class MenuElementRenderer; }}
+
+
+namespace rigel { namespace ui {
+
+/** Stacked bar graph of recent frame times, split up by profiler zone
+ *
+ * Each bar stands for one top-level zone recorded on the calling thread,
+ * which is usually a whole frame. It's made up of the self time of all
+ * zones nested within it, i.e. the time spent in a zone minus the time spent
+ * in its children. A legend lists the zones taking the most time on average.
+ */
+class ProfilerOverlay {
+public:
+  ProfilerOverlay(
+    engine::Renderer* pRenderer,
+    MenuElementRenderer* pTextRenderer);
+
+  void updateAndRender();
+
+private:
+  using ZoneTimes = std::vector<std::pair<const char*, std::int64_t>>;
+
+  void consumeNewRecords();
+  void renderGraph(int bottom);
+  void renderLegend(int bottom);
+
+  engine::Renderer* mpRenderer;
+  MenuElementRenderer* mpTextRenderer;
+
+  std::vector<base::profiler::ZoneRecord> mNewRecords;
+  std::uint64_t mReadPosition = 0;
+  std::vector<std::int64_t> mChildTimeByDepth;
+  ZoneTimes mCurrentFrame;
+  std::deque<ZoneTimes> mFrameHistory;
+};
+
+}}
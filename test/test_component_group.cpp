@@ -0,0 +1,318 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <base/warnings.hpp>
+#include <engine/component_group.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine;
+
+namespace ex = entityx;
+
+
+namespace {
+
+struct Position {
+  int x = 0;
+  int y = 0;
+};
+
+
+struct Velocity {
+  int dx = 0;
+  int dy = 0;
+};
+
+
+std::vector<ex::Entity> collectMembers(
+  ComponentGroup<Position, Velocity>& group
+) {
+  std::vector<ex::Entity> members;
+  group.forEach([&](ex::Entity entity, Position&, Velocity&) {
+    members.push_back(entity);
+  });
+  return members;
+}
+
+}
+
+
+TEST_CASE("Component group tracks entities with all components") {
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+
+  auto existing = entities.create();
+  existing.assign<Position>();
+  existing.assign<Velocity>();
+
+  auto onlyPosition = entities.create();
+  onlyPosition.assign<Position>();
+
+  ComponentGroup<Position, Velocity> group{entities, entityx.events};
+
+  SECTION("Existing entities are picked up") {
+    REQUIRE(group.size() == 1);
+    REQUIRE(collectMembers(group) == std::vector<ex::Entity>{existing});
+  }
+
+  SECTION("Entities become members once they have all components") {
+    onlyPosition.assign<Velocity>();
+    REQUIRE(group.size() == 2);
+
+    auto created = entities.create();
+    created.assign<Velocity>();
+    REQUIRE(group.size() == 2);
+    created.assign<Position>();
+    REQUIRE(group.size() == 3);
+  }
+
+  SECTION("Entities stop being members when losing a component") {
+    existing.remove<Velocity>();
+    REQUIRE(group.size() == 0);
+
+    existing.assign<Velocity>();
+    REQUIRE(group.size() == 1);
+
+    existing.destroy();
+    REQUIRE(group.size() == 0);
+  }
+
+  SECTION("Members are ordered by entity index") {
+    onlyPosition.assign<Velocity>();
+
+    const auto members = collectMembers(group);
+    REQUIRE(members.size() == 2);
+    CHECK(members[0].id().index() < members[1].id().index());
+  }
+
+  SECTION("Components are accessible") {
+    existing.component<Velocity>()->dx = 3;
+
+    group.forEach([](ex::Entity, Position& position, Velocity& velocity) {
+      position.x += velocity.dx;
+    });
+
+    CHECK(existing.component<Position>()->x == 3);
+  }
+
+  SECTION("Batched changes keep members ordered") {
+    std::vector<ex::Entity> created;
+    for (int i = 0; i < 64; ++i) {
+      auto entity = entities.create();
+      entity.assign<Velocity>();
+      entity.assign<Position>();
+      created.push_back(entity);
+    }
+
+    for (std::size_t i = 0; i < created.size(); i += 2) {
+      created[i].destroy();
+    }
+
+    // Re-uses the indices of the destroyed entities
+    for (int i = 0; i < 16; ++i) {
+      auto entity = entities.create();
+      entity.assign<Position>();
+      entity.assign<Velocity>();
+    }
+
+    existing.remove<Position>();
+    existing.assign<Position>();
+
+    const auto members = collectMembers(group);
+    REQUIRE(members.size() == 1 + 32 + 16);
+    CHECK(group.size() == members.size());
+    CHECK(std::is_sorted(members.begin(), members.end(),
+      [](const ex::Entity& lhs, const ex::Entity& rhs) {
+        return lhs.id().index() < rhs.id().index();
+      }));
+
+    for (const auto& entity : members) {
+      CHECK(entity.valid());
+    }
+  }
+
+  SECTION("Changes during iteration") {
+    onlyPosition.assign<Velocity>();
+
+    SECTION("Removed entities are skipped") {
+      auto numVisited = 0;
+      group.forEach([&](ex::Entity entity, Position&, Velocity&) {
+        ++numVisited;
+        if (entity == existing) {
+          onlyPosition.destroy();
+        } else {
+          existing.destroy();
+        }
+      });
+
+      CHECK(numVisited == 1);
+      CHECK(group.size() == 1);
+    }
+
+    SECTION("Added entities are visited on the next iteration") {
+      auto numVisited = 0;
+      group.forEach([&](ex::Entity, Position&, Velocity&) {
+        ++numVisited;
+
+        auto entity = entities.create();
+        entity.assign<Position>();
+        entity.assign<Velocity>();
+      });
+
+      CHECK(numVisited == 2);
+      CHECK(group.size() == 4);
+      CHECK(collectMembers(group).size() == 4);
+    }
+
+    SECTION("Added entities in free slots ahead are visited right away") {
+      auto placeholder1 = entities.create();
+      auto placeholder2 = entities.create();
+      const auto index1 = placeholder1.id().index();
+      const auto index2 = placeholder2.id().index();
+      placeholder2.destroy();
+      placeholder1.destroy();
+
+      std::vector<ex::Entity> visited;
+      std::vector<ex::Entity> created;
+      group.forEach([&](ex::Entity entity, Position&, Velocity&) {
+        visited.push_back(entity);
+
+        if (created.empty()) {
+          // Components are assigned individually, so the group receives
+          // several events for the same entity
+          for (auto i = 0; i < 2; ++i) {
+            auto newEntity = entities.create();
+            newEntity.assign<Velocity>();
+            newEntity.assign<Position>();
+            created.push_back(newEntity);
+          }
+        }
+      });
+
+      REQUIRE(created.size() == 2);
+      CHECK(created[0].id().index() == index1);
+      CHECK(created[1].id().index() == index2);
+
+      CHECK(visited == (std::vector<ex::Entity>{
+        existing, onlyPosition, created[0], created[1]}));
+      CHECK(collectMembers(group) == visited);
+    }
+
+    SECTION("Entities gaining components ahead are visited right away") {
+      existing.remove<Velocity>();
+      auto later = entities.create();
+      later.assign<Position>();
+
+      std::vector<ex::Entity> visited;
+      group.forEach([&](ex::Entity entity, Position&, Velocity&) {
+        visited.push_back(entity);
+        if (!later.has_component<Velocity>()) {
+          existing.assign<Velocity>();
+          later.assign<Velocity>();
+        }
+      });
+
+      // The existing entity lies behind the cursor, so it's only visited
+      // from the next iteration on
+      CHECK(visited == (std::vector<ex::Entity>{onlyPosition, later}));
+      CHECK(collectMembers(group) == (std::vector<ex::Entity>{
+        existing, onlyPosition, later}));
+    }
+
+    SECTION("Entities removed again before being reached are skipped") {
+      auto placeholder = entities.create();
+      placeholder.destroy();
+
+      auto numVisited = 0;
+      group.forEach([&](ex::Entity, Position&, Velocity&) {
+        ++numVisited;
+
+        if (numVisited == 1) {
+          auto entity = entities.create();
+          entity.assign<Position>();
+          entity.assign<Velocity>();
+          entity.destroy();
+        }
+      });
+
+      CHECK(numVisited == 2);
+      CHECK(group.size() == 2);
+    }
+  }
+}
+
+
+TEST_CASE("Component group benchmark", "[.benchmark]") {
+  using Clock = std::chrono::high_resolution_clock;
+
+  const auto NUM_ITERATIONS = 100;
+
+  for (const auto numEntities : {1000, 10000, 50000}) {
+    ex::EntityX entityx;
+    auto& entities = entityx.entities;
+
+    // Only a fraction of entities is moving, like in a real level
+    for (int i = 0; i < numEntities; ++i) {
+      auto entity = entities.create();
+      entity.assign<Position>();
+      if (i % 4 == 0) {
+        entity.assign<Velocity>(Velocity{1, 1});
+      }
+    }
+
+    ComponentGroup<Position, Velocity> group{entities, entityx.events};
+
+    const auto measure = [&](auto&& updateFunc) {
+      const auto before = Clock::now();
+      for (int i = 0; i < NUM_ITERATIONS; ++i) {
+        updateFunc();
+      }
+
+      const auto elapsed = std::chrono::duration<double, std::micro>(
+        Clock::now() - before);
+      return elapsed.count() / NUM_ITERATIONS;
+    };
+
+    const auto eachTime = measure([&]() {
+      entities.each<Position, Velocity>(
+        [](ex::Entity, Position& position, Velocity& velocity) {
+          position.x += velocity.dx;
+          position.y += velocity.dy;
+        });
+    });
+
+    const auto groupTime = measure([&]() {
+      group.forEach([](ex::Entity, Position& position, Velocity& velocity) {
+        position.x += velocity.dx;
+        position.y += velocity.dy;
+      });
+    });
+
+    std::cout
+      << numEntities << " entities: each() " << eachTime << " us, "
+      << "ComponentGroup " << groupTime << " us per tick\n";
+  }
+}
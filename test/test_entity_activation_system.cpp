@@ -0,0 +1,333 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <base/warnings.hpp>
+#include <data/game_traits.hpp>
+#include <engine/base_components.hpp>
+#include <engine/entity_activation_system.hpp>
+#include <engine/entity_tools.hpp>
+#include <engine/physical_components.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine;
+using namespace engine::components;
+
+namespace ex = entityx;
+
+
+namespace {
+
+using Policy = ActivationSettings::Policy;
+
+const auto MAP_WIDTH = 200;
+const auto MAP_HEIGHT = 120;
+
+
+// Reference implementation, evaluating all entities on each update
+void markActiveEntities(
+  ex::EntityManager& es,
+  const base::Vector& cameraPosition
+) {
+  const BoundingBox activeRegionBox{
+    cameraPosition,
+    data::GameTraits::mapViewPortSize};
+
+  es.each<WorldPosition, BoundingBox>([&activeRegionBox](
+    ex::Entity entity,
+    const WorldPosition& position,
+    const BoundingBox& bbox
+  ) {
+    const auto inActiveRegion =
+      toWorldSpace(bbox, position).intersects(activeRegionBox);
+
+    auto active = inActiveRegion;
+    if (entity.has_component<ActivationSettings>()) {
+      auto& settings = *entity.component<ActivationSettings>();
+      if (settings.mPolicy == Policy::Always) {
+        active = true;
+      } else if (settings.mPolicy == Policy::AlwaysAfterFirstActivation) {
+        settings.mHasBeenActivated =
+          settings.mHasBeenActivated || inActiveRegion;
+        active = settings.mHasBeenActivated;
+      }
+    }
+
+    setTag<Active>(entity, active);
+    if (active) {
+      entity.component<Active>()->mIsOnScreen = inActiveRegion;
+    }
+  });
+}
+
+
+bool hasSameActivationState(ex::Entity entity, ex::Entity reference) {
+  if (entity.has_component<Active>() != reference.has_component<Active>()) {
+    return false;
+  }
+
+  if (
+    entity.has_component<Active>() &&
+    entity.component<Active>()->mIsOnScreen !=
+      reference.component<Active>()->mIsOnScreen
+  ) {
+    return false;
+  }
+
+  return
+    !entity.has_component<ActivationSettings>() ||
+    entity.component<ActivationSettings>()->mHasBeenActivated ==
+      reference.component<ActivationSettings>()->mHasBeenActivated;
+}
+
+
+/** Runs EntityActivationSystem and the reference implementation side by
+ * side, on two entity managers with identical entities
+ */
+class ActivationTestWorld {
+public:
+  explicit ActivationTestWorld(const unsigned seed)
+    : mRandomGenerator(seed)
+    , mSystem(MAP_WIDTH, MAP_HEIGHT, mEntityX.entities, mEntityX.events)
+  {
+  }
+
+  // Invokes func(entity) for both copies of the entity
+  template <typename Func>
+  void forBoth(const std::size_t index, Func&& func) {
+    func(mEntities[index].first);
+    func(mEntities[index].second);
+  }
+
+  void createEntity() {
+    const auto isLarge = randomChance(0.05);
+    const auto width = isLarge ? randomInt(17, 40) : randomInt(1, 6);
+    const auto height = isLarge ? randomInt(1, 40) : randomInt(1, 6);
+    const auto position = WorldPosition{
+      randomInt(-10, MAP_WIDTH + 10), randomInt(-10, MAP_HEIGHT + 10)};
+    const auto policy = randomInt(0, 3);
+
+    auto setUp = [&](ex::Entity entity) {
+      entity.assign<WorldPosition>(position);
+      entity.assign<BoundingBox>(BoundingBox{{0, 0}, {width, height}});
+      if (policy < 3) {
+        entity.assign<ActivationSettings>(static_cast<Policy>(policy));
+      }
+    };
+
+    auto entity = mEntityX.entities.create();
+    auto reference = mReference.entities.create();
+    setUp(entity);
+    setUp(reference);
+    mEntities.emplace_back(entity, reference);
+  }
+
+  void destroyEntity(const std::size_t index) {
+    forBoth(index, [](ex::Entity entity) { entity.destroy(); });
+    mEntities.erase(mEntities.begin() + index);
+  }
+
+  void update(const base::Vector& cameraPosition) {
+    mSystem.update(cameraPosition);
+    markActiveEntities(mReference.entities, cameraPosition);
+  }
+
+  std::vector<std::size_t> mismatches() const {
+    std::vector<std::size_t> result;
+    for (std::size_t i = 0; i < mEntities.size(); ++i) {
+      if (!hasSameActivationState(mEntities[i].first, mEntities[i].second)) {
+        result.push_back(i);
+      }
+    }
+
+    return result;
+  }
+
+  bool isActive(const std::size_t index) const {
+    return mEntities[index].first.has_component<Active>();
+  }
+
+  int randomInt(const int min, const int max) {
+    return std::uniform_int_distribution<int>{min, max}(mRandomGenerator);
+  }
+
+  bool randomChance(const double probability) {
+    return std::bernoulli_distribution{probability}(mRandomGenerator);
+  }
+
+  const EntityActivationSystem& system() const {
+    return mSystem;
+  }
+
+  std::size_t size() const {
+    return mEntities.size();
+  }
+
+private:
+  std::mt19937 mRandomGenerator;
+  ex::EntityX mEntityX;
+  ex::EntityX mReference;
+  EntityActivationSystem mSystem;
+  std::vector<std::pair<ex::Entity, ex::Entity>> mEntities;
+};
+
+
+// Mostly scrolls smoothly, with an occasional jump (like when teleporting)
+base::Vector nextCameraPosition(
+  ActivationTestWorld& world,
+  const base::Vector& cameraPosition
+) {
+  const auto maxX = MAP_WIDTH - data::GameTraits::mapViewPortSize.width;
+  const auto maxY = MAP_HEIGHT - data::GameTraits::mapViewPortSize.height;
+
+  if (world.randomChance(0.02)) {
+    return {world.randomInt(0, maxX), world.randomInt(0, maxY)};
+  }
+
+  return {
+    std::clamp(cameraPosition.x + world.randomInt(-3, 3), 0, maxX),
+    std::clamp(cameraPosition.y + world.randomInt(-2, 2), 0, maxY)};
+}
+
+}
+
+
+TEST_CASE("Entity activation matches evaluating all entities") {
+  const auto NUM_UPDATES = 400;
+
+  ActivationTestWorld world{1234};
+  for (int i = 0; i < 500; ++i) {
+    world.createEntity();
+  }
+
+  auto cameraPosition = base::Vector{};
+
+  const auto runUpdates = [&](auto&& modifyWorld) {
+    for (int i = 0; i < NUM_UPDATES; ++i) {
+      cameraPosition = nextCameraPosition(world, cameraPosition);
+      world.update(cameraPosition);
+      REQUIRE(world.mismatches() == std::vector<std::size_t>{});
+
+      modifyWorld();
+    }
+  };
+
+  SECTION("Camera moves") {
+    runUpdates([]() {});
+
+    // Only entities close to the camera are evaluated
+    CHECK(world.system().entitiesEvaluatedLastUpdate() < world.size() / 2);
+  }
+
+  SECTION("Active entities move between regions") {
+    runUpdates([&]() {
+      for (std::size_t i = 0; i < world.size(); ++i) {
+        if (!world.isActive(i) || !world.randomChance(0.3)) {
+          continue;
+        }
+
+        const auto offset = world.randomChance(0.1)
+          ? base::Vector{world.randomInt(-60, 60), world.randomInt(-40, 40)}
+          : base::Vector{world.randomInt(-3, 3), world.randomInt(-3, 3)};
+        world.forBoth(i, [&](ex::Entity entity) {
+          *entity.component<WorldPosition>() += offset;
+        });
+      }
+    });
+  }
+
+  SECTION("Inactive entities are moved by re-assigning their position") {
+    runUpdates([&]() {
+      for (std::size_t i = 0; i < world.size(); ++i) {
+        if (world.isActive(i) || !world.randomChance(0.05)) {
+          continue;
+        }
+
+        const auto position = WorldPosition{
+          world.randomInt(0, MAP_WIDTH - 1),
+          world.randomInt(0, MAP_HEIGHT - 1)};
+        world.forBoth(i, [&](ex::Entity entity) {
+          reassign<WorldPosition>(entity, position);
+        });
+      }
+    });
+  }
+
+  SECTION("Activation settings change") {
+    runUpdates([&]() {
+      for (std::size_t i = 0; i < world.size(); ++i) {
+        if (!world.randomChance(0.02)) {
+          continue;
+        }
+
+        const auto change = world.randomInt(0, 2);
+        const auto policy = static_cast<Policy>(world.randomInt(0, 2));
+        world.forBoth(i, [&](ex::Entity entity) {
+          if (change == 0) {
+            reassign<ActivationSettings>(entity, policy);
+          } else if (change == 1) {
+            removeSafely<ActivationSettings>(entity);
+          } else if (entity.has_component<ActivationSettings>()) {
+            resetActivation(entity);
+          }
+        });
+      }
+    });
+  }
+
+  SECTION("Entities are created and destroyed") {
+    runUpdates([&]() {
+      for (auto i = world.randomInt(0, 4); i > 0; --i) {
+        world.destroyEntity(static_cast<std::size_t>(
+          world.randomInt(0, static_cast<int>(world.size()) - 1)));
+      }
+
+      for (auto i = world.randomInt(0, 4); i > 0; --i) {
+        world.createEntity();
+      }
+    });
+  }
+}
+
+
+TEST_CASE("Entity activation forgets destroyed entities") {
+  ActivationTestWorld world{42};
+  for (int i = 0; i < 100; ++i) {
+    world.createEntity();
+  }
+
+  world.update({0, 0});
+  REQUIRE(world.system().numTrackedEntities() == 100);
+
+  // The camera stays in the top-left corner, so most of the regions
+  // containing these entities are never evaluated again
+  while (world.size() > 10) {
+    world.destroyEntity(world.size() - 1);
+  }
+
+  world.update({0, 0});
+  CHECK(world.system().numTrackedEntities() == 10);
+  CHECK(world.mismatches() == std::vector<std::size_t>{});
+}
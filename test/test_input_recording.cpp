@@ -0,0 +1,105 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <base/warnings.hpp>
+#include <game_logic/input_recording.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+
+using namespace rigel;
+using namespace game_logic;
+
+
+namespace {
+
+PlayerInput walkingRight() {
+  PlayerInput input;
+  input.mRight = true;
+  return input;
+}
+
+
+PlayerInput jumpingAndFiring() {
+  PlayerInput input;
+  input.mLeft = true;
+  input.mUp = true;
+  input.mInteract = {true, true};
+  input.mJump = {true, true};
+  input.mFire = {true, false};
+  return input;
+}
+
+}
+
+
+TEST_CASE("Input recordings can be serialized and parsed") {
+  InputRecording recording{
+    data::GameSessionId{2, 5, data::Difficulty::Hard}, {}};
+
+  recording.mInputs.insert(recording.mInputs.end(), 100, PlayerInput{});
+  recording.mInputs.push_back(jumpingAndFiring());
+  recording.mInputs.insert(recording.mInputs.end(), 70000, walkingRight());
+  recording.mInputs.push_back(PlayerInput{});
+
+  const auto serialized = serialize(recording);
+
+  SECTION("Identical consecutive inputs are stored as a single run") {
+    // Header plus 5 runs, since runs are limited to 65535 ticks
+    CHECK(serialized.size() == 12 + 5 * 4);
+  }
+
+  SECTION("Round trip preserves all data") {
+    const auto parsed = deserializeInputRecording(serialized);
+
+    CHECK(parsed.mSessionId.mEpisode == 2);
+    CHECK(parsed.mSessionId.mLevel == 5);
+    CHECK(parsed.mSessionId.mDifficulty == data::Difficulty::Hard);
+
+    REQUIRE(parsed.mInputs.size() == recording.mInputs.size());
+    CHECK(parsed.mInputs == recording.mInputs);
+  }
+
+  SECTION("Invalid data is rejected") {
+    auto corrupted = serialized;
+
+    SECTION("Wrong magic number") {
+      corrupted[0] = 'X';
+      CHECK_THROWS(deserializeInputRecording(corrupted));
+    }
+
+    SECTION("Invalid level") {
+      corrupted[6] = 8;
+      CHECK_THROWS(deserializeInputRecording(corrupted));
+    }
+
+    SECTION("Truncated") {
+      corrupted.resize(corrupted.size() - 2);
+      CHECK_THROWS(deserializeInputRecording(corrupted));
+    }
+
+    SECTION("Tick count exceeding the data") {
+      for (auto i = 8u; i < 12u; ++i) {
+        corrupted[i] = 0xFF;
+      }
+
+      CHECK_THROWS_WITH(
+        deserializeInputRecording(corrupted), "Corrupt input recording");
+    }
+  }
+}
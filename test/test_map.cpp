@@ -0,0 +1,235 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <base/warnings.hpp>
+#include <data/map.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <random>
+#include <utility>
+#include <vector>
+
+
+using namespace rigel;
+using namespace data::map;
+
+
+namespace {
+
+const auto MAP_WIDTH = 40;
+const auto MAP_HEIGHT = 30;
+
+
+Map makeRandomMap(std::mt19937& randomGenerator) {
+  // Tile 0 is empty, the remaining tiles cover all combinations of solid
+  // edges
+  TileAttributeDict::AttributeArray attributes;
+  for (std::uint16_t flags = 0; flags < 16; ++flags) {
+    attributes.push_back(flags);
+  }
+
+  Map map{MAP_WIDTH, MAP_HEIGHT, TileAttributeDict{attributes}};
+
+  std::uniform_int_distribution<TileIndex> tileDistribution{0, 15};
+  std::bernoulli_distribution layerDistribution{0.3};
+  for (int y = 0; y < MAP_HEIGHT; ++y) {
+    for (int x = 0; x < MAP_WIDTH; ++x) {
+      map.setTileAt(0, x, y, tileDistribution(randomGenerator));
+      if (layerDistribution(randomGenerator)) {
+        map.setTileAt(1, x, y, tileDistribution(randomGenerator));
+      }
+    }
+  }
+
+  return map;
+}
+
+
+// Reference implementation, computing collision data from the tiles directly
+bool isSolid(const Map& map, const int x, const int y, const SolidEdge edge) {
+  if (x < 0 || x >= map.width()) {
+    return true;
+  }
+
+  if (y < 0 || y >= map.height()) {
+    return false;
+  }
+
+  const auto tile1 = map.tileAt(0, x, y);
+  const auto tile2 = map.tileAt(1, x, y);
+  if (tile1 != 0 && tile2 != 0) {
+    return false;
+  }
+
+  const auto& dict = map.attributeDict();
+  return
+    dict.collisionData(tile1).isSolidOn(edge) ||
+    dict.collisionData(tile2).isSolidOn(edge);
+}
+
+}
+
+
+TEST_CASE("Map span tests match per-tile collision data") {
+  std::mt19937 randomGenerator{42};
+  auto map = makeRandomMap(randomGenerator);
+
+  const auto edges = {
+    SolidEdge::top(),
+    SolidEdge::bottom(),
+    SolidEdge::left(),
+    SolidEdge::right()};
+
+  SECTION("Single tiles") {
+    for (int y = -3; y < MAP_HEIGHT + 3; ++y) {
+      for (int x = -3; x < MAP_WIDTH + 3; ++x) {
+        for (const auto& edge : edges) {
+          const auto expected = isSolid(map, x, y, edge);
+          REQUIRE(map.collisionData(x, y).isSolidOn(edge) == expected);
+          REQUIRE(map.hasSolidEdgeInRow(y, x, x, edge) == expected);
+          REQUIRE(map.hasSolidEdgeInColumn(x, y, y, edge) == expected);
+        }
+      }
+    }
+  }
+
+  SECTION("Spans of varying length") {
+    std::uniform_int_distribution<int> xDistribution{-5, MAP_WIDTH + 5};
+    std::uniform_int_distribution<int> yDistribution{-5, MAP_HEIGHT + 5};
+    std::uniform_int_distribution<int> lengthDistribution{0, 35};
+
+    for (int i = 0; i < 2000; ++i) {
+      const auto x = xDistribution(randomGenerator);
+      const auto y = yDistribution(randomGenerator);
+      const auto length = lengthDistribution(randomGenerator);
+
+      for (const auto& edge : edges) {
+        auto expectedInRow = false;
+        auto expectedInColumn = false;
+        for (int offset = 0; offset < length; ++offset) {
+          expectedInRow |= isSolid(map, x + offset, y, edge);
+          expectedInColumn |= isSolid(map, x, y + offset, edge);
+        }
+
+        REQUIRE(
+          map.hasSolidEdgeInRow(y, x, x + length - 1, edge) == expectedInRow);
+        REQUIRE(
+          map.hasSolidEdgeInColumn(x, y, y + length - 1, edge) ==
+          expectedInColumn);
+      }
+    }
+  }
+
+  SECTION("Collision data follows modifications") {
+    map.clearSection(5, 5, 20, 10);
+    map.setTileAt(1, 10, 8, 0xF);
+
+    for (int y = 5; y < 15; ++y) {
+      for (int x = 5; x < 25; ++x) {
+        const auto expected = x == 10 && y == 8;
+        const auto data = map.collisionData(x, y);
+        REQUIRE(data.isSolidOn(SolidEdge::top()) == expected);
+      }
+    }
+
+    REQUIRE(map.hasSolidEdgeInRow(8, 5, 24, SolidEdge::left()));
+    REQUIRE(!map.hasSolidEdgeInRow(9, 5, 24, SolidEdge::left()));
+    REQUIRE(map.hasSolidEdgeInColumn(10, 5, 14, SolidEdge::bottom()));
+    REQUIRE(!map.hasSolidEdgeInColumn(11, 5, 14, SolidEdge::bottom()));
+  }
+}
+
+
+TEST_CASE("Map reports changes since a given revision") {
+  std::mt19937 randomGenerator{42};
+  auto map = makeRandomMap(randomGenerator);
+
+  using Position = std::pair<int, int>;
+  auto changesSince = [&map](const std::uint64_t revision) {
+    std::vector<Position> changes;
+    const auto complete = map.forEachChangeSince(revision,
+      [&changes](const int x, const int y) {
+        changes.emplace_back(x, y);
+      });
+    return std::make_pair(complete, changes);
+  };
+
+  const auto seenRevision = map.revision();
+
+  SECTION("No changes") {
+    const auto result = changesSince(seenRevision);
+    CHECK(result.first);
+    CHECK(result.second.empty());
+  }
+
+  SECTION("Modified tiles are reported") {
+    map.setTileAt(0, 3, 4, 1);
+    map.setTileAt(1, 7, 2, 2);
+
+    CHECK(map.revision() > seenRevision);
+    const auto result = changesSince(seenRevision);
+    CHECK(result.first);
+    CHECK(result.second == (std::vector<Position>{{7, 2}, {3, 4}}));
+  }
+
+  SECTION("Old revisions are rejected once the log has been trimmed") {
+    for (auto i = 0; i < 5000; ++i) {
+      map.setTileAt(0, i % MAP_WIDTH, 0, 1);
+    }
+
+    CHECK(!changesSince(seenRevision).first);
+
+    const auto recentRevision = map.revision();
+    map.setTileAt(0, 1, 1, 1);
+    const auto result = changesSince(recentRevision);
+    CHECK(result.first);
+    CHECK(result.second == (std::vector<Position>{{1, 1}}));
+  }
+
+  SECTION("Assigning an older copy requires a full update") {
+    const auto copy = map;
+    map.setTileAt(0, 3, 4, 1);
+    const auto modifiedRevision = map.revision();
+
+    map = copy;
+    CHECK(map.tileAt(0, 3, 4) == copy.tileAt(0, 3, 4));
+    CHECK(map.revision() != modifiedRevision);
+    CHECK(!changesSince(modifiedRevision).first);
+
+    // Modifying the map again must not make the changes made by the
+    // assignment go unnoticed
+    map.setTileAt(0, 9, 9, 1);
+    CHECK(!changesSince(modifiedRevision).first);
+    CHECK(!changesSince(seenRevision).first);
+  }
+
+  SECTION("A copy starts its own history") {
+    auto copy = map;
+    const auto copyRevision = copy.revision();
+    CHECK(copyRevision != map.revision());
+
+    copy.setTileAt(0, 5, 5, 1);
+    CHECK(!copy.forEachChangeSince(seenRevision, [](int, int) {}));
+
+    std::vector<Position> changes;
+    CHECK(copy.forEachChangeSince(copyRevision,
+      [&changes](const int x, const int y) { changes.emplace_back(x, y); }));
+    CHECK(changes == (std::vector<Position>{{5, 5}}));
+  }
+}
@@ -0,0 +1,173 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <base/spatial_types_printing.hpp>
+#include <base/warnings.hpp>
+#include <data/map.hpp>
+#include <engine/collision_checker.hpp>
+#include <engine/movement.hpp>
+#include <engine/physical_components.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <random>
+
+
+using namespace rigel;
+using namespace engine;
+using namespace engine::components;
+
+
+namespace ex = entityx;
+
+
+namespace {
+
+const auto MAP_WIDTH = 40;
+const auto MAP_HEIGHT = 40;
+
+
+// Reference implementation: Moves one unit at a time, testing for
+// collisions after each step.
+template<typename CollisionTestT>
+MovementResult moveStepwise(
+  int* pPosition,
+  const int amount,
+  CollisionTestT isColliding
+) {
+  if (amount == 0) {
+    return MovementResult::Completed;
+  }
+
+  const auto desiredDistance = std::abs(amount);
+  const auto movement = amount < 0 ? -1 : 1;
+
+  const auto previousPosition = *pPosition;
+  for (int i = 0; i < desiredDistance; ++i) {
+    if (isColliding()) {
+      break;
+    }
+
+    *pPosition += movement;
+  }
+
+  const auto actualDistance = std::abs(*pPosition - previousPosition);
+  if (actualDistance == 0) {
+    return MovementResult::Failed;
+  }
+
+  return actualDistance == desiredDistance
+    ? MovementResult::Completed
+    : MovementResult::MovedPartially;
+}
+
+}
+
+
+TEST_CASE("Swept movement gives the same results as stepwise movement") {
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+
+  std::mt19937 randomGenerator{1234};
+
+  data::map::TileAttributeDict::AttributeArray attributes;
+  for (std::uint16_t flags = 0; flags < 16; ++flags) {
+    attributes.push_back(flags);
+  }
+
+  data::map::Map map{
+    MAP_WIDTH, MAP_HEIGHT, data::map::TileAttributeDict{attributes}};
+
+  {
+    std::uniform_int_distribution<data::map::TileIndex> tileDistribution{1, 15};
+    std::bernoulli_distribution solidTileDistribution{0.08};
+    for (int y = 0; y < MAP_HEIGHT; ++y) {
+      for (int x = 0; x < MAP_WIDTH; ++x) {
+        if (solidTileDistribution(randomGenerator)) {
+          map.setTileAt(0, x, y, tileDistribution(randomGenerator));
+        }
+      }
+    }
+  }
+
+  std::uniform_int_distribution<int> coordinateDistribution{-4, MAP_WIDTH + 4};
+  std::uniform_int_distribution<int> sizeDistribution{0, 6};
+
+  for (int i = 0; i < 12; ++i) {
+    auto solidBody = entities.create();
+    solidBody.assign<SolidBody>();
+    solidBody.assign<BoundingBox>(BoundingBox{
+      {0, 0},
+      {sizeDistribution(randomGenerator), sizeDistribution(randomGenerator)}});
+    solidBody.assign<WorldPosition>(
+      coordinateDistribution(randomGenerator),
+      coordinateDistribution(randomGenerator));
+  }
+
+  CollisionChecker collisionChecker{&map, entityx.entities, entityx.events};
+
+  auto entity = entities.create();
+  entity.assign<WorldPosition>();
+  entity.assign<BoundingBox>();
+
+  std::uniform_int_distribution<int> amountDistribution{-20, 20};
+
+  for (int i = 0; i < 5000; ++i) {
+    const auto startPosition = WorldPosition{
+      coordinateDistribution(randomGenerator),
+      coordinateDistribution(randomGenerator)};
+    const auto bbox = BoundingBox{
+      {0, 0},
+      {sizeDistribution(randomGenerator), sizeDistribution(randomGenerator)}};
+    const auto amount = amountDistribution(randomGenerator);
+
+    *entity.component<BoundingBox>() = bbox;
+
+    {
+      auto expectedPosition = startPosition;
+      const auto expectedResult = moveStepwise(&expectedPosition.x, amount,
+        [&]() {
+          return amount < 0
+            ? collisionChecker.isTouchingLeftWall(expectedPosition, bbox)
+            : collisionChecker.isTouchingRightWall(expectedPosition, bbox);
+        });
+
+      *entity.component<WorldPosition>() = startPosition;
+      const auto result = moveHorizontally(collisionChecker, entity, amount);
+
+      REQUIRE(result == expectedResult);
+      REQUIRE(*entity.component<WorldPosition>() == expectedPosition);
+    }
+
+    {
+      auto expectedPosition = startPosition;
+      const auto expectedResult = moveStepwise(&expectedPosition.y, amount,
+        [&]() {
+          return amount < 0
+            ? collisionChecker.isTouchingCeiling(expectedPosition, bbox)
+            : collisionChecker.isOnSolidGround(expectedPosition, bbox);
+        });
+
+      *entity.component<WorldPosition>() = startPosition;
+      const auto result = moveVertically(collisionChecker, entity, amount);
+
+      REQUIRE(result == expectedResult);
+      REQUIRE(*entity.component<WorldPosition>() == expectedPosition);
+    }
+  }
+}
@@ -37,6 +37,34 @@ using namespace engine::components::parameter_aliases;
 namespace ex = entityx;
 
 
+namespace {
+
+struct SpawnOnCollisionReceiver : ex::Receiver<SpawnOnCollisionReceiver> {
+  explicit SpawnOnCollisionReceiver(ex::EntityManager& entities)
+    : mpEntities(&entities)
+  {
+  }
+
+  void receive(const events::CollidedWithWorld&) {
+    if (mSpawnedEntity) {
+      return;
+    }
+
+    mSpawnedEntity = mpEntities->create();
+    mSpawnedEntity.assign<BoundingBox>(BoundingBox{{0, 0}, {1, 1}});
+    mSpawnedEntity.assign<MovingBody>(
+      MovingBody{{1.0f, 0.0f}, false});
+    mSpawnedEntity.assign<WorldPosition>(WorldPosition{20, 20});
+    mSpawnedEntity.assign<Active>();
+  }
+
+  ex::EntityManager* mpEntities;
+  ex::Entity mSpawnedEntity;
+};
+
+}
+
+
 TEST_CASE("Physics system works as expected") {
   ex::EntityX entityx;
   auto& entities = entityx.entities;
@@ -210,6 +238,47 @@ TEST_CASE("Physics system works as expected") {
       CHECK(physicalObject.has_component<CollidedWithWorld>());
     }
 
+    SECTION("Entities spawned on collision in phase 1 skip phase 2") {
+      SpawnOnCollisionReceiver receiver{entities};
+      entityx.events.subscribe<events::CollidedWithWorld>(receiver);
+
+      body.mVelocity.y = 2.0f;
+      physicsSystem.updatePhase1(entities);
+      physicsSystem.updatePhase2(entities);
+
+      REQUIRE(receiver.mSpawnedEntity);
+      const auto& spawnedPosition =
+        *receiver.mSpawnedEntity.component<WorldPosition>();
+      CHECK(spawnedPosition.x == 20);
+
+      physicsSystem.updatePhase1(entities);
+      CHECK(spawnedPosition.x == 21);
+    }
+
+    SECTION("Entities spawned in a free slot ahead are updated in phase 1") {
+      // Like entityx's each(), phase 1 still reaches an entity created
+      // during the update if it reuses a slot after the current one
+      auto placeholder = entities.create();
+      const auto freeIndex = placeholder.id().index();
+      placeholder.destroy();
+
+      SpawnOnCollisionReceiver receiver{entities};
+      entityx.events.subscribe<events::CollidedWithWorld>(receiver);
+
+      body.mVelocity.y = 2.0f;
+      physicsSystem.updatePhase1(entities);
+      physicsSystem.updatePhase2(entities);
+
+      REQUIRE(receiver.mSpawnedEntity);
+      CHECK(receiver.mSpawnedEntity.id().index() == freeIndex);
+      const auto& spawnedPosition =
+        *receiver.mSpawnedEntity.component<WorldPosition>();
+      CHECK(spawnedPosition.x == 21);
+
+      physicsSystem.updatePhase1(entities);
+      CHECK(spawnedPosition.x == 22);
+    }
+
     SECTION("Object continues falling after solidbody removed") {
       body.mVelocity.y = 2.0f;
       runOneFrame();
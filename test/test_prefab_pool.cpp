@@ -0,0 +1,325 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <base/warnings.hpp>
+
+#include <data/map.hpp>
+#include <engine/collision_checker.hpp>
+#include <engine/entity_tools.hpp>
+#include <engine/life_time_components.hpp>
+#include <engine/life_time_system.hpp>
+#include <engine/physical_components.hpp>
+#include <engine/physics_system.hpp>
+#include <engine/prefab_pool.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+
+using namespace rigel;
+using namespace engine;
+using namespace engine::components;
+
+
+namespace ex = entityx;
+
+
+namespace {
+
+const auto MOVER = PrefabId{1};
+const auto OTHER_PREFAB = PrefabId{2};
+
+
+struct Marker {};
+
+
+struct PoolEventRecorder : ex::Receiver<PoolEventRecorder> {
+  explicit PoolEventRecorder(ex::EventManager& events) {
+    events.subscribe<events::PrefabInstanceRecycled>(*this);
+    events.subscribe<events::PrefabInstancesParked>(*this);
+  }
+
+  void receive(const events::PrefabInstanceRecycled& event) {
+    mRecycled.push_back(event.mEntity);
+  }
+
+  void receive(const events::PrefabInstancesParked& event) {
+    mParkedBatches.push_back(event.mEntities);
+  }
+
+  std::vector<ex::Entity> mRecycled;
+  std::vector<std::vector<ex::Entity>> mParkedBatches;
+};
+
+
+ex::Entity spawnMover(
+  PrefabPool& pool,
+  const WorldPosition& position,
+  const PrefabId id = MOVER
+) {
+  return pool.spawn(id, [&](ex::Entity entity) {
+    assignOrReplace<BoundingBox>(entity, BoundingBox{{0, 0}, {1, 1}});
+    assignOrReplace<MovingBody>(entity, MovingBody{{1.0f, 0.0f}, false});
+    assignOrReplace<WorldPosition>(entity, position);
+    assignOrReplace<Active>(entity);
+  });
+}
+
+}
+
+
+TEST_CASE("Prefab pool re-uses parked instances") {
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+
+  PrefabPool pool{entities, entityx.events};
+  PoolEventRecorder recorder{entityx.events};
+
+  auto entity = spawnMover(pool, {2, 3});
+
+  REQUIRE(entity.valid());
+  CHECK(pool.isInstance(entity));
+  CHECK(pool.numParked() == 0);
+  CHECK(recorder.mRecycled.empty());
+
+  SECTION("Regular entities are not instances") {
+    CHECK(!pool.isInstance(entities.create()));
+  }
+
+  SECTION("Parking takes the entity out of the world") {
+    pool.park({entity});
+
+    REQUIRE(entity.valid());
+    CHECK(!entity.has_component<WorldPosition>());
+    CHECK(!entity.has_component<Active>());
+    CHECK(entity.has_component<MovingBody>());
+    CHECK(pool.numParked() == 1);
+
+    REQUIRE(recorder.mParkedBatches.size() == 1);
+    CHECK(recorder.mParkedBatches[0] == std::vector<ex::Entity>{entity});
+  }
+
+  SECTION("Spawning the same prefab again re-uses the parked entity") {
+    entity.component<MovingBody>()->mVelocity.x = 5.0f;
+    pool.park({entity});
+
+    const auto recycled = spawnMover(pool, {7, 8});
+
+    CHECK(recycled == entity);
+    CHECK(pool.numParked() == 0);
+    CHECK(entities.size() == 1);
+
+    const auto& position = *recycled.component<WorldPosition>();
+    CHECK(position.x == 7);
+    CHECK(position.y == 8);
+    CHECK(recycled.component<MovingBody>()->mVelocity.x == 1.0f);
+    CHECK(recycled.has_component<Active>());
+
+    REQUIRE(recorder.mRecycled.size() == 1);
+    CHECK(recorder.mRecycled[0] == entity);
+  }
+
+  SECTION("Spawning a different prefab creates a new entity") {
+    pool.park({entity});
+
+    const auto other = spawnMover(pool, {7, 8}, OTHER_PREFAB);
+
+    CHECK(other != entity);
+    CHECK(pool.isInstance(other));
+    CHECK(pool.numParked() == 1);
+    CHECK(recorder.mRecycled.empty());
+  }
+
+  SECTION("Destroyed entities are forgotten") {
+    pool.park({entity});
+    entity.destroy();
+
+    CHECK(pool.numParked() == 0);
+
+    const auto newEntity = spawnMover(pool, {7, 8});
+    CHECK(pool.isInstance(newEntity));
+    CHECK(recorder.mRecycled.empty());
+  }
+
+  SECTION("Instances with additional components are replaced") {
+    // E.g. assigned by the spawning code, or through a stale handle
+    entity.assign<Marker>();
+    pool.park({entity});
+
+    const auto newEntity = spawnMover(pool, {7, 8});
+
+    CHECK(!entity.valid());
+    REQUIRE(newEntity.valid());
+    CHECK(pool.isInstance(newEntity));
+    CHECK(!newEntity.has_component<Marker>());
+    CHECK(newEntity.component<WorldPosition>()->x == 7);
+    CHECK(pool.numParked() == 0);
+    CHECK(entities.size() == 1);
+    CHECK(recorder.mRecycled.empty());
+
+    SECTION("The replacement is recycled again") {
+      pool.park({newEntity});
+      CHECK(spawnMover(pool, {1, 1}) == newEntity);
+    }
+  }
+}
+
+
+TEST_CASE("Prefab pool handles destroying all parked instances") {
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+
+  PrefabPool pool{entities, entityx.events};
+  PoolEventRecorder recorder{entityx.events};
+
+  std::vector<ex::Entity> movers;
+  std::vector<ex::Entity> others;
+  for (int i = 0; i < 100; ++i) {
+    movers.push_back(spawnMover(pool, {i, 0}));
+    others.push_back(spawnMover(pool, {i, 1}, OTHER_PREFAB));
+  }
+
+  pool.park(movers);
+  pool.park(others);
+  REQUIRE(pool.numParked() == 200);
+
+  SECTION("All at once") {
+    entities.reset();
+
+    CHECK(pool.numParked() == 0);
+
+    const auto newEntity = spawnMover(pool, {7, 8});
+    CHECK(pool.isInstance(newEntity));
+    CHECK(recorder.mRecycled.empty());
+  }
+
+  SECTION("Partially") {
+    const auto survivor = movers[10];
+    for (auto entity : movers) {
+      if (entity != survivor) {
+        entity.destroy();
+      }
+    }
+
+    CHECK(pool.numParked() == 101);
+
+    CHECK(spawnMover(pool, {7, 8}) == survivor);
+    CHECK(pool.numParked() == 100);
+
+    const auto newEntity = spawnMover(pool, {7, 8});
+    CHECK(newEntity != survivor);
+    CHECK(recorder.mRecycled.size() == 1);
+
+    CHECK(spawnMover(pool, {7, 8}, OTHER_PREFAB) == others.back());
+  }
+}
+
+
+TEST_CASE("Life time system parks expired prefab instances") {
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+
+  PrefabPool pool{entities, entityx.events};
+  PoolEventRecorder recorder{entityx.events};
+  LifeTimeSystem lifeTimeSystem{entities, entityx.events, &pool};
+
+  auto spawnShortLived = [&]() {
+    return pool.spawn(MOVER, [](ex::Entity entity) {
+      assignOrReplace<WorldPosition>(entity, WorldPosition{0, 0});
+      assignOrReplace<AutoDestroy>(entity, AutoDestroy::afterTimeout(0));
+    });
+  };
+
+  auto first = spawnShortLived();
+  auto second = spawnShortLived();
+  auto regular = entities.create();
+  regular.assign<AutoDestroy>(AutoDestroy::afterTimeout(0));
+
+  lifeTimeSystem.update();
+
+  CHECK(!regular.valid());
+  REQUIRE(first.valid());
+  REQUIRE(second.valid());
+  CHECK(pool.numParked() == 2);
+
+  // Both instances are parked in a single batch
+  REQUIRE(recorder.mParkedBatches.size() == 1);
+  CHECK(recorder.mParkedBatches[0].size() == 2);
+
+  SECTION("Recycled instances expire again") {
+    const auto recycled = spawnShortLived();
+    REQUIRE(recycled.valid());
+    CHECK(pool.numParked() == 1);
+
+    lifeTimeSystem.update();
+
+    CHECK(pool.numParked() == 2);
+    REQUIRE(recorder.mParkedBatches.size() == 2);
+    CHECK(recorder.mParkedBatches[1] == std::vector<ex::Entity>{recycled});
+  }
+
+  SECTION("Parked instances don't expire a second time") {
+    lifeTimeSystem.update();
+
+    CHECK(recorder.mParkedBatches.size() == 1);
+  }
+}
+
+
+TEST_CASE("Physics system tracks prefab instances spawned between phases") {
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+
+  data::map::Map map{100, 100, data::map::TileAttributeDict{{0x0, 0xF}}};
+
+  PrefabPool pool{entities, entityx.events};
+  CollisionChecker collisionChecker{&map, entities, entityx.events};
+  PhysicsSystem physicsSystem{&collisionChecker, &map, &entityx.events};
+
+  auto entity = spawnMover(pool, {10, 10});
+  physicsSystem.updatePhase1(entities);
+  physicsSystem.updatePhase2(entities);
+  REQUIRE(entity.component<WorldPosition>()->x == 11);
+
+  pool.park({entity});
+
+  SECTION("Recycled instance is moved in phase 2") {
+    physicsSystem.updatePhase1(entities);
+
+    const auto recycled = spawnMover(pool, {20, 20});
+    REQUIRE(recycled == entity);
+
+    physicsSystem.updatePhase2(entities);
+
+    CHECK(recycled.component<WorldPosition>()->x == 21);
+  }
+
+  SECTION("Instance parked and recycled in between is only moved once") {
+    physicsSystem.updatePhase1(entities);
+
+    auto other = spawnMover(pool, {30, 30}, OTHER_PREFAB);
+    pool.park({other});
+    auto third = spawnMover(pool, {40, 40}, PrefabId{3});
+    const auto recycled = spawnMover(pool, {30, 30}, OTHER_PREFAB);
+    REQUIRE(recycled == other);
+
+    physicsSystem.updatePhase2(entities);
+
+    CHECK(recycled.component<WorldPosition>()->x == 31);
+    CHECK(third.component<WorldPosition>()->x == 41);
+  }
+}
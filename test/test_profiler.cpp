@@ -0,0 +1,114 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <base/profiler.hpp>
+#include <base/warnings.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace rigel;
+using namespace base::profiler;
+
+
+TEST_CASE("Profiler records nested zones") {
+  auto& buffer = threadBuffer();
+
+  std::vector<ZoneRecord> records;
+  const auto startPosition = buffer.read(0, records);
+  records.clear();
+
+  {
+    ScopedZone outer("Outer");
+    {
+      ScopedZone first("First");
+    }
+    {
+      ScopedZone second("Second");
+      ScopedZone nested("Nested");
+    }
+  }
+
+  const auto endPosition = buffer.read(startPosition, records);
+  CHECK(endPosition == startPosition + 4);
+
+  // Zones are recorded when they end, so children come before parents
+  REQUIRE(records.size() == 4);
+  CHECK(std::string{records[0].mpName} == "First");
+  CHECK(std::string{records[1].mpName} == "Nested");
+  CHECK(std::string{records[2].mpName} == "Second");
+  CHECK(std::string{records[3].mpName} == "Outer");
+
+  CHECK(records[0].mDepth == 1);
+  CHECK(records[1].mDepth == 2);
+  CHECK(records[2].mDepth == 1);
+  CHECK(records[3].mDepth == 0);
+
+  for (const auto& record : records) {
+    CHECK(record.mStartNs <= record.mEndNs);
+    CHECK(record.mStartNs >= records[3].mStartNs);
+    CHECK(record.mEndNs <= records[3].mEndNs);
+  }
+}
+
+
+TEST_CASE("Profiler ring buffer keeps most recent zones") {
+  auto& buffer = threadBuffer();
+
+  std::vector<ZoneRecord> records;
+  const auto startPosition = buffer.read(0, records);
+
+  const auto numZones = ThreadBuffer::CAPACITY + 10;
+  for (std::size_t i = 0; i < numZones; ++i) {
+    ScopedZone zone(i + 1 == numZones ? "Last" : "Filler");
+  }
+
+  records.clear();
+  const auto endPosition = buffer.read(startPosition, records);
+
+  CHECK(endPosition == startPosition + numZones);
+  REQUIRE(records.size() == ThreadBuffer::CAPACITY);
+  CHECK(std::string{records.back().mpName} == "Last");
+}
+
+
+TEST_CASE("Profiler exports zones of all threads as Chrome trace") {
+  {
+    ScopedZone zone("Main \"thread\" zone");
+  }
+
+  std::thread worker([]() {
+    ScopedZone zone("Worker zone");
+  });
+  worker.join();
+
+  std::stringstream trace;
+  writeChromeTrace(trace);
+  const auto json = trace.str();
+
+  CHECK(json.find("\"traceEvents\"") != std::string::npos);
+  const auto escapedName = R"("name":"Main \"thread\" zone")";
+  CHECK(json.find(escapedName) != std::string::npos);
+  CHECK(json.find("\"name\":\"Worker zone\"") != std::string::npos);
+  CHECK(json.find("\"ph\":\"X\"") != std::string::npos);
+}
@@ -0,0 +1,123 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <base/warnings.hpp>
+#include <engine/renderer.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+
+using namespace rigel;
+using namespace engine;
+
+
+namespace {
+
+const auto RED = base::Color{255, 0, 0, 255};
+const auto BLUE = base::Color{0, 0, 255, 255};
+
+
+data::Image makeImage(
+  const int width,
+  const int height,
+  const base::Color& color
+) {
+  return data::Image{
+    data::PixelBuffer(std::size_t(width * height), color),
+    std::size_t(width),
+    std::size_t(height)};
+}
+
+
+base::Color pixelAt(const Renderer& renderer, const int x, const int y) {
+  const auto frame = renderer.frameBufferContents();
+  REQUIRE(frame);
+  return frame->pixelData()[std::size_t(x) + std::size_t(y) * frame->width()];
+}
+
+}
+
+
+TEST_CASE("Renderer only reorders draws within a draw order") {
+  Renderer renderer{nullptr, RenderBackend::Software};
+
+  // The red texture has the lower handle, so it sorts first when grouping
+  // draws by texture
+  const auto redTexture = renderer.createTexture(makeImage(8, 8, RED));
+  const auto blueTexture = renderer.createTexture(makeImage(8, 8, BLUE));
+  REQUIRE(redTexture.mHandle < blueTexture.mHandle);
+
+  const auto sourceRect = base::Rect<int>{{0, 0}, {8, 8}};
+  const auto drawBlueThenRed = [&]() {
+    renderer.drawTexture(blueTexture, sourceRect, {{0, 0}, {8, 8}});
+    renderer.drawTexture(redTexture, sourceRect, {{4, 0}, {8, 8}});
+    renderer.setDrawOrder(std::nullopt);
+    renderer.submitBatch();
+  };
+
+  SECTION("Overlapping draws with different draw orders keep their order") {
+    renderer.setDrawOrder(10);
+    renderer.drawTexture(blueTexture, sourceRect, {{0, 0}, {8, 8}});
+    renderer.setDrawOrder(20);
+    renderer.drawTexture(redTexture, sourceRect, {{4, 0}, {8, 8}});
+    renderer.setDrawOrder(std::nullopt);
+    renderer.submitBatch();
+
+    CHECK(pixelAt(renderer, 2, 2) == BLUE);
+    CHECK(pixelAt(renderer, 6, 2) == RED);
+    CHECK(pixelAt(renderer, 10, 2) == RED);
+  }
+
+  SECTION("Draws without draw order keep their order") {
+    drawBlueThenRed();
+
+    CHECK(pixelAt(renderer, 6, 2) == RED);
+  }
+
+  SECTION("Draws sharing a draw order are grouped by texture") {
+    renderer.setDrawOrder(10);
+    drawBlueThenRed();
+
+    CHECK(pixelAt(renderer, 2, 2) == BLUE);
+    CHECK(pixelAt(renderer, 6, 2) == BLUE);
+    CHECK(pixelAt(renderer, 10, 2) == RED);
+  }
+}
+
+
+TEST_CASE("Water effect only recolors exact palette colors") {
+  Renderer renderer{nullptr, RenderBackend::Software};
+
+  const auto waterColorFor = [&](const base::Color& color) {
+    const auto screen = renderer.createTexture(makeImage(8, 8, color));
+    renderer.drawWaterEffect({{0, 0}, {8, 8}}, screen, std::nullopt);
+    renderer.submitBatch();
+    return pixelAt(renderer, 4, 4);
+  };
+
+  // Palette entries 1 and 0 map to entries 9 and 8, respectively
+  const auto paletteColor = base::Color{60, 60, 60, 255};
+  const auto waterColorForIndex1 = base::Color{0, 0, 121, 255};
+  const auto waterColorForIndex0 = base::Color{0, 60, 0, 255};
+
+  CHECK(waterColorFor(paletteColor) == waterColorForIndex1);
+
+  // Falls into the same lookup table cell as the palette color
+  const auto nonPaletteColor = base::Color{61, 60, 60, 255};
+  CHECK(waterColorFor(nonPaletteColor) == waterColorForIndex0);
+}
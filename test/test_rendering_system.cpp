@@ -0,0 +1,210 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <base/warnings.hpp>
+#include <data/game_traits.hpp>
+#include <engine/rendering_system.hpp>
+#include <engine/texture.hpp>
+#include <engine/tile_debris_system.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <memory>
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine;
+
+using components::Sprite;
+using components::WorldPosition;
+
+namespace ex = entityx;
+
+
+namespace {
+
+const auto BLACK = base::Color{0, 0, 0, 255};
+const auto TRANSPARENT = base::Color{0, 0, 0, 0};
+
+
+data::Image makeImage(
+  const int width,
+  const int height,
+  const base::Color& color
+) {
+  return data::Image{
+    data::PixelBuffer(std::size_t(width * height), color),
+    std::size_t(width),
+    std::size_t(height)};
+}
+
+
+data::map::LevelData makeEmptyLevel() {
+  using CZone = data::GameTraits::CZone;
+
+  const auto tileSize = data::GameTraits::tileSize;
+  const auto viewPortSize = data::GameTraits::inGameViewPortSize;
+
+  return data::map::LevelData{
+    makeImage(
+      CZone::tileSetImageWidth * tileSize,
+      CZone::tileSetImageHeight * tileSize,
+      TRANSPARENT),
+    makeImage(viewPortSize.width, viewPortSize.height, BLACK),
+    std::nullopt,
+    data::map::Map{},
+    {},
+    data::map::BackdropScrollMode::None,
+    data::map::BackdropSwitchCondition::None,
+    false,
+    {}};
+}
+
+
+/** Sets up a RenderingSystem drawing an empty map */
+struct RenderingSystemFixture {
+  RenderingSystemFixture()
+    : mMap(64, 32, data::map::TileAttributeDict{
+        data::map::TileAttributeDict::AttributeArray(
+          data::GameTraits::CZone::numTilesTotal, 0)})
+    , mRenderingSystem(
+        &mCameraPosition,
+        &mRenderer,
+        &mMap,
+        MapRenderer::MapRenderData{makeEmptyLevel()},
+        &mTileDebris,
+        mEntityX.entities,
+        mEntityX.events)
+  {
+  }
+
+  /** Create a sprite filled with a single color, 2 by 1 tiles in size */
+  ex::Entity createSprite(
+    const base::Color& color,
+    const int drawOrder,
+    const base::Vector& position
+  ) {
+    const auto tileSize = data::GameTraits::tileSize;
+    auto& texture = mTextures.emplace_back(std::make_unique<OwningTexture>(
+      &mRenderer, makeImage(tileSize * 2, tileSize, color)));
+
+    auto& drawData = mDrawData.emplace_back(
+      std::make_unique<SpriteDrawData>());
+    drawData->mFrames.emplace_back(TextureRegion{*texture}, base::Vector{});
+    drawData->mDrawOrder = drawOrder;
+
+    auto entity = mEntityX.entities.create();
+    entity.assign<Sprite>(drawData.get(), std::vector<int>{0});
+    entity.assign<WorldPosition>(position);
+    return entity;
+  }
+
+  /** Render, then return color at the center of given tile on screen */
+  base::Color colorAtTile(const int x, const int y) {
+    const auto tileSize = data::GameTraits::tileSize;
+    const auto frame = mRenderer.frameBufferContents();
+    REQUIRE(frame);
+
+    const auto pixelX = std::size_t(x * tileSize + tileSize / 2);
+    const auto pixelY = std::size_t(y * tileSize + tileSize / 2);
+    return frame->pixelData()[pixelX + pixelY * frame->width()];
+  }
+
+  void render() {
+    mRenderingSystem.update(mEntityX.entities, std::nullopt);
+    mRenderer.submitBatch();
+  }
+
+  Renderer mRenderer{nullptr, RenderBackend::Software};
+  ex::EntityX mEntityX;
+  data::map::Map mMap;
+  base::Vector mCameraPosition;
+  TileDebrisSystem mTileDebris;
+  std::vector<std::unique_ptr<OwningTexture>> mTextures;
+  std::vector<std::unique_ptr<SpriteDrawData>> mDrawData;
+  RenderingSystem mRenderingSystem;
+};
+
+}
+
+
+TEST_CASE("Rendering system draws sprites by draw order") {
+  RenderingSystemFixture fixture;
+
+  const auto ORDER_0_COLOR = base::Color{255, 0, 0, 255};
+  const auto ORDER_20_COLOR = base::Color{0, 255, 0, 255};
+  const auto ORDER_50_COLOR = base::Color{0, 0, 255, 255};
+  const auto ORDER_70_COLOR = base::Color{255, 255, 0, 255};
+
+  // Each sprite overlaps the right half of the previous one. Entities are
+  // created in reverse, so that entity order doesn't match draw order.
+  // Draw orders are as produced by adjustedDrawOrder(): Regular actors,
+  // player projectiles and effects.
+  fixture.createSprite(ORDER_70_COLOR, 70, {3, 5});
+  fixture.createSprite(ORDER_50_COLOR, 50, {2, 5});
+  fixture.createSprite(ORDER_20_COLOR, 20, {1, 5});
+  fixture.createSprite(ORDER_0_COLOR, 0, {0, 5});
+
+  fixture.render();
+
+  CHECK(fixture.colorAtTile(0, 5) == ORDER_0_COLOR);
+  CHECK(fixture.colorAtTile(1, 5) == ORDER_20_COLOR);
+  CHECK(fixture.colorAtTile(2, 5) == ORDER_50_COLOR);
+  CHECK(fixture.colorAtTile(3, 5) == ORDER_70_COLOR);
+  CHECK(fixture.colorAtTile(4, 5) == ORDER_70_COLOR);
+  CHECK(fixture.mRenderingSystem.spritesRendered() == 4);
+}
+
+
+TEST_CASE("Rendering system orders unusual draw orders correctly") {
+  RenderingSystemFixture fixture;
+
+  const auto COLORS = std::vector<base::Color>{
+    {255, 0, 0, 255},
+    {0, 255, 0, 255},
+    {0, 0, 255, 255},
+    {255, 255, 0, 255},
+    {0, 255, 255, 255},
+    {255, 0, 255, 255}};
+
+  // As in the test above, each sprite should end up being drawn on top of
+  // the one to its left. Entities are created in reverse.
+  auto topMost = fixture.createSprite(COLORS[5], -1, {5, 5});
+  topMost.assign<components::DrawTopMost>();
+
+  fixture.createSprite(COLORS[4], 100, {4, 5});
+  fixture.createSprite(COLORS[3], 70, {3, 5});
+
+  // The colored contents of destroyed bonus globes use an unscaled override
+  auto overridden = fixture.createSprite(COLORS[2], 60, {2, 5});
+  overridden.assign<components::OverrideDrawOrder>(7);
+
+  // The bomber plane's bomb
+  fixture.createSprite(COLORS[1], -1, {1, 5});
+
+  fixture.createSprite(COLORS[0], -5, {0, 5});
+
+  fixture.render();
+
+  for (auto i = 0; i < 6; ++i) {
+    CHECK(fixture.colorAtTile(i, 5) == COLORS[i]);
+  }
+  CHECK(fixture.colorAtTile(6, 5) == COLORS[5]);
+  CHECK(fixture.mRenderingSystem.spritesRendered() == 6);
+}
@@ -0,0 +1,158 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <engine/software_renderer.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+using namespace rigel;
+using namespace engine;
+
+
+namespace {
+
+const auto WHITE = base::Color{255, 255, 255, 255};
+const auto BLACK = base::Color{0, 0, 0, 255};
+const auto GREEN = base::Color{0, 255, 0, 255};
+const auto NO_OVERLAY = base::Color{};
+
+
+data::Image makeImage(
+  const int width,
+  const int height,
+  const base::Color& color
+) {
+  return data::Image{
+    data::PixelBuffer(std::size_t(width * height), color),
+    std::size_t(width),
+    std::size_t(height)};
+}
+
+
+base::Color pixelAt(const SoftwareRenderer& renderer, const int x, const int y) {
+  const auto frameBuffer = renderer.frameBuffer();
+  return frameBuffer.pixelData()[x + y * frameBuffer.width()];
+}
+
+}
+
+
+namespace rigel::base {
+
+std::ostream& operator<<(std::ostream& stream, const Color& color) {
+  stream
+    << '(' << int(color.r) << ", " << int(color.g) << ", " << int(color.b)
+    << ", " << int(color.a) << ')';
+  return stream;
+}
+
+}
+
+
+TEST_CASE("Software renderer") {
+  SoftwareRenderer renderer{16, 8};
+  renderer.clear(BLACK);
+
+  SECTION("Opaque texture replaces frame buffer contents") {
+    const auto color = base::Color{10, 20, 30, 255};
+    const auto texture = renderer.createTexture(makeImage(7, 3, color));
+    renderer.drawTexture(
+      texture, {{0, 0}, {7, 3}}, {{2, 1}, {7, 3}}, NO_OVERLAY, WHITE);
+
+    CHECK(pixelAt(renderer, 2, 1) == color);
+    CHECK(pixelAt(renderer, 8, 3) == color);
+    CHECK(pixelAt(renderer, 9, 3) == BLACK);
+    CHECK(pixelAt(renderer, 2, 4) == BLACK);
+  }
+
+  SECTION("Transparent pixels leave frame buffer unchanged") {
+    const auto texture = renderer.createTexture(makeImage(8, 1, {255, 0, 0, 0}));
+    renderer.drawTexture(
+      texture, {{0, 0}, {8, 1}}, {{0, 0}, {8, 1}}, NO_OVERLAY, WHITE);
+
+    for (auto x = 0; x < 8; ++x) {
+      CHECK(pixelAt(renderer, x, 0) == BLACK);
+    }
+  }
+
+  SECTION("Translucent pixels are blended") {
+    const auto texture =
+      renderer.createTexture(makeImage(9, 1, {255, 255, 255, 128}));
+    renderer.drawTexture(
+      texture, {{0, 0}, {9, 1}}, {{0, 0}, {9, 1}}, NO_OVERLAY, WHITE);
+
+    // All pixels have to get the same result, no matter if they were handled
+    // by the vectorized or the scalar code path
+    const auto expected = base::Color{128, 128, 128, 191};
+    for (auto x = 0; x < 9; ++x) {
+      CHECK(pixelAt(renderer, x, 0) == expected);
+    }
+  }
+
+  SECTION("Color modulation is applied") {
+    const auto texture = renderer.createTexture(makeImage(2, 1, WHITE));
+    renderer.drawTexture(
+      texture, {{0, 0}, {2, 1}}, {{0, 0}, {2, 1}}, NO_OVERLAY, {255, 0, 0, 255});
+
+    const auto expected = base::Color{255, 0, 0, 255};
+    CHECK(pixelAt(renderer, 0, 0) == expected);
+    CHECK(pixelAt(renderer, 1, 0) == expected);
+  }
+
+  SECTION("Clip rect limits drawing") {
+    const auto texture = renderer.createTexture(makeImage(16, 8, WHITE));
+    renderer.setClipRect(base::Rect<int>{{4, 2}, {2, 2}});
+    renderer.drawTexture(
+      texture, {{0, 0}, {16, 8}}, {{0, 0}, {16, 8}}, NO_OVERLAY, WHITE);
+
+    CHECK(pixelAt(renderer, 4, 2) == WHITE);
+    CHECK(pixelAt(renderer, 5, 3) == WHITE);
+    CHECK(pixelAt(renderer, 3, 2) == BLACK);
+    CHECK(pixelAt(renderer, 6, 3) == BLACK);
+    CHECK(pixelAt(renderer, 4, 4) == BLACK);
+  }
+
+  SECTION("Render targets are drawn into and can be used as texture") {
+    const auto targetTexture = renderer.createTexture(4, 4);
+    const auto target = renderer.createRenderTarget(targetTexture);
+
+    renderer.setRenderTarget(target);
+    renderer.clear(GREEN);
+    renderer.setRenderTarget(0);
+
+    CHECK(pixelAt(renderer, 0, 0) == BLACK);
+
+    renderer.drawTexture(
+      targetTexture, {{0, 0}, {4, 4}}, {{8, 0}, {8, 8}}, NO_OVERLAY, WHITE);
+
+    CHECK(pixelAt(renderer, 7, 0) == BLACK);
+    CHECK(pixelAt(renderer, 8, 0) == GREEN);
+    CHECK(pixelAt(renderer, 15, 7) == GREEN);
+  }
+
+  SECTION("Lines include both end points") {
+    renderer.drawLine({1, 1}, {4, 1}, WHITE);
+
+    CHECK(pixelAt(renderer, 0, 1) == BLACK);
+    CHECK(pixelAt(renderer, 1, 1) == WHITE);
+    CHECK(pixelAt(renderer, 4, 1) == WHITE);
+    CHECK(pixelAt(renderer, 5, 1) == BLACK);
+  }
+}
@@ -0,0 +1,280 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <base/warnings.hpp>
+#include <engine/physical_components.hpp>
+#include <engine/spatial_index.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine;
+using namespace engine::components;
+
+namespace ex = entityx;
+
+
+namespace {
+
+const auto MAP_WIDTH = 64;
+const auto MAP_HEIGHT = 32;
+
+
+bool overlaps(ex::Entity entity, const BoundingBox& area) {
+  return
+    entity.valid() &&
+    entity.has_component<WorldPosition>() &&
+    entity.has_component<BoundingBox>() &&
+    toWorldSpace(
+      *entity.component<BoundingBox>(),
+      *entity.component<WorldPosition>()).intersects(area);
+}
+
+
+/** What the index replaces: A full scan over all entities */
+std::vector<ex::Entity> bruteForceQuery(
+  ex::EntityManager& entities,
+  const BoundingBox& area
+) {
+  std::vector<ex::Entity> result;
+  entities.each<WorldPosition, BoundingBox>(
+    [&](ex::Entity entity, const WorldPosition&, const BoundingBox&) {
+      if (overlaps(entity, area)) {
+        result.push_back(entity);
+      }
+    });
+  return result;
+}
+
+
+std::vector<ex::Entity> indexQuery(
+  const SpatialIndex& index,
+  const BoundingBox& area
+) {
+  std::vector<ex::Entity> result;
+  index.forEachCandidate(area, [&](ex::Entity entity) {
+    if (overlaps(entity, area)) {
+      result.push_back(entity);
+    }
+  });
+  return result;
+}
+
+
+// Simple deterministic pseudo-random numbers, good enough for test data
+struct NumberSequence {
+  int next(const int min, const int max) {
+    mState = mState * 1103515245u + 12345u;
+    return min + int((mState >> 16) % std::uint32_t(max - min + 1));
+  }
+
+  std::uint32_t mState = 42;
+};
+
+
+ex::Entity createEntityAt(
+  ex::EntityManager& entities,
+  const base::Vector& position,
+  const base::Extents& size
+) {
+  auto entity = entities.create();
+  entity.assign<WorldPosition>(position);
+  entity.assign<BoundingBox>(BoundingBox{{0, 0}, size});
+  return entity;
+}
+
+
+ex::Entity createRandomEntity(
+  ex::EntityManager& entities,
+  NumberSequence& numbers
+) {
+  // Some entities are partially or entirely outside of the map
+  const auto position = base::Vector{
+    numbers.next(-10, MAP_WIDTH + 10),
+    numbers.next(-5, MAP_HEIGHT + 5)};
+  const auto size = base::Extents{numbers.next(1, 12), numbers.next(1, 6)};
+  return createEntityAt(entities, position, size);
+}
+
+
+std::vector<BoundingBox> queryAreas(NumberSequence& numbers) {
+  std::vector<BoundingBox> areas;
+  for (auto i = 0; i < 200; ++i) {
+    areas.push_back(BoundingBox{
+      {numbers.next(-15, MAP_WIDTH + 5), numbers.next(-10, MAP_HEIGHT + 5)},
+      {numbers.next(1, 20), numbers.next(1, 12)}});
+  }
+
+  // Whole map, and more
+  areas.push_back(BoundingBox{{-20, -20}, {MAP_WIDTH + 40, MAP_HEIGHT + 40}});
+  return areas;
+}
+
+
+void checkMatchesBruteForce(
+  const SpatialIndex& index,
+  ex::EntityManager& entities,
+  const std::vector<BoundingBox>& areas
+) {
+  for (const auto& area : areas) {
+    const auto expected = bruteForceQuery(entities, area);
+    const auto actual = indexQuery(index, area);
+    REQUIRE(actual == expected);
+  }
+}
+
+}
+
+
+TEST_CASE("Spatial index queries match a full scan over all entities") {
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+
+  SpatialIndex index{MAP_WIDTH, MAP_HEIGHT, entityx.events};
+
+  NumberSequence numbers;
+  std::vector<ex::Entity> createdEntities;
+  for (auto i = 0; i < 300; ++i) {
+    createdEntities.push_back(createRandomEntity(entities, numbers));
+  }
+
+  const auto areas = queryAreas(numbers);
+
+  index.rebuild(entities);
+
+  SECTION("Right after rebuilding") {
+    checkMatchesBruteForce(index, entities, areas);
+  }
+
+  SECTION("Entities destroyed after rebuilding") {
+    for (auto i = 0u; i < createdEntities.size(); i += 3) {
+      createdEntities[i].destroy();
+    }
+
+    checkMatchesBruteForce(index, entities, areas);
+  }
+
+  SECTION("Entities created after rebuilding") {
+    for (auto i = 0; i < 20; ++i) {
+      createRandomEntity(entities, numbers);
+    }
+
+    checkMatchesBruteForce(index, entities, areas);
+  }
+
+  SECTION("Entities created in free slots after rebuilding") {
+    // The new entities re-use the slots of destroyed ones, so they end up in
+    // between existing entities in iteration order.
+    for (auto i = 0u; i < createdEntities.size(); i += 5) {
+      createdEntities[i].destroy();
+    }
+    for (auto i = 0; i < 30; ++i) {
+      createRandomEntity(entities, numbers);
+    }
+
+    checkMatchesBruteForce(index, entities, areas);
+  }
+
+  SECTION("Entity created while a query is running") {
+    const auto area = BoundingBox{{0, 0}, {MAP_WIDTH, MAP_HEIGHT}};
+
+    auto hasCreated = false;
+    index.forEachCandidate(area, [&](ex::Entity) {
+      if (!hasCreated) {
+        createEntityAt(entities, {10, 10}, {2, 2});
+        hasCreated = true;
+      }
+    });
+
+    // Not visited by the ongoing query, but by the next one
+    checkMatchesBruteForce(index, entities, {area});
+  }
+
+  SECTION("Components assigned one after the other") {
+    auto entity = entities.create();
+    entity.assign<BoundingBox>(BoundingBox{{0, 0}, {3, 3}});
+
+    checkMatchesBruteForce(index, entities, areas);
+
+    entity.assign<WorldPosition>(20, 10);
+
+    checkMatchesBruteForce(index, entities, areas);
+  }
+
+  SECTION("Bounding box re-assigned after rebuilding") {
+    for (auto i = 0u; i < createdEntities.size(); i += 7) {
+      auto entity = createdEntities[i];
+      const auto bbox = *entity.component<BoundingBox>();
+      entity.remove<BoundingBox>();
+      entity.assign<BoundingBox>(bbox);
+    }
+
+    // Each entity is only visited once, despite being in the snapshot as
+    // well as having been added again since
+    checkMatchesBruteForce(index, entities, areas);
+  }
+
+  SECTION("Rebuilding again") {
+    for (auto i = 0u; i < createdEntities.size(); i += 4) {
+      createdEntities[i].destroy();
+    }
+    for (auto i = 0; i < 40; ++i) {
+      createRandomEntity(entities, numbers);
+    }
+
+    index.rebuild(entities);
+
+    checkMatchesBruteForce(index, entities, areas);
+  }
+}
+
+
+TEST_CASE("Spatial index doesn't track entities moved after rebuilding") {
+  // This is a known limitation, see the documentation of SpatialIndex.
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+
+  SpatialIndex index{MAP_WIDTH, MAP_HEIGHT, entityx.events};
+
+  auto entity = createEntityAt(entities, {1, 1}, {2, 2});
+  index.rebuild(entities);
+
+  const auto farAwayArea = BoundingBox{{40, 20}, {4, 4}};
+
+  SECTION("Moving within the cells known to the index") {
+    *entity.component<WorldPosition>() = WorldPosition{4, 4};
+
+    const auto result = indexQuery(index, BoundingBox{{4, 3}, {1, 1}});
+    CHECK(result == std::vector<ex::Entity>{entity});
+  }
+
+  SECTION("Moving to a different cell") {
+    *entity.component<WorldPosition>() = WorldPosition{41, 21};
+
+    CHECK(indexQuery(index, farAwayArea).empty());
+    CHECK(bruteForceQuery(entities, farAwayArea).size() == 1);
+
+    index.rebuild(entities);
+
+    CHECK(indexQuery(index, farAwayArea).size() == 1);
+  }
+}
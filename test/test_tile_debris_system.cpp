@@ -0,0 +1,192 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <base/spatial_types_printing.hpp>
+#include <base/warnings.hpp>
+#include <engine/tile_debris_system.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine;
+
+
+namespace {
+
+// The order in which IngameSystems::update() invokes the debris system
+void runFrame(TileDebrisSystem& debris) {
+  debris.updatePhase1();
+  debris.updateLifeTime();
+  debris.updatePhase2();
+}
+
+}
+
+
+TEST_CASE("Tile debris follows the movement sequence") {
+  TileDebrisSystem debris;
+
+  SECTION("Starting at the beginning of the sequence") {
+    debris.spawnDebris({0, 20}, 1, 1, 0);
+
+    // Once the sequence has finished, the last velocity is kept
+    const auto expectedVelocitiesY =
+      std::vector<int>{-3, -3, -2, -2, -1, 0, 0, 1, 2, 2, 3, 3, 3};
+
+    auto expectedPosition = base::Vector{0, 20};
+    for (const auto velocityY : expectedVelocitiesY) {
+      runFrame(debris);
+      expectedPosition += base::Vector{1, velocityY};
+
+      REQUIRE(debris.size() == 1);
+      CHECK(debris.positions()[0] == expectedPosition);
+      CHECK(debris.velocitiesX()[0] == 1);
+      CHECK(debris.velocitiesY()[0] == velocityY);
+    }
+  }
+
+  SECTION("Starting at an offset into the sequence") {
+    debris.spawnDebris({10, 20}, 1, -2, 9);
+
+    runFrame(debris);
+    CHECK(debris.positions()[0] == (base::Vector{8, 22}));
+
+    runFrame(debris);
+    CHECK(debris.positions()[0] == (base::Vector{6, 25}));
+
+    runFrame(debris);
+    CHECK(debris.positions()[0] == (base::Vector{4, 28}));
+  }
+}
+
+
+TEST_CASE("Tile debris moves in the same physics phase as entities would") {
+  TileDebrisSystem debris;
+
+  SECTION("Debris existing before phase 1 moves in phase 1") {
+    debris.spawnDebris({0, 20}, 1, 1, 0);
+
+    debris.updatePhase1();
+    CHECK(debris.positions()[0] == (base::Vector{1, 17}));
+
+    debris.updateLifeTime();
+    debris.updatePhase2();
+    CHECK(debris.positions()[0] == (base::Vector{1, 17}));
+  }
+
+  SECTION("Debris spawned after phase 1 moves in phase 2 of the same frame") {
+    debris.updatePhase1();
+    debris.spawnDebris({0, 20}, 1, 1, 0);
+
+    debris.updateLifeTime();
+    CHECK(debris.positions()[0] == (base::Vector{0, 20}));
+
+    debris.updatePhase2();
+    CHECK(debris.positions()[0] == (base::Vector{1, 17}));
+
+    // From then on, it moves once per frame, in phase 1
+    debris.updatePhase1();
+    CHECK(debris.positions()[0] == (base::Vector{2, 14}));
+
+    debris.updateLifeTime();
+    debris.updatePhase2();
+    CHECK(debris.positions()[0] == (base::Vector{2, 14}));
+  }
+
+  SECTION("Debris spawned after phase 2 moves in the next phase 1") {
+    runFrame(debris);
+    debris.spawnDebris({0, 20}, 1, 1, 0);
+
+    debris.updatePhase1();
+    CHECK(debris.positions()[0] == (base::Vector{1, 17}));
+  }
+}
+
+
+TEST_CASE("Tile debris expires after 80 frames") {
+  // This matches the AutoDestroy::afterTimeout(80) which debris entities
+  // used to have: the life time system lets them live for 80 updates,
+  // and removes them on the following update.
+  TileDebrisSystem debris;
+
+  SECTION("Spawned before the frame starts") {
+    debris.spawnDebris({0, 20}, 1, 1, 0);
+
+    for (auto i = 0; i < 80; ++i) {
+      runFrame(debris);
+    }
+    CHECK(debris.size() == 1);
+
+    runFrame(debris);
+    CHECK(debris.size() == 0);
+  }
+
+  SECTION("Spawned between phase 1 and the life time update") {
+    debris.updatePhase1();
+    debris.spawnDebris({0, 20}, 1, 1, 0);
+    debris.updateLifeTime();
+    debris.updatePhase2();
+
+    for (auto i = 0; i < 79; ++i) {
+      runFrame(debris);
+    }
+    CHECK(debris.size() == 1);
+
+    runFrame(debris);
+    CHECK(debris.size() == 0);
+  }
+
+  SECTION("Expiring pieces don't affect the remaining ones") {
+    debris.spawnDebris({0, 20}, 1, 1, 0);
+    for (auto i = 0; i < 40; ++i) {
+      runFrame(debris);
+    }
+
+    debris.spawnDebris({50, 20}, 2, -1, 0);
+    for (auto i = 0; i < 41; ++i) {
+      runFrame(debris);
+    }
+
+    REQUIRE(debris.size() == 1);
+    CHECK(debris.velocitiesX()[0] == -1);
+    CHECK(debris.positions()[0].x == 50 - 41);
+  }
+}
+
+
+TEST_CASE("Tile debris can be cleared") {
+  TileDebrisSystem debris;
+  debris.spawnDebris({0, 20}, 1, 1, 0);
+  debris.spawnDebris({5, 20}, 1, -1, 3);
+  runFrame(debris);
+
+  debris.clear();
+  CHECK(debris.size() == 0);
+  CHECK(debris.positions().empty());
+
+  runFrame(debris);
+  CHECK(debris.size() == 0);
+
+  debris.spawnDebris({0, 20}, 1, 1, 0);
+  runFrame(debris);
+  REQUIRE(debris.size() == 1);
+  CHECK(debris.positions()[0] == (base::Vector{1, 17}));
+}
@@ -0,0 +1,147 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <base/warnings.hpp>
+#include <engine/timer_wheel.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine;
+
+
+namespace {
+
+using Wheel = TimerWheel<int>;
+
+
+std::vector<int> advance(Wheel& wheel) {
+  std::vector<int> fired;
+  wheel.advance([&](const int value) { fired.push_back(value); });
+  std::sort(fired.begin(), fired.end());
+  return fired;
+}
+
+}
+
+
+TEST_CASE("Timer wheel fires timers at their due tick") {
+  Wheel wheel;
+
+  SECTION("Nothing fires when empty") {
+    CHECK(advance(wheel).empty());
+    CHECK(wheel.currentTick() == 1);
+  }
+
+  SECTION("Timers fire exactly once") {
+    wheel.schedule(1, 10);
+    wheel.schedule(3, 30);
+    wheel.schedule(3, 31);
+    CHECK(wheel.size() == 3);
+
+    CHECK(advance(wheel) == std::vector<int>{10});
+    CHECK(advance(wheel).empty());
+    CHECK(advance(wheel) == (std::vector<int>{30, 31}));
+    CHECK(advance(wheel).empty());
+    CHECK(wheel.size() == 0);
+  }
+
+  SECTION("Timers which are already due fire on the next advance") {
+    advance(wheel);
+    advance(wheel);
+    wheel.schedule(0, 1);
+    wheel.schedule(2, 2);
+
+    CHECK(advance(wheel) == (std::vector<int>{1, 2}));
+  }
+
+  SECTION("Timers scheduled while firing are handled") {
+    wheel.schedule(1, 1);
+
+    std::vector<int> fired;
+    wheel.advance([&](const int value) {
+      fired.push_back(value);
+      wheel.schedule(wheel.currentTick(), 2);
+      wheel.schedule(wheel.currentTick() + 1, 3);
+    });
+
+    CHECK(fired == std::vector<int>{1});
+    CHECK(advance(wheel) == (std::vector<int>{2, 3}));
+  }
+
+  SECTION("Timers far in the future are moved down through all levels") {
+    const auto farAway = Wheel::Tick{64 * 64 * 64 + 100};
+    wheel.schedule(farAway, 1);
+    wheel.schedule(farAway + 1, 2);
+
+    std::vector<Wheel::Tick> firingTicks;
+    while (wheel.currentTick() < farAway + 10) {
+      if (!advance(wheel).empty()) {
+        firingTicks.push_back(wheel.currentTick());
+      }
+    }
+
+    CHECK(firingTicks == (std::vector<Wheel::Tick>{farAway, farAway + 1}));
+  }
+}
+
+
+TEST_CASE("Timer wheel matches naive countdown") {
+  std::mt19937 randomGenerator{42};
+  std::uniform_int_distribution<int> shortDelays{0, 100};
+  std::uniform_int_distribution<int> longDelays{0, 20000};
+
+  Wheel wheel;
+
+  struct Expected {
+    Wheel::Tick mDueTick;
+    int mValue;
+  };
+  std::vector<Expected> expected;
+
+  auto nextValue = 0;
+  for (int tick = 0; tick < 30000; ++tick) {
+    if (tick % 3 == 0) {
+      const auto delay = tick % 2 == 0
+        ? shortDelays(randomGenerator)
+        : longDelays(randomGenerator);
+      const auto dueTick = std::max(
+        wheel.currentTick() + 1,
+        wheel.currentTick() + static_cast<Wheel::Tick>(delay));
+      wheel.schedule(dueTick, nextValue);
+      expected.push_back({dueTick, nextValue});
+      ++nextValue;
+    }
+
+    const auto fired = advance(wheel);
+
+    std::vector<int> expectedNow;
+    for (const auto& timer : expected) {
+      if (timer.mDueTick == wheel.currentTick()) {
+        expectedNow.push_back(timer.mValue);
+      }
+    }
+
+    REQUIRE(fired == expectedNow);
+  }
+}
@@ -0,0 +1,185 @@
+/* Copyright (C) 2019, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <base/warnings.hpp>
+#include <engine/base_components.hpp>
+#include <engine/physical_components.hpp>
+#include <engine/tile_debris_system.hpp>
+#include <game_logic/damage_components.hpp>
+#include <game_logic/world_state_hash.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <sstream>
+
+
+using namespace rigel;
+using namespace game_logic;
+
+using engine::components::MovingBody;
+using engine::components::WorldPosition;
+using game_logic::components::Shootable;
+
+namespace ex = entityx;
+
+
+TEST_CASE("World state hash attributes changes to the right part") {
+  data::map::Map map{20, 10, data::map::TileAttributeDict{{0, 0}}};
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+  data::PlayerModel playerModel;
+  engine::RandomNumberGenerator randomGenerator;
+  engine::TileDebrisSystem tileDebris;
+
+  auto entity = entities.create();
+  entity.assign<WorldPosition>(3, 4);
+  entity.assign<MovingBody>(base::Point<float>{1.0f, 0.0f}, true);
+  entity.assign<Shootable>(5);
+
+  const auto hash = [&]() {
+    return hashWorldState(
+      map, entities, tileDebris, playerModel, randomGenerator);
+  };
+
+  const auto original = hash();
+
+  SECTION("Unchanged state gives same hash") {
+    const auto again = hash();
+    CHECK(!findFirstDivergence({original}, {again}));
+  }
+
+  SECTION("Map tiles") {
+    map.setTileAt(1, 5, 5, 1);
+
+    const auto divergence = findFirstDivergence({original}, {hash()});
+    REQUIRE(divergence);
+    CHECK(divergence->mDifferingParts == std::vector<std::string>{
+      "map tiles"});
+  }
+
+  SECTION("Entity positions") {
+    entity.component<WorldPosition>()->x += 1;
+
+    const auto divergence = findFirstDivergence({original}, {hash()});
+    REQUIRE(divergence);
+    CHECK(divergence->mDifferingParts == std::vector<std::string>{
+      "entity positions"});
+  }
+
+  SECTION("Entity velocities and health") {
+    entity.component<MovingBody>()->mVelocity.y = 0.5f;
+    entity.component<Shootable>()->mHealth -= 1;
+
+    const auto divergence = findFirstDivergence({original}, {hash()});
+    REQUIRE(divergence);
+    const auto expectedParts =
+      std::vector<std::string>{"entity velocities", "entity health"};
+    CHECK(divergence->mDifferingParts == expectedParts);
+  }
+
+  SECTION("Tile debris") {
+    tileDebris.spawnDebris({3, 4}, 1, 1, 0);
+
+    const auto withDebris = hash();
+    const auto divergence = findFirstDivergence({original}, {withDebris});
+    REQUIRE(divergence);
+    const auto expectedParts =
+      std::vector<std::string>{"entity positions", "entity velocities"};
+    CHECK(divergence->mDifferingParts == expectedParts);
+
+    SECTION("Moving debris changes the position hash") {
+      tileDebris.updatePhase1();
+      tileDebris.updatePhase2();
+
+      const auto moved = findFirstDivergence({withDebris}, {hash()});
+      REQUIRE(moved);
+      CHECK(moved->mDifferingParts.front() == "entity positions");
+    }
+  }
+
+  SECTION("Player model") {
+    playerModel.giveScore(100);
+
+    const auto divergence = findFirstDivergence({original}, {hash()});
+    REQUIRE(divergence);
+    CHECK(divergence->mDifferingParts == std::vector<std::string>{
+      "player model"});
+  }
+
+  SECTION("Random number generator") {
+    randomGenerator.gen();
+
+    const auto divergence = findFirstDivergence({original}, {hash()});
+    REQUIRE(divergence);
+    CHECK(divergence->mDifferingParts == std::vector<std::string>{
+      "random number generator"});
+  }
+}
+
+
+TEST_CASE("World state hash streams") {
+  const auto makeHash = [](const std::uint64_t seed) {
+    return WorldStateHash{
+      seed, seed + 1, seed + 2, 0xFFFFFFFFFFFFFFFFull, 0, seed * 7};
+  };
+
+  const auto hashes = std::vector<WorldStateHash>{
+    makeHash(10), makeHash(20), makeHash(30)};
+
+  SECTION("Streams can be written and read back") {
+    std::stringstream stream;
+    for (std::size_t tick = 0; tick < hashes.size(); ++tick) {
+      writeWorldStateHash(stream, tick, hashes[tick]);
+    }
+
+    const auto parsed = readWorldStateHashes(stream);
+    REQUIRE(parsed.size() == hashes.size());
+    CHECK(!findFirstDivergence(hashes, parsed));
+  }
+
+  SECTION("Malformed streams are rejected") {
+    std::stringstream missingValues("0 1 2 3\n");
+    CHECK_THROWS(readWorldStateHashes(missingValues));
+
+    std::stringstream wrongTick;
+    writeWorldStateHash(wrongTick, 1, hashes[0]);
+    CHECK_THROWS(readWorldStateHashes(wrongTick));
+  }
+
+  SECTION("First divergent tick is reported") {
+    auto otherHashes = hashes;
+    otherHashes[1].mEntityHealth = 0;
+    otherHashes[2].mMapTiles = 0;
+
+    const auto divergence = findFirstDivergence(hashes, otherHashes);
+    REQUIRE(divergence);
+    CHECK(divergence->mTick == 1);
+    CHECK(divergence->mDifferingParts == std::vector<std::string>{
+      "entity health"});
+  }
+
+  SECTION("Different lengths are reported") {
+    const auto shorter =
+      std::vector<WorldStateHash>(hashes.begin(), hashes.begin() + 2);
+
+    const auto divergence = findFirstDivergence(hashes, shorter);
+    REQUIRE(divergence);
+    CHECK(divergence->mTick == 2);
+    CHECK(divergence->mDifferingParts.empty());
+  }
+}
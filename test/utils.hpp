@@ -20,6 +20,7 @@
 #include <data/sound_ids.hpp>
 #include <data/game_session_data.hpp>
 #include <game_logic/ientity_factory.hpp>
+#include <engine/entity_tools.hpp>
 #include <engine/visual_components.hpp>
 
 #include <game_mode.hpp>
@@ -42,6 +43,7 @@ struct MockServiceProvider : public rigel::IGameServiceProvider {
     mLastTriggeredSoundId = id;
   }
   void stopSound(rigel::data::SoundId id) override {}
+  void setSoundsMuted(bool) override {}
 
   void playMusic(const std::string&) override {}
   void stopMusic() override {}
@@ -109,13 +111,34 @@ struct MockEntityFactory : public rigel::game_logic::IEntityFactory {
     return createMockSpriteEntity();
   }
 
+  void initializeSprite(
+    entityx::Entity entity,
+    data::ActorID actorID,
+    const base::Vector& position,
+    bool assignBoundingBox
+  ) override {
+    rigel::engine::assignOrReplace<rigel::engine::components::Sprite>(
+      entity, mockSprite());
+  }
+
+  entityx::Entity spawnPrefab(
+    engine::PrefabId id,
+    const std::function<void(entityx::Entity)>& initialize
+  ) override {
+    auto entity = mpEntityManager->create();
+    initialize(entity);
+    return entity;
+  }
+
 private:
-  entityx::Entity createMockSpriteEntity() {
+  static rigel::engine::components::Sprite mockSprite() {
     static rigel::engine::SpriteDrawData dummyDrawData;
+    return rigel::engine::components::Sprite{&dummyDrawData, {}};
+  }
 
+  entityx::Entity createMockSpriteEntity() {
     auto entity = mpEntityManager->create();
-    rigel::engine::components::Sprite sprite{&dummyDrawData, {}};
-    entity.assign<rigel::engine::components::Sprite>(sprite);
+    entity.assign<rigel::engine::components::Sprite>(mockSprite());
     return entity;
   }
 